@@ -6,8 +6,11 @@
 #include "accumulators.h"
 #include "main.h"
 #include "txdb.h"
+#include "zerocoincache.h"
 #include "libzerocoin/Denominations.h"
 
+#include <boost/thread.hpp>
+
 using namespace libzerocoin;
 using namespace std;
 
@@ -47,17 +50,63 @@ bool AccumulatorMap::Load(uint256 nCheckpoint)
     return true;
 }
 
-//Add a zerocoin to the accumulator of its denomination.
+//Add a zerocoin to the accumulator of its denomination. Pubcoins that already validated are not checked again,
+//fSkipValidation skips the check entirely for coins the caller knows are good.
 bool AccumulatorMap::Accumulate(PublicCoin pubCoin, bool fSkipValidation)
 {
     CoinDenomination denom = pubCoin.getDenomination();
     if (denom == CoinDenomination::ZQ_ERROR)
         return false;
 
-    if (fSkipValidation)
-        mapAccumulators.at(denom)->increment(pubCoin.getValue());
-    else
-        mapAccumulators.at(denom)->accumulate(pubCoin);
+    if (!fSkipValidation && !ValidatePubcoin(pubCoin))
+        return false;
+
+    mapAccumulators.at(denom)->increment(pubCoin.getValue());
+    return true;
+}
+
+//Add a list of zerocoins. Each denomination is accumulated with one exponentiation by the product of its
+//pubcoins, and the denominations are done in parallel. The result is the same as calling Accumulate() on each coin.
+bool AccumulatorMap::AccumulateBatch(const std::list<PublicCoin>& listPubcoins, bool fSkipValidation)
+{
+    map<CoinDenomination, vector<CBigNum> > mapValues;
+    for (const PublicCoin& pubCoin : listPubcoins) {
+        CoinDenomination denom = pubCoin.getDenomination();
+        if (denom == CoinDenomination::ZQ_ERROR)
+            return false;
+
+        if (!fSkipValidation && !ValidatePubcoin(pubCoin))
+            return false;
+
+        mapValues[denom].emplace_back(pubCoin.getValue());
+    }
+
+    map<CoinDenomination, bool> mapResult;
+    for (auto& it : mapValues)
+        mapResult[it.first] = false;
+
+    auto accumulate = [&](CoinDenomination denom) {
+        try {
+            mapAccumulators.at(denom)->incrementBatch(mapValues.at(denom));
+            mapResult.at(denom) = true;
+        } catch (const std::exception& e) {
+            LogPrintf("%s : failed to accumulate denomination %d: %s\n", __func__, denom, e.what());
+        }
+    };
+
+    if (mapValues.size() == 1) {
+        accumulate(mapValues.begin()->first);
+    } else {
+        boost::thread_group threadGroup;
+        for (auto& it : mapValues)
+            threadGroup.create_thread(boost::bind<void>(accumulate, it.first));
+        threadGroup.join_all();
+    }
+
+    for (auto& it : mapResult) {
+        if (!it.second)
+            return false;
+    }
     return true;
 }
 
@@ -16,6 +16,7 @@ public:
     AccumulatorMap();
     bool Load(uint256 nCheckpoint);
     bool Accumulate(libzerocoin::PublicCoin pubCoin, bool fSkipValidation = false);
+    bool AccumulateBatch(const std::list<libzerocoin::PublicCoin>& listPubcoins, bool fSkipValidation = false);
     CBigNum GetValue(libzerocoin::CoinDenomination denom);
     uint256 GetCheckpoint();
     void Reset();
@@ -9,10 +9,95 @@
 #include "txdb.h"
 #include "init.h"
 #include "spork.h"
+#include "sync.h"
+#include "util.h"
 
 using namespace libzerocoin;
 
-std::map<uint32_t, CBigNum> mapAccumulatorValues;
+/**
+ * Accumulator values by checksum, most recently used first. Values are read from the
+ * zerocoin DB on a miss, and the least recently used one is dropped once -accumulatorcache
+ * entries are held.
+ */
+class CAccumulatorValueCache
+{
+private:
+    typedef std::list<std::pair<uint32_t, CBigNum> > list_type;
+    list_type listValues;
+    std::map<uint32_t, list_type::iterator> mapValues;
+    mutable CCriticalSection cs_cache;
+    uint64_t nHits;
+    uint64_t nMisses;
+
+    void Trim(size_t nMaxSize)
+    {
+        while (listValues.size() > nMaxSize) {
+            mapValues.erase(listValues.back().first);
+            listValues.pop_back();
+        }
+    }
+
+public:
+    CAccumulatorValueCache() : nHits(0), nMisses(0) {}
+
+    bool Get(uint32_t nChecksum, CBigNum& bnValue)
+    {
+        LOCK(cs_cache);
+        auto it = mapValues.find(nChecksum);
+        if (it == mapValues.end()) {
+            nMisses++;
+            return false;
+        }
+
+        nHits++;
+        listValues.splice(listValues.begin(), listValues, it->second);
+        bnValue = it->second->second;
+        return true;
+    }
+
+    void Set(uint32_t nChecksum, const CBigNum& bnValue)
+    {
+        int64_t nMaxSize = GetArg("-accumulatorcache", DEFAULT_ACCUMULATOR_CACHE);
+        if (nMaxSize <= 0)
+            return;
+
+        LOCK(cs_cache);
+        auto it = mapValues.find(nChecksum);
+        if (it != mapValues.end()) {
+            it->second->second = bnValue;
+            listValues.splice(listValues.begin(), listValues, it->second);
+            return;
+        }
+
+        listValues.emplace_front(nChecksum, bnValue);
+        mapValues[nChecksum] = listValues.begin();
+        Trim(nMaxSize);
+    }
+
+    void Erase(uint32_t nChecksum)
+    {
+        LOCK(cs_cache);
+        auto it = mapValues.find(nChecksum);
+        if (it == mapValues.end())
+            return;
+
+        listValues.erase(it->second);
+        mapValues.erase(it);
+    }
+
+    CZerocoinCacheStats GetStats() const
+    {
+        LOCK(cs_cache);
+        CZerocoinCacheStats stats;
+        stats.nEntries = listValues.size();
+        stats.nMaxEntries = std::max<int64_t>(0, GetArg("-accumulatorcache", DEFAULT_ACCUMULATOR_CACHE));
+        stats.nHits = nHits;
+        stats.nMisses = nMisses;
+        return stats;
+    }
+};
+
+static CAccumulatorValueCache accumulatorValueCache;
 std::list<uint256> listAccCheckpointsNoDB;
 
 uint32_t ParseChecksum(uint256 nChecksum, CoinDenomination denomination)
@@ -32,19 +117,55 @@ uint32_t GetChecksum(const CBigNum &bnValue)
     return hash.Get32();
 }
 
-bool GetAccumulatorValueFromChecksum(uint32_t nChecksum, bool fMemoryOnly, CBigNum& bnAccValue)
+bool CPubcoinReader::GetPubcoins(const CBlockIndex* pindex, list<PublicCoin>& listPubcoins, bool fFilterInvalid)
 {
-    if (mapAccumulatorValues.count(nChecksum)) {
-        bnAccValue = mapAccumulatorValues.at(nChecksum);
+    int nHeight = pindex->nHeight;
+    if (nHeight < nHeightBufferStart || nHeight >= nHeightBufferEnd) {
+        mapBlockPubcoins.clear();
+        nHeightBufferStart = nHeight;
+        nHeightBufferEnd = nHeight + nReadAhead;
+        if (!zerocoinDB->ReadBlockPubcoinsRange(nHeightBufferStart, nHeightBufferEnd, mapBlockPubcoins))
+            mapBlockPubcoins.clear();
+    }
+
+    auto it = mapBlockPubcoins.find(nHeight);
+    if (it != mapBlockPubcoins.end() && it->second.hashBlock == pindex->GetBlockHash()) {
+        BlockPubcoinsToList(it->second, listPubcoins, fFilterInvalid);
         return true;
     }
 
+    // not indexed yet, read the block and add it to the index
+    CBlock block;
+    if (!ReadBlockFromDisk(block, pindex)) {
+        LogPrintf("%s: failed to read block %d from disk\n", __func__, nHeight);
+        return false;
+    }
+
+    CBlockPubcoins blockPubcoins;
+    if (!BlockToBlockPubcoins(block, blockPubcoins)) {
+        LogPrintf("%s: failed to get zerocoin mintlist from block %d\n", __func__, nHeight);
+        return false;
+    }
+
+    if (chainActive.Contains(pindex))
+        zerocoinDB->WriteBlockPubcoins(nHeight, blockPubcoins);
+
+    BlockPubcoinsToList(blockPubcoins, listPubcoins, fFilterInvalid);
+    return true;
+}
+
+bool GetAccumulatorValueFromChecksum(uint32_t nChecksum, bool fMemoryOnly, CBigNum& bnAccValue)
+{
+    if (accumulatorValueCache.Get(nChecksum, bnAccValue))
+        return true;
+
     if (fMemoryOnly)
         return false;
 
-    if (!zerocoinDB->ReadAccumulatorValue(nChecksum, bnAccValue)) {
+    if (zerocoinDB->ReadAccumulatorValue(nChecksum, bnAccValue))
+        accumulatorValueCache.Set(nChecksum, bnAccValue);
+    else
         bnAccValue = 0;
-    }
 
     return true;
 }
@@ -59,7 +180,12 @@ void AddAccumulatorChecksum(const uint32_t nChecksum, const CBigNum &bnValue, bo
 {
     if(!fMemoryOnly)
         zerocoinDB->WriteAccumulatorValue(nChecksum, bnValue);
-    mapAccumulatorValues.insert(make_pair(nChecksum, bnValue));
+    accumulatorValueCache.Set(nChecksum, bnValue);
+}
+
+CZerocoinCacheStats GetAccumulatorCacheStats()
+{
+    return accumulatorValueCache.GetStats();
 }
 
 void DatabaseChecksums(AccumulatorMap& mapAccumulators)
@@ -76,7 +202,7 @@ void DatabaseChecksums(AccumulatorMap& mapAccumulators)
 bool EraseChecksum(uint32_t nChecksum)
 {
     //erase from both memory and database
-    mapAccumulatorValues.erase(nChecksum);
+    accumulatorValueCache.Erase(nChecksum);
     return zerocoinDB->EraseAccumulatorValue(nChecksum);
 }
 
@@ -110,7 +236,7 @@ bool LoadAccumulatorValuesFromDB(const uint256 nCheckpoint)
                 listAccCheckpointsNoDB.push_back(nCheckpoint);
             return false;
         }
-        mapAccumulatorValues.insert(make_pair(nChecksum, bnValue));
+        accumulatorValueCache.Set(nChecksum, bnValue);
     }
     return true;
 }
@@ -201,6 +327,8 @@ bool CalculateAccumulatorCheckpoint(int nHeight, uint256& nCheckpoint)
         }
     }
 
+    CPubcoinReader pubcoinReader(nHeight - 10 - pindex->nHeight);
+    std::list<PublicCoin> listPubcoinsAll;
     while (pindex->nHeight < nHeight - 10) {
         // checking whether we should stop this process due to a shutdown request
         if (ShutdownRequested()) {
@@ -214,31 +342,25 @@ bool CalculateAccumulatorCheckpoint(int nHeight, uint256& nCheckpoint)
         }
 
         //grab mints from this block
-        CBlock block;
-        if(!ReadBlockFromDisk(block, pindex)) {
-            LogPrint("zero","%s: failed to read block from disk\n", __func__);
-            return false;
-        }
-
         std::list<PublicCoin> listPubcoins;
-        if (!BlockToPubcoinList(block, listPubcoins, fFilterInvalid)) {
-            LogPrint("zero","%s: failed to get zerocoin mintlist from block %n\n", __func__, pindex->nHeight);
+        if (!pubcoinReader.GetPubcoins(pindex, listPubcoins, fFilterInvalid)) {
+            LogPrint("zero","%s: failed to get zerocoin mintlist from block %d\n", __func__, pindex->nHeight);
             return false;
         }
 
         nTotalMintsFound += listPubcoins.size();
         LogPrint("zero", "%s found %d mints\n", __func__, listPubcoins.size());
 
-        //add the pubcoins to accumulator
-        for (const PublicCoin pubcoin : listPubcoins) {
-            if(!mapAccumulators.Accumulate(pubcoin, true)) {
-                LogPrintf("%s: failed to add pubcoin to accumulator at height %n\n", __func__, pindex->nHeight);
-                return false;
-            }
-        }
+        listPubcoinsAll.splice(listPubcoinsAll.end(), listPubcoins);
         pindex = chainActive.Next(pindex);
     }
 
+    //add the pubcoins to accumulator
+    if (!mapAccumulators.AccumulateBatch(listPubcoinsAll, true)) {
+        LogPrintf("%s: failed to add pubcoins to accumulator at height %d\n", __func__, nHeight);
+        return false;
+    }
+
     // if there were no new mints found, the accumulator checkpoint will be the same as the last checkpoint
     if (nTotalMintsFound == 0) {
         nCheckpoint = chainActive[nHeight - 1]->nAccumulatorCheckpoint;
@@ -258,7 +380,21 @@ bool InvalidCheckpointRange(int nHeight)
     return nHeight > Params().Zerocoin_Block_LastGoodCheckpoint() && nHeight < Params().Zerocoin_Block_RecalculateAccumulators();
 }
 
-bool GenerateAccumulatorWitness(const PublicCoin &coin, Accumulator& accumulator, AccumulatorWitness& witness, int nSecurityLevel, int& nMintsAdded, string& strError)
+int GetWitnessHeightEnd(int nChainHeight)
+{
+    // at least two checkpoints deep
+    return nChainHeight - (nChainHeight % 10) - 20;
+}
+
+bool IsWitnessDataOnChain(const CWitnessData& data)
+{
+    if (data.IsNull() || data.nHeightNext < 1 || data.nHeightNext > chainActive.Height() + 1)
+        return false;
+
+    return chainActive[data.nHeightNext - 1]->GetBlockHash() == data.hashBlockLast;
+}
+
+bool InitWitnessData(const PublicCoin& coin, CWitnessData& data)
 {
     uint256 txid;
     if (!zerocoinDB->ReadCoinMint(coin.getValue(), txid)) {
@@ -273,6 +409,11 @@ bool GenerateAccumulatorWitness(const PublicCoin &coin, Accumulator& accumulator
         return false;
     }
 
+    if (!mapBlockIndex.count(hashBlock) || !chainActive.Contains(mapBlockIndex[hashBlock])) {
+        LogPrint("zero","%s mint tx is not in the active chain\n", __func__);
+        return false;
+    }
+
     int nHeightMintAdded= mapBlockIndex[hashBlock]->nHeight;
     uint256 nCheckpointBeforeMint = 0;
     CBlockIndex* pindex = chainActive[nHeightMintAdded];
@@ -311,14 +452,97 @@ bool GenerateAccumulatorWitness(const PublicCoin &coin, Accumulator& accumulator
     }
 
     //Get the accumulator that is right before the cluster of blocks containing our mint was added to the accumulator
+    Accumulator accumulator(Params().Zerocoin_Params(), coin.getDenomination());
     CBigNum bnAccValue = 0;
     if (GetAccumulatorValueFromDB(nCheckpointBeforeMint, coin.getDenomination(), bnAccValue)) {
-        if (bnAccValue > 0) {
+        if (bnAccValue > 0)
             accumulator.setValue(bnAccValue);
-            witness.resetValue(accumulator, coin);
+    }
+
+    data.SetNull();
+    data.bnPubcoin = coin.getValue();
+    data.denom = coin.getDenomination();
+    data.nHeightMint = nHeightMintAdded;
+    data.nHeightAccStart = nAccStartHeight;
+    data.nHeightNext = nAccStartHeight;
+    data.hashBlockLast = chainActive[nAccStartHeight - 1]->GetBlockHash();
+    data.bnWitness = accumulator.getValue();
+    return true;
+}
+
+// Whether blocks up to data.nHeightNext would all have been added by a witness generated with these limits
+static bool CanResumeWitness(const CWitnessData& data, const PublicCoin& coin, int nHeightStop, int nSecurityLevel)
+{
+    if (data.bnPubcoin != coin.getValue() || data.denom != coin.getDenomination())
+        return false;
+
+    if (!IsWitnessDataOnChain(data) || data.nHeightNext > nHeightStop)
+        return false;
+
+    return nSecurityLevel == 100 || data.nCheckpointsAdded < nSecurityLevel;
+}
+
+bool AdvanceWitnessData(const std::vector<CWitnessData*>& vData, int nHeightEnd)
+{
+    if (vData.empty())
+        return true;
+
+    int nHeightStart = nHeightEnd;
+    for (const CWitnessData* pdata : vData)
+        nHeightStart = std::min(nHeightStart, pdata->nHeightNext);
+
+    CPubcoinReader pubcoinReader;
+    for (CBlockIndex* pindex = chainActive[nHeightStart]; pindex && pindex->nHeight < nHeightEnd; pindex = chainActive.Next(pindex)) {
+        // checking whether we should stop this process due to a shutdown request
+        if (ShutdownRequested())
+            return false;
+
+        // get the block's mints once for every witness that needs them
+        bool fReadBlock = false;
+        for (const CWitnessData* pdata : vData) {
+            if (pdata->nHeightNext <= pindex->nHeight && pindex->MintedDenomination(pdata->denom))
+                fReadBlock = true;
+        }
+
+        list<PublicCoin> listPubcoins;
+        if (fReadBlock && !pubcoinReader.GetPubcoins(pindex, listPubcoins, true)) {
+            LogPrintf("%s: failed to get zerocoin mintlist from block %d\n", __func__, pindex->nHeight);
+            return false;
+        }
+
+        for (CWitnessData* pdata : vData) {
+            if (pdata->nHeightNext > pindex->nHeight)
+                continue;
+
+            if (pindex->nHeight != pdata->nHeightAccStart && pindex->pprev->nAccumulatorCheckpoint != pindex->nAccumulatorCheckpoint)
+                ++pdata->nCheckpointsAdded;
+
+            if (!listPubcoins.empty()) {
+                Accumulator witness(Params().Zerocoin_Params(), pdata->denom);
+                witness.setValue(pdata->bnWitness);
+                for (const PublicCoin& pubcoin : listPubcoins) {
+                    if (pubcoin.getDenomination() != pdata->denom)
+                        continue;
+
+                    if (pindex->nHeight == pdata->nHeightMint && pubcoin.getValue() == pdata->bnPubcoin)
+                        continue;
+
+                    witness.increment(pubcoin.getValue());
+                    ++pdata->nMintsAdded;
+                }
+                pdata->bnWitness = witness.getValue();
+            }
+
+            pdata->nHeightNext = pindex->nHeight + 1;
+            pdata->hashBlockLast = pindex->GetBlockHash();
         }
     }
 
+    return true;
+}
+
+bool GenerateAccumulatorWitness(const PublicCoin &coin, Accumulator& accumulator, AccumulatorWitness& witness, int nSecurityLevel, int& nMintsAdded, string& strError, const CWitnessData* pWitnessData)
+{
     //security level: this is an important prevention of tracing the coins via timing. Security level represents how many checkpoints
     //of accumulated coins are added *beyond* the checkpoint that the mint being spent was added too. If each spend added the exact same
     //amounts of checkpoints after the mint was accumulated, then you could know the range of blocks that the mint originated from.
@@ -331,13 +555,27 @@ bool GenerateAccumulatorWitness(const PublicCoin &coin, Accumulator& accumulator
             nSecurityLevel = 99;
     }
 
-    //add the pubcoins (zerocoinmints that have been published to the chain) up to the next checksum starting from the block
-    pindex = chainActive[nAccStartHeight];
     int nChainHeight = chainActive.Height();
-    int nHeightStop = nChainHeight % 10;
-    nHeightStop = nChainHeight - nHeightStop - 20; // at least two checkpoints deep
-    int nCheckpointsAdded = 0;
-    nMintsAdded = 0;
+    int nHeightStop = GetWitnessHeightEnd(nChainHeight);
+
+    //resume from the tracked witness when it has not gone past where this spend stops, otherwise start at the mint
+    CWitnessData data;
+    if (pWitnessData && CanResumeWitness(*pWitnessData, coin, nHeightStop, nSecurityLevel)) {
+        data = *pWitnessData;
+        LogPrint("zero", "%s : resuming witness at height %d\n", __func__, data.nHeightNext);
+    } else if (!InitWitnessData(coin, data)) {
+        return false;
+    }
+
+    accumulator.setValue(data.bnWitness);
+    witness.resetValue(accumulator, coin);
+
+    //add the pubcoins (zerocoinmints that have been published to the chain) up to the next checksum starting from the block
+    CBlockIndex* pindex = chainActive[data.nHeightNext];
+    int nAccStartHeight = data.nHeightAccStart;
+    int nCheckpointsAdded = data.nCheckpointsAdded;
+    CPubcoinReader pubcoinReader;
+    nMintsAdded = data.nMintsAdded;
     while (pindex->nHeight < nHeightStop + 1) {
         if (pindex->nHeight != nAccStartHeight && pindex->pprev->nAccumulatorCheckpoint != pindex->nAccumulatorCheckpoint)
             ++nCheckpointsAdded;
@@ -358,15 +596,9 @@ bool GenerateAccumulatorWitness(const PublicCoin &coin, Accumulator& accumulator
         // if this block contains mints of the denomination that is being spent, then add them to the witness
         if (pindex->MintedDenomination(coin.getDenomination())) {
             //grab mints from this block
-            CBlock block;
-            if(!ReadBlockFromDisk(block, pindex)) {
-                LogPrintf("%s: failed to read block from disk while adding pubcoins to witness\n", __func__);
-                return false;
-            }
-
             list<PublicCoin> listPubcoins;
-            if(!BlockToPubcoinList(block, listPubcoins, true)) {
-                LogPrintf("%s: failed to get zerocoin mintlist from block %n\n", __func__, pindex->nHeight);
+            if(!pubcoinReader.GetPubcoins(pindex, listPubcoins, true)) {
+                LogPrintf("%s: failed to get zerocoin mintlist from block %d\n", __func__, pindex->nHeight);
                 return false;
             }
 
@@ -375,7 +607,7 @@ bool GenerateAccumulatorWitness(const PublicCoin &coin, Accumulator& accumulator
                 if (pubcoin.getDenomination() != coin.getDenomination())
                     continue;
 
-                if (pindex->nHeight == nHeightMintAdded && pubcoin.getValue() == coin.getValue())
+                if (pindex->nHeight == data.nHeightMint && pubcoin.getValue() == coin.getValue())
                     continue;
 
                 witness.addRawValue(pubcoin.getValue());
@@ -402,4 +634,4 @@ bool GenerateAccumulatorWitness(const PublicCoin &coin, Accumulator& accumulator
 
     LogPrint("zero","%s : %d mints added to witness\n", __func__, nMintsAdded);
     return true;
-}
\ No newline at end of file
+}
@@ -9,12 +9,95 @@
 #include "libzerocoin/Denominations.h"
 #include "libzerocoin/Coin.h"
 #include "primitives/zerocoin.h"
+#include "serialize.h"
+#include "txdb.h"
 #include "uint256.h"
+#include "zerocoincache.h"
 
-bool GenerateAccumulatorWitness(const libzerocoin::PublicCoin &coin, libzerocoin::Accumulator& accumulator, libzerocoin::AccumulatorWitness& witness, int nSecurityLevel, int& nMintsAdded, std::string& strError);
+/** Default for -accumulatorcache, the number of accumulator values kept in memory */
+static const int64_t DEFAULT_ACCUMULATOR_CACHE = 10000;
+
+/** Witness of a mint that is kept up to date as the chain grows.
+ *  All mints of the denomination in blocks nHeightAccStart up to (not including) nHeightNext
+ *  are accumulated into bnWitness, so a spend only has to add the blocks after that.
+ */
+class CWitnessData
+{
+public:
+    CBigNum bnPubcoin;
+    libzerocoin::CoinDenomination denom;
+    int nHeightMint;
+    int nHeightAccStart;
+    int nHeightNext;
+    uint256 hashBlockLast; // block nHeightNext - 1, used to notice reorgs
+    CBigNum bnWitness;
+    int nMintsAdded;
+    int nCheckpointsAdded;
+
+    CWitnessData()
+    {
+        SetNull();
+    }
+
+    void SetNull()
+    {
+        bnPubcoin = 0;
+        denom = libzerocoin::ZQ_ERROR;
+        nHeightMint = 0;
+        nHeightAccStart = 0;
+        nHeightNext = 0;
+        hashBlockLast = 0;
+        bnWitness = 0;
+        nMintsAdded = 0;
+        nCheckpointsAdded = 0;
+    }
+
+    bool IsNull() const { return nHeightNext == 0; }
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion)
+    {
+        READWRITE(bnPubcoin);
+        READWRITE(denom);
+        READWRITE(nHeightMint);
+        READWRITE(nHeightAccStart);
+        READWRITE(nHeightNext);
+        READWRITE(hashBlockLast);
+        READWRITE(bnWitness);
+        READWRITE(nMintsAdded);
+        READWRITE(nCheckpointsAdded);
+    }
+};
+
+/** Reads the pubcoins of blocks in height order. Uses the pubcoin index of the zerocoin DB, reading
+ *  ahead nReadAhead heights at a time, and falls back to the block on disk for blocks it doesn't have yet.
+ */
+class CPubcoinReader
+{
+private:
+    std::map<int, CBlockPubcoins> mapBlockPubcoins;
+    int nReadAhead;
+    int nHeightBufferStart;
+    int nHeightBufferEnd;
+
+public:
+    CPubcoinReader(int nReadAheadIn = 1000) : nReadAhead(nReadAheadIn), nHeightBufferStart(0), nHeightBufferEnd(0) {}
+
+    bool GetPubcoins(const CBlockIndex* pindex, std::list<libzerocoin::PublicCoin>& listPubcoins, bool fFilterInvalid);
+};
+
+bool GenerateAccumulatorWitness(const libzerocoin::PublicCoin &coin, libzerocoin::Accumulator& accumulator, libzerocoin::AccumulatorWitness& witness, int nSecurityLevel, int& nMintsAdded, std::string& strError, const CWitnessData* pWitnessData = NULL);
+bool InitWitnessData(const libzerocoin::PublicCoin& coin, CWitnessData& data);
+bool AdvanceWitnessData(const std::vector<CWitnessData*>& vData, int nHeightEnd);
+bool IsWitnessDataOnChain(const CWitnessData& data);
+int GetWitnessHeightEnd(int nChainHeight);
 bool GetAccumulatorValueFromDB(uint256 nCheckpoint, libzerocoin::CoinDenomination denom, CBigNum& bnAccValue);
 bool GetAccumulatorValueFromChecksum(uint32_t nChecksum, bool fMemoryOnly, CBigNum& bnAccValue);
 void AddAccumulatorChecksum(const uint32_t nChecksum, const CBigNum &bnValue, bool fMemoryOnly);
+bool EraseChecksum(uint32_t nChecksum);
+CZerocoinCacheStats GetAccumulatorCacheStats();
 bool CalculateAccumulatorCheckpoint(int nHeight, uint256& nCheckpoint);
 bool LoadAccumulatorValuesFromDB(const uint256 nCheckpoint);
 bool EraseAccumulatorValues(const uint256& nCheckpointErase, const uint256& nCheckpointPrevious);
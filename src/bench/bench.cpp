@@ -0,0 +1,148 @@
+// Copyright (c) 2015 The Bitcoin Core developers
+// Copyright (c) 2017 The PIVX developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "clientversion.h"
+#include "libzerocoin/bignum.h"
+#include "tinyformat.h"
+#include "univalue/univalue.h"
+#include "utiltime.h"
+
+#include <algorithm>
+#include <cmath>
+#include <exception>
+#include <iostream>
+
+#include <boost/thread.hpp>
+
+benchmark::BenchRunner::BenchmarkMap& benchmark::BenchRunner::benchmarks()
+{
+    static BenchmarkMap benchmarks_map;
+    return benchmarks_map;
+}
+
+benchmark::BenchRunner::BenchRunner(const std::string& name, BenchFunction func, int nIterations)
+{
+    benchmarks().insert(std::make_pair(name, Benchmark{func, nIterations}));
+}
+
+benchmark::State::State(const std::string& nameIn, int nWarmupIn, int nIterationsIn) : name(nameIn),
+                                                                                      nWarmup(nWarmupIn),
+                                                                                      nIterations(nIterationsIn),
+                                                                                      nCount(0),
+                                                                                      nIterationBegin(0)
+{
+    vSamples.reserve(nIterations);
+}
+
+bool benchmark::State::KeepRunning()
+{
+    int64_t nNow = GetTimeMicros();
+    if (nCount > nWarmup)
+        vSamples.push_back((nNow - nIterationBegin) * 0.001);
+
+    if (nCount >= nWarmup + nIterations)
+        return false;
+
+    ++nCount;
+    // the clock is read last, so the bookkeeping above is not timed
+    nIterationBegin = GetTimeMicros();
+    return true;
+}
+
+/** Nearest-rank percentile of a sorted, non-empty list */
+static double Percentile(const std::vector<double>& vSorted, double dPercent)
+{
+    size_t nRank = (size_t)std::ceil(dPercent / 100.0 * vSorted.size());
+    return vSorted[std::max<size_t>(nRank, 1) - 1];
+}
+
+benchmark::Result::Result(const State& state) : name(state.GetName()),
+                                                nIterations(state.GetSamples().size()),
+                                                dTotal(0), dMin(0), dMax(0), dMean(0), dMedian(0), dP90(0), dP99(0)
+{
+    std::vector<double> vSorted = state.GetSamples();
+    if (vSorted.empty())
+        return;
+
+    std::sort(vSorted.begin(), vSorted.end());
+    for (double d : vSorted)
+        dTotal += d;
+    dMin = vSorted.front();
+    dMax = vSorted.back();
+    dMean = dTotal / vSorted.size();
+    dMedian = Percentile(vSorted, 50);
+    dP90 = Percentile(vSorted, 90);
+    dP99 = Percentile(vSorted, 99);
+}
+
+void benchmark::BenchRunner::List(std::ostream& os)
+{
+    for (const auto& it : benchmarks())
+        os << it.first << "\n";
+}
+
+bool benchmark::BenchRunner::RunAll(std::ostream& os, OutputFormat format, const std::string& strFilter, int nWarmup, int nIterations)
+{
+    bool fSuccess = true;
+    std::vector<Result> vResults;
+    for (const auto& it : benchmarks()) {
+        if (it.first.find(strFilter) == std::string::npos)
+            continue;
+
+        // progress goes to stderr so the report on stdout stays machine readable
+        std::cerr << it.first << "..." << std::endl;
+        State state(it.first, nWarmup, nIterations > 0 ? nIterations : it.second.nIterations);
+        try {
+            it.second.func(state);
+        } catch (const std::exception& e) {
+            std::cerr << it.first << " failed: " << e.what() << std::endl;
+            fSuccess = false;
+            continue;
+        }
+        vResults.emplace_back(state);
+    }
+
+    if (format == FORMAT_JSON) {
+        UniValue results(UniValue::VARR);
+        for (const Result& result : vResults) {
+            UniValue entry(UniValue::VOBJ);
+            entry.pushKV("name", result.name);
+            entry.pushKV("iterations", result.nIterations);
+            entry.pushKV("total_ms", UniValue(result.dTotal));
+            entry.pushKV("min_ms", UniValue(result.dMin));
+            entry.pushKV("max_ms", UniValue(result.dMax));
+            entry.pushKV("mean_ms", UniValue(result.dMean));
+            entry.pushKV("median_ms", UniValue(result.dMedian));
+            entry.pushKV("p90_ms", UniValue(result.dP90));
+            entry.pushKV("p99_ms", UniValue(result.dP99));
+            results.push_back(entry);
+        }
+
+        UniValue report(UniValue::VOBJ);
+        report.pushKV("version", FormatFullVersion());
+        report.pushKV("bignum", CBigNum::GetBackendName());
+        report.pushKV("cores", (int)boost::thread::hardware_concurrency());
+        report.pushKV("time", (int64_t)GetTime());
+        report.pushKV("warmup", nWarmup);
+        report.pushKV("benchmarks", results);
+        os << report.write(4) << "\n";
+    } else if (format == FORMAT_CSV) {
+        os << "name,iterations,total_ms,min_ms,max_ms,mean_ms,median_ms,p90_ms,p99_ms\n";
+        for (const Result& result : vResults) {
+            os << strprintf("%s,%d,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f\n", result.name, result.nIterations,
+                result.dTotal, result.dMin, result.dMax, result.dMean, result.dMedian, result.dP90, result.dP99);
+        }
+    } else {
+        os << strprintf("# PIVX %s, bignum %s\n", FormatFullVersion(), CBigNum::GetBackendName());
+        os << strprintf("%-32s %10s %10s %10s %10s %10s %10s\n", "#Benchmark", "iterations", "min(ms)", "median(ms)", "p90(ms)", "p99(ms)", "max(ms)");
+        for (const Result& result : vResults) {
+            os << strprintf("%-32s %10d %10.3f %10.3f %10.3f %10.3f %10.3f\n", result.name, result.nIterations,
+                result.dMin, result.dMedian, result.dP90, result.dP99, result.dMax);
+        }
+    }
+    return fSuccess;
+}
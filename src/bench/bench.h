@@ -0,0 +1,109 @@
+// Copyright (c) 2015 The Bitcoin Core developers
+// Copyright (c) 2017 The PIVX developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef PIVX_BENCH_BENCH_H
+#define PIVX_BENCH_BENCH_H
+
+#include <functional>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <boost/preprocessor/cat.hpp>
+#include <boost/preprocessor/stringize.hpp>
+
+// Simple micro-benchmarking framework; API mostly modeled after a subset of
+// Google's benchmarking framework (https://github.com/google/benchmark), but
+// every iteration is timed on its own so percentiles can be reported.
+//
+// Define a new benchmark function:
+//
+// static void CODE_TO_TIME(benchmark::State& state)
+// {
+//     ... do any setup needed...
+//     while (state.KeepRunning()) {
+//        ... do stuff you want to time...
+//     }
+//     ... do any cleanup needed...
+// }
+//
+// BENCHMARK(CODE_TO_TIME, 10);
+//
+// The second argument is the default number of timed iterations.
+
+namespace benchmark
+{
+class State
+{
+    std::string name;
+    int nWarmup;
+    int nIterations;
+    int nCount;
+    int64_t nIterationBegin;
+    std::vector<double> vSamples;
+
+public:
+    State(const std::string& nameIn, int nWarmupIn, int nIterationsIn);
+
+    /** Time the previous iteration and return whether another one should run */
+    bool KeepRunning();
+
+    const std::string& GetName() const { return name; }
+    /** Duration of each timed iteration in milliseconds, warmup iterations excluded */
+    const std::vector<double>& GetSamples() const { return vSamples; }
+};
+
+/** Summary statistics of one benchmark run, in milliseconds */
+struct Result
+{
+    std::string name;
+    int nIterations;
+    double dTotal;
+    double dMin;
+    double dMax;
+    double dMean;
+    double dMedian;
+    double dP90;
+    double dP99;
+
+    explicit Result(const State& state);
+};
+
+enum OutputFormat {
+    FORMAT_CONSOLE,
+    FORMAT_JSON,
+    FORMAT_CSV,
+};
+
+typedef std::function<void(State&)> BenchFunction;
+
+class BenchRunner
+{
+    struct Benchmark {
+        BenchFunction func;
+        int nIterations;
+    };
+    typedef std::map<std::string, Benchmark> BenchmarkMap;
+    static BenchmarkMap& benchmarks();
+
+public:
+    BenchRunner(const std::string& name, BenchFunction func, int nIterations);
+
+    static void List(std::ostream& os);
+
+    /**
+     * Run every benchmark whose name contains strFilter and write the results to os.
+     * nIterations overrides the default iteration count of each benchmark when positive.
+     */
+    static bool RunAll(std::ostream& os, OutputFormat format, const std::string& strFilter, int nWarmup, int nIterations);
+};
+}
+
+// BENCHMARK(foo, 10) expands to:  benchmark::BenchRunner bench_11foo("foo", foo, 10);
+#define BENCHMARK(n, iterations) \
+    benchmark::BenchRunner BOOST_PP_CAT(bench_, BOOST_PP_CAT(__LINE__, n))(BOOST_PP_STRINGIZE(n), n, iterations);
+
+#endif // PIVX_BENCH_BENCH_H
@@ -0,0 +1,116 @@
+// Copyright (c) 2015 The Bitcoin Core developers
+// Copyright (c) 2017 The PIVX developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "chainparams.h"
+#include "clientversion.h"
+#include "crypto/quark.h"
+#include "crypto/sha256.h"
+#include "random.h"
+#include "ui_interface.h"
+#include "util.h"
+#ifdef ENABLE_WALLET
+#include "wallet.h"
+#endif
+
+#include <fstream>
+#include <iostream>
+
+#include <boost/filesystem.hpp>
+
+CClientUIInterface uiInterface;
+#ifdef ENABLE_WALLET
+CWallet* pwalletMain;
+#endif
+
+// Stand-ins for init.cpp, which is not linked in
+void StartShutdown()
+{
+    exit(0);
+}
+
+bool ShutdownRequested()
+{
+    return false;
+}
+
+static std::string HelpMessage()
+{
+    std::string strUsage = "PIVX benchmark utility version " + FormatFullVersion() + "\n\n" +
+                           "Usage:\n" +
+                           "  bench_pivx [options]\n";
+
+    strUsage += HelpMessageGroup("Options:");
+    strUsage += HelpMessageOpt("-?", "This help message");
+    strUsage += HelpMessageOpt("-list", "List the benchmarks and exit");
+    strUsage += HelpMessageOpt("-filter=<str>", "Only run the benchmarks whose name contains <str>");
+    strUsage += HelpMessageOpt("-iterations=<n>", "Timed iterations of every benchmark (default: set per benchmark)");
+    strUsage += HelpMessageOpt("-warmup=<n>", "Untimed iterations before the timed ones (default: 1)");
+    strUsage += HelpMessageOpt("-format=<format>", "Report format: console, json or csv (default: console)");
+    strUsage += HelpMessageOpt("-output=<file>", "Write the report to <file> instead of stdout");
+    return strUsage;
+}
+
+int main(int argc, char** argv)
+{
+    SetupEnvironment();
+    SHA256AutoDetect();
+    QuarkAutoDetect();
+    ParseParameters(argc, argv);
+
+    if (mapArgs.count("-?") || mapArgs.count("-help")) {
+        std::cout << HelpMessage();
+        return EXIT_SUCCESS;
+    }
+
+    if (GetBoolArg("-list", false)) {
+        benchmark::BenchRunner::List(std::cout);
+        return EXIT_SUCCESS;
+    }
+
+    benchmark::OutputFormat format;
+    std::string strFormat = GetArg("-format", "console");
+    if (strFormat == "console")
+        format = benchmark::FORMAT_CONSOLE;
+    else if (strFormat == "json")
+        format = benchmark::FORMAT_JSON;
+    else if (strFormat == "csv")
+        format = benchmark::FORMAT_CSV;
+    else {
+        std::cerr << "Error: unknown -format " << strFormat << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // Benchmarks may open databases, keep them out of the real data directory
+    fPrintToDebugLog = false;
+    SelectParams(CBaseChainParams::UNITTEST);
+    boost::filesystem::path pathTemp = GetTempPath() / strprintf("bench_pivx_%lu_%i", (unsigned long)GetTime(), (int)(GetRand(100000)));
+    boost::filesystem::create_directories(pathTemp);
+    mapArgs["-datadir"] = pathTemp.string();
+    // the zerocoin parameters are the same on every run, derive them only on the first one. The cache
+    // is kept in the user's own data directory, another user could plant it in a shared temp directory
+    try {
+        boost::filesystem::path pathZerocoinParams = GetDefaultDataDir() / "testcache";
+        boost::filesystem::create_directories(pathZerocoinParams);
+        mapArgs["-zerocoinparamsdir"] = pathZerocoinParams.string();
+    } catch (const boost::filesystem::filesystem_error&) {
+        // derive them in the temporary datadir
+    }
+
+    bool fSuccess;
+    std::string strFilter = GetArg("-filter", "");
+    int nWarmup = std::max(0, (int)GetArg("-warmup", 1));
+    int nIterations = GetArg("-iterations", 0);
+    if (mapArgs.count("-output")) {
+        std::ofstream file(mapArgs["-output"].c_str());
+        fSuccess = file.good() && benchmark::BenchRunner::RunAll(file, format, strFilter, nWarmup, nIterations);
+    } else {
+        fSuccess = benchmark::BenchRunner::RunAll(std::cout, format, strFilter, nWarmup, nIterations);
+    }
+
+    boost::filesystem::remove_all(pathTemp);
+    return fSuccess ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,143 @@
+// Copyright (c) 2017 The PIVX developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "coins.h"
+#include "random.h"
+
+#include <vector>
+
+#include <boost/unordered_map.hpp>
+
+// The map type CCoinsMap was before, to compare against
+typedef boost::unordered_map<uint256, CCoinsCacheEntry, CCoinsKeyHasher> CCoinsUnorderedMap;
+
+static const size_t BENCH_COINS = 10000;
+
+namespace
+{
+struct CCoinsBenchData {
+    std::vector<uint256> vTxid;
+    CCoins coins;
+
+    CCoinsBenchData() : vTxid(BENCH_COINS)
+    {
+        for (size_t i = 0; i < BENCH_COINS; i++)
+            vTxid[i] = GetRandHash();
+        // a payment and its change
+        coins.vout.resize(2);
+        coins.vout[0].nValue = 100 * COIN;
+        coins.vout[0].scriptPubKey = CScript() << OP_DUP << OP_HASH160 << std::vector<unsigned char>(20, 1) << OP_EQUALVERIFY << OP_CHECKSIG;
+        coins.vout[1] = coins.vout[0];
+        coins.nHeight = 1000;
+        coins.nVersion = 1;
+    }
+};
+
+const CCoinsBenchData& BenchData()
+{
+    static const CCoinsBenchData data;
+    return data;
+}
+
+/** What CCoinsViewCache::FetchCoins does on a miss: pull the coins in from the parent view */
+template <typename Map>
+void FetchCoins(Map& map, const uint256& txid, const CCoins& coinsParent)
+{
+    typename Map::iterator it = map.find(txid);
+    if (it != map.end())
+        return;
+    CCoins tmp = coinsParent;
+    typename Map::iterator ret = map.insert(std::make_pair(txid, CCoinsCacheEntry())).first;
+    tmp.swap(ret->second.coins);
+}
+
+/** What CCoinsViewCache::ModifyCoins and CCoinsModifier do to spend an output */
+template <typename Map>
+void SpendCoins(Map& map, const uint256& txid, int nPos)
+{
+    std::pair<typename Map::iterator, bool> ret = map.insert(std::make_pair(txid, CCoinsCacheEntry()));
+    ret.first->second.flags |= CCoinsCacheEntry::DIRTY;
+    ret.first->second.coins.Spend(nPos);
+}
+
+/** What CCoinsViewCache::BatchWrite and Flush do to move a child cache into its parent */
+template <typename Map>
+void BatchWrite(Map& mapParent, Map& mapChild)
+{
+    for (typename Map::iterator it = mapChild.begin(); it != mapChild.end();) {
+        if (it->second.flags & CCoinsCacheEntry::DIRTY) {
+            CCoinsCacheEntry& entry = mapParent[it->first];
+            entry.coins.swap(it->second.coins);
+            entry.flags = CCoinsCacheEntry::DIRTY;
+        }
+        typename Map::iterator itOld = it++;
+        mapChild.erase(itOld);
+    }
+    mapChild.clear();
+}
+
+/** Fetch every coin once, look all of them up again and drop the cache */
+template <typename Map>
+void BenchFetchCoins(benchmark::State& state)
+{
+    const CCoinsBenchData& data = BenchData();
+    while (state.KeepRunning()) {
+        Map map;
+        for (size_t i = 0; i < BENCH_COINS; i++)
+            FetchCoins(map, data.vTxid[i], data.coins);
+        for (size_t i = 0; i < BENCH_COINS; i++)
+            FetchCoins(map, data.vTxid[i], data.coins);
+    }
+}
+
+/** Fetch the coins into a cache and spend both outputs of each */
+template <typename Map>
+void BenchModifyCoins(benchmark::State& state)
+{
+    const CCoinsBenchData& data = BenchData();
+    while (state.KeepRunning()) {
+        Map map;
+        for (size_t i = 0; i < BENCH_COINS; i++)
+            FetchCoins(map, data.vTxid[i], data.coins);
+        for (size_t i = 0; i < BENCH_COINS; i++)
+            SpendCoins(map, data.vTxid[i], 0);
+        for (size_t i = 0; i < BENCH_COINS; i++)
+            SpendCoins(map, data.vTxid[i], 1);
+    }
+}
+
+/** Fill a child cache and write it into a parent, then flush the parent */
+template <typename Map>
+void BenchBatchWrite(benchmark::State& state)
+{
+    const CCoinsBenchData& data = BenchData();
+    Map mapParent;
+    while (state.KeepRunning()) {
+        Map mapChild;
+        for (size_t i = 0; i < BENCH_COINS; i++) {
+            CCoinsCacheEntry& entry = mapChild[data.vTxid[i]];
+            entry.coins = data.coins;
+            entry.flags = CCoinsCacheEntry::DIRTY | CCoinsCacheEntry::FRESH;
+        }
+        BatchWrite(mapParent, mapChild);
+        mapParent.clear();
+    }
+}
+}
+
+static void CoinsCacheFetch(benchmark::State& state) { BenchFetchCoins<CCoinsMap>(state); }
+static void CoinsCacheFetchUnordered(benchmark::State& state) { BenchFetchCoins<CCoinsUnorderedMap>(state); }
+static void CoinsCacheModify(benchmark::State& state) { BenchModifyCoins<CCoinsMap>(state); }
+static void CoinsCacheModifyUnordered(benchmark::State& state) { BenchModifyCoins<CCoinsUnorderedMap>(state); }
+static void CoinsCacheBatchWrite(benchmark::State& state) { BenchBatchWrite<CCoinsMap>(state); }
+static void CoinsCacheBatchWriteUnordered(benchmark::State& state) { BenchBatchWrite<CCoinsUnorderedMap>(state); }
+
+BENCHMARK(CoinsCacheFetch, 200);
+BENCHMARK(CoinsCacheFetchUnordered, 200);
+BENCHMARK(CoinsCacheModify, 200);
+BENCHMARK(CoinsCacheModifyUnordered, 200);
+BENCHMARK(CoinsCacheBatchWrite, 200);
+BENCHMARK(CoinsCacheBatchWriteUnordered, 200);
@@ -0,0 +1,66 @@
+// Copyright (c) 2017 The PIVX developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "crypto/sha256.h"
+#include "hash.h"
+#include "primitives/block.h"
+
+#include <vector>
+
+static const size_t BENCH_HASHES = 1024;
+
+static void SHA256_1MB(benchmark::State& state)
+{
+    std::vector<unsigned char> in(1000000, 0);
+    unsigned char hash[CSHA256::OUTPUT_SIZE];
+    while (state.KeepRunning())
+        CSHA256().Write(in.data(), in.size()).Finalize(hash);
+}
+
+/** Double-SHA256 of 64-byte inputs, the size of a merkle tree node pair */
+static void SHA256D64(benchmark::State& state)
+{
+    std::vector<unsigned char> in(64 * BENCH_HASHES, 0), out(32 * BENCH_HASHES);
+    while (state.KeepRunning()) {
+        for (size_t i = 0; i < BENCH_HASHES; i++)
+            CHash256().Write(&in[i * 64], 64).Finalize(&out[i * 32]);
+    }
+}
+
+static void SHA256D64Batch(benchmark::State& state)
+{
+    std::vector<unsigned char> in(64 * BENCH_HASHES, 0), out(32 * BENCH_HASHES);
+    while (state.KeepRunning())
+        SHA256DBatch(out.data(), in.data(), 64, BENCH_HASHES);
+}
+
+static void MerkleRoot(benchmark::State& state)
+{
+    CBlock block;
+    for (size_t i = 0; i < BENCH_HASHES; i++) {
+        CMutableTransaction tx;
+        tx.nLockTime = i;
+        block.vtx.push_back(tx);
+    }
+    while (state.KeepRunning())
+        block.BuildMerkleTree();
+}
+
+/** Quark hash of an 80-byte block header, the proof of work of the PoW blocks */
+static void QuarkHeader(benchmark::State& state)
+{
+    CBlockHeader header;
+    while (state.KeepRunning()) {
+        header.nNonce++;
+        header.GetHash();
+    }
+}
+
+BENCHMARK(SHA256_1MB, 100);
+BENCHMARK(SHA256D64, 500);
+BENCHMARK(SHA256D64Batch, 500);
+BENCHMARK(MerkleRoot, 500);
+BENCHMARK(QuarkHeader, 5000);
@@ -0,0 +1,245 @@
+// Copyright (c) 2017 The PIVX developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "accumulatormap.h"
+#include "accumulators.h"
+#include "chainparams.h"
+#include "main.h"
+#include "random.h"
+#include "txdb.h"
+#include "libzerocoin/Accumulator.h"
+#include "libzerocoin/Coin.h"
+#include "libzerocoin/CoinSpend.h"
+#include "libzerocoin/Denominations.h"
+
+#include <stdexcept>
+
+using namespace libzerocoin;
+
+static const int BENCH_COINS = 5;
+
+/** Coins, an accumulator and a spend shared by the benchmarks, minted on first use */
+struct ZerocoinBenchSetup
+{
+    ZerocoinParams* params;
+    std::vector<PrivateCoin> vCoins;
+    Accumulator accumulator;
+    AccumulatorWitness witness;
+    uint32_t nChecksum;
+    std::unique_ptr<CoinSpend> spend;
+
+    ZerocoinBenchSetup() : params(Params().Zerocoin_Params()),
+                           accumulator(params, CoinDenomination::ZQ_ONE),
+                           witness(params, accumulator, PublicCoin(params))
+    {
+        for (int i = 0; i < BENCH_COINS; i++)
+            vCoins.emplace_back(params, CoinDenomination::ZQ_ONE);
+
+        witness.resetValue(accumulator, vCoins[0].getPublicCoin());
+        for (const PrivateCoin& coin : vCoins) {
+            accumulator += coin.getPublicCoin();
+            witness += coin.getPublicCoin();
+        }
+        nChecksum = GetChecksum(accumulator.getValue());
+        spend.reset(new CoinSpend(params, vCoins[0], accumulator, nChecksum, witness, 0));
+    }
+};
+
+static ZerocoinBenchSetup& GetSetup()
+{
+    static ZerocoinBenchSetup setup;
+    return setup;
+}
+
+/** Random values that stand in for the pubcoins of ten blocks, the accumulator does not check them */
+static std::list<PublicCoin> RandomPubcoins(int nPerDenomination)
+{
+    ZerocoinParams* params = Params().Zerocoin_Params();
+    std::list<PublicCoin> listPubcoins;
+    for (auto denom : zerocoinDenomList) {
+        for (int i = 0; i < nPerDenomination; i++)
+            listPubcoins.emplace_back(params, CBigNum::randBignum(params->coinCommitmentGroup.modulus), denom);
+    }
+    return listPubcoins;
+}
+
+static void ZerocoinMint(benchmark::State& state)
+{
+    ZerocoinParams* params = Params().Zerocoin_Params();
+    while (state.KeepRunning()) {
+        PrivateCoin coin(params, CoinDenomination::ZQ_ONE);
+    }
+}
+
+static void PubcoinValidate(benchmark::State& state)
+{
+    const PublicCoin& pubcoin = GetSetup().vCoins[0].getPublicCoin();
+    while (state.KeepRunning()) {
+        if (!pubcoin.validate())
+            throw std::runtime_error("pubcoin does not validate");
+    }
+}
+
+static void CoinSpendCreate(benchmark::State& state)
+{
+    ZerocoinBenchSetup& setup = GetSetup();
+    while (state.KeepRunning()) {
+        CoinSpend spend(setup.params, setup.vCoins[0], setup.accumulator, setup.nChecksum, setup.witness, 0);
+    }
+}
+
+static void CoinSpendVerify(benchmark::State& state)
+{
+    ZerocoinBenchSetup& setup = GetSetup();
+    while (state.KeepRunning()) {
+        if (!setup.spend->Verify(setup.accumulator))
+            throw std::runtime_error("spend does not verify");
+    }
+}
+
+static void CoinSpendVerifyCommitmentPoK(benchmark::State& state)
+{
+    ZerocoinBenchSetup& setup = GetSetup();
+    while (state.KeepRunning()) {
+        if (!setup.spend->VerifyCommitmentPoK())
+            throw std::runtime_error("commitment proof does not verify");
+    }
+}
+
+static void CoinSpendVerifyAccumulatorPoK(benchmark::State& state)
+{
+    ZerocoinBenchSetup& setup = GetSetup();
+    while (state.KeepRunning()) {
+        if (!setup.spend->VerifyAccumulatorPoK(setup.accumulator))
+            throw std::runtime_error("accumulator proof does not verify");
+    }
+}
+
+static void CoinSpendVerifySerialNumberSoK(benchmark::State& state)
+{
+    ZerocoinBenchSetup& setup = GetSetup();
+    while (state.KeepRunning()) {
+        if (!setup.spend->VerifySerialNumberSoK())
+            throw std::runtime_error("serial number signature does not verify");
+    }
+}
+
+static void AccumulatorAccumulate(benchmark::State& state)
+{
+    ZerocoinBenchSetup& setup = GetSetup();
+    Accumulator accumulator(setup.params, CoinDenomination::ZQ_ONE);
+    const PublicCoin& pubcoin = setup.vCoins[0].getPublicCoin();
+    while (state.KeepRunning())
+        accumulator.accumulate(pubcoin);
+}
+
+// Ten blocks with five mints of every denomination
+static void AccumulatorMapCheckpoint(benchmark::State& state)
+{
+    std::list<PublicCoin> listPubcoins = RandomPubcoins(5);
+    while (state.KeepRunning()) {
+        AccumulatorMap mapAccumulators;
+        for (const PublicCoin& pubcoin : listPubcoins)
+            mapAccumulators.Accumulate(pubcoin, true);
+        mapAccumulators.GetCheckpoint();
+    }
+}
+
+static void AccumulatorMapCheckpointBatch(benchmark::State& state)
+{
+    std::list<PublicCoin> listPubcoins = RandomPubcoins(5);
+    while (state.KeepRunning()) {
+        AccumulatorMap mapAccumulators;
+        mapAccumulators.AccumulateBatch(listPubcoins, true);
+        mapAccumulators.GetCheckpoint();
+    }
+}
+
+/**
+ * A chain of block indexes with one ZQ_ONE mint per block, recorded in a memory pubcoin index.
+ * The witness starts from a tracked CWitnessData, so no transactions are needed.
+ */
+static void GenerateWitness(benchmark::State& state)
+{
+    static const int nZerocoinStart = 10;
+    static const int nHeightTip = 150;
+    const CoinDenomination denom = CoinDenomination::ZQ_ONE;
+
+    ModifiableParams()->setZerocoinStartHeight(nZerocoinStart);
+    ZerocoinParams* params = Params().Zerocoin_Params();
+    std::unique_ptr<CZerocoinDB> zerocoinDBBench(new CZerocoinDB(1 << 20, true));
+    zerocoinDB = zerocoinDBBench.get();
+
+    std::vector<std::unique_ptr<CBlockIndex> > vBlockIndex;
+    for (int nHeight = 0; nHeight <= nHeightTip; nHeight++) {
+        CBlockIndex* pindex = new CBlockIndex();
+        vBlockIndex.emplace_back(pindex);
+        BlockMap::iterator mi = mapBlockIndex.insert(std::make_pair(GetRandHash(), pindex)).first;
+        pindex->phashBlock = &((*mi).first);
+        pindex->nHeight = nHeight;
+        pindex->pprev = nHeight > 0 ? vBlockIndex[nHeight - 1].get() : NULL;
+        pindex->nAccumulatorCheckpoint = nHeight - (nHeight % 10) + 1;
+        if (nHeight <= nZerocoinStart)
+            continue;
+
+        CPubcoinTx pubcoinTx;
+        pubcoinTx.txid = GetRandHash();
+        pubcoinTx.vPrevout.emplace_back(GetRandHash(), 0);
+        pubcoinTx.vOut.emplace_back(0);
+        pubcoinTx.vDenom.emplace_back(denom);
+        pubcoinTx.vPubcoin.emplace_back(CBigNum::randBignum(params->coinCommitmentGroup.modulus));
+
+        CBlockPubcoins blockPubcoins;
+        blockPubcoins.hashBlock = pindex->GetBlockHash();
+        blockPubcoins.vTx.emplace_back(pubcoinTx);
+        zerocoinDB->WriteBlockPubcoins(nHeight, blockPubcoins);
+        pindex->vMintDenominationsInBlock.emplace_back(denom);
+    }
+    chainActive.SetTip(vBlockIndex.back().get());
+
+    // the accumulator checkpoint the witness stops at
+    int nHeightStop = GetWitnessHeightEnd(nHeightTip);
+    uint32_t nChecksum = ParseChecksum(chainActive[nHeightStop + 10]->nAccumulatorCheckpoint, denom);
+    zerocoinDB->WriteAccumulatorValue(nChecksum, params->accumulatorParams.accumulatorBase);
+
+    CWitnessData data;
+    data.denom = denom;
+    data.nHeightMint = nZerocoinStart + 10;
+    data.nHeightAccStart = data.nHeightMint;
+    data.nHeightNext = data.nHeightMint;
+    data.hashBlockLast = chainActive[data.nHeightNext - 1]->GetBlockHash();
+    data.bnWitness = params->accumulatorParams.accumulatorBase;
+    CBlockPubcoins blockPubcoinsMint;
+    zerocoinDB->ReadBlockPubcoins(data.nHeightMint, blockPubcoinsMint);
+    data.bnPubcoin = blockPubcoinsMint.vTx[0].vPubcoin[0];
+    PublicCoin pubcoin(params, data.bnPubcoin, denom);
+
+    while (state.KeepRunning()) {
+        Accumulator accumulator(params, denom);
+        AccumulatorWitness witness(params, accumulator, pubcoin);
+        int nMintsAdded = 0;
+        std::string strError;
+        if (!GenerateAccumulatorWitness(pubcoin, accumulator, witness, 100, nMintsAdded, strError, &data))
+            throw std::runtime_error("failed to generate witness: " + strError);
+    }
+
+    chainActive.SetTip(NULL);
+    for (const auto& pindex : vBlockIndex)
+        mapBlockIndex.erase(pindex->GetBlockHash());
+    zerocoinDB = NULL;
+}
+
+BENCHMARK(ZerocoinMint, 10);
+BENCHMARK(PubcoinValidate, 20);
+BENCHMARK(CoinSpendCreate, 5);
+BENCHMARK(CoinSpendVerify, 10);
+BENCHMARK(CoinSpendVerifyCommitmentPoK, 10);
+BENCHMARK(CoinSpendVerifyAccumulatorPoK, 10);
+BENCHMARK(CoinSpendVerifySerialNumberSoK, 10);
+BENCHMARK(AccumulatorAccumulate, 50);
+BENCHMARK(AccumulatorMapCheckpoint, 10);
+BENCHMARK(AccumulatorMapCheckpointBatch, 10);
+BENCHMARK(GenerateWitness, 5);
@@ -0,0 +1,104 @@
+// Copyright (c) 2017 The PIVX developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef PIVX_BLOCKPIPELINE_H
+#define PIVX_BLOCKPIPELINE_H
+
+#include "uint256.h"
+
+#include <deque>
+#include <map>
+
+#include <boost/shared_ptr.hpp>
+
+/**
+ * Order of the blocks in the initial sync pipeline. Blocks are checked in the order they
+ * arrive, by any number of threads, and connected in height order: the lowest block waits
+ * until it is checked, even when later ones are done first.
+ *
+ * The entries are represented by a type T, which must provide a bool fChecked. The caller
+ * holds the lock that protects the queue.
+ */
+template <typename T>
+class CBlockPipelineQueue
+{
+public:
+    typedef boost::shared_ptr<T> Ref;
+
+private:
+    const unsigned int nMaxDepth;
+    std::deque<Ref> queueCheck;
+    std::multimap<int, Ref> mapByHeight;
+    //! Height of every block in the pipeline, kept until its connection finished so that children can follow it in
+    std::map<uint256, int> mapHeight;
+
+public:
+    explicit CBlockPipelineQueue(unsigned int nMaxDepthIn) : nMaxDepth(nMaxDepthIn) {}
+
+    size_t size() const { return mapHeight.size(); }
+    bool IsFull() const { return mapHeight.size() >= nMaxDepth; }
+    bool Contains(const uint256& hash) const { return mapHeight.count(hash) != 0; }
+
+    /**
+     * Height a block with parent hashPrev gets in the pipeline, or -1 when it has to be processed
+     * directly. nPrevHeight is the height of the parent in the block index, -1 when it is not there.
+     * A block whose parent is still in the pipeline is always taken, even when the pipeline is full
+     * or the initial sync is over: it could not be connected before its parent anyway. Downloads
+     * stop while the pipeline is full, so these children only add the blocks that were in flight.
+     */
+    int GetHeight(const uint256& hashPrev, int nPrevHeight, bool fInitialSync) const
+    {
+        std::map<uint256, int>::const_iterator it = mapHeight.find(hashPrev);
+        if (it != mapHeight.end())
+            return it->second + 1;
+        if (!fInitialSync || nPrevHeight < 0 || IsFull())
+            return -1;
+        return nPrevHeight + 1;
+    }
+
+    //! Reserve the place of a block, so that its children are taken before the entry itself is queued
+    void Add(const uint256& hash, int nHeight) { mapHeight[hash] = nHeight; }
+
+    void QueueForCheck(int nHeight, const Ref& entry)
+    {
+        mapByHeight.insert(std::make_pair(nHeight, entry));
+        queueCheck.push_back(entry);
+    }
+
+    bool HasBlockToCheck() const { return !queueCheck.empty(); }
+
+    Ref PopForCheck()
+    {
+        if (queueCheck.empty())
+            return Ref();
+        Ref entry = queueCheck.front();
+        queueCheck.pop_front();
+        return entry;
+    }
+
+    bool HasBlockToConnect() const { return !mapByHeight.empty() && mapByHeight.begin()->second->fChecked; }
+
+    //! The lowest block, if it is checked
+    Ref PopForConnect()
+    {
+        if (!HasBlockToConnect())
+            return Ref();
+        Ref entry = mapByHeight.begin()->second;
+        mapByHeight.erase(mapByHeight.begin());
+        return entry;
+    }
+
+    //! Drop a block after its connection, whether it was valid or not
+    void Finished(const uint256& hash) { mapHeight.erase(hash); }
+
+    unsigned int CountChecked() const
+    {
+        unsigned int nChecked = 0;
+        for (typename std::multimap<int, Ref>::const_iterator it = mapByHeight.begin(); it != mapByHeight.end(); ++it)
+            nChecked += it->second->fChecked;
+        return nChecked;
+    }
+};
+
+#endif // PIVX_BLOCKPIPELINE_H
@@ -0,0 +1,157 @@
+// Copyright (c) 2017 The PIVX developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockreader.h"
+
+#include "chainparams.h"
+#include "clientversion.h"
+#include "crypto/common.h"
+#include "main.h"
+#include "streams.h"
+#include "sync.h"
+#include "util.h"
+
+#include <list>
+#include <string.h>
+#include <utility>
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Blocks are stored after the message start and their size
+static const unsigned int BLOCK_HEADER_SIZE = MESSAGE_START_SIZE + sizeof(unsigned int);
+
+CMappedBlockFile::CMappedBlockFile(const boost::filesystem::path& path) : pdata(NULL), nSize(0)
+{
+#ifndef WIN32
+    int fd = open(path.string().c_str(), O_RDONLY);
+    if (fd < 0)
+        return;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        void* p = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (p != MAP_FAILED) {
+            pdata = (const unsigned char*)p;
+            nSize = st.st_size;
+        } else {
+            LogPrintf("Unable to map %s, reading it instead\n", path.string());
+        }
+    }
+    // the mapping holds its own reference to the file
+    close(fd);
+#endif
+}
+
+CMappedBlockFile::~CMappedBlockFile()
+{
+#ifndef WIN32
+    if (pdata)
+        munmap((void*)pdata, nSize);
+#endif
+}
+
+namespace
+{
+typedef std::pair<std::string, boost::shared_ptr<const CMappedBlockFile> > MappedFileEntry;
+
+CCriticalSection cs_mapped;
+// most recently used first
+std::list<MappedFileEntry> listMapped;
+
+/**
+ * Get a mapping of the file that covers at least nMinSize bytes. The file at the tip keeps
+ * growing, so an older mapping of it that is too short is replaced by a new one. Readers
+ * still holding the old mapping keep it until they are done.
+ */
+boost::shared_ptr<const CMappedBlockFile> GetMappedFile(const boost::filesystem::path& path, size_t nMinSize)
+{
+    const std::string strPath = path.string();
+
+    LOCK(cs_mapped);
+    for (std::list<MappedFileEntry>::iterator it = listMapped.begin(); it != listMapped.end(); ++it) {
+        if (it->first != strPath)
+            continue;
+        if (it->second->size() >= nMinSize) {
+            listMapped.splice(listMapped.begin(), listMapped, it);
+            return listMapped.front().second;
+        }
+        listMapped.erase(it);
+        break;
+    }
+
+    boost::shared_ptr<const CMappedBlockFile> file(new CMappedBlockFile(path));
+    if (file->IsNull())
+        return boost::shared_ptr<const CMappedBlockFile>();
+
+    listMapped.push_front(std::make_pair(strPath, file));
+    if (listMapped.size() > MAX_MAPPED_BLOCK_FILES)
+        listMapped.pop_back();
+    return file;
+}
+
+/** Check the message start and size written before a block, returns the size */
+bool ReadBlockHeader(const unsigned char* pheader, const CDiskBlockPos& pos, unsigned int& nSize)
+{
+    if (memcmp(pheader, Params().MessageStart(), MESSAGE_START_SIZE) != 0)
+        return error("%s : no block at %s", __func__, pos.ToString());
+    nSize = ReadLE32(pheader + MESSAGE_START_SIZE);
+    if (nSize > MAX_SIZE)
+        return error("%s : block size %u at %s out of range", __func__, nSize, pos.ToString());
+    return true;
+}
+} // namespace
+
+bool ReadBlockSpan(const CDiskBlockPos& pos, CBlockSpan& span)
+{
+    if (pos.IsNull() || pos.nPos < BLOCK_HEADER_SIZE)
+        return error("%s : invalid position %s", __func__, pos.ToString());
+
+    span.SetNull();
+    boost::filesystem::path path = GetBlockPosFilename(pos, "blk");
+    boost::shared_ptr<const CMappedBlockFile> file = GetMappedFile(path, pos.nPos);
+    if (file && file->size() >= pos.nPos) {
+        unsigned int nSize;
+        if (!ReadBlockHeader(file->data() + pos.nPos - BLOCK_HEADER_SIZE, pos, nSize))
+            return false;
+        if (file->size() - pos.nPos < nSize)
+            file = GetMappedFile(path, (size_t)pos.nPos + nSize);
+        if (!file || file->size() - pos.nPos < nSize)
+            return error("%s : block at %s runs past the end of %s", __func__, pos.ToString(), path.string());
+
+        span.file = file;
+        span.pbegin = file->data() + pos.nPos;
+        span.nSize = nSize;
+        return true;
+    }
+
+    // Not mappable, copy the block out of the file
+    CAutoFile filein(OpenBlockFile(CDiskBlockPos(pos.nFile, pos.nPos - BLOCK_HEADER_SIZE), true), SER_DISK, CLIENT_VERSION);
+    if (filein.IsNull())
+        return error("%s : OpenBlockFile failed for %s", __func__, pos.ToString());
+    try {
+        unsigned char header[BLOCK_HEADER_SIZE];
+        filein.read((char*)header, sizeof(header));
+        unsigned int nSize;
+        if (!ReadBlockHeader(header, pos, nSize))
+            return false;
+        span.vchCopy.resize(nSize);
+        if (nSize > 0)
+            filein.read((char*)&span.vchCopy[0], nSize);
+    } catch (std::exception& e) {
+        return error("%s : I/O error - %s", __func__, e.what());
+    }
+    span.pbegin = span.vchCopy.empty() ? NULL : &span.vchCopy[0];
+    span.nSize = span.vchCopy.size();
+    return true;
+}
+
+void UnmapBlockFiles()
+{
+    LOCK(cs_mapped);
+    listMapped.clear();
+}
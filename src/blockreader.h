@@ -0,0 +1,91 @@
+// Copyright (c) 2017 The PIVX developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef PIVX_BLOCKREADER_H
+#define PIVX_BLOCKREADER_H
+
+#include "chain.h"
+
+#include <stddef.h>
+#include <vector>
+
+#include <boost/filesystem/path.hpp>
+#include <boost/shared_ptr.hpp>
+
+/** Number of blk?????.dat files kept mapped at once, fewer where address space is scarce */
+static const unsigned int MAX_MAPPED_BLOCK_FILES = sizeof(void*) >= 8 ? 16 : 2;
+
+/** A read-only memory mapping of a whole blk?????.dat file. Unmapped when the last reference is dropped. */
+class CMappedBlockFile
+{
+private:
+    // Disallow copies
+    CMappedBlockFile(const CMappedBlockFile&);
+    CMappedBlockFile& operator=(const CMappedBlockFile&);
+
+    const unsigned char* pdata;
+    size_t nSize;
+
+public:
+    explicit CMappedBlockFile(const boost::filesystem::path& path);
+    ~CMappedBlockFile();
+
+    bool IsNull() const { return pdata == NULL; }
+    const unsigned char* data() const { return pdata; }
+    size_t size() const { return nSize; }
+};
+
+/**
+ * The serialized bytes of one stored block. They point into a mapped blk file, which stays
+ * mapped while the span is held, or into a copy read from the file when it cannot be mapped.
+ * Serializing a span writes the bytes unchanged, blocks are stored in their network format.
+ */
+class CBlockSpan
+{
+private:
+    // Disallow copies, the span may point into its own copy of the bytes
+    CBlockSpan(const CBlockSpan&);
+    CBlockSpan& operator=(const CBlockSpan&);
+
+    boost::shared_ptr<const CMappedBlockFile> file;
+    std::vector<unsigned char> vchCopy;
+    const unsigned char* pbegin;
+    size_t nSize;
+
+    void SetNull()
+    {
+        file.reset();
+        vchCopy.clear();
+        pbegin = NULL;
+        nSize = 0;
+    }
+
+    friend bool ReadBlockSpan(const CDiskBlockPos& pos, CBlockSpan& span);
+
+public:
+    CBlockSpan() : pbegin(NULL), nSize(0) {}
+
+    const unsigned char* begin() const { return pbegin; }
+    const unsigned char* end() const { return pbegin + nSize; }
+    size_t size() const { return nSize; }
+
+    unsigned int GetSerializeSize(int, int = 0) const
+    {
+        return nSize;
+    }
+
+    template <typename Stream>
+    void Serialize(Stream& s, int, int = 0) const
+    {
+        s.write((const char*)pbegin, nSize);
+    }
+};
+
+/** Get the bytes of the block stored at pos, checking the message start and size written before it. */
+bool ReadBlockSpan(const CDiskBlockPos& pos, CBlockSpan& span);
+
+/** Unmap all block files, at shutdown or after they were rewritten. */
+void UnmapBlockFiles();
+
+#endif // PIVX_BLOCKREADER_H
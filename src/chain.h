@@ -59,6 +59,11 @@ struct CDiskBlockPos {
         nPos = 0;
     }
     bool IsNull() const { return (nFile == -1); }
+
+    std::string ToString() const
+    {
+        return strprintf("CDiskBlockPos(nFile=%i, nPos=%i)", nFile, nPos);
+    }
 };
 
 enum BlockStatus {
@@ -432,7 +437,7 @@ public:
         hashNext = uint256();
     }
 
-    explicit CDiskBlockIndex(CBlockIndex* pindex) : CBlockIndex(*pindex)
+    explicit CDiskBlockIndex(const CBlockIndex* pindex) : CBlockIndex(*pindex)
     {
         hashPrev = (pprev ? pprev->GetBlockHash() : uint256());
     }
@@ -7,13 +7,18 @@
 
 #include "libzerocoin/Params.h"
 #include "chainparams.h"
+#include "clientversion.h"
+#include "hash.h"
 #include "random.h"
+#include "streams.h"
 #include "util.h"
 #include "utilstrencodings.h"
 
 #include <assert.h>
+#include <limits>
 
 #include <boost/assign/list_of.hpp>
+#include <boost/filesystem.hpp>
 
 using namespace std;
 using namespace boost::assign;
@@ -91,11 +96,147 @@ static const Checkpoints::CCheckpointData dataRegtest = {
     0,
     100};
 
+/**
+ * The zerocoin parameters are derived from the modulus with a deterministic but slow prime
+ * search, so they are cached in the datadir. The cache is keyed by the modulus, the protocol
+ * version and the security level, and checksummed like peers.dat.
+ */
+static const char* ZEROCOIN_PARAMS_CACHE = "zerocoinparams.dat";
+
+struct CZerocoinParamsCacheKey {
+    uint256 hashModulus;
+    std::string strProtocolVersion;
+    uint32_t nSecurityLevel;
+
+    CZerocoinParamsCacheKey(const CBigNum& bnModulus)
+    {
+        CDataStream ss(SER_GETHASH, 0);
+        ss << bnModulus;
+        hashModulus = Hash(ss.begin(), ss.end());
+        strProtocolVersion = ZEROCOIN_PROTOCOL_VERSION;
+        nSecurityLevel = ZEROCOIN_DEFAULT_SECURITYLEVEL;
+    }
+
+    bool operator==(const CZerocoinParamsCacheKey& other) const
+    {
+        return hashModulus == other.hashModulus && strProtocolVersion == other.strProtocolVersion && nSecurityLevel == other.nSecurityLevel;
+    }
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion)
+    {
+        READWRITE(hashModulus);
+        READWRITE(strProtocolVersion);
+        READWRITE(nSecurityLevel);
+    }
+};
+
+// -zerocoinparamsdir lets the test and bench binaries, which start from an empty datadir, keep the cache between runs
+static boost::filesystem::path GetZerocoinParamsCacheDir()
+{
+    if (mapArgs.count("-zerocoinparamsdir"))
+        return boost::filesystem::path(mapArgs["-zerocoinparamsdir"]);
+    return GetDataDir();
+}
+
+static bool ReadZerocoinParamsCache(const CBigNum& bnModulus, libzerocoin::ZerocoinParams& params, int64_t& nDeriveMillis)
+{
+    boost::filesystem::path pathCache = GetZerocoinParamsCacheDir() / ZEROCOIN_PARAMS_CACHE;
+    FILE* file = fopen(pathCache.string().c_str(), "rb");
+    CAutoFile filein(file, SER_DISK, CLIENT_VERSION);
+    if (filein.IsNull())
+        return false;
+
+    int nDataSize = boost::filesystem::file_size(pathCache) - sizeof(uint256);
+    if (nDataSize <= 0)
+        return error("%s : %s is truncated", __func__, ZEROCOIN_PARAMS_CACHE);
+
+    std::vector<unsigned char> vchData(nDataSize);
+    uint256 hashIn;
+    try {
+        filein.read((char*)&vchData[0], nDataSize);
+        filein >> hashIn;
+    } catch (const std::exception& e) {
+        return error("%s : Deserialize or I/O error - %s", __func__, e.what());
+    }
+    filein.fclose();
+
+    CDataStream ssParams(vchData, SER_DISK, CLIENT_VERSION);
+    if (hashIn != Hash(ssParams.begin(), ssParams.end()))
+        return error("%s : Checksum mismatch, data corrupted", __func__);
+
+    CZerocoinParamsCacheKey key(bnModulus);
+    CZerocoinParamsCacheKey keyIn(0);
+    try {
+        ssParams >> keyIn >> nDeriveMillis >> params;
+    } catch (const std::exception& e) {
+        return error("%s : Deserialize error - %s", __func__, e.what());
+    }
+
+    if (!(keyIn == key))
+        return error("%s : %s was derived from different parameters", __func__, ZEROCOIN_PARAMS_CACHE);
+    if (!params.initialized || !params.accumulatorParams.initialized || params.accumulatorParams.accumulatorModulus != bnModulus)
+        return error("%s : %s holds uninitialized parameters", __func__, ZEROCOIN_PARAMS_CACHE);
+
+    return true;
+}
+
+static bool WriteZerocoinParamsCache(const CBigNum& bnModulus, const libzerocoin::ZerocoinParams& params, int64_t nDeriveMillis)
+{
+    CDataStream ssParams(SER_DISK, CLIENT_VERSION);
+    ssParams << CZerocoinParamsCacheKey(bnModulus) << nDeriveMillis << params;
+    uint256 hash = Hash(ssParams.begin(), ssParams.end());
+    ssParams << hash;
+
+    // write to a temporary file first, so a reader never sees a partial cache
+    boost::filesystem::path pathCache = GetZerocoinParamsCacheDir() / ZEROCOIN_PARAMS_CACHE;
+    boost::filesystem::path pathTmp = GetZerocoinParamsCacheDir() / strprintf("%s.%08x", ZEROCOIN_PARAMS_CACHE, GetRand(std::numeric_limits<uint32_t>::max()));
+    FILE* file = fopen(pathTmp.string().c_str(), "wb");
+    CAutoFile fileout(file, SER_DISK, CLIENT_VERSION);
+    if (fileout.IsNull())
+        return error("%s : Failed to open file %s", __func__, pathTmp.string());
+
+    try {
+        fileout << ssParams;
+    } catch (const std::exception& e) {
+        return error("%s : Serialize or I/O error - %s", __func__, e.what());
+    }
+    FileCommit(fileout.Get());
+    fileout.fclose();
+
+    return RenameOver(pathTmp, pathCache);
+}
+
+static libzerocoin::ZerocoinParams LoadZerocoinParams(const CBigNum& bnModulus)
+{
+    int64_t nTimeStart = GetTimeMillis();
+    int64_t nDeriveMillis = 0;
+    libzerocoin::ZerocoinParams params;
+    if (ReadZerocoinParamsCache(bnModulus, params, nDeriveMillis)) {
+        // the exponentiation tables are not serialized
+        params.accumulatorParams.Precompute();
+        params.Precompute();
+        int64_t nLoadMillis = GetTimeMillis() - nTimeStart;
+        LogPrintf("Loaded zerocoin parameters from %s in %dms, saving %dms of derivation\n", ZEROCOIN_PARAMS_CACHE, nLoadMillis, std::max(nDeriveMillis - nLoadMillis, (int64_t)0));
+        return params;
+    }
+
+    libzerocoin::ZerocoinParams paramsDerived(bnModulus);
+    nDeriveMillis = GetTimeMillis() - nTimeStart;
+    LogPrintf("Derived zerocoin parameters in %dms\n", nDeriveMillis);
+    if (!WriteZerocoinParamsCache(bnModulus, paramsDerived, nDeriveMillis))
+        LogPrintf("%s : failed to write %s\n", __func__, ZEROCOIN_PARAMS_CACHE);
+
+    return paramsDerived;
+}
+
 libzerocoin::ZerocoinParams* CChainParams::Zerocoin_Params() const
 {
     assert(this);
     static CBigNum bnTrustedModulus(zerocoinModulus);
-    static libzerocoin::ZerocoinParams ZCParams = libzerocoin::ZerocoinParams(bnTrustedModulus);
+    static libzerocoin::ZerocoinParams ZCParams = LoadZerocoinParams(bnTrustedModulus);
 
     return &ZCParams;
 }
@@ -392,6 +533,7 @@ public:
     virtual void setDefaultConsistencyChecks(bool afDefaultConsistencyChecks) { fDefaultConsistencyChecks = afDefaultConsistencyChecks; }
     virtual void setAllowMinDifficultyBlocks(bool afAllowMinDifficultyBlocks) { fAllowMinDifficultyBlocks = afAllowMinDifficultyBlocks; }
     virtual void setSkipProofOfWorkCheck(bool afSkipProofOfWorkCheck) { fSkipProofOfWorkCheck = afSkipProofOfWorkCheck; }
+    virtual void setZerocoinStartHeight(int anZerocoinStartHeight) { nZerocoinStartHeight = anZerocoinStartHeight; }
 };
 static CUnitTestParams unitTestParams;
 
@@ -214,6 +214,22 @@ bool CCryptoKeyStore::Lock()
     return true;
 }
 
+bool CCryptoKeyStore::EncryptWithMasterKey(const CKeyingMaterial& vchPlaintext, const uint256& nIV, std::vector<unsigned char>& vchCiphertext) const
+{
+    LOCK(cs_KeyStore);
+    if (!IsCrypted() || vMasterKey.empty())
+        return false;
+    return EncryptSecret(vMasterKey, vchPlaintext, nIV, vchCiphertext);
+}
+
+bool CCryptoKeyStore::DecryptWithMasterKey(const std::vector<unsigned char>& vchCiphertext, const uint256& nIV, CKeyingMaterial& vchPlaintext) const
+{
+    LOCK(cs_KeyStore);
+    if (!IsCrypted() || vMasterKey.empty())
+        return false;
+    return DecryptSecret(vMasterKey, vchCiphertext, nIV, vchPlaintext);
+}
+
 bool CCryptoKeyStore::Unlock(const CKeyingMaterial& vMasterKeyIn)
 {
     {
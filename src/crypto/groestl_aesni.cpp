@@ -0,0 +1,207 @@
+// Copyright (c) 2017 The PIVX developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// Groestl-512 of a single 64-byte message with AES-NI, this file is compiled with -mssse3 -maes
+// and must only be called after QuarkAutoDetect has found AES-NI support.
+//
+// The 8x16 byte state is kept as eight rows of 16 bytes. AESENCLAST with a zero key does the
+// S-box on every byte once its input is shuffled to undo the AES ShiftRows, and that shuffle
+// also rotates the row as ShiftBytes needs. MixBytes is a linear combination of the rows.
+
+#if defined(HAVE_CONFIG_H)
+#include "config/pivx-config.h"
+#endif
+
+#if defined(ENABLE_AESNI)
+
+#include <immintrin.h>
+#include <stdint.h>
+
+namespace groestl_aesni
+{
+namespace
+{
+static const int ROUNDS = 14;
+
+// Row rotations of ShiftBytes for P1024 and Q1024
+static const int SHIFT_P[8] = {0, 1, 2, 3, 4, 5, 6, 11};
+static const int SHIFT_Q[8] = {1, 3, 5, 11, 0, 2, 4, 6};
+
+/** The pshufb mask that rotates a row left by n bytes and undoes the AES ShiftRows. */
+__m128i inline ShiftMask(int n)
+{
+    alignas(16) unsigned char mask[16];
+    for (int k = 0; k < 16; k++) {
+        int row = k % 4, col = k / 4;
+        mask[k] = (row + 4 * ((col - row + 4) % 4) + n) % 16;
+    }
+    return _mm_load_si128((const __m128i*)mask);
+}
+
+struct CShiftMasks {
+    __m128i p[8];
+    __m128i q[8];
+    __m128i col;
+
+    CShiftMasks()
+    {
+        alignas(16) unsigned char c[16];
+        for (int i = 0; i < 8; i++) {
+            p[i] = ShiftMask(SHIFT_P[i]);
+            q[i] = ShiftMask(SHIFT_Q[i]);
+        }
+        for (int j = 0; j < 16; j++)
+            c[j] = j << 4;
+        col = _mm_load_si128((const __m128i*)c);
+    }
+};
+
+const CShiftMasks& Masks()
+{
+    static const CShiftMasks masks;
+    return masks;
+}
+
+/** Multiply every byte by 2 in GF(2^8) with the AES polynomial */
+__m128i inline Mul2(__m128i x)
+{
+    __m128i carry = _mm_cmplt_epi8(x, _mm_setzero_si128());
+    return _mm_xor_si128(_mm_add_epi8(x, x), _mm_and_si128(carry, _mm_set1_epi8(0x1b)));
+}
+
+/**
+ * Multiply the rows by the circulant matrix circ(02, 02, 03, 04, 05, 03, 05, 07), written as
+ * out_i = X1_i ^ 2 * (X2_i ^ 2 * X4_i) with t_i = a_i ^ a_i+1 shared between the rows:
+ * X1_i = a_i+2 ^ t_i+4 ^ t_i+6, X2_i = t_i ^ a_i+2 ^ a_i+5 ^ a_i+7, X4_i = t_i+3 ^ t_i+6.
+ */
+#define MIX_ROW(o, i) o = _mm_xor_si128(_mm_xor_si128(a[(i + 2) & 7], _mm_xor_si128(t[(i + 4) & 7], t[(i + 6) & 7])), \
+                      Mul2(_mm_xor_si128(_mm_xor_si128(_mm_xor_si128(t[i], a[(i + 2) & 7]), _mm_xor_si128(a[(i + 5) & 7], a[(i + 7) & 7])), \
+                                         Mul2(_mm_xor_si128(t[(i + 3) & 7], t[(i + 6) & 7])))))
+
+void inline MixBytes(__m128i* a)
+{
+    __m128i t[8];
+    t[0] = _mm_xor_si128(a[0], a[1]);
+    t[1] = _mm_xor_si128(a[1], a[2]);
+    t[2] = _mm_xor_si128(a[2], a[3]);
+    t[3] = _mm_xor_si128(a[3], a[4]);
+    t[4] = _mm_xor_si128(a[4], a[5]);
+    t[5] = _mm_xor_si128(a[5], a[6]);
+    t[6] = _mm_xor_si128(a[6], a[7]);
+    t[7] = _mm_xor_si128(a[7], a[0]);
+    __m128i b0, b1, b2, b3, b4, b5, b6, b7;
+    MIX_ROW(b0, 0);
+    MIX_ROW(b1, 1);
+    MIX_ROW(b2, 2);
+    MIX_ROW(b3, 3);
+    MIX_ROW(b4, 4);
+    MIX_ROW(b5, 5);
+    MIX_ROW(b6, 6);
+    MIX_ROW(b7, 7);
+    a[0] = b0;
+    a[1] = b1;
+    a[2] = b2;
+    a[3] = b3;
+    a[4] = b4;
+    a[5] = b5;
+    a[6] = b6;
+    a[7] = b7;
+}
+
+#undef MIX_ROW
+
+/** AddRoundConstant has been applied, SubBytes and ShiftBytes with the given row masks then MixBytes */
+void inline SubShiftMix(__m128i* a, const __m128i* masks)
+{
+    const __m128i zero = _mm_setzero_si128();
+    a[0] = _mm_aesenclast_si128(_mm_shuffle_epi8(a[0], masks[0]), zero);
+    a[1] = _mm_aesenclast_si128(_mm_shuffle_epi8(a[1], masks[1]), zero);
+    a[2] = _mm_aesenclast_si128(_mm_shuffle_epi8(a[2], masks[2]), zero);
+    a[3] = _mm_aesenclast_si128(_mm_shuffle_epi8(a[3], masks[3]), zero);
+    a[4] = _mm_aesenclast_si128(_mm_shuffle_epi8(a[4], masks[4]), zero);
+    a[5] = _mm_aesenclast_si128(_mm_shuffle_epi8(a[5], masks[5]), zero);
+    a[6] = _mm_aesenclast_si128(_mm_shuffle_epi8(a[6], masks[6]), zero);
+    a[7] = _mm_aesenclast_si128(_mm_shuffle_epi8(a[7], masks[7]), zero);
+    MixBytes(a);
+}
+
+void inline PermP(__m128i* a, const CShiftMasks& masks)
+{
+    for (int r = 0; r < ROUNDS; r++) {
+        a[0] = _mm_xor_si128(a[0], _mm_xor_si128(masks.col, _mm_set1_epi8(r)));
+        SubShiftMix(a, masks.p);
+    }
+}
+
+void inline PermQ(__m128i* a, const CShiftMasks& masks)
+{
+    const __m128i ones = _mm_set1_epi8(-1);
+    for (int r = 0; r < ROUNDS; r++) {
+        a[0] = _mm_xor_si128(a[0], ones);
+        a[1] = _mm_xor_si128(a[1], ones);
+        a[2] = _mm_xor_si128(a[2], ones);
+        a[3] = _mm_xor_si128(a[3], ones);
+        a[4] = _mm_xor_si128(a[4], ones);
+        a[5] = _mm_xor_si128(a[5], ones);
+        a[6] = _mm_xor_si128(a[6], ones);
+        a[7] = _mm_xor_si128(a[7], _mm_xor_si128(ones, _mm_xor_si128(masks.col, _mm_set1_epi8(r))));
+        SubShiftMix(a, masks.q);
+    }
+}
+
+/** Load a 128-byte block, byte 8 * column + row, as rows */
+void inline LoadRows(__m128i* a, const unsigned char* in)
+{
+    alignas(16) unsigned char rows[8][16];
+    for (int j = 0; j < 16; j++) {
+        for (int i = 0; i < 8; i++)
+            rows[i][j] = in[8 * j + i];
+    }
+    for (int i = 0; i < 8; i++)
+        a[i] = _mm_load_si128((const __m128i*)rows[i]);
+}
+} // namespace
+
+void Hash64(const unsigned char* in, unsigned char* out)
+{
+    const CShiftMasks& masks = Masks();
+
+    // the only block of a 64-byte message: the message, a one bit and the block count
+    unsigned char block[128] = {0};
+    for (int k = 0; k < 64; k++)
+        block[k] = in[k];
+    block[64] = 0x80;
+    block[127] = 1;
+
+    __m128i m[8], h[8], p[8];
+    LoadRows(m, block);
+
+    // the initial chaining value only encodes the 512-bit output size
+    for (int i = 0; i < 8; i++)
+        h[i] = _mm_setzero_si128();
+    h[6] = _mm_insert_epi16(h[6], 0x0200, 7);
+
+    // compression: h = P(h ^ m) ^ Q(m) ^ h
+    for (int i = 0; i < 8; i++)
+        p[i] = _mm_xor_si128(h[i], m[i]);
+    PermP(p, masks);
+    PermQ(m, masks);
+    for (int i = 0; i < 8; i++)
+        h[i] = _mm_xor_si128(h[i], _mm_xor_si128(p[i], m[i]));
+
+    // output transformation: the last 512 bits of P(h) ^ h
+    for (int i = 0; i < 8; i++)
+        p[i] = h[i];
+    PermP(p, masks);
+    alignas(16) unsigned char rows[8][16];
+    for (int i = 0; i < 8; i++)
+        _mm_store_si128((__m128i*)rows[i], _mm_xor_si128(p[i], h[i]));
+    for (int j = 8; j < 16; j++) {
+        for (int i = 0; i < 8; i++)
+            out[8 * (j - 8) + i] = rows[i][j];
+    }
+}
+} // namespace groestl_aesni
+
+#endif // ENABLE_AESNI
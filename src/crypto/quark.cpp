@@ -0,0 +1,179 @@
+// Copyright (c) 2017 The PIVX developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#if defined(HAVE_CONFIG_H)
+#include "config/pivx-config.h"
+#endif
+
+#include "crypto/quark.h"
+
+#include "crypto/sph_blake.h"
+#include "crypto/sph_bmw.h"
+#include "crypto/sph_groestl.h"
+#include "crypto/sph_jh.h"
+#include "crypto/sph_keccak.h"
+#include "crypto/sph_skein.h"
+
+#include <string.h>
+
+#if defined(ENABLE_AESNI) && (defined(__x86_64__) || defined(__amd64__) || defined(__i386__))
+#include <cpuid.h>
+#define USE_QUARK_CPUID 1
+
+namespace groestl_aesni
+{
+void Hash64(const unsigned char* in, unsigned char* out);
+}
+#endif
+
+#if defined(__SSE2__)
+namespace jh_sse2
+{
+void Hash64(const unsigned char* in, unsigned char* out);
+}
+#endif
+
+// Every Quark round after the first hashes the 64-byte output of the previous one
+namespace
+{
+/** Hash a 64-byte input to a 64-byte output. */
+typedef void (*Hash64Fn)(const unsigned char* in, unsigned char* out);
+
+void Blake64(const unsigned char* in, unsigned char* out)
+{
+    sph_blake512_context ctx;
+    sph_blake512_init(&ctx);
+    sph_blake512(&ctx, in, 64);
+    sph_blake512_close(&ctx, out);
+}
+
+void Bmw64(const unsigned char* in, unsigned char* out)
+{
+    sph_bmw512_context ctx;
+    sph_bmw512_init(&ctx);
+    sph_bmw512(&ctx, in, 64);
+    sph_bmw512_close(&ctx, out);
+}
+
+void Groestl64(const unsigned char* in, unsigned char* out)
+{
+    sph_groestl512_context ctx;
+    sph_groestl512_init(&ctx);
+    sph_groestl512(&ctx, in, 64);
+    sph_groestl512_close(&ctx, out);
+}
+
+void JH64(const unsigned char* in, unsigned char* out)
+{
+    sph_jh512_context ctx;
+    sph_jh512_init(&ctx);
+    sph_jh512(&ctx, in, 64);
+    sph_jh512_close(&ctx, out);
+}
+
+void Keccak64(const unsigned char* in, unsigned char* out)
+{
+    sph_keccak512_context ctx;
+    sph_keccak512_init(&ctx);
+    sph_keccak512(&ctx, in, 64);
+    sph_keccak512_close(&ctx, out);
+}
+
+void Skein64(const unsigned char* in, unsigned char* out)
+{
+    sph_skein512_context ctx;
+    sph_skein512_init(&ctx);
+    sph_skein512(&ctx, in, 64);
+    sph_skein512_close(&ctx, out);
+}
+
+Hash64Fn groestl64 = Groestl64;
+
+// SSE2 is part of every x86-64 CPU, so its JH needs no detection
+#if defined(__SSE2__)
+Hash64Fn jh64 = jh_sse2::Hash64;
+const char* strJH = "sse2";
+#else
+Hash64Fn jh64 = JH64;
+const char* strJH = "standard";
+#endif
+} // namespace
+
+void Quark512(const unsigned char* data, size_t len, unsigned char hash[64])
+{
+    unsigned char a[64], b[64];
+
+    sph_blake512_context ctx_blake;
+    sph_blake512_init(&ctx_blake);
+    sph_blake512(&ctx_blake, data, len);
+    sph_blake512_close(&ctx_blake, a);
+
+    Bmw64(a, b);
+    if (b[0] & 8)
+        groestl64(b, a);
+    else
+        Skein64(b, a);
+
+    groestl64(a, b);
+    jh64(b, a);
+    if (a[0] & 8)
+        Blake64(a, b);
+    else
+        Bmw64(a, b);
+
+    Keccak64(b, a);
+    Skein64(a, b);
+    if (b[0] & 8)
+        Keccak64(b, hash);
+    else
+        jh64(b, hash);
+}
+
+std::string QuarkAutoDetect()
+{
+    std::string strGroestl = "standard";
+    groestl64 = Groestl64;
+#if defined(USE_QUARK_CPUID)
+    uint32_t eax, ebx, ecx, edx;
+    if (__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+        bool fSSSE3 = (ecx >> 9) & 1;
+        bool fAES = (ecx >> 25) & 1;
+        if (fSSSE3 && fAES) {
+            groestl64 = groestl_aesni::Hash64;
+            strGroestl = "aesni";
+        }
+    }
+#endif
+    return "groestl " + strGroestl + ", jh " + strJH;
+}
+
+bool QuarkSelfTest()
+{
+    // Quark of "The quick brown fox jumps over the lazy dog", the first 256 bits
+    static const unsigned char hashFox[32] = {
+        0x70, 0xec, 0xce, 0x6f, 0xe9, 0xc9, 0xe2, 0x04, 0x1c, 0xc9, 0x03, 0x24, 0xa5, 0x70, 0xb9, 0xed,
+        0x13, 0x29, 0xc7, 0xeb, 0xe9, 0x39, 0x7c, 0x5c, 0xef, 0x3d, 0xe8, 0x15, 0xc4, 0x61, 0x13, 0xa5};
+    static const char* strFox = "The quick brown fox jumps over the lazy dog";
+
+    unsigned char hash[64];
+    Quark512((const unsigned char*)strFox, strlen(strFox), hash);
+    if (memcmp(hash, hashFox, sizeof(hashFox)) != 0)
+        return false;
+
+    // the chosen Groestl and JH against the portable ones on a chain of inputs
+    unsigned char in[64], out[64], expected[64];
+    for (int i = 0; i < 64; i++)
+        in[i] = i;
+    for (int n = 0; n < 4; n++) {
+        Groestl64(in, expected);
+        groestl64(in, out);
+        if (memcmp(out, expected, sizeof(out)) != 0)
+            return false;
+        JH64(out, expected);
+        jh64(out, in);
+        if (memcmp(in, expected, sizeof(in)) != 0)
+            return false;
+    }
+    return true;
+}
@@ -0,0 +1,22 @@
+// Copyright (c) 2017 The PIVX developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef PIVX_CRYPTO_QUARK_H
+#define PIVX_CRYPTO_QUARK_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string>
+
+/** Compute the 512-bit Quark hash of len bytes. Keeps no state, so threads may hash concurrently. */
+void Quark512(const unsigned char* data, size_t len, unsigned char hash[64]);
+
+/** Autodetect the fastest Groestl and JH implementations for Quark512.
+ *  Call once at startup, before any other thread hashes. Returns the names of the implementations. */
+std::string QuarkAutoDetect();
+
+/** Check the implementations QuarkAutoDetect chose against the portable ones and a known hash. */
+bool QuarkSelfTest();
+
+#endif // PIVX_CRYPTO_QUARK_H
@@ -2,12 +2,45 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#if defined(HAVE_CONFIG_H)
+#include "config/pivx-config.h"
+#endif
+
 #include "crypto/sha256.h"
 
 #include "crypto/common.h"
 
 #include <string.h>
 
+#if defined(__x86_64__) || defined(__amd64__) || defined(__i386__)
+#if defined(ENABLE_SSE41) || defined(ENABLE_AVX2) || defined(ENABLE_SHANI)
+#include <cpuid.h>
+#define USE_SHA256_CPUID 1
+#endif
+#endif
+
+#if defined(ENABLE_SHANI)
+namespace sha256_shani
+{
+void Transform(uint32_t* s, const unsigned char* chunk, size_t blocks);
+}
+#endif
+
+#if defined(ENABLE_SSE41)
+namespace sha256_sse41
+{
+void Transform(uint32_t* s, const unsigned char* chunk, size_t blocks);
+void Transform4(uint32_t* s, const unsigned char** chunks);
+}
+#endif
+
+#if defined(ENABLE_AVX2)
+namespace sha256_avx2
+{
+void Transform8(uint32_t* s, const unsigned char** chunks);
+}
+#endif
+
 // Internal implementation code.
 namespace
 {
@@ -127,6 +160,97 @@ void Transform(uint32_t* s, const unsigned char* chunk)
     s[7] += h;
 }
 
+/** Perform SHA-256 transformations on a number of consecutive 64-byte chunks. */
+void TransformBlocks(uint32_t* s, const unsigned char* chunk, size_t blocks)
+{
+    while (blocks--) {
+        Transform(s, chunk);
+        chunk += 64;
+    }
+}
+
+/** The transform CSHA256 uses, chosen by SHA256AutoDetect. */
+typedef void (*TransformType)(uint32_t* s, const unsigned char* chunk, size_t blocks);
+
+TransformType transform = TransformBlocks;
+
+/** Single lane version of the multi-lane transforms, the state layout is the same as Transform's. */
+void Transform1(uint32_t* s, const unsigned char** chunks)
+{
+    Transform(s, chunks[0]);
+}
+
+/**
+ * Multi-lane transforms process one 64-byte chunk for each of nLanes independent states.
+ * The states are interleaved word by word: word i of lane j is s[i * nLanes + j].
+ */
+typedef void (*TransformLanesFn)(uint32_t* s, const unsigned char** chunks);
+
+TransformLanesFn transformLanes = Transform1;
+size_t nTransformLanes = 1;
+
+static const size_t MAX_LANES = 8;
+
+/** Double-SHA256 of nTransformLanes messages of nLen bytes, starting at in with a stride of nLen. */
+void DoubleHashLanes(unsigned char* out, const unsigned char* in, size_t nLen)
+{
+    const size_t nLanes = nTransformLanes;
+    const size_t nFull = nLen / 64;
+    const size_t nTail = nLen % 64;
+    // padding needs 9 bytes, so it spills into an extra chunk when the tail is longer than 55 bytes
+    const size_t nPadChunks = nTail < 56 ? 1 : 2;
+
+    uint32_t s[8 * MAX_LANES];
+    unsigned char pad[MAX_LANES][128];
+    const unsigned char* chunks[MAX_LANES];
+
+    for (size_t lane = 0; lane < nLanes; lane++) {
+        uint32_t init[8];
+        Initialize(init);
+        for (int i = 0; i < 8; i++)
+            s[i * nLanes + lane] = init[i];
+
+        unsigned char* p = pad[lane];
+        memset(p, 0, 64 * nPadChunks);
+        memcpy(p, in + lane * nLen + nFull * 64, nTail);
+        p[nTail] = 0x80;
+        WriteBE64(p + 64 * nPadChunks - 8, (uint64_t)nLen << 3);
+    }
+
+    for (size_t n = 0; n < nFull; n++) {
+        for (size_t lane = 0; lane < nLanes; lane++)
+            chunks[lane] = in + lane * nLen + n * 64;
+        transformLanes(s, chunks);
+    }
+    for (size_t n = 0; n < nPadChunks; n++) {
+        for (size_t lane = 0; lane < nLanes; lane++)
+            chunks[lane] = pad[lane] + n * 64;
+        transformLanes(s, chunks);
+    }
+
+    // second round: the 32-byte first hash padded to a single chunk
+    for (size_t lane = 0; lane < nLanes; lane++) {
+        unsigned char* p = pad[lane];
+        for (int i = 0; i < 8; i++)
+            WriteBE32(p + i * 4, s[i * nLanes + lane]);
+        memset(p + 32, 0, 32);
+        p[32] = 0x80;
+        WriteBE64(p + 56, 256);
+        chunks[lane] = p;
+
+        uint32_t init[8];
+        Initialize(init);
+        for (int i = 0; i < 8; i++)
+            s[i * nLanes + lane] = init[i];
+    }
+    transformLanes(s, chunks);
+
+    for (size_t lane = 0; lane < nLanes; lane++) {
+        for (int i = 0; i < 8; i++)
+            WriteBE32(out + lane * 32 + i * 4, s[i * nLanes + lane]);
+    }
+}
+
 } // namespace sha256
 } // namespace
 
@@ -147,14 +271,15 @@ CSHA256& CSHA256::Write(const unsigned char* data, size_t len)
         memcpy(buf + bufsize, data, 64 - bufsize);
         bytes += 64 - bufsize;
         data += 64 - bufsize;
-        sha256::Transform(s, buf);
+        sha256::transform(s, buf, 1);
         bufsize = 0;
     }
-    while (end >= data + 64) {
+    if (end >= data + 64) {
         // Process full chunks directly from the source.
-        sha256::Transform(s, data);
-        bytes += 64;
-        data += 64;
+        size_t blocks = (end - data) / 64;
+        sha256::transform(s, data, blocks);
+        bytes += 64 * blocks;
+        data += 64 * blocks;
     }
     if (end > data) {
         // Fill the buffer with what remains.
@@ -187,3 +312,133 @@ CSHA256& CSHA256::Reset()
     sha256::Initialize(s);
     return *this;
 }
+
+////// Batched double-SHA256
+
+std::string SHA256AutoDetect()
+{
+    std::string ret = "standard";
+    sha256::transform = sha256::TransformBlocks;
+    sha256::transformLanes = sha256::Transform1;
+    sha256::nTransformLanes = 1;
+#if defined(USE_SHA256_CPUID)
+    uint32_t eax, ebx, ecx, edx;
+    bool fSSE41 = false, fAVX2 = false, fSHANI = false;
+    std::string strBatch;
+    if (__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+        fSSE41 = (ecx >> 19) & 1;
+        // AVX needs the OS to save the ymm registers, check OSXSAVE and XCR0 before trusting CPUID
+        bool fOSAVX = false;
+        if ((ecx >> 27) & 1) {
+            uint32_t xcr0_lo, xcr0_hi;
+            __asm__("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+            fOSAVX = (xcr0_lo & 6) == 6;
+        }
+        if (__get_cpuid_max(0, NULL) >= 7) {
+            __cpuid_count(7, 0, eax, ebx, ecx, edx);
+            fAVX2 = fOSAVX && ((ebx >> 5) & 1);
+            fSHANI = fSSE41 && ((ebx >> 29) & 1);
+        }
+    }
+    // SHA-NI hashes a single message faster than the multi-lane transforms hash eight,
+    // the batches only go through the lanes without it
+    bool fLanes = true;
+#if defined(ENABLE_SSE41)
+    if (fSSE41) {
+        sha256::transform = sha256_sse41::Transform;
+        ret = "sse4";
+    }
+#endif
+#if defined(ENABLE_SHANI)
+    if (fSHANI) {
+        sha256::transform = sha256_shani::Transform;
+        ret = "shani";
+        fLanes = false;
+    }
+#endif
+#if defined(ENABLE_SSE41)
+    if (fLanes && fSSE41) {
+        sha256::transformLanes = sha256_sse41::Transform4;
+        sha256::nTransformLanes = 4;
+        strBatch = "4-way SSE4.1";
+    }
+#endif
+#if defined(ENABLE_AVX2)
+    if (fLanes && fAVX2) {
+        sha256::transformLanes = sha256_avx2::Transform8;
+        sha256::nTransformLanes = 8;
+        strBatch = "8-way AVX2";
+    }
+#endif
+    (void)fSSE41;
+    (void)fAVX2;
+    (void)fSHANI;
+    (void)fLanes;
+    if (!strBatch.empty())
+        ret += ", " + strBatch + " batches";
+#endif
+    return ret;
+}
+
+void SHA256DBatch(unsigned char* out, const unsigned char* in, size_t nLen, size_t nCount)
+{
+    const size_t nLanes = sha256::nTransformLanes;
+    if (nLanes > 1) {
+        while (nCount >= nLanes) {
+            sha256::DoubleHashLanes(out, in, nLen);
+            out += 32 * nLanes;
+            in += nLen * nLanes;
+            nCount -= nLanes;
+        }
+    }
+    // what does not fill all the lanes goes through the plain transform
+    unsigned char hash[CSHA256::OUTPUT_SIZE];
+    while (nCount > 0) {
+        CSHA256().Write(in, nLen).Finalize(hash);
+        CSHA256().Write(hash, sizeof(hash)).Finalize(out);
+        out += 32;
+        in += nLen;
+        nCount--;
+    }
+}
+
+bool SHA256SelfTest()
+{
+    static const unsigned char hashABC[CSHA256::OUTPUT_SIZE] = {
+        0xba, 0x78, 0x16, 0xbf, 0x8f, 0x01, 0xcf, 0xea, 0x41, 0x41, 0x40, 0xde, 0x5d, 0xae, 0x22, 0x23,
+        0xb0, 0x03, 0x61, 0xa3, 0x96, 0x17, 0x7a, 0x9c, 0xb4, 0x10, 0xff, 0x61, 0xf2, 0x00, 0x15, 0xad};
+    // SHA256 of the bytes 0..199, several chunks in one write
+    static const unsigned char hash200[CSHA256::OUTPUT_SIZE] = {
+        0x19, 0x01, 0xda, 0x1c, 0x9f, 0x69, 0x9b, 0x48, 0xf6, 0xb2, 0x63, 0x6e, 0x65, 0xcb, 0xf7, 0x3a,
+        0xbf, 0x99, 0xd0, 0x44, 0x1e, 0xf6, 0x7f, 0x5c, 0x54, 0x0a, 0x42, 0xf7, 0x05, 0x1d, 0xec, 0x6f};
+    // double-SHA256 of the bytes 0..63, a merkle node pair
+    static const unsigned char hash64D[CSHA256::OUTPUT_SIZE] = {
+        0x01, 0xc9, 0xf4, 0x64, 0x78, 0x0a, 0x1b, 0x6a, 0xf4, 0xeb, 0x40, 0x0f, 0xe2, 0xf2, 0x89, 0x6c,
+        0xfb, 0x21, 0x69, 0xf5, 0xa6, 0x57, 0x01, 0x43, 0x9e, 0x4c, 0x2c, 0x4e, 0x21, 0x39, 0x03, 0xef};
+
+    unsigned char data[200];
+    for (size_t i = 0; i < sizeof(data); i++)
+        data[i] = i;
+
+    // the single message transform picked by SHA256AutoDetect, one chunk and then three in one call
+    unsigned char hash[CSHA256::OUTPUT_SIZE];
+    CSHA256().Write((const unsigned char*)"abc", 3).Finalize(hash);
+    if (memcmp(hash, hashABC, sizeof(hash)) != 0)
+        return false;
+    CSHA256().Write(data, sizeof(data)).Finalize(hash);
+    if (memcmp(hash, hash200, sizeof(hash)) != 0)
+        return false;
+
+    // enough copies to fill the widest lanes and leave a remainder
+    static const size_t nCount = 9;
+    unsigned char in[64 * nCount];
+    unsigned char out[CSHA256::OUTPUT_SIZE * nCount];
+    for (size_t i = 0; i < nCount; i++)
+        memcpy(in + 64 * i, data, 64);
+    SHA256DBatch(out, in, 64, nCount);
+    for (size_t i = 0; i < nCount; i++) {
+        if (memcmp(out + CSHA256::OUTPUT_SIZE * i, hash64D, CSHA256::OUTPUT_SIZE) != 0)
+            return false;
+    }
+    return true;
+}
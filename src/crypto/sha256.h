@@ -7,6 +7,7 @@
 
 #include <stdint.h>
 #include <stdlib.h>
+#include <string>
 
 /** A hasher class for SHA-256. */
 class CSHA256
@@ -25,4 +26,15 @@ public:
     CSHA256& Reset();
 };
 
+/** Autodetect the best available SHA256 transform for CSHA256 and multi-lane implementation for SHA256DBatch.
+ *  Call once at startup, before any other thread hashes. Returns the names of the implementations. */
+std::string SHA256AutoDetect();
+
+/** Check the implementations SHA256AutoDetect chose against known hashes. */
+bool SHA256SelfTest();
+
+/** Compute the double-SHA256 of nCount independent messages of nLen bytes each.
+ *  The messages are read back to back from in, the 32-byte hashes are written back to back to out. */
+void SHA256DBatch(unsigned char* out, const unsigned char* in, size_t nLen, size_t nCount);
+
 #endif // BITCOIN_CRYPTO_SHA256_H
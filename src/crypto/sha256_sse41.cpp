@@ -0,0 +1,177 @@
+// Copyright (c) 2014 The Bitcoin developers
+// Copyright (c) 2017 The PIVX developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// SSE4.1 SHA-256 transforms, this file is compiled with -msse4.1 and must
+// only be called after SHA256AutoDetect has found SSE4.1 support. Transform4
+// hashes four messages in the lanes, Transform a single message with the
+// message schedule computed four words at a time.
+
+#if defined(HAVE_CONFIG_H)
+#include "config/pivx-config.h"
+#endif
+
+#if defined(ENABLE_SSE41)
+
+#include "crypto/common.h"
+
+#include <immintrin.h>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace sha256_sse41
+{
+namespace
+{
+alignas(16) const uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+__m128i inline Add(__m128i x, __m128i y) { return _mm_add_epi32(x, y); }
+__m128i inline Xor(__m128i x, __m128i y) { return _mm_xor_si128(x, y); }
+__m128i inline Or(__m128i x, __m128i y) { return _mm_or_si128(x, y); }
+__m128i inline And(__m128i x, __m128i y) { return _mm_and_si128(x, y); }
+__m128i inline Rotr(__m128i x, int n) { return Or(_mm_srli_epi32(x, n), _mm_slli_epi32(x, 32 - n)); }
+__m128i inline ShR(__m128i x, int n) { return _mm_srli_epi32(x, n); }
+
+__m128i inline Ch(__m128i x, __m128i y, __m128i z) { return Xor(z, And(x, Xor(y, z))); }
+__m128i inline Maj(__m128i x, __m128i y, __m128i z) { return Or(And(x, y), And(z, Or(x, y))); }
+__m128i inline Sigma0(__m128i x) { return Xor(Xor(Rotr(x, 2), Rotr(x, 13)), Rotr(x, 22)); }
+__m128i inline Sigma1(__m128i x) { return Xor(Xor(Rotr(x, 6), Rotr(x, 11)), Rotr(x, 25)); }
+__m128i inline sigma0(__m128i x) { return Xor(Xor(Rotr(x, 7), Rotr(x, 18)), ShR(x, 3)); }
+__m128i inline sigma1(__m128i x) { return Xor(Xor(Rotr(x, 17), Rotr(x, 19)), ShR(x, 10)); }
+
+uint32_t inline Ch(uint32_t x, uint32_t y, uint32_t z) { return z ^ (x & (y ^ z)); }
+uint32_t inline Maj(uint32_t x, uint32_t y, uint32_t z) { return (x & y) | (z & (x | y)); }
+uint32_t inline Sigma0(uint32_t x) { return (x >> 2 | x << 30) ^ (x >> 13 | x << 19) ^ (x >> 22 | x << 10); }
+uint32_t inline Sigma1(uint32_t x) { return (x >> 6 | x << 26) ^ (x >> 11 | x << 21) ^ (x >> 25 | x << 7); }
+
+/** One round of the single message transform, wk is the message word plus the round constant. */
+void inline Round(uint32_t a, uint32_t b, uint32_t c, uint32_t& d, uint32_t e, uint32_t f, uint32_t g, uint32_t& h, uint32_t wk)
+{
+    uint32_t t1 = h + Sigma1(e) + Ch(e, f, g) + wk;
+    uint32_t t2 = Sigma0(a) + Maj(a, b, c);
+    d += t1;
+    h = t1 + t2;
+}
+
+/** The next four message words from the last sixteen in x0..x3, oldest first. */
+__m128i inline Schedule(__m128i x0, __m128i x1, __m128i x2, __m128i x3)
+{
+    const __m128i lo = _mm_set_epi32(0, 0, -1, -1);
+    __m128i w = Add(Add(x0, sigma0(_mm_alignr_epi8(x1, x0, 4))), _mm_alignr_epi8(x3, x2, 4));
+    // the first two new words use the last two old ones, the other two the first two new ones
+    w = Add(w, And(sigma1(_mm_shuffle_epi32(x3, 0xfe)), lo));
+    return Add(w, _mm_andnot_si128(lo, sigma1(_mm_shuffle_epi32(w, 0x40))));
+}
+
+/** Rounds i..i+3 with the message words in x0, while the words of round i+16.. are scheduled.
+ *  Forced inline, at -O2 gcc keeps it out of line and the transform ends up slower than the portable one. */
+__attribute__((always_inline)) void inline QuadRound(uint32_t& a, uint32_t& b, uint32_t& c, uint32_t& d, uint32_t& e, uint32_t& f, uint32_t& g, uint32_t& h,
+                      __m128i& x0, __m128i& x1, __m128i& x2, __m128i& x3, int i)
+{
+    alignas(16) uint32_t wk[4];
+    _mm_store_si128((__m128i*)wk, Add(x0, _mm_load_si128((const __m128i*)&K[i])));
+    __m128i xn = i < 48 ? Schedule(x0, x1, x2, x3) : x0;
+    x0 = x1;
+    x1 = x2;
+    x2 = x3;
+    x3 = xn;
+    Round(a, b, c, d, e, f, g, h, wk[0]);
+    Round(h, a, b, c, d, e, f, g, wk[1]);
+    Round(g, h, a, b, c, d, e, f, wk[2]);
+    Round(f, g, h, a, b, c, d, e, wk[3]);
+}
+
+/** Load big endian word i of every lane's chunk. */
+__m128i inline Read(const unsigned char** chunks, int i)
+{
+    return _mm_set_epi32(ReadBE32(chunks[3] + i * 4), ReadBE32(chunks[2] + i * 4), ReadBE32(chunks[1] + i * 4), ReadBE32(chunks[0] + i * 4));
+}
+} // namespace
+
+void Transform4(uint32_t* s, const unsigned char** chunks)
+{
+    __m128i v[8];
+    for (int i = 0; i < 8; i++)
+        v[i] = _mm_loadu_si128((const __m128i*)(s + i * 4));
+
+    __m128i a = v[0], b = v[1], c = v[2], d = v[3], e = v[4], f = v[5], g = v[6], h = v[7];
+    __m128i w[16];
+    for (int i = 0; i < 64; i++) {
+        if (i < 16)
+            w[i] = Read(chunks, i);
+        else
+            w[i & 15] = Add(Add(w[i & 15], sigma1(w[(i + 14) & 15])), Add(w[(i + 9) & 15], sigma0(w[(i + 1) & 15])));
+
+        __m128i t1 = Add(Add(Add(h, Sigma1(e)), Add(Ch(e, f, g), _mm_set1_epi32(K[i]))), w[i & 15]);
+        __m128i t2 = Add(Sigma0(a), Maj(a, b, c));
+        h = g;
+        g = f;
+        f = e;
+        e = Add(d, t1);
+        d = c;
+        c = b;
+        b = a;
+        a = Add(t1, t2);
+    }
+
+    v[0] = Add(v[0], a);
+    v[1] = Add(v[1], b);
+    v[2] = Add(v[2], c);
+    v[3] = Add(v[3], d);
+    v[4] = Add(v[4], e);
+    v[5] = Add(v[5], f);
+    v[6] = Add(v[6], g);
+    v[7] = Add(v[7], h);
+    for (int i = 0; i < 8; i++)
+        _mm_storeu_si128((__m128i*)(s + i * 4), v[i]);
+}
+
+void Transform(uint32_t* s, const unsigned char* chunk, size_t blocks)
+{
+    // byte order of a big endian message word
+    const __m128i mask = _mm_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
+    while (blocks--) {
+        uint32_t a = s[0], b = s[1], c = s[2], d = s[3], e = s[4], f = s[5], g = s[6], h = s[7];
+        __m128i x0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)chunk), mask);
+        __m128i x1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(chunk + 16)), mask);
+        __m128i x2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(chunk + 32)), mask);
+        __m128i x3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(chunk + 48)), mask);
+        QuadRound(a, b, c, d, e, f, g, h, x0, x1, x2, x3, 0);
+        QuadRound(e, f, g, h, a, b, c, d, x0, x1, x2, x3, 4);
+        QuadRound(a, b, c, d, e, f, g, h, x0, x1, x2, x3, 8);
+        QuadRound(e, f, g, h, a, b, c, d, x0, x1, x2, x3, 12);
+        QuadRound(a, b, c, d, e, f, g, h, x0, x1, x2, x3, 16);
+        QuadRound(e, f, g, h, a, b, c, d, x0, x1, x2, x3, 20);
+        QuadRound(a, b, c, d, e, f, g, h, x0, x1, x2, x3, 24);
+        QuadRound(e, f, g, h, a, b, c, d, x0, x1, x2, x3, 28);
+        QuadRound(a, b, c, d, e, f, g, h, x0, x1, x2, x3, 32);
+        QuadRound(e, f, g, h, a, b, c, d, x0, x1, x2, x3, 36);
+        QuadRound(a, b, c, d, e, f, g, h, x0, x1, x2, x3, 40);
+        QuadRound(e, f, g, h, a, b, c, d, x0, x1, x2, x3, 44);
+        QuadRound(a, b, c, d, e, f, g, h, x0, x1, x2, x3, 48);
+        QuadRound(e, f, g, h, a, b, c, d, x0, x1, x2, x3, 52);
+        QuadRound(a, b, c, d, e, f, g, h, x0, x1, x2, x3, 56);
+        QuadRound(e, f, g, h, a, b, c, d, x0, x1, x2, x3, 60);
+        s[0] += a;
+        s[1] += b;
+        s[2] += c;
+        s[3] += d;
+        s[4] += e;
+        s[5] += f;
+        s[6] += g;
+        s[7] += h;
+        chunk += 64;
+    }
+}
+} // namespace sha256_sse41
+
+#endif // ENABLE_SSE41
@@ -0,0 +1,364 @@
+// Copyright (c) 2017 The PIVX developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef PIVX_FLATMAP_H
+#define PIVX_FLATMAP_H
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <iterator>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/**
+ * STL-like hash map with open addressing, for maps with many small entries that are
+ * cleared as a whole, like the coins cache.
+ *
+ * The table is an array of control bytes and an array of pointers to the entries. A control
+ * byte holds 7 bits of the hash of its entry, or marks the slot as empty or deleted. Lookups
+ * probe groups of 16 control bytes at once and only compare keys whose 7 bits match.
+ *
+ * The entries themselves are carved out of large chunks that clear() gives back at once.
+ * They never move, so pointers and references to them stay valid until they are erased.
+ * Iterators are positions in the table and are invalidated by inserts, as with the
+ * standard unordered containers. Erasing an entry does not move the others, so a loop can
+ * erase the entry it just stepped past.
+ */
+template <typename K, typename V, typename Hash>
+class flatmap
+{
+public:
+    typedef K key_type;
+    typedef V mapped_type;
+    typedef std::pair<const key_type, mapped_type> value_type;
+    typedef size_t size_type;
+
+    static const size_t GROUP_SIZE = 16;
+
+private:
+    // Disallow copies
+    flatmap(const flatmap&);
+    flatmap& operator=(const flatmap&);
+
+    /** Chunked storage for the entries, erased ones are reused before the next chunk */
+    class arena
+    {
+    private:
+        union node {
+            node* next;
+            typename std::aligned_storage<sizeof(value_type), alignof(value_type)>::type data;
+        };
+
+        static const size_t MIN_CHUNK_NODES = 16;
+        static const size_t MAX_CHUNK_NODES = 4096;
+
+        std::vector<node*> chunks;
+        size_t nChunkNodes; // nodes in the last chunk
+        size_t nUsed;       // nodes taken out of the last chunk
+        size_t nReserved;   // nodes in all chunks
+        node* freelist;
+
+    public:
+        arena() : nChunkNodes(0), nUsed(0), nReserved(0), freelist(NULL) {}
+        ~arena() { Reset(); }
+
+        void* Allocate()
+        {
+            if (freelist) {
+                node* p = freelist;
+                freelist = p->next;
+                return p;
+            }
+            if (nUsed == nChunkNodes) {
+                size_t n = chunks.empty() ? MIN_CHUNK_NODES : nChunkNodes < MAX_CHUNK_NODES ? nChunkNodes * 2 : MAX_CHUNK_NODES;
+                chunks.push_back(static_cast<node*>(::operator new(n * sizeof(node))));
+                nChunkNodes = n;
+                nUsed = 0;
+                nReserved += n;
+            }
+            return &chunks.back()[nUsed++];
+        }
+
+        void Free(void* p)
+        {
+            node* n = static_cast<node*>(p);
+            n->next = freelist;
+            freelist = n;
+        }
+
+        /** Give all chunks back, the entries must have been destroyed */
+        void Reset()
+        {
+            for (size_t i = 0; i < chunks.size(); i++)
+                ::operator delete(chunks[i]);
+            std::vector<node*>().swap(chunks);
+            nChunkNodes = 0;
+            nUsed = 0;
+            nReserved = 0;
+            freelist = NULL;
+        }
+
+        size_t ReservedBytes() const { return nReserved * sizeof(node); }
+        size_t ChunkCount() const { return chunks.size(); }
+    };
+
+    // Control bytes of free slots, those of used ones are 0..127 so the sign bit tells them apart
+    enum {
+        CTRL_EMPTY = -128,
+        CTRL_DELETED = -2,
+    };
+
+    std::vector<int8_t> ctrl;
+    std::vector<value_type*> slots;
+    size_t nSize;
+    // Empty slots that can still be used before the table has to grow, keeps it at most 7/8 full
+    size_t nGrowthLeft;
+    arena nodes;
+    Hash hasher;
+
+    static size_t MaxLoad(size_t nCapacity) { return nCapacity - nCapacity / 8; }
+
+    static uint32_t CountTrailingZeros(uint32_t x)
+    {
+#if defined(__GNUC__)
+        return __builtin_ctz(x);
+#else
+        uint32_t n = 0;
+        while (!(x & 1)) {
+            x >>= 1;
+            n++;
+        }
+        return n;
+#endif
+    }
+
+    /** Bit i is set if byte i of the group equals b */
+    static uint32_t MatchByte(const int8_t* group, int8_t b)
+    {
+#if defined(__SSE2__)
+        __m128i g = _mm_loadu_si128((const __m128i*)group);
+        return _mm_movemask_epi8(_mm_cmpeq_epi8(g, _mm_set1_epi8(b)));
+#else
+        uint32_t mask = 0;
+        for (size_t i = 0; i < GROUP_SIZE; i++)
+            mask |= (uint32_t)(group[i] == b) << i;
+        return mask;
+#endif
+    }
+
+    /** Bit i is set if slot i of the group is empty or deleted */
+    static uint32_t MatchFree(const int8_t* group)
+    {
+#if defined(__SSE2__)
+        return _mm_movemask_epi8(_mm_loadu_si128((const __m128i*)group));
+#else
+        uint32_t mask = 0;
+        for (size_t i = 0; i < GROUP_SIZE; i++)
+            mask |= (uint32_t)(group[i] < 0) << i;
+        return mask;
+#endif
+    }
+
+    size_t GroupMask() const { return ctrl.size() / GROUP_SIZE - 1; }
+
+    /** Position of the entry with this key, or the capacity if there is none */
+    size_t FindPos(const key_type& key, size_t hash) const
+    {
+        if (ctrl.empty())
+            return 0;
+        const size_t mask = GroupMask();
+        const int8_t h2 = hash & 0x7f;
+        size_t g = (hash >> 7) & mask;
+        // Triangular probing visits every group, and a table that is at most 7/8 full has an empty slot
+        for (size_t step = 1;; step++) {
+            const int8_t* group = &ctrl[g * GROUP_SIZE];
+            for (uint32_t match = MatchByte(group, h2); match; match &= match - 1) {
+                size_t pos = g * GROUP_SIZE + CountTrailingZeros(match);
+                if (slots[pos]->first == key)
+                    return pos;
+            }
+            if (MatchByte(group, CTRL_EMPTY))
+                return ctrl.size();
+            g = (g + step) & mask;
+        }
+    }
+
+    /** First free slot on the probe sequence of this hash, there must be one */
+    size_t FindFree(size_t hash) const
+    {
+        const size_t mask = GroupMask();
+        size_t g = (hash >> 7) & mask;
+        for (size_t step = 1;; step++) {
+            uint32_t match = MatchFree(&ctrl[g * GROUP_SIZE]);
+            if (match)
+                return g * GROUP_SIZE + CountTrailingZeros(match);
+            g = (g + step) & mask;
+        }
+    }
+
+    /** Rebuild the table with room for at least twice the current entries, which drops the deleted slots */
+    void Rehash()
+    {
+        size_t nCapacity = GROUP_SIZE;
+        while (MaxLoad(nCapacity) < 2 * (nSize + 1))
+            nCapacity *= 2;
+
+        std::vector<int8_t> ctrlOld(nCapacity, CTRL_EMPTY);
+        std::vector<value_type*> slotsOld(nCapacity, NULL);
+        ctrl.swap(ctrlOld);
+        slots.swap(slotsOld);
+        for (size_t i = 0; i < ctrlOld.size(); i++) {
+            if (ctrlOld[i] < 0)
+                continue;
+            size_t pos = FindFree(hasher(slotsOld[i]->first));
+            ctrl[pos] = ctrlOld[i];
+            slots[pos] = slotsOld[i];
+        }
+        nGrowthLeft = MaxLoad(nCapacity) - nSize;
+    }
+
+    size_t NextUsed(size_t pos) const
+    {
+        while (pos < ctrl.size() && ctrl[pos] < 0)
+            pos++;
+        return pos;
+    }
+
+    template <typename Map, typename Value>
+    class iterator_base : public std::iterator<std::forward_iterator_tag, Value>
+    {
+    private:
+        Map* map;
+        size_t pos;
+
+        iterator_base(Map* mapIn, size_t posIn) : map(mapIn), pos(posIn) {}
+
+        friend class flatmap;
+        template <typename, typename>
+        friend class iterator_base;
+
+    public:
+        iterator_base() : map(NULL), pos(0) {}
+
+        template <typename Map2, typename Value2>
+        iterator_base(const iterator_base<Map2, Value2>& it) : map(it.map), pos(it.pos) {}
+
+        Value& operator*() const { return *map->slots[pos]; }
+        Value* operator->() const { return map->slots[pos]; }
+
+        iterator_base& operator++()
+        {
+            pos = map->NextUsed(pos + 1);
+            return *this;
+        }
+        iterator_base operator++(int)
+        {
+            iterator_base ret = *this;
+            ++*this;
+            return ret;
+        }
+
+        bool operator==(const iterator_base& it) const { return pos == it.pos; }
+        bool operator!=(const iterator_base& it) const { return pos != it.pos; }
+    };
+
+public:
+    typedef iterator_base<flatmap, value_type> iterator;
+    typedef iterator_base<const flatmap, const value_type> const_iterator;
+
+    explicit flatmap(const Hash& hasherIn = Hash()) : nSize(0), nGrowthLeft(0), hasher(hasherIn) {}
+    ~flatmap() { clear(); }
+
+    iterator begin() { return iterator(this, NextUsed(0)); }
+    iterator end() { return iterator(this, ctrl.size()); }
+    const_iterator begin() const { return const_iterator(this, NextUsed(0)); }
+    const_iterator end() const { return const_iterator(this, ctrl.size()); }
+
+    size_type size() const { return nSize; }
+    bool empty() const { return nSize == 0; }
+    /** Number of slots in the table */
+    size_type bucket_count() const { return ctrl.size(); }
+    /** Bytes held by the chunks the entries are stored in, and the number of chunks */
+    size_t node_bytes() const { return nodes.ReservedBytes(); }
+    size_t node_chunks() const { return nodes.ChunkCount(); }
+
+    iterator find(const key_type& key) { return iterator(this, FindPos(key, hasher(key))); }
+    const_iterator find(const key_type& key) const { return const_iterator(this, FindPos(key, hasher(key))); }
+    size_type count(const key_type& key) const { return FindPos(key, hasher(key)) != ctrl.size(); }
+
+    std::pair<iterator, bool> insert(const value_type& x)
+    {
+        size_t hash = hasher(x.first);
+        size_t pos = FindPos(x.first, hash);
+        if (pos != ctrl.size())
+            return std::make_pair(iterator(this, pos), false);
+
+        if (nGrowthLeft == 0)
+            Rehash();
+        pos = FindFree(hash);
+        slots[pos] = new (nodes.Allocate()) value_type(x);
+        if (ctrl[pos] == CTRL_EMPTY)
+            nGrowthLeft--;
+        ctrl[pos] = hash & 0x7f;
+        nSize++;
+        return std::make_pair(iterator(this, pos), true);
+    }
+
+    mapped_type& operator[](const key_type& key)
+    {
+        return insert(value_type(key, mapped_type())).first->second;
+    }
+
+    void erase(iterator it)
+    {
+        size_t pos = it.pos;
+        assert(pos < ctrl.size() && ctrl[pos] >= 0);
+        slots[pos]->~value_type();
+        nodes.Free(slots[pos]);
+        slots[pos] = NULL;
+        nSize--;
+        // A lookup stops at the first group with an empty slot, so no probe sequence went past
+        // this group if it has one, and the slot can be empty again rather than deleted.
+        const int8_t* group = &ctrl[pos - pos % GROUP_SIZE];
+        if (MatchByte(group, CTRL_EMPTY)) {
+            ctrl[pos] = CTRL_EMPTY;
+            nGrowthLeft++;
+        } else {
+            ctrl[pos] = CTRL_DELETED;
+        }
+    }
+
+    size_type erase(const key_type& key)
+    {
+        iterator it = find(key);
+        if (it == end())
+            return 0;
+        erase(it);
+        return 1;
+    }
+
+    /** Destroy all entries and release the table and the chunks holding them */
+    void clear()
+    {
+        for (size_t i = 0; i < ctrl.size(); i++) {
+            if (ctrl[i] >= 0)
+                slots[i]->~value_type();
+        }
+        std::vector<int8_t>().swap(ctrl);
+        std::vector<value_type*>().swap(slots);
+        nodes.Reset();
+        nSize = 0;
+        nGrowthLeft = 0;
+    }
+};
+
+#endif // PIVX_FLATMAP_H
@@ -15,8 +15,11 @@
 #include "activemasternode.h"
 #include "addrman.h"
 #include "amount.h"
+#include "blockreader.h"
 #include "checkpoints.h"
 #include "compat/sanity.h"
+#include "crypto/quark.h"
+#include "crypto/sha256.h"
 #include "key.h"
 #include "main.h"
 #include "masternode-budget.h"
@@ -35,6 +38,7 @@
 #include "util.h"
 #include "utilmoneystr.h"
 #include "validationinterface.h"
+#include "zerocoincache.h"
 #ifdef ENABLE_WALLET
 #include "db.h"
 #include "wallet.h"
@@ -224,6 +228,7 @@ void PrepareShutdown()
         delete pSporkDB;
         pSporkDB = NULL;
     }
+    UnmapBlockFiles();
 #ifdef ENABLE_WALLET
     if (pwalletMain)
         bitdb.Flush(true);
@@ -322,6 +327,7 @@ std::string HelpMessage(HelpMessageMode mode)
         strUsage += HelpMessageOpt("-daemon", _("Run in the background as a daemon and accept commands"));
 #endif
     }
+    strUsage += HelpMessageOpt("-blockcheckthreads=<n>", strprintf(_("Set the number of threads checking downloaded blocks during the initial sync (0 = auto, <0 = off, default: %d)"), DEFAULT_BLOCK_CHECK_THREADS));
     strUsage += HelpMessageOpt("-datadir=<dir>", _("Specify data directory"));
     strUsage += HelpMessageOpt("-dbcache=<n>", strprintf(_("Set database cache size in megabytes (%d to %d, default: %d)"), nMinDbCache, nMaxDbCache, nDefaultDbCache));
     strUsage += HelpMessageOpt("-loadblock=<file>", _("Imports blocks from external blk000??.dat file") + " " + _("on startup"));
@@ -419,6 +425,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageGroup(_("Debugging/Testing options:"));
     if (GetBoolArg("-help-debug", false)) {
         strUsage += HelpMessageOpt("-checkblockindex", strprintf("Do a full consistency check for mapBlockIndex, setBlockIndexCandidates, chainActive and mapBlocksUnlinked occasionally. Also sets -checkmempool (default: %u)", Params(CBaseChainParams::MAIN).DefaultConsistencyChecks()));
+        strUsage += HelpMessageOpt("-checkblockreads", strprintf("Hash the header of every block read from disk again, also for blocks connected with valid scripts (default: %u)", DEFAULT_CHECK_BLOCK_READS));
         strUsage += HelpMessageOpt("-checkmempool=<n>", strprintf("Run checks every <n> transactions (default: %u)", Params(CBaseChainParams::MAIN).DefaultConsistencyChecks()));
         strUsage += HelpMessageOpt("-checkpoints", strprintf(_("Only accept block chain matching built-in checkpoints (default: %u)"), 1));
         strUsage += HelpMessageOpt("-dblogsize=<n>", strprintf(_("Flush database activity from memory pool to disk log every <n> megabytes (default: %u)"), 100));
@@ -430,6 +437,7 @@ std::string HelpMessage(HelpMessageMode mode)
         strUsage += HelpMessageOpt("-maxreorg", strprintf(_("Use a custom max chain reorganization depth (default: %u)"), 100));
         strUsage += HelpMessageOpt("-stopafterblockimport", strprintf(_("Stop running after importing blocks from disk (default: %u)"), 0));
         strUsage += HelpMessageOpt("-sporkkey=<privkey>", _("Enable spork administration functionality with the appropriate private key."));
+        strUsage += HelpMessageOpt("-zerocoinparamsdir=<dir>", "Read and write the derived zerocoin parameters in <dir> instead of the data directory");
     }
     string debugCategories = "addrman, alert, bench, coindb, db, lock, rand, rpc, selectcoins, tor, mempool, net, proxy, pivx, (obfuscation, swiftx, masternode, mnpayments, mnbudget, zero)"; // Don't translate these and qt below
     if (mode == HMM_BITCOIN_QT)
@@ -449,6 +457,9 @@ std::string HelpMessage(HelpMessageMode mode)
         strUsage += HelpMessageOpt("-limitfreerelay=<n>", strprintf(_("Continuously rate-limit free transactions to <n>*1000 bytes per minute (default:%u)"), 15));
         strUsage += HelpMessageOpt("-relaypriority", strprintf(_("Require high priority for relaying free or low-fee transactions (default:%u)"), 1));
         strUsage += HelpMessageOpt("-maxsigcachesize=<n>", strprintf(_("Limit size of signature cache to <n> entries (default: %u)"), 50000));
+        strUsage += HelpMessageOpt("-maxzerocoinspendcache=<n>", strprintf(_("Limit size of verified zerocoin spend cache to <n> entries (default: %u)"), DEFAULT_MAX_ZEROCOINSPEND_CACHE));
+        strUsage += HelpMessageOpt("-accumulatorcache=<n>", strprintf(_("Keep at most <n> zerocoin accumulator values in memory (default: %u)"), DEFAULT_ACCUMULATOR_CACHE));
+        strUsage += HelpMessageOpt("-maxpubcoincache=<n>", strprintf(_("Limit size of validated zerocoin mint cache to <n> entries (default: %u)"), DEFAULT_MAX_PUBCOIN_CACHE));
     }
     strUsage += HelpMessageOpt("-minrelaytxfee=<amt>", strprintf(_("Fees (in PIV/Kb) smaller than this are considered zero fee for relaying (default: %s)"), FormatMoney(::minRelayTxFee.GetFeePerK())));
     strUsage += HelpMessageOpt("-printtoconsole", strprintf(_("Send trace/debug info to console instead of debug.log file (default: %u)"), 0));
@@ -467,6 +478,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageGroup(_("Staking options:"));
     strUsage += HelpMessageOpt("-staking=<n>", strprintf(_("Enable staking functionality (0-1, default: %u)"), 1));
     strUsage += HelpMessageOpt("-reservebalance=<amt>", _("Keep the specified amount available for spending at all times (default: 0)"));
+    strUsage += HelpMessageOpt("-stakethreads=<n>", strprintf(_("Number of threads searching for stake kernels (0 = one per core, default: %d)"), DEFAULT_STAKE_THREADS));
     if (GetBoolArg("-help-debug", false)) {
         strUsage += HelpMessageOpt("-printstakemodifier", _("Display the stake modifier calculations in the debug.log file."));
         strUsage += HelpMessageOpt("-printcoinstake", _("Display verbose coin stake messages in the debug.log file."));
@@ -484,6 +496,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageGroup(_("Zerocoin options:"));
     strUsage += HelpMessageOpt("-enablezeromint=<n>", strprintf(_("Enable automatic Zerocoin minting (0-1, default: %u)"), 1));
     strUsage += HelpMessageOpt("-zeromintpercentage=<n>", strprintf(_("Percentage of automatically minted Zerocoin  (10-100, default: %u)"), 10));
+    strUsage += HelpMessageOpt("-zeromintpool=<n>", strprintf(_("Pre-generate <n> Zerocoin mints of each denomination in the background while the wallet is unlocked (default: %u)"), 0));
     strUsage += HelpMessageOpt("-preferredDenom=<n>", strprintf(_("Preferred Denomination for automatically minted Zerocoin  (1/5/10/50/100/500/1000/5000), 0 for no preference. default: %u)"), 0));
     strUsage += HelpMessageOpt("-backupzpiv=<n>", strprintf(_("Enable automatic wallet backups triggered after each zPiv minting (0-1, default: %u)"), 1));
 
@@ -637,6 +650,16 @@ bool InitSanityCheck(void)
     if (!glibc_sanity_test() || !glibcxx_sanity_test())
         return false;
 
+    if (!SHA256SelfTest()) {
+        InitError("SHA256 self-test failed for the detected implementation.");
+        return false;
+    }
+
+    if (!QuarkSelfTest()) {
+        InitError("Quark self-test failed for the detected implementation.");
+        return false;
+    }
+
     return true;
 }
 
@@ -820,6 +843,7 @@ bool AppInit2(boost::thread_group& threadGroup)
     // Checkmempool and checkblockindex default to true in regtest mode
     mempool.setSanityCheck(GetBoolArg("-checkmempool", Params().DefaultConsistencyChecks()));
     fCheckBlockIndex = GetBoolArg("-checkblockindex", Params().DefaultConsistencyChecks());
+    fCheckBlockReads = GetBoolArg("-checkblockreads", DEFAULT_CHECK_BLOCK_READS);
     Checkpoints::fEnabled = GetBoolArg("-checkpoints", true);
 
     // -par=0 means autodetect, but nScriptCheckThreads==0 means no concurrency
@@ -831,6 +855,15 @@ bool AppInit2(boost::thread_group& threadGroup)
     else if (nScriptCheckThreads > MAX_SCRIPTCHECK_THREADS)
         nScriptCheckThreads = MAX_SCRIPTCHECK_THREADS;
 
+    // -blockcheckthreads=0 means one per core, but nBlockCheckThreads==0 means no pipeline
+    nBlockCheckThreads = GetArg("-blockcheckthreads", DEFAULT_BLOCK_CHECK_THREADS);
+    if (nBlockCheckThreads == 0)
+        nBlockCheckThreads = boost::thread::hardware_concurrency();
+    if (nBlockCheckThreads < 0)
+        nBlockCheckThreads = 0;
+    else if (nBlockCheckThreads > MAX_SCRIPTCHECK_THREADS)
+        nBlockCheckThreads = MAX_SCRIPTCHECK_THREADS;
+
     fServer = GetBoolArg("-server", false);
     setvbuf(stdout, NULL, _IOLBF, 0); /// ***TODO*** do we still need this after -printtoconsole is gone?
 
@@ -914,6 +947,9 @@ bool AppInit2(boost::thread_group& threadGroup)
 
     // ********************************************************* Step 4: application initialization: dir lock, daemonize, pidfile, debug log
 
+    std::string strSHA256Impl = SHA256AutoDetect();
+    std::string strQuarkImpl = QuarkAutoDetect();
+
     // Sanity check
     if (!InitSanityCheck())
         return InitError(_("Initialization sanity check failed. PIVX Core is shutting down."));
@@ -942,6 +978,8 @@ bool AppInit2(boost::thread_group& threadGroup)
     LogPrintf("\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n");
     LogPrintf("PIVX version %s (%s)\n", FormatFullVersion(), CLIENT_DATE);
     LogPrintf("Using OpenSSL version %s\n", SSLeay_version(SSLEAY_VERSION));
+    LogPrintf("Using SHA256 implementation: %s\n", strSHA256Impl);
+    LogPrintf("Using Quark implementation: %s\n", strQuarkImpl);
 #ifdef ENABLE_WALLET
     LogPrintf("Using BerkeleyDB version %s\n", DbEnv::version(0, 0, 0));
 #endif
@@ -955,8 +993,17 @@ bool AppInit2(boost::thread_group& threadGroup)
 
     LogPrintf("Using %u threads for script verification\n", nScriptCheckThreads);
     if (nScriptCheckThreads) {
-        for (int i = 0; i < nScriptCheckThreads - 1; i++)
+        for (int i = 0; i < nScriptCheckThreads - 1; i++) {
             threadGroup.create_thread(&ThreadScriptCheck);
+            threadGroup.create_thread(&ThreadZerocoinSpendCheck);
+        }
+    }
+
+    LogPrintf("Using %u threads for the initial sync block pipeline\n", nBlockCheckThreads);
+    if (nBlockCheckThreads) {
+        for (int i = 0; i < nBlockCheckThreads; i++)
+            threadGroup.create_thread(&ThreadBlockPreCheck);
+        threadGroup.create_thread(&ThreadBlockConnect);
     }
 
     if (mapArgs.count("-sporkkey")) // spork priv key
@@ -1291,7 +1338,11 @@ bool AppInit2(boost::thread_group& threadGroup)
     nTotalCache -= nBlockTreeDBCache;
     size_t nCoinDBCache = nTotalCache / 2; // use half of the remaining cache for coindb cache
     nTotalCache -= nCoinDBCache;
-    nCoinCacheSize = nTotalCache / 300; // coins in memory require around 300 bytes
+    nCoinCacheUsage = nTotalCache;
+    LogPrintf("Cache configuration:\n");
+    LogPrintf("* Using %.1fMiB for block index database\n", nBlockTreeDBCache * (1.0 / 1024 / 1024));
+    LogPrintf("* Using %.1fMiB for chain state database\n", nCoinDBCache * (1.0 / 1024 / 1024));
+    LogPrintf("* Using %.1fMiB for in-memory UTXO set\n", nCoinCacheUsage * (1.0 / 1024 / 1024));
 
     bool fLoaded = false;
     while (!fLoaded) {
@@ -1318,6 +1369,15 @@ bool AppInit2(boost::thread_group& threadGroup)
                 pcoinscatcher = new CCoinsViewErrorCatcher(pcoinsdbview);
                 pcoinsTip = new CCoinsViewCache(pcoinscatcher);
 
+                if (!pcoinsdbview->Upgrade()) {
+                    strLoadError = _("Error upgrading chainstate database");
+                    break;
+                }
+                if (fRequestShutdown) {
+                    LogPrintf("Shutdown requested. Exiting.\n");
+                    return false;
+                }
+
                 if (fReindex)
                     pblocktree->WriteReindexing(true);
 
@@ -1801,6 +1861,14 @@ bool AppInit2(boost::thread_group& threadGroup)
 
         // Run a thread to flush wallet periodically
         threadGroup.create_thread(boost::bind(&ThreadFlushWalletDB, boost::ref(pwalletMain->strWalletFile)));
+
+        // Advance the tracked zerocoin witnesses as the chain grows
+        threadGroup.create_thread(boost::bind(&ThreadZerocoinWitnesses, pwalletMain));
+
+        // Keep a pool of pre-generated zerocoin mints
+        int nMintPoolSize = GetArg("-zeromintpool", 0);
+        if (nMintPoolSize > 0)
+            threadGroup.create_thread(boost::bind(&ThreadMintPool, pwalletMain, (unsigned int)nMintPoolSize));
     }
 #endif
 
@@ -4,9 +4,14 @@
 // Distributed under the MIT/X11 software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <atomic>
+
 #include <boost/assign/list_of.hpp>
 #include <boost/lexical_cast.hpp>
+#include <boost/thread.hpp>
 
+#include "crypto/common.h"
+#include "crypto/sha256.h"
 #include "db.h"
 #include "kernel.h"
 #include "script/interpreter.h"
@@ -240,14 +245,42 @@ bool ComputeNextStakeModifier(const CBlockIndex* pindexPrev, uint64_t& nStakeMod
     return true;
 }
 
+// The stake modifier of a kernel, found by walking the active chain from the kernel's block
+struct CKernelStakeModifier {
+    //! the block the walk stopped at, the result holds while it is in the active chain
+    const CBlockIndex* pindex;
+    uint64_t nStakeModifier;
+    int nStakeModifierHeight;
+    int64_t nStakeModifierTime;
+};
+
+static const size_t MAX_KERNEL_STAKE_MODIFIER_CACHE = 50000;
+static std::map<uint256, CKernelStakeModifier> mapKernelStakeModifiers;
+static CCriticalSection cs_mapKernelStakeModifiers;
+
 // The stake modifier used to hash for a stake kernel is chosen as the stake
 // modifier about a selection interval later than the coin generating the kernel
 bool GetKernelStakeModifier(uint256 hashBlockFrom, uint64_t& nStakeModifier, int& nStakeModifierHeight, int64_t& nStakeModifierTime, bool fPrintProofOfStake)
 {
     nStakeModifier = 0;
-    if (!mapBlockIndex.count(hashBlockFrom))
+    BlockMap::iterator mi = mapBlockIndex.find(hashBlockFrom);
+    if (mi == mapBlockIndex.end())
         return error("GetKernelStakeModifier() : block not indexed");
-    const CBlockIndex* pindexFrom = mapBlockIndex[hashBlockFrom];
+
+    {
+        // a cached walk is still valid if the block it stopped at was not reorganized away,
+        // the blocks before it are then the same ones
+        LOCK(cs_mapKernelStakeModifiers);
+        std::map<uint256, CKernelStakeModifier>::const_iterator it = mapKernelStakeModifiers.find(hashBlockFrom);
+        if (it != mapKernelStakeModifiers.end() && chainActive.Contains(it->second.pindex)) {
+            nStakeModifier = it->second.nStakeModifier;
+            nStakeModifierHeight = it->second.nStakeModifierHeight;
+            nStakeModifierTime = it->second.nStakeModifierTime;
+            return true;
+        }
+    }
+
+    const CBlockIndex* pindexFrom = mi->second;
     nStakeModifierHeight = pindexFrom->nHeight;
     nStakeModifierTime = pindexFrom->GetBlockTime();
     int64_t nStakeModifierSelectionInterval = GetStakeModifierSelectionInterval();
@@ -269,6 +302,17 @@ bool GetKernelStakeModifier(uint256 hashBlockFrom, uint64_t& nStakeModifier, int
         }
     }
     nStakeModifier = pindex->nStakeModifier;
+
+    CKernelStakeModifier entry;
+    entry.pindex = pindex;
+    entry.nStakeModifier = nStakeModifier;
+    entry.nStakeModifierHeight = nStakeModifierHeight;
+    entry.nStakeModifierTime = nStakeModifierTime;
+
+    LOCK(cs_mapKernelStakeModifiers);
+    if (mapKernelStakeModifiers.size() >= MAX_KERNEL_STAKE_MODIFIER_CACHE)
+        mapKernelStakeModifiers.clear();
+    mapKernelStakeModifiers[hashBlockFrom] = entry;
     return true;
 }
 
@@ -290,11 +334,10 @@ bool stakeTargetHit(uint256 hashProofOfStake, int64_t nValueIn, uint256 bnTarget
 }
 
 //instead of looping outside and reinitializing variables many times, we will give a nTimeTx and also search interval so that we can do all the hashing here
-bool CheckStakeKernelHash(unsigned int nBits, const CBlock blockFrom, const CTransaction txPrev, const COutPoint prevout, unsigned int& nTimeTx, unsigned int nHashDrift, bool fCheck, uint256& hashProofOfStake, bool fPrintProofOfStake)
+bool CheckStakeKernelHash(unsigned int nBits, const CBlockIndex* pindexFrom, CAmount nValueIn, const COutPoint prevout, unsigned int& nTimeTx, unsigned int nHashDrift, bool fCheck, uint256& hashProofOfStake, bool fPrintProofOfStake)
 {
     //assign new variables to make it easier to read
-    int64_t nValueIn = txPrev.vout[prevout.n].nValue;
-    unsigned int nTimeBlockFrom = blockFrom.GetBlockTime();
+    unsigned int nTimeBlockFrom = pindexFrom->GetBlockTime();
 
     if (nTimeTx < nTimeBlockFrom) // Transaction timestamp violation
         return error("CheckStakeKernelHash() : nTime violation");
@@ -310,7 +353,7 @@ bool CheckStakeKernelHash(unsigned int nBits, const CBlock blockFrom, const CTra
     uint64_t nStakeModifier = 0;
     int nStakeModifierHeight = 0;
     int64_t nStakeModifierTime = 0;
-    if (!GetKernelStakeModifier(blockFrom.GetHash(), nStakeModifier, nStakeModifierHeight, nStakeModifierTime, fPrintProofOfStake)) {
+    if (!GetKernelStakeModifier(pindexFrom->GetBlockHash(), nStakeModifier, nStakeModifierHeight, nStakeModifierTime, fPrintProofOfStake)) {
         LogPrintf("CheckStakeKernelHash(): failed to get kernel stake modifier \n");
         return false;
     }
@@ -350,8 +393,8 @@ bool CheckStakeKernelHash(unsigned int nBits, const CBlock blockFrom, const CTra
             LogPrintf("CheckStakeKernelHash() : using modifier %s at height=%d timestamp=%s for block from height=%d timestamp=%s\n",
                 boost::lexical_cast<std::string>(nStakeModifier).c_str(), nStakeModifierHeight,
                 DateTimeStrFormat("%Y-%m-%d %H:%M:%S", nStakeModifierTime).c_str(),
-                mapBlockIndex[blockFrom.GetHash()]->nHeight,
-                DateTimeStrFormat("%Y-%m-%d %H:%M:%S", blockFrom.GetBlockTime()).c_str());
+                pindexFrom->nHeight,
+                DateTimeStrFormat("%Y-%m-%d %H:%M:%S", pindexFrom->GetBlockTime()).c_str());
             LogPrintf("CheckStakeKernelHash() : pass protocol=%s modifier=%s nTimeBlockFrom=%u prevoutHash=%s nTimeTxPrev=%u nPrevout=%u nTimeTx=%u hashProof=%s\n",
                 "0.3",
                 boost::lexical_cast<std::string>(nStakeModifier).c_str(),
@@ -366,7 +409,144 @@ bool CheckStakeKernelHash(unsigned int nBits, const CBlock blockFrom, const CTra
     return fSuccess;
 }
 
+bool GetStakeCandidate(const CBlockIndex* pindexFrom, const CTransaction& txPrev, unsigned int nOut, unsigned int nTimeTx, CStakeCandidate& candidate)
+{
+    candidate.prevout = COutPoint(txPrev.GetHash(), nOut);
+    candidate.nValueIn = txPrev.vout[nOut].nValue;
+    candidate.nTimeBlockFrom = pindexFrom->GetBlockTime();
+
+    if (nTimeTx < candidate.nTimeBlockFrom || candidate.nTimeBlockFrom + nStakeMinAge > nTimeTx)
+        return false;
+
+    int nStakeModifierHeight = 0;
+    int64_t nStakeModifierTime = 0;
+    return GetKernelStakeModifier(pindexFrom->GetBlockHash(), candidate.nStakeModifier, nStakeModifierHeight, nStakeModifierTime, false);
+}
+
+static std::atomic<double> dStakeHashesPerSec(0.0);
+
+double GetStakeHashesPerSec()
+{
+    return dStakeHashesPerSec;
+}
+
+bool FindStakeKernel(const std::vector<CStakeCandidate>& vCandidates, unsigned int nBits, unsigned int& nTimeTx, unsigned int nHashDrift, unsigned int nTimeMin, int nThreads, size_t& nIndexFound, uint256& hashProofOfStake)
+{
+    uint256 bnTargetPerCoinDay;
+    bnTargetPerCoinDay.SetCompact(nBits);
+
+    // the times of the window that are after nTimeMin, latest first
+    const unsigned int nTries = nTimeTx + nHashDrift <= nTimeMin ? 0 : std::min(nHashDrift, nTimeTx + nHashDrift - nTimeMin);
+
+    int nHeightStart = chainActive.Height();
+    int64_t nTimeStart = GetTimeMicros();
+    std::atomic<size_t> nNext(0);
+    // candidates from this index on cannot win any more, it drops to the index of every kernel found
+    std::atomic<size_t> nIndexStop(vCandidates.size());
+    std::atomic<bool> fStop(false);
+    std::atomic<uint64_t> nHashes(0);
+    bool fFound = false;
+    unsigned int nTimeFound = 0;
+    CCriticalSection cs_found;
+
+    auto search = [&]() {
+        // the serialized stake hash inputs of stakeHash() for a batch of times, only the time at the end differs
+        static const size_t nKernelSize = 8 + 4 + 4 + 32 + 4;
+        unsigned char vchKernels[STAKE_HASH_BATCH][nKernelSize];
+        uint256 vHashes[STAKE_HASH_BATCH];
+        uint64_t nHashesDone = 0;
+        while (!fStop) {
+            size_t nIndex = nNext++;
+            if (nIndex >= nIndexStop)
+                break;
+
+            const CStakeCandidate& candidate = vCandidates[nIndex];
+            for (unsigned int j = 0; j < STAKE_HASH_BATCH; j++) {
+                WriteLE64(&vchKernels[j][0], candidate.nStakeModifier);
+                WriteLE32(&vchKernels[j][8], candidate.nTimeBlockFrom);
+                WriteLE32(&vchKernels[j][12], candidate.prevout.n);
+                memcpy(&vchKernels[j][16], candidate.prevout.hash.begin(), 32);
+            }
+            uint256 bnTarget = (uint256(candidate.nValueIn) / 100) * bnTargetPerCoinDay;
+
+            for (unsigned int i = 0; i < nTries && nIndex < nIndexStop && !fStop; i += STAKE_HASH_BATCH) {
+                unsigned int nBatch = std::min(STAKE_HASH_BATCH, nTries - i);
+                for (unsigned int j = 0; j < nBatch; j++)
+                    WriteLE32(&vchKernels[j][48], nTimeTx + nHashDrift - i - j);
+                SHA256DBatch(vHashes[0].begin(), vchKernels[0], nKernelSize, nBatch);
+                nHashesDone += nBatch;
+
+                // the latest time that meets the target wins and the lowest index among the kernels,
+                // so that the result is the one of a search of one candidate after the other
+                for (unsigned int j = 0; j < nBatch; j++) {
+                    if (!(vHashes[j] < bnTarget))
+                        continue;
+                    LOCK(cs_found);
+                    if (!fFound || nIndex < nIndexFound) {
+                        fFound = true;
+                        nIndexFound = nIndex;
+                        nTimeFound = nTimeTx + nHashDrift - i - j;
+                        hashProofOfStake = vHashes[j];
+                        nIndexStop = nIndex;
+                    }
+                    break;
+                }
+            }
+
+            //new block came in, move on
+            if (chainActive.Height() != nHeightStart)
+                fStop = true;
+        }
+        nHashes += nHashesDone;
+    };
+
+    if (nThreads <= 0)
+        nThreads = boost::thread::hardware_concurrency();
+    nThreads = std::max(1, std::min(nThreads, (int)vCandidates.size()));
+    if (nThreads == 1) {
+        search();
+    } else {
+        boost::thread_group threadGroup;
+        for (int i = 0; i < nThreads; i++)
+            threadGroup.create_thread(search);
+        threadGroup.join_all();
+    }
+
+    int64_t nTimeElapsed = GetTimeMicros() - nTimeStart;
+    if (nTimeElapsed > 0)
+        dStakeHashesPerSec = 1000000.0 * nHashes / nTimeElapsed;
+    LogPrint("staking", "%s : %d hashes over %d inputs on %d threads in %.2fms\n", __func__, (uint64_t)nHashes, vCandidates.size(), nThreads, nTimeElapsed * 0.001);
+
+    mapHashedBlocks.clear();
+    mapHashedBlocks[chainActive.Tip()->nHeight] = GetTime(); //store a time stamp of when we last hashed on this block
+
+    if (!fFound)
+        return false;
+
+    nTimeTx = nTimeFound;
+    LogPrintf("FindStakeKernel() : pass modifier=%s nTimeBlockFrom=%u prevoutHash=%s nPrevout=%u nTimeTx=%u hashProof=%s\n",
+        boost::lexical_cast<std::string>(vCandidates[nIndexFound].nStakeModifier).c_str(), vCandidates[nIndexFound].nTimeBlockFrom,
+        vCandidates[nIndexFound].prevout.hash.ToString().c_str(), vCandidates[nIndexFound].prevout.n, nTimeTx, hashProofOfStake.ToString().c_str());
+    return true;
+}
+
 // Check kernel hash target and coinstake signature
+/**
+ * Look up the kernel output and the block that created it in the coin cache, so that
+ * the stake of a new block is checked without reading the transaction or its block from disk.
+ */
+static bool GetKernelInputFromCoins(const COutPoint& prevout, CTxOut& txoutPrev, const CBlockIndex*& pindexFrom)
+{
+    LOCK(cs_main);
+    const CCoins* coins = pcoinsTip->AccessCoins(prevout.hash);
+    if (!coins || !coins->IsAvailable(prevout.n) || coins->nHeight <= 0 || coins->nHeight > chainActive.Height())
+        return false;
+
+    txoutPrev = coins->vout[prevout.n];
+    pindexFrom = chainActive[coins->nHeight];
+    return true;
+}
+
 bool CheckProofOfStake(const CBlock block, uint256& hashProofOfStake)
 {
     const CTransaction tx = block.vtx[1];
@@ -376,31 +556,34 @@ bool CheckProofOfStake(const CBlock block, uint256& hashProofOfStake)
     // Kernel (input 0) must match the stake hash target per coin age (nBits)
     const CTxIn& txin = tx.vin[0];
 
-    // First try finding the previous transaction in database
-    uint256 hashBlock;
-    CTransaction txPrev;
-    if (!GetTransaction(txin.prevout.hash, txPrev, hashBlock, true))
-        return error("CheckProofOfStake() : INFO: read txPrev failed");
+    int64_t nTimeStart = GetTimeMicros();
+    CTxOut txoutPrev;
+    const CBlockIndex* pindexFrom = NULL;
+    bool fFromCoins = GetKernelInputFromCoins(txin.prevout, txoutPrev, pindexFrom);
+    if (!fFromCoins) {
+        // Spent in the active chain or not in the coin cache, find the previous transaction in database
+        uint256 hashBlock;
+        CTransaction txPrev;
+        if (!GetTransaction(txin.prevout.hash, txPrev, hashBlock, true))
+            return error("CheckProofOfStake() : INFO: read txPrev failed");
+        if (txin.prevout.n >= txPrev.vout.size())
+            return error("CheckProofOfStake() : prevout %s out of range", txin.prevout.ToString());
+
+        BlockMap::iterator it = mapBlockIndex.find(hashBlock);
+        if (it == mapBlockIndex.end())
+            return error("CheckProofOfStake() : read block failed");
+        txoutPrev = txPrev.vout[txin.prevout.n];
+        pindexFrom = it->second;
+    }
+    LogPrint("bench", "    - Stake kernel input from %s: %.2fms\n", fFromCoins ? "coins" : "block files", 0.001 * (GetTimeMicros() - nTimeStart));
 
     //verify signature and script
-    if (!VerifyScript(txin.scriptSig, txPrev.vout[txin.prevout.n].scriptPubKey, STANDARD_SCRIPT_VERIFY_FLAGS, TransactionSignatureChecker(&tx, 0)))
+    if (!VerifyScript(txin.scriptSig, txoutPrev.scriptPubKey, STANDARD_SCRIPT_VERIFY_FLAGS, TransactionSignatureChecker(&tx, 0)))
         return error("CheckProofOfStake() : VerifySignature failed on coinstake %s", tx.GetHash().ToString().c_str());
 
-    CBlockIndex* pindex = NULL;
-    BlockMap::iterator it = mapBlockIndex.find(hashBlock);
-    if (it != mapBlockIndex.end())
-        pindex = it->second;
-    else
-        return error("CheckProofOfStake() : read block failed");
-
-    // Read block header
-    CBlock blockprev;
-    if (!ReadBlockFromDisk(blockprev, pindex->GetBlockPos()))
-        return error("CheckProofOfStake(): INFO: failed to find block");
-
     unsigned int nInterval = 0;
     unsigned int nTime = block.nTime;
-    if (!CheckStakeKernelHash(block.nBits, blockprev, txPrev, txin.prevout, nTime, nInterval, true, hashProofOfStake, fDebug))
+    if (!CheckStakeKernelHash(block.nBits, pindexFrom, txoutPrev.nValue, txin.prevout, nTime, nInterval, true, hashProofOfStake, fDebug))
         return error("CheckProofOfStake() : INFO: check kernel failed on coinstake %s, hashProof=%s \n", tx.GetHash().ToString().c_str(), hashProofOfStake.ToString().c_str()); // may occur during initial download or if behind on block chain sync
 
     return true;
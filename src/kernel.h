@@ -21,11 +21,40 @@ static const int MODIFIER_INTERVAL_RATIO = 3;
 // Compute the hash modifier for proof-of-stake
 bool ComputeNextStakeModifier(const CBlockIndex* pindexPrev, uint64_t& nStakeModifier, bool& fGeneratedStakeModifier);
 
+// The stake modifier used to hash for a kernel whose coin is from hashBlockFrom
+bool GetKernelStakeModifier(uint256 hashBlockFrom, uint64_t& nStakeModifier, int& nStakeModifierHeight, int64_t& nStakeModifierTime, bool fPrintProofOfStake);
+
 // Check whether stake kernel meets hash target
 // Sets hashProofOfStake on success return
 uint256 stakeHash(unsigned int nTimeTx, CDataStream ss, unsigned int prevoutIndex, uint256 prevoutHash, unsigned int nTimeBlockFrom);
 bool stakeTargetHit(uint256 hashProofOfStake, int64_t nValueIn, uint256 bnTargetPerCoinDay);
-bool CheckStakeKernelHash(unsigned int nBits, const CBlock blockFrom, const CTransaction txPrev, const COutPoint prevout, unsigned int& nTimeTx, unsigned int nHashDrift, bool fCheck, uint256& hashProofOfStake, bool fPrintProofOfStake = false);
+bool CheckStakeKernelHash(unsigned int nBits, const CBlockIndex* pindexFrom, CAmount nValueIn, const COutPoint prevout, unsigned int& nTimeTx, unsigned int nHashDrift, bool fCheck, uint256& hashProofOfStake, bool fPrintProofOfStake = false);
+
+// Default for -stakethreads, one thread leaves the other cores to validation; 0 uses one thread per core
+static const int DEFAULT_STAKE_THREADS = 1;
+
+// Kernel times hashed together by SHA256DBatch during the search
+static const unsigned int STAKE_HASH_BATCH = 16;
+
+// A stake input with everything the kernel hash needs, gathered before the search
+struct CStakeCandidate {
+    COutPoint prevout;
+    int64_t nValueIn;
+    unsigned int nTimeBlockFrom;
+    uint64_t nStakeModifier;
+};
+
+// Prepare an output for FindStakeKernel, fails if it cannot stake at nTimeTx
+bool GetStakeCandidate(const CBlockIndex* pindexFrom, const CTransaction& txPrev, unsigned int nOut, unsigned int nTimeTx, CStakeCandidate& candidate);
+
+// Search the hash drift window after nTimeTx of every candidate on nThreads threads, skipping the times
+// up to nTimeMin and stopping when the tip changes. Finds the kernel of the first candidate that has one,
+// at its latest time, as a search of one candidate after the other would. Sets nIndexFound, nTimeTx and
+// hashProofOfStake on success
+bool FindStakeKernel(const std::vector<CStakeCandidate>& vCandidates, unsigned int nBits, unsigned int& nTimeTx, unsigned int nHashDrift, unsigned int nTimeMin, int nThreads, size_t& nIndexFound, uint256& hashProofOfStake);
+
+// Kernel hashes per second of the last FindStakeKernel search
+double GetStakeHashesPerSec();
 
 // Check kernel hash target and coinstake signature
 // Sets hashProofOfStake on success return
@@ -59,6 +59,11 @@ public:
 
         batch.Delete(slKey);
     }
+
+    void Clear()
+    {
+        batch.Clear();
+    }
 };
 
 class CLevelDBWrapper
@@ -168,6 +173,24 @@ public:
     {
         return pdb->NewIterator(iteroptions);
     }
+
+    //! iterator for short lookups like the records of one key prefix, which fills the block cache as Read does
+    leveldb::Iterator* NewReadIterator() const
+    {
+        return pdb->NewIterator(readoptions);
+    }
+
+    //! compact the keys from keyBegin to keyEnd, after most of them were erased
+    template <typename K>
+    void CompactRange(const K& keyBegin, const K& keyEnd) const
+    {
+        CDataStream ssBegin(SER_DISK, CLIENT_VERSION), ssEnd(SER_DISK, CLIENT_VERSION);
+        ssBegin << keyBegin;
+        ssEnd << keyEnd;
+        leveldb::Slice slBegin(&ssBegin[0], ssBegin.size());
+        leveldb::Slice slEnd(&ssEnd[0], ssEnd.size());
+        pdb->CompactRange(&slBegin, &slEnd);
+    }
 };
 
 #endif // BITCOIN_LEVELDBWRAPPER_H
@@ -46,6 +46,22 @@ void Accumulator::increment(const CBigNum& bnValue) {
     this->value = this->value.pow_mod(bnValue, this->params->accumulatorModulus);
 }
 
+// Multiply vValues[nBegin, nEnd) pairwise, so the operands of each multiplication stay about the same size
+static CBigNum ProductTree(const std::vector<CBigNum>& vValues, size_t nBegin, size_t nEnd) {
+    if (nEnd - nBegin == 1)
+        return vValues[nBegin];
+    size_t nMid = nBegin + (nEnd - nBegin) / 2;
+    return ProductTree(vValues, nBegin, nMid) * ProductTree(vValues, nMid, nEnd);
+}
+
+void Accumulator::incrementBatch(const std::vector<CBigNum>& vValues) {
+    if (vValues.empty())
+        return;
+
+    // (value^a)^b = value^(a*b) mod N
+    this->value = this->value.pow_mod(ProductTree(vValues, 0, vValues.size()), this->params->accumulatorModulus);
+}
+
 void Accumulator::accumulate(const PublicCoin& coin) {
 	// Make sure we're initialized
 	if(!(this->value)) {
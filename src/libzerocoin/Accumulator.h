@@ -62,6 +62,15 @@ public:
 	void accumulate(const PublicCoin &coin);
     void increment(const CBigNum& bnValue);
 
+    /**
+     * Accumulate several values with a single exponentiation by their product,
+     * the result is the same as calling increment() on each of them.
+     * No checks performed!
+     *
+     * @param vValues the coin values to add
+     */
+    void incrementBatch(const std::vector<CBigNum>& vValues);
+
 	CoinDenomination getDenomination() const;
 	/** Get the accumulator result
 	 *
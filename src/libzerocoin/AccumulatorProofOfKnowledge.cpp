@@ -27,6 +27,8 @@ AccumulatorProofOfKnowledge::AccumulatorProofOfKnowledge(const AccumulatorAndPro
 	CBigNum g_n = params->accumulatorQRNCommitmentGroup.g;
 	CBigNum h_n = params->accumulatorQRNCommitmentGroup.h;
 
+	std::shared_ptr<const AccumulatorPoKPrecomputation> pre = params->GetPrecomputation();
+
 	CBigNum e = commitmentToCoin.getContents();
 	CBigNum r = commitmentToCoin.getRandomness();
 
@@ -36,9 +38,9 @@ AccumulatorProofOfKnowledge::AccumulatorProofOfKnowledge(const AccumulatorAndPro
 	CBigNum r_2 = CBigNum::randBignum(params->accumulatorModulus/4);
 	CBigNum r_3 = CBigNum::randBignum(params->accumulatorModulus/4);
 
-	this->C_e = g_n.pow_mod(e, params->accumulatorModulus) * h_n.pow_mod(r_1, params->accumulatorModulus);
-	this->C_u = witness.getValue() * h_n.pow_mod(r_2, params->accumulatorModulus);
-	this->C_r = g_n.pow_mod(r_2, params->accumulatorModulus) * h_n.pow_mod(r_3, params->accumulatorModulus);
+	this->C_e = pre->g_n.pow_mod(e) * pre->h_n.pow_mod(r_1);
+	this->C_u = witness.getValue() * pre->h_n.pow_mod(r_2);
+	this->C_r = pre->g_n.pow_mod(r_2) * pre->h_n.pow_mod(r_3);
 
 	CBigNum r_alpha = CBigNum::randBignum(params->maxCoinValue * CBigNum(2).pow(params->k_prime + params->k_dprime));
 	if(!(CBigNum::randBignum(CBigNum(3)) % 2)) {
@@ -73,14 +75,17 @@ AccumulatorProofOfKnowledge::AccumulatorProofOfKnowledge(const AccumulatorAndPro
 		r_delta = 0-r_delta;
 	}
 
-	this->st_1 = (sg.pow_mod(r_alpha, params->accumulatorPoKCommitmentGroup.modulus) * sh.pow_mod(r_phi, params->accumulatorPoKCommitmentGroup.modulus)) % params->accumulatorPoKCommitmentGroup.modulus;
-	this->st_2 = (((commitmentToCoin.getCommitmentValue() * sg.inverse(params->accumulatorPoKCommitmentGroup.modulus)).pow_mod(r_gamma, params->accumulatorPoKCommitmentGroup.modulus)) * sh.pow_mod(r_psi, params->accumulatorPoKCommitmentGroup.modulus)) % params->accumulatorPoKCommitmentGroup.modulus;
-	this->st_3 = ((sg * commitmentToCoin.getCommitmentValue()).pow_mod(r_sigma, params->accumulatorPoKCommitmentGroup.modulus) * sh.pow_mod(r_xi, params->accumulatorPoKCommitmentGroup.modulus)) % params->accumulatorPoKCommitmentGroup.modulus;
+	// (C * sg^-1)^r_gamma and (sg * C)^r_sigma are split into powers of sg and C,
+	// so that every generator is raised through its precomputed table
+	const CBigNum& C = commitmentToCoin.getCommitmentValue();
+	this->st_1 = MultiExp(pre->pokModulus).add(pre->sg, r_alpha).add(pre->sh, r_phi).eval();
+	this->st_2 = MultiExp(pre->pokModulus).add(C, r_gamma).add(pre->sg, 0 - r_gamma).add(pre->sh, r_psi).eval();
+	this->st_3 = MultiExp(pre->pokModulus).add(C, r_sigma).add(pre->sg, r_sigma).add(pre->sh, r_xi).eval();
 
-	this->t_1 = (h_n.pow_mod(r_zeta, params->accumulatorModulus) * g_n.pow_mod(r_epsilon, params->accumulatorModulus)) % params->accumulatorModulus;
-	this->t_2 = (h_n.pow_mod(r_eta, params->accumulatorModulus) * g_n.pow_mod(r_alpha, params->accumulatorModulus)) % params->accumulatorModulus;
-	this->t_3 = (C_u.pow_mod(r_alpha, params->accumulatorModulus) * ((h_n.inverse(params->accumulatorModulus)).pow_mod(r_beta, params->accumulatorModulus))) % params->accumulatorModulus;
-	this->t_4 = (C_r.pow_mod(r_alpha, params->accumulatorModulus) * ((h_n.inverse(params->accumulatorModulus)).pow_mod(r_delta, params->accumulatorModulus)) * ((g_n.inverse(params->accumulatorModulus)).pow_mod(r_beta, params->accumulatorModulus))) % params->accumulatorModulus;
+	this->t_1 = MultiExp(pre->qrnModulus).add(pre->h_n, r_zeta).add(pre->g_n, r_epsilon).eval();
+	this->t_2 = MultiExp(pre->qrnModulus).add(pre->h_n, r_eta).add(pre->g_n, r_alpha).eval();
+	this->t_3 = MultiExp(pre->qrnModulus).add(C_u, r_alpha).add(pre->h_n, 0 - r_beta).eval();
+	this->t_4 = MultiExp(pre->qrnModulus).add(C_r, r_alpha).add(pre->h_n, 0 - r_delta).add(pre->g_n, 0 - r_beta).eval();
 
 	CHashWriter hasher(0,0);
 	hasher << *params << sg << sh << g_n << h_n << commitmentToCoin.getCommitmentValue() << C_e << C_u << C_r << st_1 << st_2 << st_3 << t_1 << t_2 << t_3 << t_4;
@@ -116,14 +121,17 @@ bool AccumulatorProofOfKnowledge:: Verify(const Accumulator& a, const CBigNum& v
 
 	CBigNum c = CBigNum(hasher.GetHash()); //this hash should be of length k_prime bits
 
-	CBigNum st_1_prime = (valueOfCommitmentToCoin.pow_mod(c, params->accumulatorPoKCommitmentGroup.modulus) * sg.pow_mod(s_alpha, params->accumulatorPoKCommitmentGroup.modulus) * sh.pow_mod(s_phi, params->accumulatorPoKCommitmentGroup.modulus)) % params->accumulatorPoKCommitmentGroup.modulus;
-	CBigNum st_2_prime = (sg.pow_mod(c, params->accumulatorPoKCommitmentGroup.modulus) * ((valueOfCommitmentToCoin * sg.inverse(params->accumulatorPoKCommitmentGroup.modulus)).pow_mod(s_gamma, params->accumulatorPoKCommitmentGroup.modulus)) * sh.pow_mod(s_psi, params->accumulatorPoKCommitmentGroup.modulus)) % params->accumulatorPoKCommitmentGroup.modulus;
-	CBigNum st_3_prime = (sg.pow_mod(c, params->accumulatorPoKCommitmentGroup.modulus) * (sg * valueOfCommitmentToCoin).pow_mod(s_sigma, params->accumulatorPoKCommitmentGroup.modulus) * sh.pow_mod(s_xi, params->accumulatorPoKCommitmentGroup.modulus)) % params->accumulatorPoKCommitmentGroup.modulus;
-
-	CBigNum t_1_prime = (C_r.pow_mod(c, params->accumulatorModulus) * h_n.pow_mod(s_zeta, params->accumulatorModulus) * g_n.pow_mod(s_epsilon, params->accumulatorModulus)) % params->accumulatorModulus;
-	CBigNum t_2_prime = (C_e.pow_mod(c, params->accumulatorModulus) * h_n.pow_mod(s_eta, params->accumulatorModulus) * g_n.pow_mod(s_alpha, params->accumulatorModulus)) % params->accumulatorModulus;
-	CBigNum t_3_prime = ((a.getValue()).pow_mod(c, params->accumulatorModulus) * C_u.pow_mod(s_alpha, params->accumulatorModulus) * ((h_n.inverse(params->accumulatorModulus)).pow_mod(s_beta, params->accumulatorModulus))) % params->accumulatorModulus;
-	CBigNum t_4_prime = (C_r.pow_mod(s_alpha, params->accumulatorModulus) * ((h_n.inverse(params->accumulatorModulus)).pow_mod(s_delta, params->accumulatorModulus)) * ((g_n.inverse(params->accumulatorModulus)).pow_mod(s_beta, params->accumulatorModulus))) % params->accumulatorModulus;
+	// Same products as in the prover, the powers of sg are merged into one
+	// exponent and the inverted generators become negative exponents.
+	std::shared_ptr<const AccumulatorPoKPrecomputation> pre = params->GetPrecomputation();
+	CBigNum st_1_prime = MultiExp(pre->pokModulus).add(valueOfCommitmentToCoin, c).add(pre->sg, s_alpha).add(pre->sh, s_phi).eval();
+	CBigNum st_2_prime = MultiExp(pre->pokModulus).add(valueOfCommitmentToCoin, s_gamma).add(pre->sg, c - s_gamma).add(pre->sh, s_psi).eval();
+	CBigNum st_3_prime = MultiExp(pre->pokModulus).add(valueOfCommitmentToCoin, s_sigma).add(pre->sg, c + s_sigma).add(pre->sh, s_xi).eval();
+
+	CBigNum t_1_prime = MultiExp(pre->qrnModulus).add(C_r, c).add(pre->h_n, s_zeta).add(pre->g_n, s_epsilon).eval();
+	CBigNum t_2_prime = MultiExp(pre->qrnModulus).add(C_e, c).add(pre->h_n, s_eta).add(pre->g_n, s_alpha).eval();
+	CBigNum t_3_prime = MultiExp(pre->qrnModulus).add(a.getValue(), c).add(C_u, s_alpha).add(pre->h_n, 0 - s_beta).eval();
+	CBigNum t_4_prime = MultiExp(pre->qrnModulus).add(C_r, s_alpha).add(pre->h_n, 0 - s_delta).add(pre->g_n, 0 - s_beta).eval();
 
 	bool result = false;
 
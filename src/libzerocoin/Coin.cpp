@@ -13,6 +13,11 @@
 // Copyright (c) 2017 The PIVX developers
 #include <stdexcept>
 #include <iostream>
+#include <atomic>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
 #include "Coin.h"
 #include "Commitment.h"
 #include "Denominations.h"
@@ -46,13 +51,65 @@ PublicCoin::PublicCoin(const ZerocoinParams* p, const CBigNum& coin, const CoinD
 	}
 };
 
+// Odd primes below this bound are divided out of mint candidates before the
+// Miller-Rabin test
+#define MINT_SIEVE_BOUND 2000
+
+// Product of the odd primes below MINT_SIEVE_BOUND. Most candidates share a factor
+// with it, and one gcd tells that much cheaper than a probabilistic prime test.
+static const CBigNum& SmallPrimesProduct() {
+	static const CBigNum bnProduct = []() {
+		std::vector<bool> vComposite(MINT_SIEVE_BOUND, false);
+		CBigNum bn = 1;
+		for (uint32_t i = 3; i < MINT_SIEVE_BOUND; i += 2) {
+			if (vComposite[i])
+				continue;
+			bn *= i;
+			for (uint32_t j = i * i; j < MINT_SIEVE_BOUND; j += 2 * i)
+				vComposite[j] = true;
+		}
+		return bn;
+	}();
+	return bnProduct;
+}
+
+// A commitment is a coin if it is in range and prime
+bool IsValidCoinValue(const ZerocoinParams* params, const CBigNum& bnValue) {
+	return bnValue >= params->accumulatorParams.minCoinValue &&
+	       bnValue <= params->accumulatorParams.maxCoinValue &&
+	       bnValue.gcd(SmallPrimesProduct()).isOne() &&
+	       bnValue.isPrime(ZEROCOIN_MINT_PRIME_PARAM);
+}
+
+// Run the same candidate search on every core until one of them sets fFound.
+// Candidates are independent, so this finds a coin nThreads times sooner.
+static void SearchOnAllCores(const std::function<void()>& search) {
+#if ZEROCOIN_THREADING
+	uint32_t nThreads = std::max(std::thread::hardware_concurrency(), 1u);
+	if (nThreads > 1 && !IsThreadSingleCore()) {
+		std::vector<std::future<void> > vWorkers;
+		for (uint32_t t = 0; t < nThreads; t++)
+			vWorkers.push_back(std::async(std::launch::async, search));
+		// get() rethrows whatever a worker threw
+		for (auto& worker : vWorkers)
+			worker.get();
+		return;
+	}
+#endif
+	search();
+}
+
 //PrivateCoin class
-PrivateCoin::PrivateCoin(const ZerocoinParams* p, const CoinDenomination denomination): params(p), publicCoin(p) {
+PrivateCoin::PrivateCoin(const ZerocoinParams* p, const CoinDenomination denomination, bool fMintNew): params(p), publicCoin(p) {
 	// Verify that the parameters are valid
 	if(this->params->initialized == false) {
 		throw std::runtime_error("Params are not initialized");
 	}
 
+	// The caller sets the secrets of an existing coin
+	if (!fMintNew)
+		return;
+
 #ifdef ZEROCOIN_FAST_MINT
 	// Mint a new coin with a random serial number using the fast process.
 	// This is more vulnerable to timing attacks so don't mint coins when
@@ -66,82 +123,100 @@ PrivateCoin::PrivateCoin(const ZerocoinParams* p, const CoinDenomination denomin
 }
 
 void PrivateCoin::mintCoin(const CoinDenomination denomination) {
+	std::atomic<uint32_t> nAttempts(0);
+	std::atomic<bool> fFound(false);
+	std::mutex mutexFound;
+
 	// Repeat this process up to MAX_COINMINT_ATTEMPTS times until
 	// we obtain a prime number
-	for(uint32_t attempt = 0; attempt < MAX_COINMINT_ATTEMPTS; attempt++) {
+	SearchOnAllCores([&]() {
+		while (!fFound && nAttempts++ < MAX_COINMINT_ATTEMPTS) {
 
-		// Generate a random serial number in the range 0...{q-1} where
-		// "q" is the order of the commitment group.
-		CBigNum s = CBigNum::randBignum(this->params->coinCommitmentGroup.groupOrder);
+			// Generate a random serial number in the range 0...{q-1} where
+			// "q" is the order of the commitment group.
+			CBigNum s = CBigNum::randBignum(this->params->coinCommitmentGroup.groupOrder);
+
+			// Generate a Pedersen commitment to the serial number "s"
+			Commitment coin(&params->coinCommitmentGroup, s);
 
-		// Generate a Pedersen commitment to the serial number "s"
-		Commitment coin(&params->coinCommitmentGroup, s);
-
-		// Now verify that the commitment is a prime number
-		// in the appropriate range. If not, we'll throw this coin
-		// away and generate a new one.
-		if (coin.getCommitmentValue().isPrime(ZEROCOIN_MINT_PRIME_PARAM) &&
-		        coin.getCommitmentValue() >= params->accumulatorParams.minCoinValue &&
-		        coin.getCommitmentValue() <= params->accumulatorParams.maxCoinValue) {
-			// Found a valid coin. Store it.
-			this->serialNumber = s;
-			this->randomness = coin.getRandomness();
-			this->publicCoin = PublicCoin(params,coin.getCommitmentValue(), denomination);
-
-			// Success! We're done.
-			return;
+			// Now verify that the commitment is a prime number
+			// in the appropriate range. If not, we'll throw this coin
+			// away and generate a new one.
+			if (IsValidCoinValue(params, coin.getCommitmentValue())) {
+				// Found a valid coin. Store it, unless another thread was first.
+				std::lock_guard<std::mutex> lock(mutexFound);
+				if (fFound)
+					return;
+				this->serialNumber = s;
+				this->randomness = coin.getRandomness();
+				this->publicCoin = PublicCoin(params,coin.getCommitmentValue(), denomination);
+
+				// Success! We're done.
+				fFound = true;
+				return;
+			}
 		}
-	}
+	});
 
 	// We only get here if we did not find a coin within
 	// MAX_COINMINT_ATTEMPTS. Throw an exception.
-	throw std::runtime_error("Unable to mint a new Zerocoin (too many attempts)");
+	if (!fFound)
+		throw std::runtime_error("Unable to mint a new Zerocoin (too many attempts)");
 }
 
 void PrivateCoin::mintCoinFast(const CoinDenomination denomination) {
-	
-	// Generate a random serial number in the range 0...{q-1} where
-	// "q" is the order of the commitment group.
-	CBigNum s = CBigNum::randBignum(this->params->coinCommitmentGroup.groupOrder);
-	
-	// Generate a random number "r" in the range 0...{q-1}
-	CBigNum r = CBigNum::randBignum(this->params->coinCommitmentGroup.groupOrder);
-	
-	// Manually compute a Pedersen commitment to the serial number "s" under randomness "r"
-	// C = g^s * h^r mod p
-	CBigNum commitmentValue = this->params->coinCommitmentGroup.g.pow_mod(s, this->params->coinCommitmentGroup.modulus).mul_mod(this->params->coinCommitmentGroup.h.pow_mod(r, this->params->coinCommitmentGroup.modulus), this->params->coinCommitmentGroup.modulus);
-	
-	// Repeat this process up to MAX_COINMINT_ATTEMPTS times until
-	// we obtain a prime number
-	for (uint32_t attempt = 0; attempt < MAX_COINMINT_ATTEMPTS; attempt++) {
-		// First verify that the commitment is a prime number
-		// in the appropriate range. If not, we'll throw this coin
-		// away and generate a new one.
-		if (commitmentValue.isPrime(ZEROCOIN_MINT_PRIME_PARAM) &&
-			commitmentValue >= params->accumulatorParams.minCoinValue &&
-			commitmentValue <= params->accumulatorParams.maxCoinValue) {
-			// Found a valid coin. Store it.
-			this->serialNumber = s;
-			this->randomness = r;
-			this->publicCoin = PublicCoin(params, commitmentValue, denomination);
-				
-			// Success! We're done.
-			return;
+	std::atomic<uint32_t> nAttempts(0);
+	std::atomic<bool> fFound(false);
+	std::mutex mutexFound;
+
+	// Every thread walks from its own serial number and randomness
+	SearchOnAllCores([&]() {
+		// Generate a random serial number in the range 0...{q-1} where
+		// "q" is the order of the commitment group.
+		CBigNum s = CBigNum::randBignum(this->params->coinCommitmentGroup.groupOrder);
+
+		// Generate a random number "r" in the range 0...{q-1}
+		CBigNum r = CBigNum::randBignum(this->params->coinCommitmentGroup.groupOrder);
+
+		// Manually compute a Pedersen commitment to the serial number "s" under randomness "r"
+		// C = g^s * h^r mod p
+		CBigNum commitmentValue = this->params->coinCommitmentGroup.g.pow_mod_sec(s, this->params->coinCommitmentGroup.modulus).mul_mod(this->params->coinCommitmentGroup.h.pow_mod_sec(r, this->params->coinCommitmentGroup.modulus), this->params->coinCommitmentGroup.modulus);
+
+		// Repeat this process up to MAX_COINMINT_ATTEMPTS times until
+		// we obtain a prime number
+		while (!fFound && nAttempts++ < MAX_COINMINT_ATTEMPTS) {
+			// First verify that the commitment is a prime number
+			// in the appropriate range. If not, we'll throw this coin
+			// away and generate a new one.
+			if (IsValidCoinValue(params, commitmentValue)) {
+				// Found a valid coin. Store it, unless another thread was first.
+				std::lock_guard<std::mutex> lock(mutexFound);
+				if (fFound)
+					return;
+				this->serialNumber = s;
+				this->randomness = r;
+				this->publicCoin = PublicCoin(params, commitmentValue, denomination);
+
+				// Success! We're done.
+				fFound = true;
+				return;
+			}
+
+			// Generate a new random "r_delta" in 0...{q-1}
+			CBigNum r_delta = CBigNum::randBignum(this->params->coinCommitmentGroup.groupOrder);
+
+			// The commitment was not prime. Increment "r" and recalculate "C":
+			// r = r + r_delta mod q
+			// C = C * h mod p
+			r = (r + r_delta) % this->params->coinCommitmentGroup.groupOrder;
+			commitmentValue = commitmentValue.mul_mod(this->params->coinCommitmentGroup.h.pow_mod(r_delta, this->params->coinCommitmentGroup.modulus), this->params->coinCommitmentGroup.modulus);
 		}
-		
-		// Generate a new random "r_delta" in 0...{q-1}
-		CBigNum r_delta = CBigNum::randBignum(this->params->coinCommitmentGroup.groupOrder);
-
-		// The commitment was not prime. Increment "r" and recalculate "C":
-		// r = r + r_delta mod q
-		// C = C * h mod p
-		r = (r + r_delta) % this->params->coinCommitmentGroup.groupOrder;
-		commitmentValue = commitmentValue.mul_mod(this->params->coinCommitmentGroup.h.pow_mod(r_delta, this->params->coinCommitmentGroup.modulus), this->params->coinCommitmentGroup.modulus);
-	}
-		
+	});
+
 	// We only get here if we did not find a coin within
 	// MAX_COINMINT_ATTEMPTS. Throw an exception.
-	throw std::runtime_error("Unable to mint a new Zerocoin (too many attempts)");
+	if (!fFound)
+		throw std::runtime_error("Unable to mint a new Zerocoin (too many attempts)");
 }
 	
 } /* namespace libzerocoin */
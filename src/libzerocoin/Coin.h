@@ -92,7 +92,11 @@ public:
     {
         strm >> *this;
     }
-    PrivateCoin(const ZerocoinParams* p, const CoinDenomination denomination);
+    /**
+     * @param fMintNew mint a new coin, otherwise the secrets are left for the
+     * caller to set with setPublicCoin(), setRandomness() and setSerialNumber()
+     */
+    PrivateCoin(const ZerocoinParams* p, const CoinDenomination denomination, bool fMintNew = true);
     const PublicCoin& getPublicCoin() const { return this->publicCoin; }
     // @return the coins serial number
     const CBigNum& getSerialNumber() const { return this->serialNumber; }
@@ -146,5 +150,9 @@ private:
     void mintCoinFast(const CoinDenomination denomination);
 };
 
+/** Whether a commitment is in the coin range and prime. Candidates sharing a factor with
+ *  the odd primes below 2000 are rejected before the primality test. */
+bool IsValidCoinValue(const ZerocoinParams* params, const CBigNum& bnValue);
+
 } /* namespace libzerocoin */
 #endif /* COIN_H_ */
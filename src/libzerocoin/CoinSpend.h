@@ -91,6 +91,14 @@ public:
     CBigNum getSerialComm() const { return serialCommitmentToCoinValue; }
 
     bool Verify(const Accumulator& a) const;
+
+    /** The individual sub-proofs checked by Verify(). Each can be evaluated
+     * independently of the others, which lets callers spread a spend's
+     * verification across several threads.
+     */
+    bool VerifyCommitmentPoK() const;
+    bool VerifyAccumulatorPoK(const Accumulator& a) const;
+    bool VerifySerialNumberSoK() const;
     bool HasValidSerial(ZerocoinParams* params) const;
     CBigNum CalculateValidSerial(ZerocoinParams* params);
 
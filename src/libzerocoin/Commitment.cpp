@@ -21,8 +21,8 @@ namespace libzerocoin {
 Commitment::Commitment::Commitment(const IntegerGroupParams* p,
                                    const CBigNum& value): params(p), contents(value) {
 	this->randomness = CBigNum::randBignum(params->groupOrder);
-	this->commitmentValue = (params->g.pow_mod(this->contents, params->modulus).mul_mod(
-	                         params->h.pow_mod(this->randomness, params->modulus), params->modulus));
+	this->commitmentValue = (params->g.pow_mod_sec(this->contents, params->modulus).mul_mod(
+	                         params->h.pow_mod_sec(this->randomness, params->modulus), params->modulus));
 }
 
 const CBigNum& Commitment::getCommitmentValue() const {
@@ -73,8 +73,8 @@ CommitmentProofOfKnowledge::CommitmentProofOfKnowledge(const IntegerGroupParams*
 	// T2 = g2^r1 * h2^r3 mod p2
 	//
 	// Where (g1, h1, p1) are from "aParams" and (g2, h2, p2) are from "bParams".
-	CBigNum T1 = this->ap->g.pow_mod(r1, this->ap->modulus).mul_mod((this->ap->h.pow_mod(r2, this->ap->modulus)), this->ap->modulus);
-	CBigNum T2 = this->bp->g.pow_mod(r1, this->bp->modulus).mul_mod((this->bp->h.pow_mod(r3, this->bp->modulus)), this->bp->modulus);
+	CBigNum T1 = this->ap->g.pow_mod_sec(r1, this->ap->modulus).mul_mod((this->ap->h.pow_mod_sec(r2, this->ap->modulus)), this->ap->modulus);
+	CBigNum T2 = this->bp->g.pow_mod_sec(r1, this->bp->modulus).mul_mod((this->bp->h.pow_mod_sec(r3, this->bp->modulus)), this->bp->modulus);
 
 	// Now hash commitment "A" with commitment "B" as well as the
 	// parameters and the two ephemeral commitments "T1, T2" we just generated
@@ -0,0 +1,256 @@
+/**
+ * @file       MultiExp.cpp
+ *
+ * @brief      Fixed-base and simultaneous multi-exponentiation for the Zerocoin library.
+ *
+ * @copyright  Copyright 2017 The PIVX developers
+ * @license    This project is released under the MIT license.
+ **/
+
+#include "MultiExp.h"
+
+namespace libzerocoin
+{
+/** Value of the nWidth bits of e starting at bit nPos, e must not be negative */
+static unsigned int GetWindow(const CBigNum& e, unsigned int nPos, unsigned int nWidth)
+{
+    unsigned int nWindow = 0;
+    for (unsigned int i = 0; i < nWidth; i++) {
+        if (e.isBitSet(nPos + i))
+            nWindow |= 1 << i;
+    }
+    return nWindow;
+}
+
+#if defined(USE_NUM_OPENSSL)
+MontgomeryModulus::MontgomeryModulus(const CBigNum& modulusIn) : modulus(modulusIn), fMontgomery(false), mont(NULL)
+{
+    if (!modulus.isBitSet(0) || modulus.isOne() || modulus < 0)
+        return;
+
+    Context ctx;
+    mont = BN_MONT_CTX_new();
+    if (mont == NULL)
+        throw bignum_error("MontgomeryModulus : BN_MONT_CTX_new failed");
+    if (!BN_MONT_CTX_set(mont, modulus.bn, ctx.pctx)) {
+        BN_MONT_CTX_free(mont);
+        throw bignum_error("MontgomeryModulus : BN_MONT_CTX_set failed");
+    }
+    fMontgomery = true;
+    toMontgomery(montOne, CBigNum(1), ctx);
+}
+
+MontgomeryModulus::~MontgomeryModulus()
+{
+    if (mont != NULL)
+        BN_MONT_CTX_free(mont);
+}
+
+void MontgomeryModulus::toMontgomery(CBigNum& r, const CBigNum& a, Context& ctx) const
+{
+    if (!BN_to_montgomery(r.bn, a.bn, mont, ctx.pctx))
+        throw bignum_error("MontgomeryModulus::toMontgomery : BN_to_montgomery failed");
+}
+
+void MontgomeryModulus::fromMontgomery(CBigNum& r, const CBigNum& a, Context& ctx) const
+{
+    if (!BN_from_montgomery(r.bn, a.bn, mont, ctx.pctx))
+        throw bignum_error("MontgomeryModulus::fromMontgomery : BN_from_montgomery failed");
+}
+
+void MontgomeryModulus::mul(CBigNum& r, const CBigNum& a, const CBigNum& b, Context& ctx) const
+{
+    if (!BN_mod_mul_montgomery(r.bn, a.bn, b.bn, mont, ctx.pctx))
+        throw bignum_error("MontgomeryModulus::mul : BN_mod_mul_montgomery failed");
+}
+#endif
+
+#if defined(USE_NUM_GMP)
+MontgomeryModulus::MontgomeryModulus(const CBigNum& modulusIn) : modulus(modulusIn), fMontgomery(modulusIn > 1), montOne(1) {}
+
+MontgomeryModulus::~MontgomeryModulus() {}
+
+void MontgomeryModulus::toMontgomery(CBigNum& r, const CBigNum& a, Context& ctx) const
+{
+    mpz_mod(r.bn, a.bn, modulus.bn);
+}
+
+void MontgomeryModulus::fromMontgomery(CBigNum& r, const CBigNum& a, Context& ctx) const
+{
+    r = a;
+}
+
+void MontgomeryModulus::mul(CBigNum& r, const CBigNum& a, const CBigNum& b, Context& ctx) const
+{
+    mpz_mul(r.bn, a.bn, b.bn);
+    mpz_tdiv_r(r.bn, r.bn, modulus.bn);
+}
+#endif
+
+FixedBaseTable::FixedBaseTable(const std::shared_ptr<const MontgomeryModulus>& mod, const CBigNum& baseIn, unsigned int nMaxBits) : modulus(mod), base(baseIn)
+{
+    // Without Montgomery arithmetic the table stays empty and every
+    // exponentiation falls back to pow_mod()
+    if (!modulus->isMontgomery())
+        return;
+
+    MontgomeryModulus::Context ctx;
+    vPowers.resize((nMaxBits + MULTIEXP_FIXED_WINDOW - 1) / MULTIEXP_FIXED_WINDOW);
+    modulus->toMontgomery(vPowers[0], base % modulus->getModulus(), ctx);
+    for (unsigned int i = 1; i < vPowers.size(); i++) {
+        CBigNum bnPower = vPowers[i - 1];
+        for (unsigned int j = 0; j < MULTIEXP_FIXED_WINDOW; j++)
+            modulus->mul(bnPower, bnPower, bnPower, ctx);
+        vPowers[i] = bnPower;
+    }
+}
+
+CBigNum FixedBaseTable::pow_mod(const CBigNum& e) const
+{
+    return MultiExp(modulus).add(*this, e).eval();
+}
+
+MultiExp::MultiExp(const std::shared_ptr<const MontgomeryModulus>& mod) : modulus(mod) {}
+
+MultiExp& MultiExp::add(const FixedBaseTable& table, const CBigNum& e)
+{
+    if (table.getModulus()->getModulus() != modulus->getModulus())
+        throw std::runtime_error("MultiExp::add : table belongs to a different modulus");
+
+    // Exponents that do not fit the table are handled like any other base
+    if (e.bitSize() > (int)table.getMaxBits())
+        return add(table.getBase(), e);
+
+    vFixed.push_back(std::make_pair(&table, e));
+    return *this;
+}
+
+MultiExp& MultiExp::add(const CBigNum& base, const CBigNum& e)
+{
+    vVariable.push_back(std::make_pair(base, e));
+    return *this;
+}
+
+CBigNum MultiExp::eval() const
+{
+    const CBigNum& m = modulus->getModulus();
+
+    if (!modulus->isMontgomery()) {
+        CBigNum ret = CBigNum(1) % m;
+        for (const auto& term : vFixed)
+            ret = ret.mul_mod(term.first->getBase().pow_mod(term.second, m), m);
+        for (const auto& term : vVariable)
+            ret = ret.mul_mod(term.first.pow_mod(term.second, m), m);
+        return ret;
+    }
+
+    MontgomeryModulus::Context ctx;
+
+    // 1. All fixed bases in a single pass of Yao's method. Windows with the
+    // same digit value are gathered in one bucket, bucket d ends up raised to
+    // the power d. Negative exponents go to a separate product that is
+    // inverted once at the end.
+    static const unsigned int nDigitValues = 1 << MULTIEXP_FIXED_WINDOW;
+    std::vector<const CBigNum*> vBuckets[2][nDigitValues];
+    for (const auto& term : vFixed) {
+        int nSign = term.second < 0 ? 1 : 0;
+        const CBigNum e = nSign ? -term.second : term.second;
+        unsigned int nBits = e.bitSize();
+        for (unsigned int i = 0; i * MULTIEXP_FIXED_WINDOW < nBits; i++) {
+            unsigned int nDigit = GetWindow(e, i * MULTIEXP_FIXED_WINDOW, MULTIEXP_FIXED_WINDOW);
+            if (nDigit)
+                vBuckets[nSign][nDigit].push_back(&term.first->vPowers[i]);
+        }
+    }
+
+    CBigNum bnFixed[2];
+    bool fFixed[2] = {false, false};
+    for (int nSign = 0; nSign < 2; nSign++) {
+        CBigNum bnRunning;
+        bool fRunning = false;
+        for (unsigned int nDigit = nDigitValues - 1; nDigit > 0; nDigit--) {
+            for (const CBigNum* pPower : vBuckets[nSign][nDigit]) {
+                if (fRunning)
+                    modulus->mul(bnRunning, bnRunning, *pPower, ctx);
+                else
+                    bnRunning = *pPower;
+                fRunning = true;
+            }
+            if (!fRunning)
+                continue;
+            if (fFixed[nSign])
+                modulus->mul(bnFixed[nSign], bnFixed[nSign], bnRunning, ctx);
+            else
+                bnFixed[nSign] = bnRunning;
+            fFixed[nSign] = true;
+        }
+    }
+
+    // 2. The other bases with Straus' method: a table of the first 2^w powers
+    // of each base, then one shared chain of squarings over the exponent windows.
+    static const unsigned int nWindowValues = 1 << MULTIEXP_VARIABLE_WINDOW;
+    std::vector<std::vector<CBigNum> > vTables;
+    std::vector<CBigNum> vExponents;
+    unsigned int nMaxBits = 0;
+    for (const auto& term : vVariable) {
+        if (!term.second)
+            continue;
+
+        // g^-x = (g^-1)^x
+        CBigNum bnBase = term.first % m;
+        CBigNum bnExponent = term.second;
+        if (bnExponent < 0) {
+            bnBase = bnBase.inverse(m);
+            bnExponent = -bnExponent;
+        }
+
+        std::vector<CBigNum> vPowers(nWindowValues);
+        vPowers[0] = modulus->one();
+        modulus->toMontgomery(vPowers[1], bnBase, ctx);
+        for (unsigned int i = 2; i < nWindowValues; i++)
+            modulus->mul(vPowers[i], vPowers[i - 1], vPowers[1], ctx);
+
+        nMaxBits = std::max(nMaxBits, (unsigned int)bnExponent.bitSize());
+        vTables.push_back(vPowers);
+        vExponents.push_back(bnExponent);
+    }
+
+    CBigNum bnVariable;
+    bool fVariable = false;
+    unsigned int nWindows = (nMaxBits + MULTIEXP_VARIABLE_WINDOW - 1) / MULTIEXP_VARIABLE_WINDOW;
+    for (unsigned int nWindow = nWindows; nWindow > 0; nWindow--) {
+        if (fVariable) {
+            for (unsigned int i = 0; i < MULTIEXP_VARIABLE_WINDOW; i++)
+                modulus->mul(bnVariable, bnVariable, bnVariable, ctx);
+        }
+        for (unsigned int i = 0; i < vExponents.size(); i++) {
+            unsigned int nDigit = GetWindow(vExponents[i], (nWindow - 1) * MULTIEXP_VARIABLE_WINDOW, MULTIEXP_VARIABLE_WINDOW);
+            if (!nDigit)
+                continue;
+            if (fVariable)
+                modulus->mul(bnVariable, bnVariable, vTables[i][nDigit], ctx);
+            else
+                bnVariable = vTables[i][nDigit];
+            fVariable = true;
+        }
+    }
+
+    // 3. Combine the partial products
+    CBigNum bnResult = modulus->one();
+    if (fFixed[0])
+        modulus->mul(bnResult, bnResult, bnFixed[0], ctx);
+    if (fFixed[1]) {
+        CBigNum bnInverse;
+        modulus->fromMontgomery(bnInverse, bnFixed[1], ctx);
+        modulus->toMontgomery(bnInverse, bnInverse.inverse(m), ctx);
+        modulus->mul(bnResult, bnResult, bnInverse, ctx);
+    }
+    if (fVariable)
+        modulus->mul(bnResult, bnResult, bnVariable, ctx);
+
+    CBigNum ret;
+    modulus->fromMontgomery(ret, bnResult, ctx);
+    return ret;
+}
+
+} /* namespace libzerocoin */
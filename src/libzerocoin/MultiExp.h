@@ -0,0 +1,124 @@
+/**
+ * @file       MultiExp.h
+ *
+ * @brief      Fixed-base and simultaneous multi-exponentiation for the Zerocoin library.
+ *
+ * @copyright  Copyright 2017 The PIVX developers
+ * @license    This project is released under the MIT license.
+ **/
+
+#ifndef MULTIEXP_H_
+#define MULTIEXP_H_
+
+#include "bignum.h"
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace libzerocoin
+{
+/** Window width (in bits) of the fixed-base tables */
+static const unsigned int MULTIEXP_FIXED_WINDOW = 5;
+/** Window width (in bits) used for bases without a precomputed table */
+static const unsigned int MULTIEXP_VARIABLE_WINDOW = 4;
+
+/** A modulus prepared for Montgomery multiplication.
+ *
+ * Shared by all tables and multi-exponentiations working modulo the same
+ * number. It is immutable once constructed, so it can be used from several
+ * threads at once. With the GMP backend there is no Montgomery form, values
+ * stay plain residues and every modulus above one qualifies.
+ */
+class MontgomeryModulus
+{
+public:
+    /** Scratch space for the helpers below, not to be shared between threads */
+    class Context
+    {
+    public:
+#if defined(USE_NUM_OPENSSL)
+        CAutoBN_CTX pctx;
+#endif
+    };
+
+    explicit MontgomeryModulus(const CBigNum& modulus);
+    ~MontgomeryModulus();
+
+    const CBigNum& getModulus() const { return modulus; }
+
+    /** Montgomery multiplication needs an odd modulus, even ones fall back to plain pow_mod */
+    bool isMontgomery() const { return fMontgomery; }
+
+    // Helpers on values in Montgomery representation
+    void toMontgomery(CBigNum& r, const CBigNum& a, Context& ctx) const;
+    void fromMontgomery(CBigNum& r, const CBigNum& a, Context& ctx) const;
+    void mul(CBigNum& r, const CBigNum& a, const CBigNum& b, Context& ctx) const;
+    const CBigNum& one() const { return montOne; }
+
+private:
+    MontgomeryModulus(const MontgomeryModulus&);
+    MontgomeryModulus& operator=(const MontgomeryModulus&);
+
+    CBigNum modulus;
+    bool fMontgomery;
+#if defined(USE_NUM_OPENSSL)
+    BN_MONT_CTX* mont;
+#endif
+    CBigNum montOne;
+};
+
+/** Precomputed powers of a fixed base.
+ *
+ * Stores base^(2^(w*i)) for every w-bit window of exponents up to nMaxBits
+ * (Yao's method), so raising the base to such an exponent costs about
+ * nMaxBits/w + 2^(w+1) multiplications and no squarings at all.
+ */
+class FixedBaseTable
+{
+public:
+    FixedBaseTable(const std::shared_ptr<const MontgomeryModulus>& mod, const CBigNum& base, unsigned int nMaxBits);
+
+    const CBigNum& getBase() const { return base; }
+    unsigned int getMaxBits() const { return vPowers.size() * MULTIEXP_FIXED_WINDOW; }
+    const std::shared_ptr<const MontgomeryModulus>& getModulus() const { return modulus; }
+
+    /** base^e mod m, same result as getBase().pow_mod(e, m) */
+    CBigNum pow_mod(const CBigNum& e) const;
+
+private:
+    friend class MultiExp;
+
+    std::shared_ptr<const MontgomeryModulus> modulus;
+    CBigNum base;
+    //! base^(2^(w*i)) in Montgomery representation
+    std::vector<CBigNum> vPowers;
+};
+
+/** Computes a product of powers b_1^e_1 * ... * b_k^e_k mod m.
+ *
+ * Terms on a FixedBaseTable share a single Yao pass, the remaining terms are
+ * evaluated with Straus' interleaved windows so that all of them share the
+ * same chain of squarings. Exponents may be negative. The result is always
+ * reduced, equal to the product of the individual pow_mod() results mod m.
+ */
+class MultiExp
+{
+public:
+    explicit MultiExp(const std::shared_ptr<const MontgomeryModulus>& mod);
+
+    /** Add table.getBase()^e to the product */
+    MultiExp& add(const FixedBaseTable& table, const CBigNum& e);
+    /** Add base^e to the product */
+    MultiExp& add(const CBigNum& base, const CBigNum& e);
+
+    CBigNum eval() const;
+
+private:
+    std::shared_ptr<const MontgomeryModulus> modulus;
+    std::vector<std::pair<const FixedBaseTable*, CBigNum> > vFixed;
+    std::vector<std::pair<CBigNum, CBigNum> > vVariable;
+};
+
+} /* namespace libzerocoin */
+#endif /* MULTIEXP_H_ */
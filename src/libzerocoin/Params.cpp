@@ -26,13 +26,70 @@ ZerocoinParams::ZerocoinParams(CBigNum N, uint32_t securityLevel) {
 	CalculateParams(*this, N, ZEROCOIN_PROTOCOL_VERSION, securityLevel);
 
 	this->accumulatorParams.initialized = true;
+	this->accumulatorParams.Precompute();
+	this->Precompute();
 	this->initialized = true;
 }
 
+ZerocoinParams::ZerocoinParams() {
+	this->initialized = false;
+	this->zkp_hash_len = 0;
+	this->zkp_iterations = 0;
+}
+
+void ZerocoinParams::Precompute() {
+	this->precomputed = std::make_shared<const SerialNumberSoKPrecomputation>(*this);
+}
+
+std::shared_ptr<const SerialNumberSoKPrecomputation> ZerocoinParams::GetPrecomputation() const {
+	if (this->precomputed)
+		return this->precomputed;
+	return std::make_shared<const SerialNumberSoKPrecomputation>(*this);
+}
+
 AccumulatorAndProofParams::AccumulatorAndProofParams() {
 	this->initialized = false;
 }
 
+void AccumulatorAndProofParams::Precompute() {
+	this->precomputed = std::make_shared<const AccumulatorPoKPrecomputation>(*this);
+}
+
+std::shared_ptr<const AccumulatorPoKPrecomputation> AccumulatorAndProofParams::GetPrecomputation() const {
+	if (this->precomputed)
+		return this->precomputed;
+	return std::make_shared<const AccumulatorPoKPrecomputation>(*this);
+}
+
+// Largest exponents the accumulator proof raises the generators to: the
+// randomness ranges of the prover plus the 256 bit challenge times a secret.
+static unsigned int MaxPoKExponentBits(const AccumulatorAndProofParams& p) {
+	return 2 * p.accumulatorPoKCommitmentGroup.modulus.bitSize() + std::max(p.maxCoinValue.bitSize() + (int)(p.k_prime + p.k_dprime), 256) + 2;
+}
+
+static unsigned int MaxQRNExponentBits(const AccumulatorAndProofParams& p) {
+	return p.accumulatorModulus.bitSize() + std::max(p.accumulatorPoKCommitmentGroup.modulus.bitSize() + (int)(p.k_prime + p.k_dprime), p.maxCoinValue.bitSize() + 256) + 2;
+}
+
+AccumulatorPoKPrecomputation::AccumulatorPoKPrecomputation(const AccumulatorAndProofParams& p) :
+	pokModulus(std::make_shared<const MontgomeryModulus>(p.accumulatorPoKCommitmentGroup.modulus)),
+	qrnModulus(std::make_shared<const MontgomeryModulus>(p.accumulatorModulus)),
+	sg(pokModulus, p.accumulatorPoKCommitmentGroup.g, MaxPoKExponentBits(p)),
+	sh(pokModulus, p.accumulatorPoKCommitmentGroup.h, MaxPoKExponentBits(p)),
+	g_n(qrnModulus, p.accumulatorQRNCommitmentGroup.g, MaxQRNExponentBits(p)),
+	h_n(qrnModulus, p.accumulatorQRNCommitmentGroup.h, MaxQRNExponentBits(p)) {}
+
+// The serial number proof raises a and b to a serial number or a blinding
+// factor, g to a value reduced mod its group order and h to a response that
+// can be as large as a product of two such values.
+SerialNumberSoKPrecomputation::SerialNumberSoKPrecomputation(const ZerocoinParams& p) :
+	coinModulus(std::make_shared<const MontgomeryModulus>(p.coinCommitmentGroup.modulus)),
+	sokModulus(std::make_shared<const MontgomeryModulus>(p.serialNumberSoKCommitmentGroup.modulus)),
+	a(coinModulus, p.coinCommitmentGroup.g, p.coinCommitmentGroup.groupOrder.bitSize() + 1),
+	b(coinModulus, p.coinCommitmentGroup.h, p.coinCommitmentGroup.groupOrder.bitSize() + 1),
+	g(sokModulus, p.serialNumberSoKCommitmentGroup.g, p.serialNumberSoKCommitmentGroup.groupOrder.bitSize()),
+	h(sokModulus, p.serialNumberSoKCommitmentGroup.h, 2 * p.serialNumberSoKCommitmentGroup.groupOrder.bitSize() + 1) {}
+
 IntegerGroupParams::IntegerGroupParams() {
 	this->initialized = false;
 }
@@ -44,4 +101,14 @@ CBigNum IntegerGroupParams::randomElement() const {
 	return this->g.pow_mod(CBigNum::randBignum(this->groupOrder),this->modulus);
 }
 
+static thread_local bool fThreadSingleCore = false;
+
+void SetThreadSingleCore(bool fSingleCore) {
+	fThreadSingleCore = fSingleCore;
+}
+
+bool IsThreadSingleCore() {
+	return fThreadSingleCore;
+}
+
 } /* namespace libzerocoin */
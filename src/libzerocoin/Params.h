@@ -14,10 +14,50 @@
 #define PARAMS_H_
 
 #include "bignum.h"
+#include "MultiExp.h"
 #include "ZerocoinDefines.h"
 
+#include <memory>
+
 namespace libzerocoin {
 
+class AccumulatorAndProofParams;
+class ZerocoinParams;
+
+/** Exponentiation tables for the fixed generators of the accumulator proof of knowledge */
+class AccumulatorPoKPrecomputation {
+public:
+	explicit AccumulatorPoKPrecomputation(const AccumulatorAndProofParams& p);
+
+	//! accumulatorPoKCommitmentGroup.modulus
+	std::shared_ptr<const MontgomeryModulus> pokModulus;
+	//! accumulatorModulus
+	std::shared_ptr<const MontgomeryModulus> qrnModulus;
+
+	FixedBaseTable sg;
+	FixedBaseTable sh;
+	FixedBaseTable g_n;
+	FixedBaseTable h_n;
+};
+
+/** Exponentiation tables for the fixed generators of the serial number signature of knowledge */
+class SerialNumberSoKPrecomputation {
+public:
+	explicit SerialNumberSoKPrecomputation(const ZerocoinParams& p);
+
+	//! coinCommitmentGroup.modulus, the order of serialNumberSoKCommitmentGroup
+	std::shared_ptr<const MontgomeryModulus> coinModulus;
+	//! serialNumberSoKCommitmentGroup.modulus
+	std::shared_ptr<const MontgomeryModulus> sokModulus;
+
+	//! coinCommitmentGroup.g and h
+	FixedBaseTable a;
+	FixedBaseTable b;
+	//! serialNumberSoKCommitmentGroup.g and h
+	FixedBaseTable g;
+	FixedBaseTable h;
+};
+
 class IntegerGroupParams {
 public:
 	/** @brief Integer group class, default constructor
@@ -138,6 +178,19 @@ public:
 	 * The statistical zero-knowledgeness of the accumulator proof.
 	 */
 	uint32_t k_dprime;
+
+	/**
+	 * Exponentiation tables for the generators above. Derived data,
+	 * not serialized, shared between copies of the parameters.
+	 */
+	std::shared_ptr<const AccumulatorPoKPrecomputation> precomputed;
+
+	/** Builds the exponentiation tables, once the parameters are set */
+	void Precompute();
+
+	/** The exponentiation tables, built on the fly if Precompute() was never called */
+	std::shared_ptr<const AccumulatorPoKPrecomputation> GetPrecomputation() const;
+
 	ADD_SERIALIZE_METHODS;
   template <typename Stream, typename Operation>  inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
 	    READWRITE(initialized);
@@ -173,6 +226,9 @@ public:
 	ZerocoinParams(CBigNum accumulatorModulus,
 	       uint32_t securityLevel = ZEROCOIN_DEFAULT_SECURITYLEVEL);
 
+	/** @brief Allocates an empty (uninitialized) set of parameters, to be deserialized */
+	ZerocoinParams();
+
 	bool initialized;
 
 	AccumulatorAndProofParams accumulatorParams;
@@ -202,7 +258,19 @@ public:
 	 * proofs.
 	 */
 	uint32_t zkp_hash_len;
-	
+
+	/**
+	 * Exponentiation tables for the serial number proof generators.
+	 * Derived data, not serialized.
+	 */
+	std::shared_ptr<const SerialNumberSoKPrecomputation> precomputed;
+
+	/** Builds the exponentiation tables, once the parameters are set */
+	void Precompute();
+
+	/** The exponentiation tables, built on the fly if Precompute() was never called */
+	std::shared_ptr<const SerialNumberSoKPrecomputation> GetPrecomputation() const;
+
 	ADD_SERIALIZE_METHODS;
   template <typename Stream, typename Operation>  inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
 	    READWRITE(initialized);
@@ -214,6 +282,14 @@ public:
 	}
 };
 
+/**
+ * Keep the work of libzerocoin calls made on this thread on this thread.
+ * For threads that are already one of several workers, e.g. the zerocoin
+ * check queue, so that every worker does not spread out over all cores.
+ */
+void SetThreadSingleCore(bool fSingleCore);
+bool IsThreadSingleCore();
+
 } /* namespace libzerocoin */
 
 #endif /* PARAMS_H_ */
@@ -13,8 +13,36 @@
 #include <streams.h>
 #include "SerialNumberSignatureOfKnowledge.h"
 
+#include <algorithm>
+#include <functional>
+#include <future>
+#include <thread>
+
 namespace libzerocoin {
 
+// The proof iterations are independent of each other, so they can be
+// computed on all cores. Only the hashing of the results has to stay in order.
+static void ForEachIteration(uint32_t nIterations, const std::function<void(uint32_t)>& func) {
+#if ZEROCOIN_THREADING
+	uint32_t nThreads = std::min(std::max(std::thread::hardware_concurrency(), 1u), nIterations);
+	if (nThreads > 1 && !IsThreadSingleCore()) {
+		std::vector<std::future<void> > vWorkers;
+		for (uint32_t t = 0; t < nThreads; t++) {
+			vWorkers.push_back(std::async(std::launch::async, [&func, t, nThreads, nIterations]() {
+				for (uint32_t i = t; i < nIterations; i += nThreads)
+					func(i);
+			}));
+		}
+		// get() rethrows whatever a worker threw
+		for (auto& worker : vWorkers)
+			worker.get();
+		return;
+	}
+#endif
+	for (uint32_t i = 0; i < nIterations; i++)
+		func(i);
+}
+
 SerialNumberSignatureOfKnowledge::SerialNumberSignatureOfKnowledge(const ZerocoinParams* p): params(p) { }
 
 // Use one 256 bit seed and concatenate 4 unique 256 bit hashes to make a 1024 bit hash
@@ -47,10 +75,7 @@ SerialNumberSignatureOfKnowledge::SerialNumberSignatureOfKnowledge(const
 		throw std::runtime_error("Groups are not structured correctly.");
 	}
 
-	CBigNum a = params->coinCommitmentGroup.g;
-	CBigNum b = params->coinCommitmentGroup.h;
-	CBigNum g = params->serialNumberSoKCommitmentGroup.g;
-	CBigNum h = params->serialNumberSoKCommitmentGroup.h;
+	std::shared_ptr<const SerialNumberSoKPrecomputation> pre = params->GetPrecomputation();
 
 	CHashWriter hasher(0,0);
 	hasher << *params << commitmentToCoin.getCommitmentValue() << coin.getSerialNumber() << msghash;
@@ -77,14 +102,12 @@ SerialNumberSignatureOfKnowledge::SerialNumberSignatureOfKnowledge(const
         }
 	}
 
-	for(uint32_t i=0; i < params->zkp_iterations; i++) {
+	ForEachIteration(params->zkp_iterations, [&](uint32_t i) {
 		// compute g^{ {a^x b^r} h^v} mod p2
-		c[i] = challengeCalculation(coin.getSerialNumber(), r[i], v_expanded[i]);
-	}
+		c[i] = challengeCalculation(*pre, coin.getSerialNumber(), r[i], v_expanded[i]);
+	});
 
-	// We can't hash data in parallel either
-	// because OPENMP cannot not guarantee loops
-	// execute in order.
+	// The hash has to be computed in order
 	for(uint32_t i=0; i < params->zkp_iterations; i++) {
 		hasher << c[i];
 	}
@@ -102,50 +125,44 @@ SerialNumberSignatureOfKnowledge::SerialNumberSignatureOfKnowledge(const
 		} else {
 			s_notprime[i]       = r[i] - coin.getRandomness();
 			sprime[i]           = v_expanded[i] - (commitmentToCoin.getRandomness() *
-			                              b.pow_mod(r[i] - coin.getRandomness(), params->serialNumberSoKCommitmentGroup.groupOrder));
+			                              pre->b.pow_mod(r[i] - coin.getRandomness()));
 		}
 	}
 }
 
-inline CBigNum SerialNumberSignatureOfKnowledge::challengeCalculation(const CBigNum& a_exp,const CBigNum& b_exp,
-        const CBigNum& h_exp) const {
-
-	CBigNum a = params->coinCommitmentGroup.g;
-	CBigNum b = params->coinCommitmentGroup.h;
-	CBigNum g = params->serialNumberSoKCommitmentGroup.g;
-	CBigNum h = params->serialNumberSoKCommitmentGroup.h;
+inline CBigNum SerialNumberSignatureOfKnowledge::challengeCalculation(const SerialNumberSoKPrecomputation& pre,
+        const CBigNum& a_exp, const CBigNum& b_exp, const CBigNum& h_exp) const {
 
-	CBigNum exponent = (a.pow_mod(a_exp, params->serialNumberSoKCommitmentGroup.groupOrder)
-	                   * b.pow_mod(b_exp, params->serialNumberSoKCommitmentGroup.groupOrder)) % params->serialNumberSoKCommitmentGroup.groupOrder;
+	// a^a_exp * b^b_exp mod q, then g^exponent * h^h_exp mod p
+	CBigNum exponent = MultiExp(pre.coinModulus).add(pre.a, a_exp).add(pre.b, b_exp).eval();
 
-	return (g.pow_mod(exponent, params->serialNumberSoKCommitmentGroup.modulus) * h.pow_mod(h_exp, params->serialNumberSoKCommitmentGroup.modulus)) % params->serialNumberSoKCommitmentGroup.modulus;
+	return MultiExp(pre.sokModulus).add(pre.g, exponent).add(pre.h, h_exp).eval();
 }
 
 bool SerialNumberSignatureOfKnowledge::Verify(const CBigNum& coinSerialNumber, const CBigNum& valueOfCommitmentToCoin,
         const uint256 msghash) const {
-	CBigNum a = params->coinCommitmentGroup.g;
-	CBigNum b = params->coinCommitmentGroup.h;
-	CBigNum g = params->serialNumberSoKCommitmentGroup.g;
-	CBigNum h = params->serialNumberSoKCommitmentGroup.h;
+	// Every iteration needs its responses, the workers index them blindly
+	if (s_notprime.size() != params->zkp_iterations || sprime.size() != params->zkp_iterations)
+		return false;
+
+	std::shared_ptr<const SerialNumberSoKPrecomputation> pre = params->GetPrecomputation();
 	CHashWriter hasher(0,0);
 	hasher << *params << valueOfCommitmentToCoin << coinSerialNumber << msghash;
 
 	vector<CBigNum> tprime(params->zkp_iterations);
-	unsigned char *hashbytes = (unsigned char*) &this->hash;
+	const unsigned char *hashbytes = (const unsigned char*) &this->hash;
 
-	for(uint32_t i = 0; i < params->zkp_iterations; i++) {
+	ForEachIteration(params->zkp_iterations, [&](uint32_t i) {
 		int bit = i % 8;
 		int byte = i / 8;
 		bool challenge_bit = ((hashbytes[byte] >> bit) & 0x01);
 		if(challenge_bit) {
-			tprime[i] = challengeCalculation(coinSerialNumber, s_notprime[i], SeedTo1024(sprime[i].getuint256()));
+			tprime[i] = challengeCalculation(*pre, coinSerialNumber, s_notprime[i], SeedTo1024(sprime[i].getuint256()));
 		} else {
-			CBigNum exp = b.pow_mod(s_notprime[i], params->serialNumberSoKCommitmentGroup.groupOrder);
-			tprime[i] = ((valueOfCommitmentToCoin.pow_mod(exp, params->serialNumberSoKCommitmentGroup.modulus) % params->serialNumberSoKCommitmentGroup.modulus) *
-			             (h.pow_mod(sprime[i], params->serialNumberSoKCommitmentGroup.modulus) % params->serialNumberSoKCommitmentGroup.modulus)) %
-			            params->serialNumberSoKCommitmentGroup.modulus;
+			CBigNum exp = pre->b.pow_mod(s_notprime[i]);
+			tprime[i] = MultiExp(pre->sokModulus).add(valueOfCommitmentToCoin, exp).add(pre->h, sprime[i]).eval();
 		}
-	}
+	});
 	for(uint32_t i = 0; i < params->zkp_iterations; i++) {
 		hasher << tprime[i];
 	}
@@ -67,8 +67,8 @@ private:
 	// define something named s and it conflicts
 	vector<CBigNum> s_notprime;
 	vector<CBigNum> sprime;
-	inline CBigNum challengeCalculation(const CBigNum& a_exp, const CBigNum& b_exp,
-	                                   const CBigNum& h_exp) const;
+	inline CBigNum challengeCalculation(const SerialNumberSoKPrecomputation& pre, const CBigNum& a_exp,
+	                                   const CBigNum& b_exp, const CBigNum& h_exp) const;
 };
 
 } /* namespace libzerocoin */
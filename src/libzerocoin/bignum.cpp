@@ -0,0 +1,174 @@
+// Copyright (c) 2009-2010 Satoshi Nakamoto
+// Copyright (c) 2009-2012 The Bitcoin developers
+// Copyright (c) 2017 The PIVX developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// Parts of CBigNum that only use the public interface and are shared by
+// every backend.
+
+#include "bignum.h"
+
+#include <algorithm>
+#include <limits>
+
+int CBigNum::getint() const
+{
+    unsigned long n = getulong();
+    if (*this >= 0)
+        return (n > (unsigned long)std::numeric_limits<int>::max() ? std::numeric_limits<int>::max() : n);
+    else
+        return (n > (unsigned long)std::numeric_limits<int>::max() ? std::numeric_limits<int>::min() : -(int)n);
+}
+
+CBigNum& CBigNum::SetCompact(unsigned int nCompact)
+{
+    unsigned int nSize = nCompact >> 24;
+    bool fNegative     =(nCompact & 0x00800000) != 0;
+    unsigned int nWord = nCompact & 0x007fffff;
+    if (nSize <= 3)
+    {
+        nWord >>= 8*(3-nSize);
+        setulong(nWord);
+    }
+    else
+    {
+        setulong(nWord);
+        *this <<= 8*(nSize-3);
+    }
+    if (fNegative)
+        *this = -*this;
+    return *this;
+}
+
+unsigned int CBigNum::GetCompact() const
+{
+    CBigNum bnAbs = (*this < 0 ? -*this : *this);
+    unsigned int nSize = (bnAbs.bitSize() + 7) / 8;
+    unsigned int nCompact = 0;
+    if (nSize <= 3)
+        nCompact = bnAbs.getulong() << 8*(3-nSize);
+    else
+        nCompact = (bnAbs >> 8*(nSize-3)).getulong();
+    // The 0x00800000 bit denotes the sign.
+    // Thus, if it is already set, divide the mantissa by 256 and increase the exponent.
+    if (nCompact & 0x00800000)
+    {
+        nCompact >>= 8;
+        nSize++;
+    }
+    nCompact |= nSize << 24;
+    nCompact |= (*this < 0 ? 0x00800000 : 0);
+    return nCompact;
+}
+
+void CBigNum::SetHex(const std::string& str)
+{
+    SetHexBool(str);
+}
+
+bool CBigNum::SetHexBool(const std::string& str)
+{
+    // skip 0x
+    const char* psz = str.c_str();
+    while (isspace(*psz))
+        psz++;
+    bool fNegative = false;
+    if (*psz == '-')
+    {
+        fNegative = true;
+        psz++;
+    }
+    if (psz[0] == '0' && tolower(psz[1]) == 'x')
+        psz += 2;
+    while (isspace(*psz))
+        psz++;
+
+    // hex string to bignum
+    static const signed char phexdigit[256] = { 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, 0,1,2,3,4,5,6,7,8,9,0,0,0,0,0,0, 0,0xa,0xb,0xc,0xd,0xe,0xf,0,0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, 0,0xa,0xb,0xc,0xd,0xe,0xf,0,0,0,0,0,0,0,0,0 };
+    *this = 0;
+    while (isxdigit(*psz))
+    {
+        *this <<= 4;
+        int n = phexdigit[(unsigned char)*psz++];
+        *this += n;
+    }
+    if (fNegative)
+        *this = 0 - *this;
+
+    return true;
+}
+
+std::string CBigNum::ToString(int nBase) const
+{
+    CBigNum bnBase = nBase;
+    CBigNum bn = (*this < 0 ? -*this : *this);
+    std::string str;
+    if (!bn)
+        return "0";
+    while (bn > 0)
+    {
+        unsigned int c = (bn % bnBase).getulong();
+        bn = bn / bnBase;
+        str += "0123456789abcdef"[c];
+    }
+    if (*this < 0)
+        str += "-";
+    reverse(str.begin(), str.end());
+    return str;
+}
+
+CBigNum& CBigNum::operator-=(const CBigNum& b)
+{
+    *this = *this - b;
+    return *this;
+}
+
+CBigNum& CBigNum::operator/=(const CBigNum& b)
+{
+    *this = *this / b;
+    return *this;
+}
+
+CBigNum& CBigNum::operator%=(const CBigNum& b)
+{
+    *this = *this % b;
+    return *this;
+}
+
+CBigNum& CBigNum::operator++()
+{
+    // prefix operator
+    *this += 1;
+    return *this;
+}
+
+const CBigNum CBigNum::operator++(int)
+{
+    // postfix operator
+    const CBigNum ret = *this;
+    ++(*this);
+    return ret;
+}
+
+CBigNum& CBigNum::operator--()
+{
+    // prefix operator
+    *this = *this - 1;
+    return *this;
+}
+
+const CBigNum CBigNum::operator--(int)
+{
+    // postfix operator
+    const CBigNum ret = *this;
+    --(*this);
+    return ret;
+}
+
+const CBigNum operator>>(const CBigNum& a, unsigned int shift)
+{
+    CBigNum r = a;
+    r >>= shift;
+    return r;
+}
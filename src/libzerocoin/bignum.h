@@ -6,13 +6,34 @@
 #ifndef BITCOIN_BIGNUM_H
 #define BITCOIN_BIGNUM_H
 
+#if defined(HAVE_CONFIG_H)
+#include "config/pivx-config.h"
+#endif
+
+// The big integer implementation is chosen at configure time
+// (--with-zerocoin-bignum), OpenSSL is the default.
+#if !defined(USE_NUM_GMP) && !defined(USE_NUM_OPENSSL)
+#define USE_NUM_OPENSSL 1
+#endif
+
 #include <stdexcept>
+#include <string>
 #include <vector>
+#if defined(USE_NUM_GMP)
+#include <gmp.h>
+#endif
+#if defined(USE_NUM_OPENSSL)
 #include <openssl/bn.h>
+#endif
 #include "serialize.h"
 #include "uint256.h"
 #include "version.h"
 
+namespace libzerocoin
+{
+class MontgomeryModulus;
+}
+
 /** Errors thrown by the bignum class */
 class bignum_error : public std::runtime_error
 {
@@ -21,6 +42,7 @@ public:
 };
 
 
+#if defined(USE_NUM_OPENSSL)
 /** RAII encapsulated BN_CTX (OpenSSL bignum context) */
 class CAutoBN_CTX
 {
@@ -47,266 +69,93 @@ public:
     BN_CTX** operator&() { return &pctx; }
     bool operator!() { return (pctx == NULL); }
 };
+#endif
 
 
-/** C++ wrapper for BIGNUM (OpenSSL bignum) */
-class CBigNum : public BIGNUM
+/** C++ wrapper for a big integer (OpenSSL BIGNUM or GMP mpz_t)
+ *
+ * The arithmetic lives in bignum_openssl.cpp or bignum_gmp.cpp, whichever
+ * backend was configured. Both produce the same values and the same
+ * serialization, so they can be swapped without touching consensus.
+ */
+class CBigNum
 {
-public:
-    CBigNum()
-    {
-        BN_init(this);
-    }
-
-    // Initialize from a Hex String (for zerocoin modulus)
-    CBigNum(const std::string& str) {
-        BN_init(this);
-        SetHexBool(str);
-    }
-    
+#if defined(USE_NUM_OPENSSL)
+    BIGNUM* bn;
+#endif
+#if defined(USE_NUM_GMP)
+    mpz_t bn;
+#endif
 
-    CBigNum(const CBigNum& b)
-    {
-        BN_init(this);
-        if (!BN_copy(this, &b))
-        {
-            BN_clear_free(this);
-            throw bignum_error("CBigNum::CBigNum(const CBigNum&) : BN_copy failed");
-        }
-    }
+    // Works on the raw backend values
+    friend class libzerocoin::MontgomeryModulus;
 
-    CBigNum& operator=(const CBigNum& b)
-    {
-        if (!BN_copy(this, &b))
-            throw bignum_error("CBigNum::operator= : BN_copy failed");
-        return (*this);
-    }
+public:
+    CBigNum();
+    CBigNum(const CBigNum& b);
+    CBigNum& operator=(const CBigNum& b);
+    ~CBigNum();
 
-    ~CBigNum()
-    {
-        BN_clear_free(this);
-    }
+    // Initialize from a Hex String (for zerocoin modulus)
+    CBigNum(const std::string& str) : CBigNum() { SetHexBool(str); }
 
     //CBigNum(char n) is not portable.  Use 'signed char' or 'unsigned char'.
-    CBigNum(signed char n)      { BN_init(this); if (n >= 0) setulong(n); else setint64(n); }
-    CBigNum(short n)            { BN_init(this); if (n >= 0) setulong(n); else setint64(n); }
-    CBigNum(int n)              { BN_init(this); if (n >= 0) setulong(n); else setint64(n); }
-    CBigNum(long n)             { BN_init(this); if (n >= 0) setulong(n); else setint64(n); }
-#ifdef __APPLE__	
-    CBigNum(int64_t n)            { BN_init(this); setint64(n); }
+    CBigNum(signed char n) : CBigNum()      { if (n >= 0) setulong(n); else setint64(n); }
+    CBigNum(short n) : CBigNum()            { if (n >= 0) setulong(n); else setint64(n); }
+    CBigNum(int n) : CBigNum()              { if (n >= 0) setulong(n); else setint64(n); }
+    CBigNum(long n) : CBigNum()             { if (n >= 0) setulong(n); else setint64(n); }
+#ifdef __APPLE__
+    CBigNum(int64_t n) : CBigNum()          { setint64(n); }
 #endif
-    CBigNum(unsigned char n)    { BN_init(this); setulong(n); }
-    CBigNum(unsigned short n)   { BN_init(this); setulong(n); }
-    CBigNum(unsigned int n)     { BN_init(this); setulong(n); }
-    CBigNum(unsigned long n)    { BN_init(this); setulong(n); }
-  //  CBigNum(uint64_t n)           { BN_init(this); setuint64(n); }
-    explicit CBigNum(uint256 n) { BN_init(this); setuint256(n); }
-
-    explicit CBigNum(const std::vector<unsigned char>& vch)
+    CBigNum(unsigned char n) : CBigNum()    { setulong(n); }
+    CBigNum(unsigned short n) : CBigNum()   { setulong(n); }
+    CBigNum(unsigned int n) : CBigNum()     { setulong(n); }
+    CBigNum(unsigned long n) : CBigNum()    { setulong(n); }
+  //  CBigNum(uint64_t n) : CBigNum()         { setuint64(n); }
+    explicit CBigNum(uint256 n) : CBigNum() { setuint256(n); }
+
+    explicit CBigNum(const std::vector<unsigned char>& vch) : CBigNum()
     {
-        BN_init(this);
         setvch(vch);
     }
 
+    /** Name of the configured big integer implementation */
+    static const char* GetBackendName();
+
     /** Generates a cryptographically secure random number between zero and range exclusive
     * i.e. 0 < returned number < range
     * @param range The upper bound on the number.
     * @return
     */
-    static CBigNum  randBignum(const CBigNum& range) {
-        CBigNum ret;
-        if(!BN_rand_range(&ret, &range)){
-            throw bignum_error("CBigNum:rand element : BN_rand_range failed");
-        }
-        return ret;
-    }
+    static CBigNum randBignum(const CBigNum& range);
 
     /** Generates a cryptographically secure random k-bit number
     * @param k The bit length of the number.
     * @return
     */
-    static CBigNum RandKBitBigum(const uint32_t k){
-        CBigNum ret;
-        if(!BN_rand(&ret, k, -1, 0)){
-            throw bignum_error("CBigNum:rand element : BN_rand failed");
-        }
-        return ret;
-    }
+    static CBigNum RandKBitBigum(const uint32_t k);
 
     /**Returns the size in bits of the underlying bignum.
      *
      * @return the size
      */
-    int bitSize() const{
-        return  BN_num_bits(this);
-    }
+    int bitSize() const;
 
-    void setulong(unsigned long n)
-    {
-        if (!BN_set_word(this, n))
-            throw bignum_error("CBigNum conversion from unsigned long : BN_set_word failed");
-    }
-
-    unsigned long getulong() const
-    {
-        return BN_get_word(this);
-    }
+    /** Whether bit n of the absolute value is set */
+    bool isBitSet(unsigned int n) const;
 
-    unsigned int getuint() const
-    {
-        return BN_get_word(this);
-    }
+    void setulong(unsigned long n);
+    unsigned long getulong() const;
+    unsigned int getuint() const { return getulong(); }
+    int getint() const;
+    void setint64(int64_t sn);
+    void setuint64(uint64_t n);
+    void setuint256(uint256 n);
+    uint256 getuint256() const;
 
-    int getint() const
-    {
-        unsigned long n = BN_get_word(this);
-        if (!BN_is_negative(this))
-            return (n > (unsigned long)std::numeric_limits<int>::max() ? std::numeric_limits<int>::max() : n);
-        else
-            return (n > (unsigned long)std::numeric_limits<int>::max() ? std::numeric_limits<int>::min() : -(int)n);
-    }
-
-    void setint64(int64_t sn)
-    {
-        unsigned char pch[sizeof(sn) + 6];
-        unsigned char* p = pch + 4;
-        bool fNegative;
-        uint64_t n;
-
-        if (sn < (int64_t)0)
-        {
-            // Since the minimum signed integer cannot be represented as positive so long as its type is signed, 
-            // and it's not well-defined what happens if you make it unsigned before negating it,
-            // we instead increment the negative integer by 1, convert it, then increment the (now positive) unsigned integer by 1 to compensate
-            n = -(sn + 1);
-            ++n;
-            fNegative = true;
-        } else {
-            n = sn;
-            fNegative = false;
-        }
-
-        bool fLeadingZeroes = true;
-        for (int i = 0; i < 8; i++)
-        {
-            unsigned char c = (n >> 56) & 0xff;
-            n <<= 8;
-            if (fLeadingZeroes)
-            {
-                if (c == 0)
-                    continue;
-                if (c & 0x80)
-                    *p++ = (fNegative ? 0x80 : 0);
-                else if (fNegative)
-                    c |= 0x80;
-                fLeadingZeroes = false;
-            }
-            *p++ = c;
-        }
-        unsigned int nSize = p - (pch + 4);
-        pch[0] = (nSize >> 24) & 0xff;
-        pch[1] = (nSize >> 16) & 0xff;
-        pch[2] = (nSize >> 8) & 0xff;
-        pch[3] = (nSize) & 0xff;
-        BN_mpi2bn(pch, p - pch, this);
-    }
-
-    void setuint64(uint64_t n)
-    {
-        unsigned char pch[sizeof(n) + 6];
-        unsigned char* p = pch + 4;
-        bool fLeadingZeroes = true;
-        for (int i = 0; i < 8; i++)
-        {
-            unsigned char c = (n >> 56) & 0xff;
-            n <<= 8;
-            if (fLeadingZeroes)
-            {
-                if (c == 0)
-                    continue;
-                if (c & 0x80)
-                    *p++ = 0;
-                fLeadingZeroes = false;
-            }
-            *p++ = c;
-        }
-        unsigned int nSize = p - (pch + 4);
-        pch[0] = (nSize >> 24) & 0xff;
-        pch[1] = (nSize >> 16) & 0xff;
-        pch[2] = (nSize >> 8) & 0xff;
-        pch[3] = (nSize) & 0xff;
-        BN_mpi2bn(pch, p - pch, this);
-    }
-
-    void setuint256(uint256 n)
-    {
-        unsigned char pch[sizeof(n) + 6];
-        unsigned char* p = pch + 4;
-        bool fLeadingZeroes = true;
-        unsigned char* pbegin = (unsigned char*)&n;
-        unsigned char* psrc = pbegin + sizeof(n);
-        while (psrc != pbegin)
-        {
-            unsigned char c = *(--psrc);
-            if (fLeadingZeroes)
-            {
-                if (c == 0)
-                    continue;
-                if (c & 0x80)
-                    *p++ = 0;
-                fLeadingZeroes = false;
-            }
-            *p++ = c;
-        }
-        unsigned int nSize = p - (pch + 4);
-        pch[0] = (nSize >> 24) & 0xff;
-        pch[1] = (nSize >> 16) & 0xff;
-        pch[2] = (nSize >> 8) & 0xff;
-        pch[3] = (nSize >> 0) & 0xff;
-        BN_mpi2bn(pch, p - pch, this);
-    }
-
-    uint256 getuint256() const
-    {
-        unsigned int nSize = BN_bn2mpi(this, NULL);
-        if (nSize < 4)
-            return 0;
-        std::vector<unsigned char> vch(nSize);
-        BN_bn2mpi(this, &vch[0]);
-        if (vch.size() > 4)
-            vch[4] &= 0x7f;
-        uint256 n = 0;
-        for (unsigned int i = 0, j = vch.size()-1; i < sizeof(n) && j >= 4; i++, j--)
-            ((unsigned char*)&n)[i] = vch[j];
-        return n;
-    }
-
-    void setvch(const std::vector<unsigned char>& vch)
-    {
-        std::vector<unsigned char> vch2(vch.size() + 4);
-        unsigned int nSize = vch.size();
-        // BIGNUM's byte stream format expects 4 bytes of
-        // big endian size data info at the front
-        vch2[0] = (nSize >> 24) & 0xff;
-        vch2[1] = (nSize >> 16) & 0xff;
-        vch2[2] = (nSize >> 8) & 0xff;
-        vch2[3] = (nSize >> 0) & 0xff;
-        // swap data to big endian
-        reverse_copy(vch.begin(), vch.end(), vch2.begin() + 4);
-        BN_mpi2bn(&vch2[0], vch2.size(), this);
-    }
-
-    std::vector<unsigned char> getvch() const
-    {
-        unsigned int nSize = BN_bn2mpi(this, NULL);
-        if (nSize <= 4)
-            return std::vector<unsigned char>();
-        std::vector<unsigned char> vch(nSize);
-        BN_bn2mpi(this, &vch[0]);
-        vch.erase(vch.begin(), vch.begin() + 4);
-        reverse(vch.begin(), vch.end());
-        return vch;
-    }
+    /** Little endian magnitude, the most significant bit of the last byte is the sign */
+    void setvch(const std::vector<unsigned char>& vch);
+    std::vector<unsigned char> getvch() const;
 
     // The "compact" format is a representation of a whole
     // number N using an unsigned 32bit number similar to a
@@ -330,142 +179,13 @@ public:
     //
     // This implementation directly uses shifts instead of going
     // through an intermediate MPI representation.
-    CBigNum& SetCompact(unsigned int nCompact)
-    {
-        unsigned int nSize = nCompact >> 24;
-        bool fNegative     =(nCompact & 0x00800000) != 0;
-        unsigned int nWord = nCompact & 0x007fffff;
-        if (nSize <= 3)
-        {
-            nWord >>= 8*(3-nSize);
-            BN_set_word(this, nWord);
-        }
-        else
-        {
-            BN_set_word(this, nWord);
-            BN_lshift(this, this, 8*(nSize-3));
-        }
-        BN_set_negative(this, fNegative);
-        return *this;
-    }
+    CBigNum& SetCompact(unsigned int nCompact);
+    unsigned int GetCompact() const;
 
-    unsigned int GetCompact() const
-    {
-        unsigned int nSize = BN_num_bytes(this);
-        unsigned int nCompact = 0;
-        if (nSize <= 3)
-            nCompact = BN_get_word(this) << 8*(3-nSize);
-        else
-        {
-            CBigNum bn;
-            BN_rshift(&bn, this, 8*(nSize-3));
-            nCompact = BN_get_word(&bn);
-        }
-        // The 0x00800000 bit denotes the sign.
-        // Thus, if it is already set, divide the mantissa by 256 and increase the exponent.
-        if (nCompact & 0x00800000)
-        {
-            nCompact >>= 8;
-            nSize++;
-        }
-        nCompact |= nSize << 24;
-        nCompact |= (BN_is_negative(this) ? 0x00800000 : 0);
-        return nCompact;
-    }
-
-    void SetHex(const std::string& str)
-    {
-        // skip 0x
-        const char* psz = str.c_str();
-        while (isspace(*psz))
-            psz++;
-        bool fNegative = false;
-        if (*psz == '-')
-        {
-            fNegative = true;
-            psz++;
-        }
-        if (psz[0] == '0' && tolower(psz[1]) == 'x')
-            psz += 2;
-        while (isspace(*psz))
-            psz++;
-
-        // hex string to bignum
-        static const signed char phexdigit[256] = { 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, 0,1,2,3,4,5,6,7,8,9,0,0,0,0,0,0, 0,0xa,0xb,0xc,0xd,0xe,0xf,0,0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, 0,0xa,0xb,0xc,0xd,0xe,0xf,0,0,0,0,0,0,0,0,0 };
-        *this = 0;
-        while (isxdigit(*psz))
-        {
-            *this <<= 4;
-            int n = phexdigit[(unsigned char)*psz++];
-            *this += n;
-        }
-        if (fNegative)
-            *this = 0 - *this;
-    }
-
-    bool SetHexBool(const std::string& str)
-    {
-        // skip 0x
-        const char* psz = str.c_str();
-        while (isspace(*psz))
-            psz++;
-        bool fNegative = false;
-        if (*psz == '-')
-        {
-            fNegative = true;
-            psz++;
-        }
-        if (psz[0] == '0' && tolower(psz[1]) == 'x')
-            psz += 2;
-        while (isspace(*psz))
-            psz++;
-
-        // hex string to bignum
-        static const signed char phexdigit[256] = { 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, 0,1,2,3,4,5,6,7,8,9,0,0,0,0,0,0, 0,0xa,0xb,0xc,0xd,0xe,0xf,0,0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, 0,0xa,0xb,0xc,0xd,0xe,0xf,0,0,0,0,0,0,0,0,0 };
-        *this = 0;
-        while (isxdigit(*psz))
-        {
-            *this <<= 4;
-            int n = phexdigit[(unsigned char)*psz++];
-            *this += n;
-        }
-        if (fNegative)
-            *this = 0 - *this;
-
-        return true;
-    }
-
-
-    std::string ToString(int nBase=10) const
-    {
-        CAutoBN_CTX pctx;
-        CBigNum bnBase = nBase;
-        CBigNum bn0 = 0;
-        std::string str;
-        CBigNum bn = *this;
-        BN_set_negative(&bn, false);
-        CBigNum dv;
-        CBigNum rem;
-        if (BN_cmp(&bn, &bn0) == 0)
-            return "0";
-        while (BN_cmp(&bn, &bn0) > 0)
-        {
-            if (!BN_div(&dv, &rem, &bn, &bnBase, pctx))
-                throw bignum_error("CBigNum::ToString() : BN_div failed");
-            bn = dv;
-            unsigned int c = rem.getulong();
-            str += "0123456789abcdef"[c];
-        }
-        if (BN_is_negative(this))
-            str += "-";
-        reverse(str.begin(), str.end());
-        return str;
-    }
-
-    std::string GetHex() const
-    {
-        return ToString(16);
-    }
+    void SetHex(const std::string& str);
+    bool SetHexBool(const std::string& str);
+    std::string ToString(int nBase=10) const;
+    std::string GetHex() const { return ToString(16); }
 
     unsigned int GetSerializeSize(int nType=0, int nVersion=PROTOCOL_VERSION) const
     {
@@ -500,48 +220,30 @@ public:
      * @param e the exponent
      * @return
      */
-    CBigNum pow(const CBigNum& e) const {
-        CAutoBN_CTX pctx;
-        CBigNum ret;
-        if (!BN_exp(&ret, this, &e, pctx))
-            throw bignum_error("CBigNum::pow : BN_exp failed");
-        return ret;
-    }
+    CBigNum pow(const CBigNum& e) const;
 
     /**
      * modular multiplication: (this * b) mod m
      * @param b operand
      * @param m modulus
      */
-    CBigNum mul_mod(const CBigNum& b, const CBigNum& m) const {
-        CAutoBN_CTX pctx;
-        CBigNum ret;
-        if (!BN_mod_mul(&ret, this, &b, &m, pctx))
-                throw bignum_error("CBigNum::mul_mod : BN_mod_mul failed");
-
-        return ret;
-    }
+    CBigNum mul_mod(const CBigNum& b, const CBigNum& m) const;
 
     /**
      * modular exponentiation: this^e mod n
      * @param e exponent
      * @param m modulus
      */
-    CBigNum pow_mod(const CBigNum& e, const CBigNum& m) const {
-        CAutoBN_CTX pctx;
-        CBigNum ret;
-        if( e < 0){
-            // g^-x = (g^-1)^x
-            CBigNum inv = this->inverse(m);
-            CBigNum posE = e * -1;
-            if (!BN_mod_exp(&ret, &inv, &posE, &m, pctx))
-                throw bignum_error("CBigNum::pow_mod: BN_mod_exp failed on negative exponent");
-        }else
-            if (!BN_mod_exp(&ret, this, &e, &m, pctx))
-                throw bignum_error("CBigNum::pow_mod : BN_mod_exp failed");
-
-        return ret;
-    }
+    CBigNum pow_mod(const CBigNum& e, const CBigNum& m) const;
+
+    /**
+     * modular exponentiation for secret exponents: this^e mod n
+     * Same result as pow_mod(), but the running time does not depend on
+     * the value of e when m is odd.
+     * @param e exponent
+     * @param m modulus
+     */
+    CBigNum pow_mod_sec(const CBigNum& e, const CBigNum& m) const;
 
    /**
     * Calculates the inverse of this element mod m.
@@ -549,13 +251,7 @@ public:
     * @param m the modu
     * @return the inverse
     */
-    CBigNum inverse(const CBigNum& m) const {
-        CAutoBN_CTX pctx;
-        CBigNum ret;
-        if (!BN_mod_inverse(&ret, this, &m, pctx))
-            throw bignum_error("CBigNum::inverse*= :BN_mod_inverse");
-        return ret;
-    }
+    CBigNum inverse(const CBigNum& m) const;
 
     /**
      * Generates a random (safe) prime of numBits bits
@@ -563,226 +259,70 @@ public:
      * @param safe true for a safe prime
      * @return the prime
      */
-    static CBigNum generatePrime(const unsigned int numBits, bool safe = false) {
-        CBigNum ret;
-        if(!BN_generate_prime_ex(&ret, numBits, (safe == true), NULL, NULL, NULL))
-            throw bignum_error("CBigNum::generatePrime*= :BN_generate_prime_ex");
-        return ret;
-    }
+    static CBigNum generatePrime(const unsigned int numBits, bool safe = false);
 
     /**
      * Calculates the greatest common divisor (GCD) of two numbers.
      * @param m the second element
      * @return the GCD
      */
-    CBigNum gcd( const CBigNum& b) const{
-        CAutoBN_CTX pctx;
-        CBigNum ret;
-        if (!BN_gcd(&ret, this, &b, pctx))
-            throw bignum_error("CBigNum::gcd*= :BN_gcd");
-        return ret;
-    }
+    CBigNum gcd(const CBigNum& b) const;
 
    /**
     * Miller-Rabin primality test on this element
     * @param checks: optional, the number of Miller-Rabin tests to run
-    * 			 	default causes error rate of 2^-80.
+    * 			 	default (0) picks a number for the size of the element
+    * 			 	which causes error rate of 2^-80.
     * @return true if prime
     */
-    bool isPrime(const int checks=BN_prime_checks) const {
-        CAutoBN_CTX pctx;
-        int ret = BN_is_prime(this, checks, NULL, pctx, NULL);
-        if(ret < 0){
-            throw bignum_error("CBigNum::isPrime :BN_is_prime");
-        }
-        return ret;
-    }
-
-    bool isOne() const {
-        return BN_is_one(this);
-    }
-
-
-
-    bool operator!() const
-    {
-        return BN_is_zero(this);
-    }
-
-    CBigNum& operator+=(const CBigNum& b)
-    {
-        if (!BN_add(this, this, &b))
-            throw bignum_error("CBigNum::operator+= : BN_add failed");
-        return *this;
-    }
-
-    CBigNum& operator-=(const CBigNum& b)
-    {
-        *this = *this - b;
-        return *this;
-    }
-
-    CBigNum& operator*=(const CBigNum& b)
-    {
-        CAutoBN_CTX pctx;
-        if (!BN_mul(this, this, &b, pctx))
-            throw bignum_error("CBigNum::operator*= : BN_mul failed");
-        return *this;
-    }
-
-    CBigNum& operator/=(const CBigNum& b)
-    {
-        *this = *this / b;
-        return *this;
-    }
-
-    CBigNum& operator%=(const CBigNum& b)
-    {
-        *this = *this % b;
-        return *this;
-    }
-
-    CBigNum& operator<<=(unsigned int shift)
-    {
-        if (!BN_lshift(this, this, shift))
-            throw bignum_error("CBigNum:operator<<= : BN_lshift failed");
-        return *this;
-    }
-
-    CBigNum& operator>>=(unsigned int shift)
-    {
-        // Note: BN_rshift segfaults on 64-bit if 2^shift is greater than the number
-        //   if built on ubuntu 9.04 or 9.10, probably depends on version of OpenSSL
-        CBigNum a = 1;
-        a <<= shift;
-        if (BN_cmp(&a, this) > 0)
-        {
-            *this = 0;
-            return *this;
-        }
-
-        if (!BN_rshift(this, this, shift))
-            throw bignum_error("CBigNum:operator>>= : BN_rshift failed");
-        return *this;
-    }
-
-
-    CBigNum& operator++()
-    {
-        // prefix operator
-        if (!BN_add(this, this, BN_value_one()))
-            throw bignum_error("CBigNum::operator++ : BN_add failed");
-        return *this;
-    }
-
-    const CBigNum operator++(int)
-    {
-        // postfix operator
-        const CBigNum ret = *this;
-        ++(*this);
-        return ret;
-    }
-
-    CBigNum& operator--()
-    {
-        // prefix operator
-        CBigNum r;
-        if (!BN_sub(&r, this, BN_value_one()))
-            throw bignum_error("CBigNum::operator-- : BN_sub failed");
-        *this = r;
-        return *this;
-    }
-
-    const CBigNum operator--(int)
-    {
-        // postfix operator
-        const CBigNum ret = *this;
-        --(*this);
-        return ret;
-    }
-
-
-    friend inline const CBigNum operator-(const CBigNum& a, const CBigNum& b);
-    friend inline const CBigNum operator/(const CBigNum& a, const CBigNum& b);
-    friend inline const CBigNum operator%(const CBigNum& a, const CBigNum& b);
-    friend inline const CBigNum operator*(const CBigNum& a, const CBigNum& b);
-    friend inline bool operator<(const CBigNum& a, const CBigNum& b);
-
+    bool isPrime(const int checks=0) const;
+
+    bool isOne() const;
+
+    bool operator!() const;
+
+    CBigNum& operator+=(const CBigNum& b);
+    CBigNum& operator-=(const CBigNum& b);
+    CBigNum& operator*=(const CBigNum& b);
+    CBigNum& operator/=(const CBigNum& b);
+    CBigNum& operator%=(const CBigNum& b);
+    CBigNum& operator<<=(unsigned int shift);
+    CBigNum& operator>>=(unsigned int shift);
+
+    CBigNum& operator++();
+    const CBigNum operator++(int);
+    CBigNum& operator--();
+    const CBigNum operator--(int);
+
+    friend const CBigNum operator+(const CBigNum& a, const CBigNum& b);
+    friend const CBigNum operator-(const CBigNum& a, const CBigNum& b);
+    friend const CBigNum operator-(const CBigNum& a);
+    friend const CBigNum operator*(const CBigNum& a, const CBigNum& b);
+    friend const CBigNum operator/(const CBigNum& a, const CBigNum& b);
+    friend const CBigNum operator%(const CBigNum& a, const CBigNum& b);
+    friend const CBigNum operator<<(const CBigNum& a, unsigned int shift);
+    friend bool operator==(const CBigNum& a, const CBigNum& b);
+    friend bool operator!=(const CBigNum& a, const CBigNum& b);
+    friend bool operator<=(const CBigNum& a, const CBigNum& b);
+    friend bool operator>=(const CBigNum& a, const CBigNum& b);
+    friend bool operator<(const CBigNum& a, const CBigNum& b);
+    friend bool operator>(const CBigNum& a, const CBigNum& b);
 };
 
-
-
-inline const CBigNum operator+(const CBigNum& a, const CBigNum& b)
-{
-    CBigNum r;
-    if (!BN_add(&r, &a, &b))
-        throw bignum_error("CBigNum::operator+ : BN_add failed");
-    return r;
-}
-
-inline const CBigNum operator-(const CBigNum& a, const CBigNum& b)
-{
-    CBigNum r;
-    if (!BN_sub(&r, &a, &b))
-        throw bignum_error("CBigNum::operator- : BN_sub failed");
-    return r;
-}
-
-inline const CBigNum operator-(const CBigNum& a)
-{
-    CBigNum r(a);
-    BN_set_negative(&r, !BN_is_negative(&r));
-    return r;
-}
-
-inline const CBigNum operator*(const CBigNum& a, const CBigNum& b)
-{
-    CAutoBN_CTX pctx;
-    CBigNum r;
-    if (!BN_mul(&r, &a, &b, pctx))
-        throw bignum_error("CBigNum::operator* : BN_mul failed");
-    return r;
-}
-
-inline const CBigNum operator/(const CBigNum& a, const CBigNum& b)
-{
-    CAutoBN_CTX pctx;
-    CBigNum r;
-    if (!BN_div(&r, NULL, &a, &b, pctx))
-        throw bignum_error("CBigNum::operator/ : BN_div failed");
-    return r;
-}
-
-inline const CBigNum operator%(const CBigNum& a, const CBigNum& b)
-{
-    CAutoBN_CTX pctx;
-    CBigNum r;
-    if (!BN_nnmod(&r, &a, &b, pctx))
-        throw bignum_error("CBigNum::operator% : BN_div failed");
-    return r;
-}
-
-inline const CBigNum operator<<(const CBigNum& a, unsigned int shift)
-{
-    CBigNum r;
-    if (!BN_lshift(&r, &a, shift))
-        throw bignum_error("CBigNum:operator<< : BN_lshift failed");
-    return r;
-}
-
-inline const CBigNum operator>>(const CBigNum& a, unsigned int shift)
-{
-    CBigNum r = a;
-    r >>= shift;
-    return r;
-}
-
-inline bool operator==(const CBigNum& a, const CBigNum& b) { return (BN_cmp(&a, &b) == 0); }
-inline bool operator!=(const CBigNum& a, const CBigNum& b) { return (BN_cmp(&a, &b) != 0); }
-inline bool operator<=(const CBigNum& a, const CBigNum& b) { return (BN_cmp(&a, &b) <= 0); }
-inline bool operator>=(const CBigNum& a, const CBigNum& b) { return (BN_cmp(&a, &b) >= 0); }
-inline bool operator<(const CBigNum& a, const CBigNum& b)  { return (BN_cmp(&a, &b) < 0); }
-inline bool operator>(const CBigNum& a, const CBigNum& b)  { return (BN_cmp(&a, &b) > 0); }
+const CBigNum operator+(const CBigNum& a, const CBigNum& b);
+const CBigNum operator-(const CBigNum& a, const CBigNum& b);
+const CBigNum operator-(const CBigNum& a);
+const CBigNum operator*(const CBigNum& a, const CBigNum& b);
+const CBigNum operator/(const CBigNum& a, const CBigNum& b);
+const CBigNum operator%(const CBigNum& a, const CBigNum& b);
+const CBigNum operator<<(const CBigNum& a, unsigned int shift);
+const CBigNum operator>>(const CBigNum& a, unsigned int shift);
+bool operator==(const CBigNum& a, const CBigNum& b);
+bool operator!=(const CBigNum& a, const CBigNum& b);
+bool operator<=(const CBigNum& a, const CBigNum& b);
+bool operator>=(const CBigNum& a, const CBigNum& b);
+bool operator<(const CBigNum& a, const CBigNum& b);
+bool operator>(const CBigNum& a, const CBigNum& b);
 inline std::ostream& operator<<(std::ostream &strm, const CBigNum &b) { return strm << b.ToString(10); }
 
 typedef CBigNum Bignum;
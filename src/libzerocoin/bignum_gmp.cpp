@@ -0,0 +1,398 @@
+// Copyright (c) 2017 The PIVX developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// CBigNum on top of GMP mpz_t. Values, rounding and the byte format of
+// getvch()/setvch() follow the OpenSSL implementation exactly.
+
+#include "bignum.h"
+
+#if defined(USE_NUM_GMP)
+
+#include <algorithm>
+#include <limits>
+
+#include <openssl/crypto.h> // for OPENSSL_cleanse()
+#include <openssl/rand.h>
+
+/** Miller-Rabin rounds for an error rate of 2^-80, same table as BN_prime_checks_for_size */
+static int PrimeChecksForSize(int nBits)
+{
+    return nBits >= 1300 ? 2 :
+           nBits >=  850 ? 3 :
+           nBits >=  650 ? 4 :
+           nBits >=  550 ? 5 :
+           nBits >=  450 ? 6 :
+           nBits >=  400 ? 7 :
+           nBits >=  350 ? 8 :
+           nBits >=  300 ? 9 :
+           nBits >=  250 ? 12 :
+           nBits >=  200 ? 15 :
+           nBits >=  150 ? 18 :
+           27;
+}
+
+static void CheckDivisor(const CBigNum& b, const char* strWhere)
+{
+    if (!b)
+        throw bignum_error(std::string(strWhere) + " : division by zero");
+}
+
+CBigNum::CBigNum()
+{
+    mpz_init(bn);
+}
+
+CBigNum::CBigNum(const CBigNum& b)
+{
+    mpz_init_set(bn, b.bn);
+}
+
+CBigNum& CBigNum::operator=(const CBigNum& b)
+{
+    mpz_set(bn, b.bn);
+    return (*this);
+}
+
+CBigNum::~CBigNum()
+{
+    // Same as BN_clear_free, do not leave secrets behind
+    size_t nLimbs = mpz_size(bn);
+    if (nLimbs > 0)
+        OPENSSL_cleanse(mpz_limbs_modify(bn, nLimbs), nLimbs * sizeof(mp_limb_t));
+    mpz_clear(bn);
+}
+
+const char* CBigNum::GetBackendName()
+{
+    return "gmp";
+}
+
+CBigNum CBigNum::randBignum(const CBigNum& range)
+{
+    if (range <= 0)
+        throw bignum_error("CBigNum:rand element : range must be positive");
+
+    // Rejection sampling on bitSize() random bits, less than two draws on average
+    CBigNum ret;
+    do {
+        ret = RandKBitBigum(range.bitSize());
+    } while (ret >= range);
+    return ret;
+}
+
+CBigNum CBigNum::RandKBitBigum(const uint32_t k)
+{
+    std::vector<unsigned char> vch((k + 7) / 8);
+    if (vch.empty())
+        return CBigNum();
+    if (RAND_bytes(&vch[0], vch.size()) != 1)
+        throw bignum_error("CBigNum:rand element : RAND_bytes failed");
+    if (k % 8)
+        vch[0] &= (1 << (k % 8)) - 1;
+
+    CBigNum ret;
+    mpz_import(ret.bn, vch.size(), 1, 1, 0, 0, &vch[0]);
+    OPENSSL_cleanse(&vch[0], vch.size());
+    return ret;
+}
+
+int CBigNum::bitSize() const
+{
+    // mpz_sizeinbase() counts one digit for zero
+    return mpz_sgn(bn) == 0 ? 0 : mpz_sizeinbase(bn, 2);
+}
+
+bool CBigNum::isBitSet(unsigned int n) const
+{
+    if (mpz_sgn(bn) >= 0)
+        return mpz_tstbit(bn, n);
+
+    // mpz_tstbit() works on the two's complement of negative numbers
+    CBigNum bnAbs = -*this;
+    return mpz_tstbit(bnAbs.bn, n);
+}
+
+void CBigNum::setulong(unsigned long n)
+{
+    mpz_set_ui(bn, n);
+}
+
+unsigned long CBigNum::getulong() const
+{
+    // BN_get_word() gives all ones when the value does not fit
+    if (bitSize() > std::numeric_limits<unsigned long>::digits)
+        return std::numeric_limits<unsigned long>::max();
+    return mpz_get_ui(bn);
+}
+
+void CBigNum::setint64(int64_t sn)
+{
+    // Negate as unsigned so that the minimum value does not overflow
+    uint64_t n = (sn < 0 ? -(uint64_t)sn : (uint64_t)sn);
+    setuint64(n);
+    if (sn < 0)
+        mpz_neg(bn, bn);
+}
+
+void CBigNum::setuint64(uint64_t n)
+{
+    // unsigned long is only 32 bits on some platforms
+    mpz_import(bn, 1, 1, sizeof(n), 0, 0, &n);
+}
+
+void CBigNum::setuint256(uint256 n)
+{
+    mpz_import(bn, sizeof(n), -1, 1, 0, 0, (unsigned char*)&n);
+}
+
+uint256 CBigNum::getuint256() const
+{
+    // The low 256 bits of the absolute value
+    mpz_t low;
+    mpz_init(low);
+    mpz_abs(low, bn);
+    mpz_tdiv_r_2exp(low, low, 256);
+
+    uint256 n = 0;
+    size_t nCount = 0;
+    mpz_export((unsigned char*)&n, &nCount, -1, 1, 0, 0, low);
+    mpz_clear(low);
+    return n;
+}
+
+void CBigNum::setvch(const std::vector<unsigned char>& vch)
+{
+    if (vch.empty()) {
+        mpz_set_ui(bn, 0);
+        return;
+    }
+
+    // The top bit of the most significant (last) byte is the sign
+    std::vector<unsigned char> vchMagnitude(vch);
+    bool fNegative = (vchMagnitude.back() & 0x80) != 0;
+    vchMagnitude.back() &= 0x7f;
+    mpz_import(bn, vchMagnitude.size(), -1, 1, 0, 0, &vchMagnitude[0]);
+    if (fNegative)
+        mpz_neg(bn, bn);
+}
+
+std::vector<unsigned char> CBigNum::getvch() const
+{
+    if (mpz_sgn(bn) == 0)
+        return std::vector<unsigned char>();
+
+    // Little endian magnitude, with an extra byte when the top bit is
+    // needed for the sign (like BN_bn2mpi())
+    std::vector<unsigned char> vch((bitSize() + 7) / 8 + 1);
+    size_t nCount = 0;
+    mpz_export(&vch[0], &nCount, -1, 1, 0, 0, bn);
+    vch.resize(nCount);
+    if (vch.back() & 0x80)
+        vch.push_back(0);
+    if (mpz_sgn(bn) < 0)
+        vch.back() |= 0x80;
+    return vch;
+}
+
+CBigNum CBigNum::pow(const CBigNum& e) const
+{
+    if (e < 0 || e.bitSize() > std::numeric_limits<unsigned long>::digits)
+        throw bignum_error("CBigNum::pow : exponent out of range");
+    CBigNum ret;
+    mpz_pow_ui(ret.bn, bn, e.getulong());
+    return ret;
+}
+
+CBigNum CBigNum::mul_mod(const CBigNum& b, const CBigNum& m) const
+{
+    CheckDivisor(m, "CBigNum::mul_mod");
+    CBigNum ret;
+    mpz_mul(ret.bn, bn, b.bn);
+    mpz_mod(ret.bn, ret.bn, m.bn);
+    return ret;
+}
+
+CBigNum CBigNum::pow_mod(const CBigNum& e, const CBigNum& m) const
+{
+    CheckDivisor(m, "CBigNum::pow_mod");
+    CBigNum ret;
+    if (e < 0) {
+        // g^-x = (g^-1)^x
+        CBigNum inv = this->inverse(m);
+        CBigNum posE = -e;
+        mpz_powm(ret.bn, inv.bn, posE.bn, m.bn);
+    } else
+        mpz_powm(ret.bn, bn, e.bn, m.bn);
+
+    return ret;
+}
+
+CBigNum CBigNum::pow_mod_sec(const CBigNum& e, const CBigNum& m) const
+{
+    // mpz_powm_sec() needs an odd modulus and a positive exponent
+    if (!m.isBitSet(0) || !e)
+        return pow_mod(e, m);
+
+    CBigNum ret;
+    if (e < 0) {
+        CBigNum inv = this->inverse(m);
+        CBigNum posE = -e;
+        mpz_powm_sec(ret.bn, inv.bn, posE.bn, m.bn);
+    } else
+        mpz_powm_sec(ret.bn, bn, e.bn, m.bn);
+
+    return ret;
+}
+
+CBigNum CBigNum::inverse(const CBigNum& m) const
+{
+    CheckDivisor(m, "CBigNum::inverse");
+    CBigNum ret;
+    if (!mpz_invert(ret.bn, bn, m.bn))
+        throw bignum_error("CBigNum::inverse*= :mpz_invert");
+    return ret;
+}
+
+CBigNum CBigNum::generatePrime(const unsigned int numBits, bool safe)
+{
+    if (numBits < (safe ? 3u : 2u))
+        throw bignum_error("CBigNum::generatePrime*= : too few bits");
+
+    // Random numbers with the top bit set, the next prime above them
+    // is kept if it still has numBits bits.
+    while (true) {
+        CBigNum candidate = RandKBitBigum(numBits - (safe ? 1 : 0));
+        mpz_setbit(candidate.bn, numBits - (safe ? 2 : 1));
+        mpz_nextprime(candidate.bn, candidate.bn);
+        if (safe) {
+            // p = 2q + 1 with q prime
+            candidate = candidate * 2 + 1;
+            if (candidate.bitSize() != (int)numBits || !candidate.isPrime())
+                continue;
+        } else if (candidate.bitSize() != (int)numBits)
+            continue;
+        return candidate;
+    }
+}
+
+CBigNum CBigNum::gcd(const CBigNum& b) const
+{
+    CBigNum ret;
+    mpz_gcd(ret.bn, bn, b.bn);
+    return ret;
+}
+
+bool CBigNum::isPrime(const int checks) const
+{
+    // mpz_probab_prime_p() looks at the absolute value
+    if (*this <= 1)
+        return false;
+    return mpz_probab_prime_p(bn, checks > 0 ? checks : PrimeChecksForSize(bitSize())) != 0;
+}
+
+bool CBigNum::isOne() const
+{
+    return mpz_cmp_ui(bn, 1) == 0;
+}
+
+bool CBigNum::operator!() const
+{
+    return mpz_sgn(bn) == 0;
+}
+
+CBigNum& CBigNum::operator+=(const CBigNum& b)
+{
+    mpz_add(bn, bn, b.bn);
+    return *this;
+}
+
+CBigNum& CBigNum::operator*=(const CBigNum& b)
+{
+    mpz_mul(bn, bn, b.bn);
+    return *this;
+}
+
+CBigNum& CBigNum::operator<<=(unsigned int shift)
+{
+    mpz_mul_2exp(bn, bn, shift);
+    return *this;
+}
+
+CBigNum& CBigNum::operator>>=(unsigned int shift)
+{
+    // Anything below 2^shift (negative numbers included) becomes zero,
+    // like the OpenSSL implementation
+    CBigNum a = 1;
+    a <<= shift;
+    if (a > *this)
+    {
+        *this = 0;
+        return *this;
+    }
+
+    mpz_tdiv_q_2exp(bn, bn, shift);
+    return *this;
+}
+
+const CBigNum operator+(const CBigNum& a, const CBigNum& b)
+{
+    CBigNum r;
+    mpz_add(r.bn, a.bn, b.bn);
+    return r;
+}
+
+const CBigNum operator-(const CBigNum& a, const CBigNum& b)
+{
+    CBigNum r;
+    mpz_sub(r.bn, a.bn, b.bn);
+    return r;
+}
+
+const CBigNum operator-(const CBigNum& a)
+{
+    CBigNum r;
+    mpz_neg(r.bn, a.bn);
+    return r;
+}
+
+const CBigNum operator*(const CBigNum& a, const CBigNum& b)
+{
+    CBigNum r;
+    mpz_mul(r.bn, a.bn, b.bn);
+    return r;
+}
+
+const CBigNum operator/(const CBigNum& a, const CBigNum& b)
+{
+    // Rounds towards zero, like BN_div()
+    CheckDivisor(b, "CBigNum::operator/");
+    CBigNum r;
+    mpz_tdiv_q(r.bn, a.bn, b.bn);
+    return r;
+}
+
+const CBigNum operator%(const CBigNum& a, const CBigNum& b)
+{
+    // Never negative, like BN_nnmod()
+    CheckDivisor(b, "CBigNum::operator%");
+    CBigNum r;
+    mpz_mod(r.bn, a.bn, b.bn);
+    return r;
+}
+
+const CBigNum operator<<(const CBigNum& a, unsigned int shift)
+{
+    CBigNum r;
+    mpz_mul_2exp(r.bn, a.bn, shift);
+    return r;
+}
+
+bool operator==(const CBigNum& a, const CBigNum& b) { return (mpz_cmp(a.bn, b.bn) == 0); }
+bool operator!=(const CBigNum& a, const CBigNum& b) { return (mpz_cmp(a.bn, b.bn) != 0); }
+bool operator<=(const CBigNum& a, const CBigNum& b) { return (mpz_cmp(a.bn, b.bn) <= 0); }
+bool operator>=(const CBigNum& a, const CBigNum& b) { return (mpz_cmp(a.bn, b.bn) >= 0); }
+bool operator<(const CBigNum& a, const CBigNum& b)  { return (mpz_cmp(a.bn, b.bn) < 0); }
+bool operator>(const CBigNum& a, const CBigNum& b)  { return (mpz_cmp(a.bn, b.bn) > 0); }
+
+#endif // USE_NUM_GMP
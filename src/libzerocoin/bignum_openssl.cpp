@@ -0,0 +1,430 @@
+// Copyright (c) 2009-2010 Satoshi Nakamoto
+// Copyright (c) 2009-2012 The Bitcoin developers
+// Copyright (c) 2017 The PIVX developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// CBigNum on top of OpenSSL BIGNUM
+
+#include "bignum.h"
+
+#if defined(USE_NUM_OPENSSL)
+
+CBigNum::CBigNum()
+{
+    bn = BN_new();
+    if (bn == NULL)
+        throw bignum_error("CBigNum::CBigNum : BN_new failed");
+}
+
+CBigNum::CBigNum(const CBigNum& b)
+{
+    bn = BN_new();
+    if (bn == NULL || !BN_copy(bn, b.bn))
+    {
+        BN_clear_free(bn);
+        throw bignum_error("CBigNum::CBigNum(const CBigNum&) : BN_copy failed");
+    }
+}
+
+CBigNum& CBigNum::operator=(const CBigNum& b)
+{
+    if (!BN_copy(bn, b.bn))
+        throw bignum_error("CBigNum::operator= : BN_copy failed");
+    return (*this);
+}
+
+CBigNum::~CBigNum()
+{
+    BN_clear_free(bn);
+}
+
+const char* CBigNum::GetBackendName()
+{
+    return "openssl";
+}
+
+CBigNum CBigNum::randBignum(const CBigNum& range)
+{
+    CBigNum ret;
+    if(!BN_rand_range(ret.bn, range.bn)){
+        throw bignum_error("CBigNum:rand element : BN_rand_range failed");
+    }
+    return ret;
+}
+
+CBigNum CBigNum::RandKBitBigum(const uint32_t k)
+{
+    CBigNum ret;
+    if(!BN_rand(ret.bn, k, -1, 0)){
+        throw bignum_error("CBigNum:rand element : BN_rand failed");
+    }
+    return ret;
+}
+
+int CBigNum::bitSize() const
+{
+    return BN_num_bits(bn);
+}
+
+bool CBigNum::isBitSet(unsigned int n) const
+{
+    return BN_is_bit_set(bn, n);
+}
+
+void CBigNum::setulong(unsigned long n)
+{
+    if (!BN_set_word(bn, n))
+        throw bignum_error("CBigNum conversion from unsigned long : BN_set_word failed");
+}
+
+unsigned long CBigNum::getulong() const
+{
+    return BN_get_word(bn);
+}
+
+void CBigNum::setint64(int64_t sn)
+{
+    unsigned char pch[sizeof(sn) + 6];
+    unsigned char* p = pch + 4;
+    bool fNegative;
+    uint64_t n;
+
+    if (sn < (int64_t)0)
+    {
+        // Since the minimum signed integer cannot be represented as positive so long as its type is signed,
+        // and it's not well-defined what happens if you make it unsigned before negating it,
+        // we instead increment the negative integer by 1, convert it, then increment the (now positive) unsigned integer by 1 to compensate
+        n = -(sn + 1);
+        ++n;
+        fNegative = true;
+    } else {
+        n = sn;
+        fNegative = false;
+    }
+
+    bool fLeadingZeroes = true;
+    for (int i = 0; i < 8; i++)
+    {
+        unsigned char c = (n >> 56) & 0xff;
+        n <<= 8;
+        if (fLeadingZeroes)
+        {
+            if (c == 0)
+                continue;
+            if (c & 0x80)
+                *p++ = (fNegative ? 0x80 : 0);
+            else if (fNegative)
+                c |= 0x80;
+            fLeadingZeroes = false;
+        }
+        *p++ = c;
+    }
+    unsigned int nSize = p - (pch + 4);
+    pch[0] = (nSize >> 24) & 0xff;
+    pch[1] = (nSize >> 16) & 0xff;
+    pch[2] = (nSize >> 8) & 0xff;
+    pch[3] = (nSize) & 0xff;
+    BN_mpi2bn(pch, p - pch, bn);
+}
+
+void CBigNum::setuint64(uint64_t n)
+{
+    unsigned char pch[sizeof(n) + 6];
+    unsigned char* p = pch + 4;
+    bool fLeadingZeroes = true;
+    for (int i = 0; i < 8; i++)
+    {
+        unsigned char c = (n >> 56) & 0xff;
+        n <<= 8;
+        if (fLeadingZeroes)
+        {
+            if (c == 0)
+                continue;
+            if (c & 0x80)
+                *p++ = 0;
+            fLeadingZeroes = false;
+        }
+        *p++ = c;
+    }
+    unsigned int nSize = p - (pch + 4);
+    pch[0] = (nSize >> 24) & 0xff;
+    pch[1] = (nSize >> 16) & 0xff;
+    pch[2] = (nSize >> 8) & 0xff;
+    pch[3] = (nSize) & 0xff;
+    BN_mpi2bn(pch, p - pch, bn);
+}
+
+void CBigNum::setuint256(uint256 n)
+{
+    unsigned char pch[sizeof(n) + 6];
+    unsigned char* p = pch + 4;
+    bool fLeadingZeroes = true;
+    unsigned char* pbegin = (unsigned char*)&n;
+    unsigned char* psrc = pbegin + sizeof(n);
+    while (psrc != pbegin)
+    {
+        unsigned char c = *(--psrc);
+        if (fLeadingZeroes)
+        {
+            if (c == 0)
+                continue;
+            if (c & 0x80)
+                *p++ = 0;
+            fLeadingZeroes = false;
+        }
+        *p++ = c;
+    }
+    unsigned int nSize = p - (pch + 4);
+    pch[0] = (nSize >> 24) & 0xff;
+    pch[1] = (nSize >> 16) & 0xff;
+    pch[2] = (nSize >> 8) & 0xff;
+    pch[3] = (nSize >> 0) & 0xff;
+    BN_mpi2bn(pch, p - pch, bn);
+}
+
+uint256 CBigNum::getuint256() const
+{
+    unsigned int nSize = BN_bn2mpi(bn, NULL);
+    if (nSize < 4)
+        return 0;
+    std::vector<unsigned char> vch(nSize);
+    BN_bn2mpi(bn, &vch[0]);
+    if (vch.size() > 4)
+        vch[4] &= 0x7f;
+    uint256 n = 0;
+    for (unsigned int i = 0, j = vch.size()-1; i < sizeof(n) && j >= 4; i++, j--)
+        ((unsigned char*)&n)[i] = vch[j];
+    return n;
+}
+
+void CBigNum::setvch(const std::vector<unsigned char>& vch)
+{
+    std::vector<unsigned char> vch2(vch.size() + 4);
+    unsigned int nSize = vch.size();
+    // BIGNUM's byte stream format expects 4 bytes of
+    // big endian size data info at the front
+    vch2[0] = (nSize >> 24) & 0xff;
+    vch2[1] = (nSize >> 16) & 0xff;
+    vch2[2] = (nSize >> 8) & 0xff;
+    vch2[3] = (nSize >> 0) & 0xff;
+    // swap data to big endian
+    reverse_copy(vch.begin(), vch.end(), vch2.begin() + 4);
+    BN_mpi2bn(&vch2[0], vch2.size(), bn);
+}
+
+std::vector<unsigned char> CBigNum::getvch() const
+{
+    unsigned int nSize = BN_bn2mpi(bn, NULL);
+    if (nSize <= 4)
+        return std::vector<unsigned char>();
+    std::vector<unsigned char> vch(nSize);
+    BN_bn2mpi(bn, &vch[0]);
+    vch.erase(vch.begin(), vch.begin() + 4);
+    reverse(vch.begin(), vch.end());
+    return vch;
+}
+
+CBigNum CBigNum::pow(const CBigNum& e) const
+{
+    CAutoBN_CTX pctx;
+    CBigNum ret;
+    if (!BN_exp(ret.bn, bn, e.bn, pctx))
+        throw bignum_error("CBigNum::pow : BN_exp failed");
+    return ret;
+}
+
+CBigNum CBigNum::mul_mod(const CBigNum& b, const CBigNum& m) const
+{
+    CAutoBN_CTX pctx;
+    CBigNum ret;
+    if (!BN_mod_mul(ret.bn, bn, b.bn, m.bn, pctx))
+        throw bignum_error("CBigNum::mul_mod : BN_mod_mul failed");
+
+    return ret;
+}
+
+CBigNum CBigNum::pow_mod(const CBigNum& e, const CBigNum& m) const
+{
+    CAutoBN_CTX pctx;
+    CBigNum ret;
+    if( e < 0){
+        // g^-x = (g^-1)^x
+        CBigNum inv = this->inverse(m);
+        CBigNum posE = e * -1;
+        if (!BN_mod_exp(ret.bn, inv.bn, posE.bn, m.bn, pctx))
+            throw bignum_error("CBigNum::pow_mod: BN_mod_exp failed on negative exponent");
+    }else
+        if (!BN_mod_exp(ret.bn, bn, e.bn, m.bn, pctx))
+            throw bignum_error("CBigNum::pow_mod : BN_mod_exp failed");
+
+    return ret;
+}
+
+CBigNum CBigNum::pow_mod_sec(const CBigNum& e, const CBigNum& m) const
+{
+    // Montgomery ladder only works with odd moduli
+    if (!BN_is_odd(m.bn))
+        return pow_mod(e, m);
+
+    CAutoBN_CTX pctx;
+    CBigNum ret;
+    CBigNum base = (e < 0 ? this->inverse(m) : *this % m);
+    CBigNum posE = (e < 0 ? e * -1 : e);
+    if (!BN_mod_exp_mont_consttime(ret.bn, base.bn, posE.bn, m.bn, pctx, NULL))
+        throw bignum_error("CBigNum::pow_mod_sec : BN_mod_exp_mont_consttime failed");
+
+    return ret;
+}
+
+CBigNum CBigNum::inverse(const CBigNum& m) const
+{
+    CAutoBN_CTX pctx;
+    CBigNum ret;
+    if (!BN_mod_inverse(ret.bn, bn, m.bn, pctx))
+        throw bignum_error("CBigNum::inverse*= :BN_mod_inverse");
+    return ret;
+}
+
+CBigNum CBigNum::generatePrime(const unsigned int numBits, bool safe)
+{
+    CBigNum ret;
+    if(!BN_generate_prime_ex(ret.bn, numBits, (safe == true), NULL, NULL, NULL))
+        throw bignum_error("CBigNum::generatePrime*= :BN_generate_prime_ex");
+    return ret;
+}
+
+CBigNum CBigNum::gcd(const CBigNum& b) const
+{
+    CAutoBN_CTX pctx;
+    CBigNum ret;
+    if (!BN_gcd(ret.bn, bn, b.bn, pctx))
+        throw bignum_error("CBigNum::gcd*= :BN_gcd");
+    return ret;
+}
+
+bool CBigNum::isPrime(const int checks) const
+{
+    CAutoBN_CTX pctx;
+    int ret = BN_is_prime_ex(bn, checks, pctx, NULL);
+    if(ret < 0){
+        throw bignum_error("CBigNum::isPrime :BN_is_prime");
+    }
+    return ret;
+}
+
+bool CBigNum::isOne() const
+{
+    return BN_is_one(bn);
+}
+
+bool CBigNum::operator!() const
+{
+    return BN_is_zero(bn);
+}
+
+CBigNum& CBigNum::operator+=(const CBigNum& b)
+{
+    if (!BN_add(bn, bn, b.bn))
+        throw bignum_error("CBigNum::operator+= : BN_add failed");
+    return *this;
+}
+
+CBigNum& CBigNum::operator*=(const CBigNum& b)
+{
+    CAutoBN_CTX pctx;
+    if (!BN_mul(bn, bn, b.bn, pctx))
+        throw bignum_error("CBigNum::operator*= : BN_mul failed");
+    return *this;
+}
+
+CBigNum& CBigNum::operator<<=(unsigned int shift)
+{
+    if (!BN_lshift(bn, bn, shift))
+        throw bignum_error("CBigNum:operator<<= : BN_lshift failed");
+    return *this;
+}
+
+CBigNum& CBigNum::operator>>=(unsigned int shift)
+{
+    // Note: BN_rshift segfaults on 64-bit if 2^shift is greater than the number
+    //   if built on ubuntu 9.04 or 9.10, probably depends on version of OpenSSL
+    CBigNum a = 1;
+    a <<= shift;
+    if (BN_cmp(a.bn, bn) > 0)
+    {
+        *this = 0;
+        return *this;
+    }
+
+    if (!BN_rshift(bn, bn, shift))
+        throw bignum_error("CBigNum:operator>>= : BN_rshift failed");
+    return *this;
+}
+
+const CBigNum operator+(const CBigNum& a, const CBigNum& b)
+{
+    CBigNum r;
+    if (!BN_add(r.bn, a.bn, b.bn))
+        throw bignum_error("CBigNum::operator+ : BN_add failed");
+    return r;
+}
+
+const CBigNum operator-(const CBigNum& a, const CBigNum& b)
+{
+    CBigNum r;
+    if (!BN_sub(r.bn, a.bn, b.bn))
+        throw bignum_error("CBigNum::operator- : BN_sub failed");
+    return r;
+}
+
+const CBigNum operator-(const CBigNum& a)
+{
+    CBigNum r(a);
+    BN_set_negative(r.bn, !BN_is_negative(r.bn));
+    return r;
+}
+
+const CBigNum operator*(const CBigNum& a, const CBigNum& b)
+{
+    CAutoBN_CTX pctx;
+    CBigNum r;
+    if (!BN_mul(r.bn, a.bn, b.bn, pctx))
+        throw bignum_error("CBigNum::operator* : BN_mul failed");
+    return r;
+}
+
+const CBigNum operator/(const CBigNum& a, const CBigNum& b)
+{
+    CAutoBN_CTX pctx;
+    CBigNum r;
+    if (!BN_div(r.bn, NULL, a.bn, b.bn, pctx))
+        throw bignum_error("CBigNum::operator/ : BN_div failed");
+    return r;
+}
+
+const CBigNum operator%(const CBigNum& a, const CBigNum& b)
+{
+    CAutoBN_CTX pctx;
+    CBigNum r;
+    if (!BN_nnmod(r.bn, a.bn, b.bn, pctx))
+        throw bignum_error("CBigNum::operator% : BN_div failed");
+    return r;
+}
+
+const CBigNum operator<<(const CBigNum& a, unsigned int shift)
+{
+    CBigNum r;
+    if (!BN_lshift(r.bn, a.bn, shift))
+        throw bignum_error("CBigNum:operator<< : BN_lshift failed");
+    return r;
+}
+
+bool operator==(const CBigNum& a, const CBigNum& b) { return (BN_cmp(a.bn, b.bn) == 0); }
+bool operator!=(const CBigNum& a, const CBigNum& b) { return (BN_cmp(a.bn, b.bn) != 0); }
+bool operator<=(const CBigNum& a, const CBigNum& b) { return (BN_cmp(a.bn, b.bn) <= 0); }
+bool operator>=(const CBigNum& a, const CBigNum& b) { return (BN_cmp(a.bn, b.bn) >= 0); }
+bool operator<(const CBigNum& a, const CBigNum& b)  { return (BN_cmp(a.bn, b.bn) < 0); }
+bool operator>(const CBigNum& a, const CBigNum& b)  { return (BN_cmp(a.bn, b.bn) > 0); }
+
+#endif // USE_NUM_OPENSSL
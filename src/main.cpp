@@ -10,6 +10,8 @@
 #include "accumulators.h"
 #include "addrman.h"
 #include "alert.h"
+#include "blockpipeline.h"
+#include "blockreader.h"
 #include "chainparams.h"
 #include "checkpoints.h"
 #include "checkqueue.h"
@@ -30,6 +32,7 @@
 #include "ui_interface.h"
 #include "util.h"
 #include "utilmoneystr.h"
+#include "zerocoincache.h"
 
 #include "primitives/zerocoin.h"
 #include "libzerocoin/Denominations.h"
@@ -70,13 +73,15 @@ int64_t nTimeBestReceived = 0;
 CWaitableCriticalSection csBestBlock;
 CConditionVariable cvBlockChange;
 int nScriptCheckThreads = 0;
+int nBlockCheckThreads = 0;
 bool fImporting = false;
 bool fReindex = false;
 bool fTxIndex = true;
 bool fIsBareMultisigStd = true;
 bool fCheckBlockIndex = false;
+bool fCheckBlockReads = DEFAULT_CHECK_BLOCK_READS;
 bool fVerifyingBlocks = false;
-unsigned int nCoinCacheSize = 5000;
+size_t nCoinCacheUsage = 5000 * 300;
 bool fAlerts = DEFAULT_ALERTS;
 
 unsigned int nStakeMinAge = 60 * 60;
@@ -1219,6 +1224,76 @@ bool BlockToPubcoinList(const CBlock& block, list<PublicCoin>& listPubcoins, boo
     return true;
 }
 
+//collect the zerocoin mints of a block with the outpoints they spend, as stored in the zerocoin db
+bool BlockToBlockPubcoins(const CBlock& block, CBlockPubcoins& blockPubcoins)
+{
+    blockPubcoins.SetNull();
+    blockPubcoins.hashBlock = block.GetHash();
+    for (const CTransaction& tx : block.vtx) {
+        if(!tx.IsZerocoinMint())
+            continue;
+
+        CPubcoinTx pubcoinTx;
+        pubcoinTx.txid = tx.GetHash();
+        for (const CTxIn& in : tx.vin)
+            pubcoinTx.vPrevout.emplace_back(in.prevout);
+
+        for (unsigned int i = 0; i < tx.vout.size(); i++) {
+            const CTxOut& txOut = tx.vout[i];
+            if(!txOut.scriptPubKey.IsZerocoinMint())
+                continue;
+
+            CValidationState state;
+            PublicCoin pubCoin(Params().Zerocoin_Params());
+            if(!TxOutToPublicCoin(txOut, pubCoin, state))
+                return false;
+
+            pubcoinTx.vOut.emplace_back(i);
+            pubcoinTx.vDenom.emplace_back(pubCoin.getDenomination());
+            pubcoinTx.vPubcoin.emplace_back(pubCoin.getValue());
+        }
+        blockPubcoins.vTx.emplace_back(pubcoinTx);
+    }
+
+    return true;
+}
+
+void BlockPubcoinsToList(const CBlockPubcoins& blockPubcoins, list<PublicCoin>& listPubcoins, bool fFilterInvalid)
+{
+    // same filtering as BlockToPubcoinList()
+    for (const CPubcoinTx& pubcoinTx : blockPubcoins.vTx) {
+        if (fFilterInvalid) {
+            bool fValid = true;
+            for (const COutPoint& prevout : pubcoinTx.vPrevout) {
+                if (!ValidOutPoint(prevout, INT_MAX)) {
+                    fValid = false;
+                    break;
+                }
+            }
+            if (!fValid)
+                continue;
+        }
+
+        unsigned int nOutChecked = 0;
+        for (unsigned int i = 0; i < pubcoinTx.vPubcoin.size(); i++) {
+            //Filter out mints that use invalid outpoints - edge case: invalid spend with minted change
+            if (fFilterInvalid) {
+                bool fValid = true;
+                for (; nOutChecked <= pubcoinTx.vOut[i]; nOutChecked++) {
+                    if (!ValidOutPoint(COutPoint(pubcoinTx.txid, nOutChecked), INT_MAX)) {
+                        fValid = false;
+                        break;
+                    }
+                }
+                if (!fValid)
+                    break;
+            }
+
+            listPubcoins.emplace_back(PublicCoin(Params().Zerocoin_Params(), pubcoinTx.vPubcoin[i], pubcoinTx.vDenom[i]));
+        }
+    }
+}
+
 //return a list of zerocoin mints contained in a specific block
 bool BlockToZerocoinMintList(const CBlock& block, std::list<CZerocoinMint>& vMints, bool fFilterInvalid)
 {
@@ -1319,7 +1394,7 @@ bool CheckZerocoinMint(const uint256& txHash, const CTxOut& txout, CValidationSt
     if(!TxOutToPublicCoin(txout, pubCoin, state))
         return state.DoS(100, error("CheckZerocoinMint(): TxOutToPublicCoin() failed"));
 
-    if (!pubCoin.validate())
+    if (!ValidatePubcoin(pubCoin))
         return state.DoS(100, error("CheckZerocoinMint() : PubCoin does not validate"));
 
     if(!fCheckOnly && !RecordMintToDB(pubCoin, txHash))
@@ -1350,7 +1425,7 @@ bool IsZerocoinSpendUnknown(CoinSpend coinSpend, uint256 hashTx, CValidationStat
     return true;
 }
 
-bool CheckZerocoinSpend(const CTransaction tx, bool fVerifySignature, CValidationState& state)
+bool CheckZerocoinSpend(const CTransaction tx, bool fVerifySignature, CValidationState& state, std::vector<CZerocoinSpendCheck>* pvSpendChecks)
 {
     //max needed non-mint outputs should be 2 - one for redemption address and a possible 2nd for change
     if (tx.vout.size() > 2) {
@@ -1396,8 +1471,8 @@ bool CheckZerocoinSpend(const CTransaction tx, bool fVerifySignature, CValidatio
         if (newSpend.getTxOutHash() != hashTxOut)
             return state.DoS(100, error("Zerocoinspend does not use the same txout that was used in the SoK"));
 
-        // Skip signature verification during initial block download
-        if (fVerifySignature) {
+        // Skip signature verification during initial block download, or when the spend was already verified
+        if (fVerifySignature && !IsZerocoinSpendVerified(newSpend)) {
             //see if we have record of the accumulator used in the spend tx
             CBigNum bnAccumulatorValue = 0;
             if(!zerocoinDB->ReadAccumulatorValue(newSpend.getAccumulatorChecksum(), bnAccumulatorValue))
@@ -1405,9 +1480,22 @@ bool CheckZerocoinSpend(const CTransaction tx, bool fVerifySignature, CValidatio
 
             Accumulator accumulator(Params().Zerocoin_Params(), newSpend.getDenomination(), bnAccumulatorValue);
 
-            //Check that the coin is on the accumulator
-            if(!newSpend.Verify(accumulator))
+            if (pvSpendChecks) {
+                //Defer the proofs to the check queue, one job per sub-proof
+                if (accumulator.getDenomination() != newSpend.getDenomination())
+                    return state.DoS(100, error("CheckZerocoinSpend(): zerocoin spend did not verify"));
+
+                boost::shared_ptr<const CoinSpend> pspend(new CoinSpend(newSpend));
+                boost::shared_ptr<const Accumulator> paccumulator(new Accumulator(accumulator));
+                pvSpendChecks->push_back(CZerocoinSpendCheck(pspend, paccumulator, CZerocoinSpendCheck::PROOF_COMMITMENT, tx.GetHash()));
+                pvSpendChecks->push_back(CZerocoinSpendCheck(pspend, paccumulator, CZerocoinSpendCheck::PROOF_ACCUMULATOR, tx.GetHash()));
+                pvSpendChecks->push_back(CZerocoinSpendCheck(pspend, paccumulator, CZerocoinSpendCheck::PROOF_SERIAL, tx.GetHash()));
+            } else if (!newSpend.Verify(accumulator)) {
+                //Check that the coin is on the accumulator
                 return state.DoS(100, error("CheckZerocoinSpend(): zerocoin spend did not verify"));
+            } else {
+                SetZerocoinSpendVerified(newSpend);
+            }
         }
 
         if (serials.count(newSpend.getCoinSerialNumber()))
@@ -1440,7 +1528,18 @@ bool CheckZerocoinSpend(const CTransaction tx, bool fVerifySignature, CValidatio
     return fValidated;
 }
 
-bool CheckTransaction(const CTransaction& tx, bool fZerocoinActive, bool fRejectBadUTXO, CValidationState& state)
+CBlockCheckContext GetBlockCheckContext(int nHeight, bool fRecordZerocoinMints)
+{
+    AssertLockHeld(cs_main);
+    CBlockCheckContext context;
+    context.nHeight = nHeight;
+    // Do not require signature verification if this is initial sync and a block over 24 hours old
+    context.fVerifyZerocoinSpends = !IsInitialBlockDownload() && (GetTime() - chainActive.Tip()->GetBlockTime() < (60*60*24));
+    context.fRecordZerocoinMints = fRecordZerocoinMints;
+    return context;
+}
+
+bool CheckTransaction(const CTransaction& tx, bool fZerocoinActive, bool fRejectBadUTXO, CValidationState& state, std::vector<CZerocoinSpendCheck>* pvSpendChecks, const CBlockCheckContext* pcontext)
 {
     // Basic checks that don't depend on any context
     if (tx.vin.empty())
@@ -1475,7 +1574,7 @@ bool CheckTransaction(const CTransaction& tx, bool fZerocoinActive, bool fReject
             return state.DoS(100, error("CheckTransaction() : txout total out of range"),
                 REJECT_INVALID, "bad-txns-txouttotal-toolarge");
         if (fZerocoinActive && txout.IsZerocoinMint()) {
-            if(!CheckZerocoinMint(tx.GetHash(), txout, state, false))
+            if(!CheckZerocoinMint(tx.GetHash(), txout, state, pcontext && !pcontext->fRecordZerocoinMints))
                 return state.DoS(100, error("CheckTransaction() : invalid zerocoin mint"));
         }
         if (fZerocoinActive && txout.scriptPubKey.IsZerocoinSpend())
@@ -1494,9 +1593,14 @@ bool CheckTransaction(const CTransaction& tx, bool fZerocoinActive, bool fReject
                                      error("CheckTransaction() : zerocoinspend contains inputs that are not zerocoins"));
             }
 
-            // Do not require signature verification if this is initial sync and a block over 24 hours old
-            bool fVerifySignature = !IsInitialBlockDownload() && (GetTime() - chainActive.Tip()->GetBlockTime() < (60*60*24));
-            if (!CheckZerocoinSpend(tx, fVerifySignature, state))
+            bool fVerifySignature;
+            if (pcontext) {
+                fVerifySignature = pcontext->fVerifyZerocoinSpends;
+            } else {
+                LOCK(cs_main);
+                fVerifySignature = GetBlockCheckContext(chainActive.Height() + 1).fVerifyZerocoinSpends;
+            }
+            if (!CheckZerocoinSpend(tx, fVerifySignature, state, pvSpendChecks))
                 return state.DoS(100, error("CheckTransaction() : invalid zerocoin spend"));
         }
     }
@@ -2024,6 +2128,26 @@ bool AcceptableInputs(CTxMemPool& pool, CValidationState& state, const CTransact
     return true;
 }
 
+/** Read a transaction at a position from the transaction index, does not need cs_main */
+static bool ReadTransactionFromDisk(const CDiskTxPos& postx, const uint256& hash, CTransaction& txOut, uint256& hashBlock)
+{
+    CAutoFile file(OpenBlockFile(postx, true), SER_DISK, CLIENT_VERSION);
+    if (file.IsNull())
+        return error("%s: OpenBlockFile failed", __func__);
+    CBlockHeader header;
+    try {
+        file >> header;
+        fseek(file.Get(), postx.nTxOffset, SEEK_CUR);
+        file >> txOut;
+    } catch (std::exception& e) {
+        return error("%s : Deserialize or I/O error - %s", __func__, e.what());
+    }
+    hashBlock = header.GetHash();
+    if (txOut.GetHash() != hash)
+        return error("%s : txid mismatch", __func__);
+    return true;
+}
+
 /** Return transaction in tx, and if it was found inside a block, its hash is placed in hashBlock */
 bool GetTransaction(const uint256& hash, CTransaction& txOut, uint256& hashBlock, bool fAllowSlow)
 {
@@ -2038,23 +2162,8 @@ bool GetTransaction(const uint256& hash, CTransaction& txOut, uint256& hashBlock
 
         if (fTxIndex) {
             CDiskTxPos postx;
-            if (pblocktree->ReadTxIndex(hash, postx)) {
-                CAutoFile file(OpenBlockFile(postx, true), SER_DISK, CLIENT_VERSION);
-                if (file.IsNull())
-                    return error("%s: OpenBlockFile failed", __func__);
-                CBlockHeader header;
-                try {
-                    file >> header;
-                    fseek(file.Get(), postx.nTxOffset, SEEK_CUR);
-                    file >> txOut;
-                } catch (std::exception& e) {
-                    return error("%s : Deserialize or I/O error - %s", __func__, e.what());
-                }
-                hashBlock = header.GetHash();
-                if (txOut.GetHash() != hash)
-                    return error("%s : txid mismatch", __func__);
-                return true;
-            }
+            if (pblocktree->ReadTxIndex(hash, postx))
+                return ReadTransactionFromDisk(postx, hash, txOut, hashBlock);
         }
 
         if (fAllowSlow) { // use coin database to locate block that contains transaction, and scan it
@@ -2113,22 +2222,31 @@ bool WriteBlockToDisk(CBlock& block, CDiskBlockPos& pos)
     return true;
 }
 
-bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos)
+/** Deserialize the block stored at pos straight from its mapped blk file */
+static bool ReadBlockDataFromDisk(CBlock& block, const CDiskBlockPos& pos)
 {
     block.SetNull();
 
-    // Open history file to read
-    CAutoFile filein(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
-    if (filein.IsNull())
-        return error("ReadBlockFromDisk : OpenBlockFile failed");
+    CBlockSpan span;
+    if (!ReadBlockSpan(pos, span))
+        return error("ReadBlockFromDisk : ReadBlockSpan failed");
 
     // Read block
     try {
-        filein >> block;
+        CSpanReader reader(span.begin(), span.size(), SER_DISK, CLIENT_VERSION);
+        reader >> block;
     } catch (std::exception& e) {
         return error("%s : Deserialize or I/O error - %s", __func__, e.what());
     }
 
+    return true;
+}
+
+bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos)
+{
+    if (!ReadBlockDataFromDisk(block, pos))
+        return false;
+
     // Check the header
     if (block.IsProofOfWork()) {
         if (!CheckProofOfWork(block.GetHash(), block.nBits))
@@ -2140,12 +2258,20 @@ bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos)
 
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex)
 {
-    if (!ReadBlockFromDisk(block, pindex->GetBlockPos()))
+    if (!ReadBlockDataFromDisk(block, pindex->GetBlockPos()))
         return false;
-    if (block.GetHash() != pindex->GetBlockHash()) {
-        LogPrintf("%s : block=%s index=%s\n", __func__, block.GetHash().ToString().c_str(), pindex->GetBlockHash().ToString().c_str());
+
+    // The header of a block with valid scripts was checked when it was connected
+    if (!fCheckBlockReads && pindex->IsValid(BLOCK_VALID_SCRIPTS))
+        return true;
+
+    uint256 hash = block.GetHash();
+    if (hash != pindex->GetBlockHash()) {
+        LogPrintf("%s : block=%s index=%s\n", __func__, hash.ToString().c_str(), pindex->GetBlockHash().ToString().c_str());
         return error("ReadBlockFromDisk(CBlock&, CBlockIndex*) : GetHash() doesn't match index");
     }
+    if (block.IsProofOfWork() && !CheckProofOfWork(hash, block.nBits))
+        return error("ReadBlockFromDisk : Errors in block header");
     return true;
 }
 
@@ -2632,6 +2758,33 @@ bool CScriptCheck::operator()()
     return true;
 }
 
+bool CZerocoinSpendCheck::operator()()
+{
+    bool fVerified = false;
+    // Malformed proofs can make the bignum arithmetic throw, which must not escape a check queue worker
+    try {
+        switch (proof) {
+        case PROOF_COMMITMENT:
+            fVerified = spend->VerifyCommitmentPoK();
+            break;
+        case PROOF_ACCUMULATOR:
+            fVerified = spend->VerifyAccumulatorPoK(*accumulator);
+            break;
+        case PROOF_SERIAL:
+            fVerified = spend->VerifySerialNumberSoK();
+            break;
+        case PROOF_NONE:
+            break;
+        }
+    } catch (std::exception& e) {
+        return ::error("CZerocoinSpendCheck(): %s proof %d threw: %s", txid.ToString(), proof, e.what());
+    }
+
+    if (!fVerified)
+        return ::error("CZerocoinSpendCheck(): %s proof %d of serial %s failed to verify", txid.ToString(), proof, spend ? spend->getCoinSerialNumber().GetHex() : "");
+    return true;
+}
+
 CBitcoinAddress addressExp1("DQZzqnSR6PXxagep1byLiRg9ZurCZ5KieQ");
 CBitcoinAddress addressExp2("DTQYdnNqKuEHXyNeeYhPQGGGdqHbXYwjpj");
 
@@ -3021,6 +3174,9 @@ bool DisconnectBlock(CBlock& block, CValidationState& state, CBlockIndex* pindex
             if(!EraseAccumulatorValues(nCheckpoint, pindex->pprev->nAccumulatorCheckpoint))
                 return error("DisconnectBlock(): failed to erase checkpoint");
         }
+
+        if (pindex->nHeight >= Params().Zerocoin_StartHeight() && !zerocoinDB->EraseBlockPubcoins(pindex->nHeight))
+            return error("DisconnectBlock(): failed to erase pubcoin index");
     }
 
     if (pfClean) {
@@ -3064,69 +3220,216 @@ void ThreadScriptCheck()
     scriptcheckqueue.Thread();
 }
 
-void RecalculateZPIVMinted()
+// Each job is a full zerocoin sub-proof, so hand them out one at a time
+static CCheckQueue<CZerocoinSpendCheck> zerocoinspendcheckqueue(1);
+// CheckBlock() may run outside of cs_main, serialize the users of the queue
+static CCriticalSection cs_zerocoinspendcheckqueue;
+static int64_t nTimeZerocoinSpendVerify = 0;
+
+void ThreadZerocoinSpendCheck()
 {
-    CBlockIndex *pindex = chainActive[Params().Zerocoin_StartHeight()];
-    int nHeightEnd = chainActive.Height();
-    while (true) {
-        if (pindex->nHeight % 1000 == 0)
-            LogPrintf("%s : block %d...\n", __func__, pindex->nHeight);
+    RenameThread("pivx-zspendch");
+    // the queue already runs one proof per core
+    libzerocoin::SetThreadSingleCore(true);
+    zerocoinspendcheckqueue.Thread();
+}
 
-        //overwrite possibly wrong vMintsInBlock data
-        CBlock block;
-        assert(ReadBlockFromDisk(block, pindex));
+/**
+ * Walk the active chain from nHeightStart to the tip. Worker threads claim runs of blocks ahead of
+ * the caller and run fnExtract on them, the results are handed to fnReduce in height order on the
+ * calling thread. With fWriteIndex the reduced block indexes are written to the block tree in batches.
+ */
+template <typename T>
+static bool ScanActiveChain(int nHeightStart, const std::string& strProgress, bool fWriteIndex,
+                            const std::function<bool(const CBlockIndex*, T&)>& fnExtract,
+                            const std::function<bool(CBlockIndex*, T&)>& fnReduce)
+{
+    static const int nReadAhead = 1024; // blocks that may be extracted but not reduced yet
+    static const int nWorkerBatch = 16; // consecutive blocks claimed by a worker at once
+    static const unsigned int nWriteBatch = 1000;
 
-        std::list<CZerocoinMint> listMints;
-        BlockToZerocoinMintList(block, listMints, true);
+    const int nHeightEnd = chainActive.Height();
+    if (nHeightStart > nHeightEnd)
+        return true;
 
-        vector<libzerocoin::CoinDenomination> vDenomsBefore = pindex->vMintDenominationsInBlock;
-        pindex->vMintDenominationsInBlock.clear();
-        for (auto mint : listMints)
-            pindex->vMintDenominationsInBlock.emplace_back(mint.GetDenomination());
+    boost::mutex mutex;
+    boost::condition_variable condExtracted;
+    boost::condition_variable condReduced;
+    std::vector<T> vResult(nReadAhead);
+    std::vector<int> vResultHeight(nReadAhead, -1);
+    int nHeightClaim = nHeightStart;
+    int nHeightReduce = nHeightStart;
+    bool fAbort = false;
+
+    auto worker = [&]() {
+        RenameThread("pivx-chainscan");
+        while (true) {
+            int nBegin, nEnd;
+            {
+                boost::unique_lock<boost::mutex> lock(mutex);
+                while (!fAbort && nHeightClaim <= nHeightEnd && nHeightClaim >= nHeightReduce + nReadAhead)
+                    condReduced.wait(lock);
+                if (fAbort || nHeightClaim > nHeightEnd)
+                    return;
+                nBegin = nHeightClaim;
+                nEnd = std::min(std::min(nBegin + nWorkerBatch, nHeightReduce + nReadAhead), nHeightEnd + 1);
+                nHeightClaim = nEnd;
+            }
 
-        if (pindex->nHeight < nHeightEnd)
-            pindex = chainActive.Next(pindex);
-        else
+            for (int nHeight = nBegin; nHeight < nEnd; nHeight++) {
+                T result;
+                bool fExtracted = false;
+                try {
+                    fExtracted = fnExtract(chainActive[nHeight], result);
+                } catch (const std::exception& e) {
+                    LogPrintf("ScanActiveChain : block %d: %s\n", nHeight, e.what());
+                }
+
+                boost::unique_lock<boost::mutex> lock(mutex);
+                if (!fExtracted) {
+                    LogPrintf("ScanActiveChain : failed to extract block %d\n", nHeight);
+                    fAbort = true;
+                    condExtracted.notify_all();
+                    condReduced.notify_all();
+                    return;
+                }
+                vResult[nHeight % nReadAhead] = std::move(result);
+                vResultHeight[nHeight % nReadAhead] = nHeight;
+                if (nHeight == nHeightReduce)
+                    condExtracted.notify_all();
+            }
+        }
+    };
+
+    boost::thread_group threadGroup;
+    int nWorkers = std::max(1, std::min(nScriptCheckThreads, (nHeightEnd - nHeightStart) / nWorkerBatch + 1));
+    for (int i = 0; i < nWorkers; i++)
+        threadGroup.create_thread(worker);
+
+    bool fSuccess = true;
+    std::vector<const CBlockIndex*> vWrite;
+    for (int nHeight = nHeightStart; nHeight <= nHeightEnd; nHeight++) {
+        T result;
+        {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            while (!fAbort && vResultHeight[nHeight % nReadAhead] != nHeight)
+                condExtracted.wait(lock);
+            if (fAbort) {
+                fSuccess = false;
+                break;
+            }
+            result = std::move(vResult[nHeight % nReadAhead]);
+            vResultHeight[nHeight % nReadAhead] = -1;
+        }
+
+        CBlockIndex* pindex = chainActive[nHeight];
+        if (!fnReduce(pindex, result)) {
+            LogPrintf("ScanActiveChain : failed to process block %d\n", nHeight);
+            fSuccess = false;
             break;
+        }
+
+        {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            nHeightReduce = nHeight + 1;
+        }
+        condReduced.notify_all();
+
+        if (fWriteIndex) {
+            vWrite.emplace_back(pindex);
+            if (vWrite.size() >= nWriteBatch || nHeight == nHeightEnd) {
+                if (!pblocktree->WriteBlockIndexBatch(vWrite)) {
+                    LogPrintf("ScanActiveChain : failed to write block index at height %d\n", nHeight);
+                    fSuccess = false;
+                    break;
+                }
+                vWrite.clear();
+            }
+        }
+
+        if (nHeight % 1000 == 0) {
+            LogPrintf("%s : block %d...\n", strProgress, nHeight);
+            uiInterface.ShowProgress(strProgress, (int)((nHeight - nHeightStart) * 100.0 / (nHeightEnd - nHeightStart + 1)));
+        }
     }
+
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        fAbort = true;
+    }
+    condReduced.notify_all();
+    threadGroup.join_all();
+    uiInterface.ShowProgress("", 100);
+
+    return fSuccess;
 }
 
-void RecalculateZPIVSpent()
+void RecalculateZPIVMinted()
 {
-    CBlockIndex* pindex = chainActive[Params().Zerocoin_StartHeight()];
-    while (true) {
-        if (pindex->nHeight % 1000 == 0)
-            LogPrintf("%s : block %d...\n", __func__, pindex->nHeight);
+    std::function<bool(const CBlockIndex*, std::vector<CoinDenomination>&)> fnExtract =
+        [](const CBlockIndex* pindex, std::vector<CoinDenomination>& vDenoms) {
+            std::list<PublicCoin> listPubcoins;
+            if (!CPubcoinReader(1).GetPubcoins(pindex, listPubcoins, true))
+                return false;
 
-        //Rewrite zPIV supply
-        CBlock block;
-        assert(ReadBlockFromDisk(block, pindex));
+            for (auto pubcoin : listPubcoins)
+                vDenoms.emplace_back(pubcoin.getDenomination());
+            return true;
+        };
 
-        list<libzerocoin::CoinDenomination> listDenomsSpent = ZerocoinSpendListFromBlock(block, true);
+    //overwrite possibly wrong vMintsInBlock data
+    std::function<bool(CBlockIndex*, std::vector<CoinDenomination>&)> fnReduce =
+        [](CBlockIndex* pindex, std::vector<CoinDenomination>& vDenoms) {
+            pindex->vMintDenominationsInBlock = std::move(vDenoms);
+            return true;
+        };
 
-        //Reset the supply to previous block
-        pindex->mapZerocoinSupply = pindex->pprev->mapZerocoinSupply;
+    assert(ScanActiveChain(Params().Zerocoin_StartHeight(), _("Recalculating minted zPIV..."), false, fnExtract, fnReduce));
+}
 
-        //Add mints to zPIV supply
-        for (auto denom : libzerocoin::zerocoinDenomList) {
-            long nDenomAdded = count(pindex->vMintDenominationsInBlock.begin(), pindex->vMintDenominationsInBlock.end(), denom);
-            pindex->mapZerocoinSupply.at(denom) += nDenomAdded;
-        }
+void RecalculateZPIVSpent()
+{
+    std::function<bool(const CBlockIndex*, list<CoinDenomination>&)> fnExtract =
+        [](const CBlockIndex* pindex, list<CoinDenomination>& listDenomsSpent) {
+            CBlock block;
+            if (!ReadBlockFromDisk(block, pindex))
+                return false;
 
-        //Remove spends from zPIV supply
-        for (auto denom : listDenomsSpent)
-            pindex->mapZerocoinSupply.at(denom)--;
+            listDenomsSpent = ZerocoinSpendListFromBlock(block, true);
+            return true;
+        };
+
+    //Rewrite zPIV supply
+    std::function<bool(CBlockIndex*, list<CoinDenomination>&)> fnReduce =
+        [](CBlockIndex* pindex, list<CoinDenomination>& listDenomsSpent) {
+            //Reset the supply to previous block
+            pindex->mapZerocoinSupply = pindex->pprev->mapZerocoinSupply;
+
+            //Add mints to zPIV supply
+            for (auto denom : libzerocoin::zerocoinDenomList) {
+                long nDenomAdded = count(pindex->vMintDenominationsInBlock.begin(), pindex->vMintDenominationsInBlock.end(), denom);
+                pindex->mapZerocoinSupply.at(denom) += nDenomAdded;
+            }
 
-        //Rewrite money supply
-        assert(pblocktree->WriteBlockIndex(CDiskBlockIndex(pindex)));
+            //Remove spends from zPIV supply
+            for (auto denom : listDenomsSpent)
+                pindex->mapZerocoinSupply.at(denom)--;
+            return true;
+        };
 
-        if (pindex->nHeight < chainActive.Height())
-            pindex = chainActive.Next(pindex);
-        else
-            break;
-    }
+    assert(ScanActiveChain(Params().Zerocoin_StartHeight(), _("Recalculating zPIV supply..."), true, fnExtract, fnReduce));
 }
 
+/** The value moved by a block, as far as it can be worked out without cs_main */
+struct CBlockValueFlow
+{
+    CAmount nValueIn;
+    CAmount nValueOut;
+    std::vector<COutPoint> vPrevoutUnresolved; // inputs that are not in the transaction index
+
+    CBlockValueFlow() : nValueIn(0), nValueOut(0) {}
+};
+
 bool RecalculatePIVSupply(int nHeightStart)
 {
     if (nHeightStart > chainActive.Height())
@@ -3137,64 +3440,73 @@ bool RecalculatePIVSupply(int nHeightStart)
     if (nHeightStart == Params().Zerocoin_StartHeight())
         nSupplyPrev = CAmount(5449796547496199);
 
-    while (true) {
-        if (pindex->nHeight % 1000 == 0)
-            LogPrintf("%s : block %d...\n", __func__, pindex->nHeight);
+    std::function<bool(const CBlockIndex*, CBlockValueFlow&)> fnExtract =
+        [](const CBlockIndex* pindex, CBlockValueFlow& flow) {
+            CBlock block;
+            if (!ReadBlockFromDisk(block, pindex))
+                return false;
 
-        CBlock block;
-        assert(ReadBlockFromDisk(block, pindex));
+            for (const CTransaction& tx : block.vtx) {
+                for (unsigned int i = 0; i < tx.vin.size(); i++) {
+                    if (tx.IsCoinBase())
+                        break;
 
-        CAmount nValueIn = 0;
-        CAmount nValueOut = 0;
-        for (const CTransaction tx : block.vtx) {
-            for (unsigned int i = 0; i < tx.vin.size(); i++) {
-                if (tx.IsCoinBase())
-                    break;
+                    if (tx.vin[i].scriptSig.IsZerocoinSpend()) {
+                        flow.nValueIn += tx.vin[i].nSequence * COIN;
+                        continue;
+                    }
 
-                if (tx.vin[i].scriptSig.IsZerocoinSpend()) {
-                    nValueIn += tx.vin[i].nSequence * COIN;
-                    continue;
+                    // GetTransaction() takes cs_main, leave anything the tx index can't answer to the reduction
+                    const COutPoint& prevout = tx.vin[i].prevout;
+                    CDiskTxPos postx;
+                    CTransaction txPrev;
+                    uint256 hashBlock;
+                    if (fTxIndex && pblocktree->ReadTxIndex(prevout.hash, postx) && ReadTransactionFromDisk(postx, prevout.hash, txPrev, hashBlock))
+                        flow.nValueIn += txPrev.vout[prevout.n].nValue;
+                    else
+                        flow.vPrevoutUnresolved.emplace_back(prevout);
                 }
 
-                COutPoint prevout = tx.vin[i].prevout;
-                CTransaction txPrev;
-                uint256 hashBlock;
-                assert(GetTransaction(prevout.hash, txPrev, hashBlock, true));
-                nValueIn += txPrev.vout[prevout.n].nValue;
-            }
-
-            for (unsigned int i = 0; i < tx.vout.size(); i++) {
-                if (i == 0 && tx.IsCoinStake())
-                    continue;
+                for (unsigned int i = 0; i < tx.vout.size(); i++) {
+                    if (i == 0 && tx.IsCoinStake())
+                        continue;
 
-                nValueOut += tx.vout[i].nValue;
+                    flow.nValueOut += tx.vout[i].nValue;
+                }
             }
-        }
+            return true;
+        };
 
-        // Rewrite money supply
-        pindex->nMoneySupply = nSupplyPrev + nValueOut - nValueIn;
-        nSupplyPrev = pindex->nMoneySupply;
+    std::function<bool(CBlockIndex*, CBlockValueFlow&)> fnReduce =
+        [&nSupplyPrev](CBlockIndex* pindex, CBlockValueFlow& flow) {
+            for (const COutPoint& prevout : flow.vPrevoutUnresolved) {
+                CTransaction txPrev;
+                uint256 hashBlock;
+                if (!GetTransaction(prevout.hash, txPrev, hashBlock, true))
+                    return false;
+                flow.nValueIn += txPrev.vout[prevout.n].nValue;
+            }
 
-        // Add fraudulent funds to the supply and remove any recovered funds.
-        if (pindex->nHeight == Params().Zerocoin_Block_RecalculateAccumulators()) {
-            PopulateInvalidOutPointMap();
-            LogPrintf("%s : Original money supply=%s\n", __func__, FormatMoney(pindex->nMoneySupply));
+            // Rewrite money supply
+            pindex->nMoneySupply = nSupplyPrev + flow.nValueOut - flow.nValueIn;
+            nSupplyPrev = pindex->nMoneySupply;
 
-            pindex->nMoneySupply += nFilteredThroughBittrex;
-            LogPrintf("%s : Adding bittrex filtered funds to supply + %s : supply=%s\n", __func__, FormatMoney(nFilteredThroughBittrex), FormatMoney(pindex->nMoneySupply));
+            // Add fraudulent funds to the supply and remove any recovered funds.
+            if (pindex->nHeight == Params().Zerocoin_Block_RecalculateAccumulators()) {
+                PopulateInvalidOutPointMap();
+                LogPrintf("RecalculatePIVSupply : Original money supply=%s\n", FormatMoney(pindex->nMoneySupply));
 
-            CAmount nLocked = GetInvalidUTXOValue();
-            pindex->nMoneySupply -= nLocked;
-            LogPrintf("%s : Removing locked from supply - %s : supply=%s\n", __func__, FormatMoney(nLocked), FormatMoney(pindex->nMoneySupply));
-        }
+                pindex->nMoneySupply += nFilteredThroughBittrex;
+                LogPrintf("RecalculatePIVSupply : Adding bittrex filtered funds to supply + %s : supply=%s\n", FormatMoney(nFilteredThroughBittrex), FormatMoney(pindex->nMoneySupply));
 
-        assert(pblocktree->WriteBlockIndex(CDiskBlockIndex(pindex)));
+                CAmount nLocked = GetInvalidUTXOValue();
+                pindex->nMoneySupply -= nLocked;
+                LogPrintf("RecalculatePIVSupply : Removing locked from supply - %s : supply=%s\n", FormatMoney(nLocked), FormatMoney(pindex->nMoneySupply));
+            }
+            return true;
+        };
 
-        if (pindex->nHeight < chainActive.Height())
-            pindex = chainActive.Next(pindex);
-        else
-            break;
-    }
+    assert(ScanActiveChain(nHeightStart, _("Recalculating PIV supply..."), true, fnExtract, fnReduce));
     return true;
 }
 
@@ -3217,8 +3529,8 @@ bool ReindexAccumulators(list<uint256>& listMissingCheckpoints, string& strError
             // find checkpoints by iterating through the blockchain beginning with the first zerocoin block
             if (pindex->nAccumulatorCheckpoint != pindex->pprev->nAccumulatorCheckpoint) {
 
-                //double dPercent = (pindex->nHeight - nZerocoinStart) / (double) (chainActive.Height() - nZerocoinStart);
-                //uiInterface.ShowProgress(_("Calculating missing accumulators..."), (int) (dPercent * 100));
+                double dPercent = (pindex->nHeight - nZerocoinStart) / (double) (chainActive.Height() - nZerocoinStart);
+                uiInterface.ShowProgress(_("Calculating missing accumulators..."), (int) (dPercent * 100));
                 if (find(listMissingCheckpoints.begin(), listMissingCheckpoints.end(), pindex->nAccumulatorCheckpoint) != listMissingCheckpoints.end()) {
                     uint256 nCheckpointCalculated = 0;
                     if (!CalculateAccumulatorCheckpoint(pindex->nHeight, nCheckpointCalculated)) {
@@ -3247,6 +3559,7 @@ bool ReindexAccumulators(list<uint256>& listMissingCheckpoints, string& strError
             else
                 break;
         }
+        uiInterface.ShowProgress("", 100);
     }
     return true;
 }
@@ -3577,6 +3890,13 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
         if (!pblocktree->WriteTxIndex(vPos))
             return state.Abort("Failed to write transaction index");
 
+    // index the pubcoins of this block so that accumulators don't need to read it back from disk
+    if (pindex->nHeight >= Params().Zerocoin_StartHeight()) {
+        CBlockPubcoins blockPubcoins;
+        if (!BlockToBlockPubcoins(block, blockPubcoins) || !zerocoinDB->WriteBlockPubcoins(pindex->nHeight, blockPubcoins))
+            return state.Abort("Failed to write zerocoin pubcoin index");
+    }
+
     // add this block to the view's block chain
     view.SetBestBlock(pindex->GetBlockHash());
 
@@ -3611,13 +3931,20 @@ enum FlushStateMode {
  * The caches and indexes are flushed if either they're too large, forceWrite is set, or
  * fast is not set and it's been a while since the last write.
  */
+static uint64_t nCoinCacheFlushes = 0;
+static uint64_t nCoinCacheFlushesFull = 0;
+
 bool static FlushStateToDisk(CValidationState& state, FlushStateMode mode)
 {
     LOCK(cs_main);
     static int64_t nLastWrite = 0;
     try {
-        if ((mode == FLUSH_STATE_ALWAYS) ||
-            ((mode == FLUSH_STATE_PERIODIC || mode == FLUSH_STATE_IF_NEEDED) && pcoinsTip->GetCacheSize() > nCoinCacheSize) ||
+        size_t cacheSize = pcoinsTip->DynamicMemoryUsage();
+        // The cache is large and close to the limit, but we have time now (not in the middle of a block processing).
+        bool fCacheLarge = mode == FLUSH_STATE_PERIODIC && cacheSize * (10.0 / 9) > nCoinCacheUsage;
+        // The cache is over the limit, we have to write now.
+        bool fCacheCritical = mode == FLUSH_STATE_IF_NEEDED && cacheSize > nCoinCacheUsage;
+        if ((mode == FLUSH_STATE_ALWAYS) || fCacheLarge || fCacheCritical ||
             (mode == FLUSH_STATE_PERIODIC && GetTimeMicros() > nLastWrite + DATABASE_WRITE_INTERVAL * 1000000)) {
             // Typical CCoins structures on disk are around 100 bytes in size.
             // Pushing a new one to the database can cause it to be written
@@ -3650,6 +3977,9 @@ bool static FlushStateToDisk(CValidationState& state, FlushStateMode mode)
             // Finally flush the chainstate (which may refer to block index entries).
             if (!pcoinsTip->Flush())
                 return state.Abort("Failed to write to coin database");
+            nCoinCacheFlushes++;
+            if (fCacheLarge || fCacheCritical)
+                nCoinCacheFlushesFull++;
             // Update best block in wallet (so we can detect restored wallets).
             if (mode != FLUSH_STATE_IF_NEEDED) {
                 g_signals.SetBestChain(chainActive.GetLocator());
@@ -3668,6 +3998,16 @@ void FlushStateToDisk()
     FlushStateToDisk(state, FLUSH_STATE_ALWAYS);
 }
 
+void GetCoinsCacheStats(CCoinsCacheStats& stats)
+{
+    LOCK(cs_main);
+    stats.nUsage = pcoinsTip->DynamicMemoryUsage();
+    stats.nLimit = nCoinCacheUsage;
+    stats.nEntries = pcoinsTip->GetCacheSize();
+    stats.nFlushes = nCoinCacheFlushes;
+    stats.nFlushesFull = nCoinCacheFlushesFull;
+}
+
 /** Update chainActive and related internal data structures. */
 void static UpdateTip(CBlockIndex* pindexNew)
 {
@@ -3681,10 +4021,10 @@ void static UpdateTip(CBlockIndex* pindexNew)
     nTimeBestReceived = GetTime();
     mempool.AddTransactionsUpdated(1);
 
-    LogPrintf("UpdateTip: new best=%s  height=%d  log2_work=%.8g  tx=%lu  date=%s progress=%f  cache=%u\n",
+    LogPrintf("UpdateTip: new best=%s  height=%d  log2_work=%.8g  tx=%lu  date=%s progress=%f  cache=%.1fMiB(%utx)\n",
         chainActive.Tip()->GetBlockHash().ToString(), chainActive.Height(), log(chainActive.Tip()->nChainWork.getdouble()) / log(2.0), (unsigned long)chainActive.Tip()->nChainTx,
         DateTimeStrFormat("%Y-%m-%d %H:%M:%S", chainActive.Tip()->GetBlockTime()),
-        Checkpoints::GuessVerificationProgress(chainActive.Tip()), (unsigned int)pcoinsTip->GetCacheSize());
+        Checkpoints::GuessVerificationProgress(chainActive.Tip()), pcoinsTip->DynamicMemoryUsage() * (1.0 / (1 << 20)), pcoinsTip->GetCacheSize());
 
     cvBlockChange.notify_all();
 
@@ -4110,6 +4450,7 @@ bool ActivateBestChain(CValidationState& state, CBlock* pblock, bool fAlreadyChe
                         pnode->PushInventory(CInv(MSG_BLOCK, hashNewTip));
             }
             // Notify external listeners about the new tip.
+            GetMainSignals().UpdatedBlockTip(pindexNewTip);
             uiInterface.NotifyBlockTip(hashNewTip);
         }
     } while (pindexMostWork != chainActive.Tip());
@@ -4407,9 +4748,16 @@ bool CheckBlockHeader(const CBlockHeader& block, CValidationState& state, bool f
     return true;
 }
 
-bool CheckBlock(const CBlock& block, CValidationState& state, bool fCheckPOW, bool fCheckMerkleRoot, bool fCheckSig)
+bool CheckBlockContextFree(const CBlock& block, CValidationState& state, bool fCheckPOW, bool fCheckMerkleRoot, const CBlockCheckContext* pcontext)
 {
     // These are checks that are independent of context.
+    CBlockCheckContext context;
+    if (pcontext) {
+        context = *pcontext;
+    } else {
+        LOCK(cs_main);
+        context = GetBlockCheckContext(chainActive.Height() + 1);
+    }
 
     // Check that the header is valid (particularly PoW).  This is mostly
     // redundant with the call in AcceptBlockHeader.
@@ -4471,6 +4819,66 @@ bool CheckBlock(const CBlock& block, CValidationState& state, bool fCheckPOW, bo
                 return state.DoS(100, error("CheckBlock() : more than one coinstake"));
     }
 
+    // Check transactions
+    bool fZerocoinActive = block.GetBlockTime() > Params().Zerocoin_StartTime();
+    vector<CBigNum> vBlockSerials;
+    std::vector<CZerocoinSpendCheck> vSpendChecks;
+    for (const CTransaction& tx : block.vtx) {
+        if (!CheckTransaction(tx, fZerocoinActive, context.nHeight >= Params().Zerocoin_Block_EnforceSerialRange(), state, nScriptCheckThreads ? &vSpendChecks : NULL, &context))
+            return error("CheckBlock() : CheckTransaction failed");
+
+        // double check that there are no double spent zPiv spends in this block
+        if (tx.IsZerocoinSpend()) {
+            for (const CTxIn txIn : tx.vin) {
+                if (txIn.scriptSig.IsZerocoinSpend()) {
+                    libzerocoin::CoinSpend spend = TxInToZerocoinSpend(txIn);
+                    if (count(vBlockSerials.begin(), vBlockSerials.end(), spend.getCoinSerialNumber()))
+                        return state.DoS(100, error("%s : Double spending of zPiv serial %s in block\n Block: %s",
+                                                    __func__, spend.getCoinSerialNumber().GetHex(), block.ToString()));
+                    vBlockSerials.emplace_back(spend.getCoinSerialNumber());
+                }
+            }
+        }
+    }
+
+    // Verify the zerocoin spend proofs collected above in parallel
+    if (!vSpendChecks.empty()) {
+        int64_t nTimeStart = GetTimeMicros();
+        unsigned int nSpendChecks = vSpendChecks.size();
+        bool fSpendsValid;
+        int64_t nTime;
+        {
+            LOCK(cs_zerocoinspendcheckqueue);
+            CCheckQueueControl<CZerocoinSpendCheck> control(&zerocoinspendcheckqueue);
+            control.Add(vSpendChecks);
+            fSpendsValid = control.Wait();
+            nTime = GetTimeMicros() - nTimeStart;
+            nTimeZerocoinSpendVerify += nTime;
+        }
+        LogPrint("bench", "    - Verify %u zerocoin spend proofs: %.2fms (%.3fms/proof) [%.2fs]\n", nSpendChecks, 0.001 * nTime, 0.001 * nTime / nSpendChecks, nTimeZerocoinSpendVerify * 0.000001);
+
+        if (!fSpendsValid)
+            return state.DoS(100, error("CheckBlock() : invalid zerocoin spend"));
+    }
+
+
+    unsigned int nSigOps = 0;
+    BOOST_FOREACH (const CTransaction& tx, block.vtx) {
+        nSigOps += GetLegacySigOpCount(tx);
+    }
+    unsigned int nMaxBlockSigOps = fZerocoinActive ? MAX_BLOCK_SIGOPS_CURRENT : MAX_BLOCK_SIGOPS_LEGACY;
+    if (nSigOps > nMaxBlockSigOps)
+        return state.DoS(100, error("CheckBlock() : out-of-bounds SigOpCount"),
+            REJECT_INVALID, "bad-blk-sigops", true);
+
+    return true;
+}
+
+bool CheckBlockNetworkState(const CBlock& block, CValidationState& state)
+{
+    // The SwiftX locks and rejected blocks are guarded by cs_main, the block pipeline calls this from its own thread
+    LOCK(cs_main);
+
     // ----------- swiftTX transaction scanning -----------
     if (IsSporkActive(SPORK_3_SWIFTTX_BLOCK_FILTERING)) {
         BOOST_FOREACH (const CTransaction& tx, block.vtx) {
@@ -4503,7 +4911,8 @@ bool CheckBlock(const CBlock& block, CValidationState& state, bool fCheckPOW, bo
             if (mi != mapBlockIndex.end() && (*mi).second)
                 nHeight = (*mi).second->nHeight + 1;
         }
-
+    }
+    if (pindexPrev != NULL) {
         // PIVX
         // It is entierly possible that we don't have enough data and this could fail
         // (i.e. the block could indeed be valid). Store the block for later consideration
@@ -4522,40 +4931,14 @@ bool CheckBlock(const CBlock& block, CValidationState& state, bool fCheckPOW, bo
         }
     }
 
-    // Check transactions
-    bool fZerocoinActive = block.GetBlockTime() > Params().Zerocoin_StartTime();
-    vector<CBigNum> vBlockSerials;
-    for (const CTransaction& tx : block.vtx) {
-        if (!CheckTransaction(tx, fZerocoinActive, chainActive.Height() + 1 >= Params().Zerocoin_Block_EnforceSerialRange(), state))
-            return error("CheckBlock() : CheckTransaction failed");
-
-        // double check that there are no double spent zPiv spends in this block
-        if (tx.IsZerocoinSpend()) {
-            for (const CTxIn txIn : tx.vin) {
-                if (txIn.scriptSig.IsZerocoinSpend()) {
-                    libzerocoin::CoinSpend spend = TxInToZerocoinSpend(txIn);
-                    if (count(vBlockSerials.begin(), vBlockSerials.end(), spend.getCoinSerialNumber()))
-                        return state.DoS(100, error("%s : Double spending of zPiv serial %s in block\n Block: %s",
-                                                    __func__, spend.getCoinSerialNumber().GetHex(), block.ToString()));
-                    vBlockSerials.emplace_back(spend.getCoinSerialNumber());
-                }
-            }
-        }
-    }
-
-
-    unsigned int nSigOps = 0;
-    BOOST_FOREACH (const CTransaction& tx, block.vtx) {
-        nSigOps += GetLegacySigOpCount(tx);
-    }
-    unsigned int nMaxBlockSigOps = fZerocoinActive ? MAX_BLOCK_SIGOPS_CURRENT : MAX_BLOCK_SIGOPS_LEGACY;
-    if (nSigOps > nMaxBlockSigOps)
-        return state.DoS(100, error("CheckBlock() : out-of-bounds SigOpCount"),
-            REJECT_INVALID, "bad-blk-sigops", true);
-
     return true;
 }
 
+bool CheckBlock(const CBlock& block, CValidationState& state, bool fCheckPOW, bool fCheckMerkleRoot, bool fCheckSig)
+{
+    return CheckBlockContextFree(block, state, fCheckPOW, fCheckMerkleRoot) && CheckBlockNetworkState(block, state);
+}
+
 bool CheckWork(const CBlock block, CBlockIndex* const pindexPrev)
 {
     if (pindexPrev == NULL)
@@ -4877,11 +5260,30 @@ void CBlockIndex::BuildSkip()
         pskip = pprev->GetAncestor(GetSkipHeight(nHeight));
 }
 
-bool ProcessNewBlock(CValidationState& state, CNode* pfrom, CBlock* pblock, CDiskBlockPos* dbp)
+/** Record the zerocoin mints of a block that the pipeline checked without recording them */
+static bool RecordBlockMints(const CBlock& block, CValidationState& state)
 {
-    // Preliminary checks
+    AssertLockHeld(cs_main);
+    if (block.GetBlockTime() <= Params().Zerocoin_StartTime())
+        return true;
+
+    for (const CTransaction& tx : block.vtx) {
+        for (const CTxOut& txout : tx.vout) {
+            if (!txout.IsZerocoinMint())
+                continue;
+            PublicCoin pubCoin(Params().Zerocoin_Params());
+            if (!TxOutToPublicCoin(txout, pubCoin, state) || !RecordMintToDB(pubCoin, tx.GetHash()))
+                return state.DoS(100, error("%s : RecordMintToDB() failed for %s", __func__, tx.GetHash().GetHex()));
+        }
+    }
+    return true;
+}
+
+bool ProcessNewBlock(CValidationState& state, CNode* pfrom, CBlock* pblock, CDiskBlockPos* dbp, bool fPreChecked)
+{
+    // Preliminary checks, the block pipeline has done the context-free ones and the signature
     int64_t nStartTime = GetTimeMillis();
-    bool checked = CheckBlock(*pblock, state);
+    bool checked = fPreChecked ? CheckBlockNetworkState(*pblock, state) : CheckBlock(*pblock, state);
 
     int nMints = 0;
     int nSpends = 0;
@@ -4907,11 +5309,12 @@ bool ProcessNewBlock(CValidationState& state, CNode* pfrom, CBlock* pblock, CDis
     //    return error("ProcessNewBlock() : duplicate proof-of-stake (%s, %d) for block %s", pblock->GetProofOfStake().first.ToString().c_str(), pblock->GetProofOfStake().second, pblock->GetHash().ToString().c_str());
 
     // NovaCoin: check proof-of-stake block signature
-    if (!pblock->CheckBlockSignature())
+    if (!fPreChecked && !pblock->CheckBlockSignature())
         return error("ProcessNewBlock() : bad proof-of-stake block signature");
 
     if (pblock->GetHash() != Params().HashGenesisBlock() && pfrom != NULL) {
         //if we get this far, check if the prev block is our prev block, if not then request sync and return false
+        LOCK(cs_main);
         BlockMap::iterator mi = mapBlockIndex.find(pblock->hashPrevBlock);
         if (mi == mapBlockIndex.end()) {
             pfrom->PushMessage("getblocks", chainActive.GetLocator(), uint256(0));
@@ -4923,6 +5326,8 @@ bool ProcessNewBlock(CValidationState& state, CNode* pfrom, CBlock* pblock, CDis
         LOCK(cs_main);   // Replaces the former TRY_LOCK loop because busy waiting wastes too much resources
 
         MarkBlockAsReceived (pblock->GetHash ());
+        if (checked && fPreChecked)
+            checked = RecordBlockMints(*pblock, state);
         if (!checked) {
             return error ("%s : CheckBlock FAILED for block %s", __func__, pblock->GetHash().GetHex());
         }
@@ -4965,6 +5370,167 @@ bool ProcessNewBlock(CValidationState& state, CNode* pfrom, CBlock* pblock, CDis
     return true;
 }
 
+/**
+ * Initial sync pipeline: blocks received from peers are checked by CheckBlockContextFree on
+ * nBlockCheckThreads threads outside cs_main, while ThreadBlockConnect hands the checked ones
+ * to ProcessNewBlock in height order. The next block is being checked while the last one is connected.
+ */
+namespace
+{
+struct CPipelinedBlock {
+    CBlock block;
+    uint256 hash;
+    CBlockCheckContext context;
+    CNode* pfrom;
+    bool fChecked;
+    bool fValid;
+    CValidationState state;
+    int64_t nTimeChecked;
+
+    CPipelinedBlock(const CBlock& blockIn, const uint256& hashIn, const CBlockCheckContext& contextIn, CNode* pfromIn)
+        : block(blockIn), hash(hashIn), context(contextIn), pfrom(pfromIn), fChecked(false), fValid(false), nTimeChecked(0) {}
+};
+typedef CBlockPipelineQueue<CPipelinedBlock>::Ref CPipelinedBlockRef;
+
+CWaitableCriticalSection csBlockPipeline;
+// Workers wait for blocks to check and the connector for the lowest block to be checked
+CConditionVariable cvBlockPipelineCheck;
+CConditionVariable cvBlockPipelineConnect;
+CBlockPipelineQueue<CPipelinedBlock> blockPipeline(MAX_BLOCK_PIPELINE_DEPTH);
+CBlockPipelineStats blockPipelineStats = {0, 0, 0, 0, 0, 0, 0};
+} // anon namespace
+
+/**
+ * Queue a block received during the initial sync for the pipeline. Returns false when it has to be
+ * processed directly, because the pipeline is off or full, the chain is synced or the parent block is
+ * unknown. The children of blocks in the pipeline are always queued.
+ */
+static bool QueueBlockForPipeline(CNode* pfrom, const CBlock& block, const uint256& hash)
+{
+    if (nBlockCheckThreads == 0)
+        return false;
+
+    CBlockCheckContext context;
+    {
+        LOCK(cs_main);
+        if (mapBlockIndex.count(hash))
+            return false;
+
+        BlockMap::iterator mi = mapBlockIndex.find(block.hashPrevBlock);
+        boost::unique_lock<boost::mutex> lock(csBlockPipeline);
+        if (blockPipeline.Contains(hash))
+            return true;
+        // Waiting for room would stall the message handler and with it every peer, SendMessages
+        // stops requesting blocks instead while the pipeline is full
+        int nHeight = blockPipeline.GetHeight(block.hashPrevBlock, mi != mapBlockIndex.end() ? mi->second->nHeight : -1, IsInitialBlockDownload());
+        if (nHeight < 0)
+            return false;
+        // The mints are recorded when the block is connected, the checks run concurrently
+        context = GetBlockCheckContext(nHeight, false);
+        blockPipeline.Add(hash, nHeight);
+        MarkBlockAsReceived(hash);
+    }
+
+    {
+        LOCK(cs_vNodes);
+        pfrom->AddRef();
+    }
+    CPipelinedBlockRef entry(new CPipelinedBlock(block, hash, context, pfrom));
+    {
+        boost::unique_lock<boost::mutex> lock(csBlockPipeline);
+        blockPipeline.QueueForCheck(context.nHeight, entry);
+    }
+    cvBlockPipelineCheck.notify_one();
+    return true;
+}
+
+void ThreadBlockPreCheck()
+{
+    RenameThread("pivx-blockchk");
+    while (true) {
+        CPipelinedBlockRef entry;
+        {
+            boost::unique_lock<boost::mutex> lock(csBlockPipeline);
+            while (!blockPipeline.HasBlockToCheck())
+                cvBlockPipelineCheck.wait(lock);
+            entry = blockPipeline.PopForCheck();
+        }
+
+        int64_t nTimeStart = GetTimeMicros();
+        bool fValid = CheckBlockContextFree(entry->block, entry->state, true, true, &entry->context);
+        if (fValid && !entry->block.CheckBlockSignature())
+            fValid = error("%s : bad proof-of-stake block signature for %s", __func__, entry->hash.GetHex());
+        int64_t nTimeChecked = GetTimeMicros();
+
+        {
+            boost::unique_lock<boost::mutex> lock(csBlockPipeline);
+            entry->fChecked = true;
+            entry->fValid = fValid;
+            entry->nTimeChecked = nTimeChecked;
+            blockPipelineStats.nTimeCheck += nTimeChecked - nTimeStart;
+        }
+        cvBlockPipelineConnect.notify_one();
+    }
+}
+
+void ThreadBlockConnect()
+{
+    RenameThread("pivx-blockcon");
+    while (true) {
+        CPipelinedBlockRef entry;
+        {
+            // A later block may be checked first, it still waits for the lowest one
+            boost::unique_lock<boost::mutex> lock(csBlockPipeline);
+            while (!blockPipeline.HasBlockToConnect())
+                cvBlockPipelineConnect.wait(lock);
+            entry = blockPipeline.PopForConnect();
+        }
+
+        int64_t nTimeStart = GetTimeMicros();
+        CValidationState& state = entry->state;
+        if (entry->fValid)
+            ProcessNewBlock(state, entry->pfrom, &entry->block, NULL, true);
+        int nDoS;
+        if (state.IsInvalid(nDoS)) {
+            entry->pfrom->PushMessage("reject", std::string("block"), state.GetRejectCode(),
+                                      state.GetRejectReason().substr(0, MAX_REJECT_MESSAGE_LENGTH), entry->hash);
+            if (nDoS > 0) {
+                LOCK(cs_main);
+                Misbehaving(entry->pfrom->GetId(), nDoS);
+            }
+        }
+        {
+            LOCK(cs_vNodes);
+            entry->pfrom->Release();
+        }
+        int64_t nTimeConnected = GetTimeMicros();
+
+        {
+            boost::unique_lock<boost::mutex> lock(csBlockPipeline);
+            blockPipeline.Finished(entry->hash);
+            blockPipelineStats.nBlocks++;
+            blockPipelineStats.nTimeWait += nTimeStart - entry->nTimeChecked;
+            blockPipelineStats.nTimeConnect += nTimeConnected - nTimeStart;
+        }
+    }
+}
+
+void GetBlockPipelineStats(CBlockPipelineStats& stats)
+{
+    boost::unique_lock<boost::mutex> lock(csBlockPipeline);
+    stats = blockPipelineStats;
+    stats.nThreads = nBlockCheckThreads;
+    stats.nQueued = blockPipeline.size();
+    stats.nChecked = blockPipeline.CountChecked();
+}
+
+/** Blocks are not requested while the pipeline is full, the ones that arrive would have to wait for room */
+static bool IsBlockPipelineFull()
+{
+    boost::unique_lock<boost::mutex> lock(csBlockPipeline);
+    return blockPipeline.IsFull();
+}
+
 bool TestBlockValidity(CValidationState& state, const CBlock& block, CBlockIndex* const pindexPrev, bool fCheckPOW, bool fCheckMerkleRoot)
 {
     AssertLockHeld(cs_main);
@@ -5291,7 +5857,7 @@ bool CVerifyDB::VerifyDB(CCoinsView* coinsview, int nCheckLevel, int nCheckDepth
             }
         }
         // check level 3: check for inconsistencies during memory-only disconnect of tip blocks
-        if (nCheckLevel >= 3 && pindex == pindexState && (coins.GetCacheSize() + pcoinsTip->GetCacheSize()) <= nCoinCacheSize) {
+        if (nCheckLevel >= 3 && pindex == pindexState && (coins.DynamicMemoryUsage() + pcoinsTip->DynamicMemoryUsage()) <= nCoinCacheUsage) {
             bool fClean = true;
             if (!DisconnectBlock(block, state, pindex, coins, &fClean))
                 return error("VerifyDB() : *** irrecoverable inconsistency in block data at %d, hash=%s", pindex->nHeight, pindex->GetBlockHash().ToString());
@@ -5788,13 +6354,17 @@ void static ProcessGetData(CNode* pfrom)
                 // Don't send not-validated blocks
                 if (send && (mi->second->nStatus & BLOCK_HAVE_DATA)) {
                     // Send block from disk
-                    CBlock block;
-                    if (!ReadBlockFromDisk(block, (*mi).second))
-                        assert(!"cannot load block from disk");
-                    if (inv.type == MSG_BLOCK)
-                        pfrom->PushMessage("block", block);
-                    else // MSG_FILTERED_BLOCK)
+                    if (inv.type == MSG_BLOCK) {
+                        // Stored blocks are in network format, forward the bytes without parsing them
+                        CBlockSpan span;
+                        if (!ReadBlockSpan(mi->second->GetBlockPos(), span))
+                            assert(!"cannot load block from disk");
+                        pfrom->PushMessage("block", span);
+                    } else // MSG_FILTERED_BLOCK)
                     {
+                        CBlock block;
+                        if (!ReadBlockFromDisk(block, (*mi).second))
+                            assert(!"cannot load block from disk");
                         LOCK(pfrom->cs_filter);
                         if (pfrom->pfilter) {
                             CMerkleBlock merkleBlock(block, *pfrom->pfilter);
@@ -6551,6 +7121,13 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
         CInv inv(MSG_BLOCK, hashBlock);
         LogPrint("net", "received block %s peer=%d\n", inv.hash.ToString(), pfrom->id);
 
+        // During the initial sync the block is checked and connected by the block pipeline
+        if (QueueBlockForPipeline(pfrom, block, hashBlock)) {
+            pfrom->AddInventoryKnown(inv);
+            pfrom->DisconnectOldProtocol(ActiveProtocol(), strCommand);
+            return true;
+        }
+
         //sometimes we will be sent their most recent block and its not the one we want, in that case tell where we are
         if (!mapBlockIndex.count(block.hashPrevBlock)) {
             if (find(pfrom->vBlockRequested.begin(), pfrom->vBlockRequested.end(), hashBlock) != pfrom->vBlockRequested.end()) {
@@ -7131,7 +7708,7 @@ bool SendMessages(CNode* pto, bool fSendTrickle)
         // Message: getdata (blocks)
         //
         vector<CInv> vGetData;
-        if (!pto->fDisconnect && !pto->fClient && fFetch && state.nBlocksInFlight < MAX_BLOCKS_IN_TRANSIT_PER_PEER) {
+        if (!pto->fDisconnect && !pto->fClient && fFetch && state.nBlocksInFlight < MAX_BLOCKS_IN_TRANSIT_PER_PEER && !IsBlockPipelineFull()) {
             vector<CBlockIndex*> vToDownload;
             NodeId staller = -1;
             FindNextBlocksToDownload(pto->GetId(), MAX_BLOCKS_IN_TRANSIT_PER_PEER - state.nBlocksInFlight, vToDownload, staller);
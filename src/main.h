@@ -41,15 +41,18 @@
 
 #include "libzerocoin/CoinSpend.h"
 
+#include <boost/shared_ptr.hpp>
 #include <boost/unordered_map.hpp>
 
 class CBlockIndex;
+class CBlockPubcoins;
 class CBlockTreeDB;
 class CZerocoinDB;
 class CSporkDB;
 class CBloomFilter;
 class CInv;
 class CScriptCheck;
+class CZerocoinSpendCheck;
 class CValidationInterface;
 class CValidationState;
 
@@ -63,6 +66,8 @@ static const unsigned int DEFAULT_BLOCK_MIN_SIZE = 0;
 static const unsigned int DEFAULT_BLOCK_PRIORITY_SIZE = 50000;
 /** Default for accepting alerts from the P2P network. */
 static const bool DEFAULT_ALERTS = true;
+/** Default for -checkblockreads, hash the header of every block read from disk again */
+static const bool DEFAULT_CHECK_BLOCK_READS = true;
 /** The maximum size for transactions we're willing to relay/mine */
 static const unsigned int MAX_STANDARD_TX_SIZE = 100000;
 static const unsigned int MAX_ZEROCOIN_TX_SIZE = 150000;
@@ -90,6 +95,10 @@ static const unsigned int LOCKTIME_THRESHOLD = 500000000; // Tue Nov  5 00:53:20
 static const int MAX_SCRIPTCHECK_THREADS = 16;
 /** -par default (number of script-checking threads, 0 = auto) */
 static const int DEFAULT_SCRIPTCHECK_THREADS = 0;
+/** -blockcheckthreads default, 0 = one per core and a negative value turns the initial sync pipeline off */
+static const int DEFAULT_BLOCK_CHECK_THREADS = 0;
+/** Maximum number of downloaded blocks waiting in the initial sync pipeline */
+static const unsigned int MAX_BLOCK_PIPELINE_DEPTH = 64;
 /** Number of blocks that can be requested at any given time from a single peer. */
 static const int MAX_BLOCKS_IN_TRANSIT_PER_PEER = 16;
 /** Timeout in seconds during which a peer must stall block download progress before being disconnected. */
@@ -138,10 +147,12 @@ extern CConditionVariable cvBlockChange;
 extern bool fImporting;
 extern bool fReindex;
 extern int nScriptCheckThreads;
+extern int nBlockCheckThreads;
 extern bool fTxIndex;
 extern bool fIsBareMultisigStd;
 extern bool fCheckBlockIndex;
-extern unsigned int nCoinCacheSize;
+extern bool fCheckBlockReads;
+extern size_t nCoinCacheUsage;
 extern CFeeRate minRelayTxFee;
 extern bool fAlerts;
 extern bool fVerifyingBlocks;
@@ -189,9 +200,10 @@ void UnregisterNodeSignals(CNodeSignals& nodeSignals);
  * @param[in]   pfrom   The node which we are receiving the block from; it is added to mapBlockSource and may be penalised if the block is invalid.
  * @param[in]   pblock  The block we want to process.
  * @param[out]  dbp     If pblock is stored to disk (or already there), this will be set to its location.
+ * @param[in]   fPreChecked  The block pipeline already ran CheckBlockContextFree and checked the block signature, without recording its zerocoin mints.
  * @return True if state.IsValid()
  */
-bool ProcessNewBlock(CValidationState& state, CNode* pfrom, CBlock* pblock, CDiskBlockPos* dbp = NULL);
+bool ProcessNewBlock(CValidationState& state, CNode* pfrom, CBlock* pblock, CDiskBlockPos* dbp = NULL, bool fPreChecked = false);
 /** Check whether enough disk space is available for an incoming block */
 bool CheckDiskSpace(uint64_t nAdditionalBytes = 0);
 /** Open a block file (blk?????.dat) */
@@ -221,6 +233,34 @@ bool ProcessMessages(CNode* pfrom);
 bool SendMessages(CNode* pto, bool fSendTrickle);
 /** Run an instance of the script checking thread */
 void ThreadScriptCheck();
+/** Run an instance of the zerocoin spend proof checking thread */
+void ThreadZerocoinSpendCheck();
+/** Run an instance of the thread checking blocks queued by the initial sync pipeline */
+void ThreadBlockPreCheck();
+/** Run the thread connecting checked blocks of the initial sync pipeline in height order */
+void ThreadBlockConnect();
+
+/** State of the initial sync pipeline, times are totals in microseconds */
+struct CBlockPipelineStats {
+    int nThreads;
+    unsigned int nQueued;
+    unsigned int nChecked;
+    uint64_t nBlocks;
+    int64_t nTimeCheck;
+    int64_t nTimeWait;
+    int64_t nTimeConnect;
+};
+void GetBlockPipelineStats(CBlockPipelineStats& stats);
+
+/** Memory used by the chainstate cache and how often it was written to disk */
+struct CCoinsCacheStats {
+    size_t nUsage;
+    size_t nLimit;
+    unsigned int nEntries;
+    uint64_t nFlushes;
+    uint64_t nFlushesFull;
+};
+void GetCoinsCacheStats(CCoinsCacheStats& stats);
 
 // ***TODO*** probably not the right place for these 2
 /** Check whether a block hash satisfies the proof-of-work requirement specified by nBits */
@@ -351,14 +391,31 @@ bool CheckInputs(const CTransaction& tx, CValidationState& state, const CCoinsVi
 /** Apply the effects of this transaction on the UTXO set represented by view */
 void UpdateCoins(const CTransaction& tx, CValidationState& state, CCoinsViewCache& inputs, CTxUndo& txundo, int nHeight);
 
+/**
+ * The chain state that CheckBlockContextFree and CheckTransaction depend on. It is taken under
+ * cs_main, so that the block pipeline can run these checks without holding it.
+ */
+struct CBlockCheckContext {
+    //! Height the block is checked for
+    int nHeight;
+    //! Verify the zerocoin spend proofs, they are skipped while syncing blocks older than a day
+    bool fVerifyZerocoinSpends;
+    //! Record zerocoin mints in the zerocoin database as they are checked
+    bool fRecordZerocoinMints;
+};
+/** The context for checking a block at nHeight against the active chain, cs_main must be held */
+CBlockCheckContext GetBlockCheckContext(int nHeight, bool fRecordZerocoinMints = true);
+
 /** Context-independent validity checks */
-bool CheckTransaction(const CTransaction& tx, bool fZerocoinActive, bool fRejectBadUTXO, CValidationState& state);
+bool CheckTransaction(const CTransaction& tx, bool fZerocoinActive, bool fRejectBadUTXO, CValidationState& state, std::vector<CZerocoinSpendCheck>* pvSpendChecks = NULL, const CBlockCheckContext* pcontext = NULL);
 bool CheckZerocoinMint(const uint256& txHash, const CTxOut& txout, CValidationState& state, bool fCheckOnly = false);
-bool CheckZerocoinSpend(const CTransaction tx, bool fVerifySignature, CValidationState& state);
+bool CheckZerocoinSpend(const CTransaction tx, bool fVerifySignature, CValidationState& state, std::vector<CZerocoinSpendCheck>* pvSpendChecks = NULL);
 libzerocoin::CoinSpend TxInToZerocoinSpend(const CTxIn& txin);
 bool TxOutToPublicCoin(const CTxOut txout, libzerocoin::PublicCoin& pubCoin, CValidationState& state);
 bool BlockToPubcoinList(const CBlock& block, list<libzerocoin::PublicCoin>& listPubcoins, bool fFilterInvalid);
 bool BlockToZerocoinMintList(const CBlock& block, std::list<CZerocoinMint>& vMints, bool fFilterInvalid);
+bool BlockToBlockPubcoins(const CBlock& block, CBlockPubcoins& blockPubcoins);
+void BlockPubcoinsToList(const CBlockPubcoins& blockPubcoins, list<libzerocoin::PublicCoin>& listPubcoins, bool fFilterInvalid);
 bool BlockToMintValueVector(const CBlock& block, const libzerocoin::CoinDenomination denom, std::vector<CBigNum>& vValues);
 std::list<libzerocoin::CoinDenomination> ZerocoinSpendListFromBlock(const CBlock& block, bool fFilterInvalid);
 void FindMints(vector<CZerocoinMint> vMintsToFind, vector<CZerocoinMint>& vMintsToUpdate, vector<CZerocoinMint>& vMissingMints, bool fExtendedSearch);
@@ -446,6 +503,43 @@ public:
     ScriptError GetScriptError() const { return error; }
 };
 
+/**
+ * Closure representing the verification of one sub-proof of a zerocoin spend.
+ * A CoinSpend is made of three independent proofs, so each spend input yields
+ * three of these, which can be evaluated in parallel on a CCheckQueue.
+ */
+class CZerocoinSpendCheck
+{
+public:
+    enum SpendProof {
+        PROOF_NONE,
+        PROOF_COMMITMENT,
+        PROOF_ACCUMULATOR,
+        PROOF_SERIAL
+    };
+
+private:
+    boost::shared_ptr<const libzerocoin::CoinSpend> spend;
+    boost::shared_ptr<const libzerocoin::Accumulator> accumulator;
+    SpendProof proof;
+    uint256 txid;
+
+public:
+    CZerocoinSpendCheck() : proof(PROOF_NONE), txid(0) {}
+    CZerocoinSpendCheck(const boost::shared_ptr<const libzerocoin::CoinSpend>& spendIn, const boost::shared_ptr<const libzerocoin::Accumulator>& accumulatorIn,
+                        SpendProof proofIn, const uint256& txidIn) : spend(spendIn), accumulator(accumulatorIn), proof(proofIn), txid(txidIn) {}
+
+    bool operator()();
+
+    void swap(CZerocoinSpendCheck& check)
+    {
+        spend.swap(check.spend);
+        accumulator.swap(check.accumulator);
+        std::swap(proof, check.proof);
+        std::swap(txid, check.txid);
+    }
+};
+
 
 /** Functions for disk access for blocks */
 bool WriteBlockToDisk(CBlock& block, CDiskBlockPos& pos);
@@ -470,6 +564,13 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
 /** Context-independent validity checks */
 bool CheckBlockHeader(const CBlockHeader& block, CValidationState& state, bool fCheckPOW = true);
 bool CheckBlock(const CBlock& block, CValidationState& state, bool fCheckPOW = true, bool fCheckMerkleRoot = true, bool fCheckSig = true);
+/**
+ * The checks of CheckBlock that need no chain state besides pcontext, may run on several threads at once
+ * when pcontext is given. Without it the context is taken from the active chain.
+ */
+bool CheckBlockContextFree(const CBlock& block, CValidationState& state, bool fCheckPOW = true, bool fCheckMerkleRoot = true, const CBlockCheckContext* pcontext = NULL);
+/** The checks of CheckBlock against the SwiftX locks and masternode payments known to this node */
+bool CheckBlockNetworkState(const CBlock& block, CValidationState& state);
 bool CheckWork(const CBlock block, CBlockIndex* const pindexPrev);
 
 /** Context-dependent validity checks */
@@ -3,6 +3,7 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include "blockreader.h"
 #include "main.h"
 #include "primitives/block.h"
 #include "primitives/transaction.h"
@@ -105,28 +106,29 @@ static bool rest_block(AcceptedConnection* conn,
 
     CBlock block;
     CBlockIndex* pblockindex = NULL;
+    CBlockSpan span;
     {
         LOCK(cs_main);
         if (mapBlockIndex.count(hash) == 0)
             throw RESTERR(HTTP_NOT_FOUND, hashStr + " not found");
 
         pblockindex = mapBlockIndex[hash];
-        if (!ReadBlockFromDisk(block, pblockindex))
+        if (!(pblockindex->nStatus & BLOCK_HAVE_DATA))
+            throw RESTERR(HTTP_NOT_FOUND, hashStr + " not found");
+        // the binary and hex formats are the stored bytes, only JSON needs the parsed block
+        if (rf == RF_JSON ? !ReadBlockFromDisk(block, pblockindex) : !ReadBlockSpan(pblockindex->GetBlockPos(), span))
             throw RESTERR(HTTP_NOT_FOUND, hashStr + " not found");
     }
 
-    CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION);
-    ssBlock << block;
-
     switch (rf) {
     case RF_BINARY: {
-        string binaryBlock = ssBlock.str();
+        string binaryBlock(span.begin(), span.end());
         conn->stream() << HTTPReplyHeader(HTTP_OK, fRun, binaryBlock.size(), "application/octet-stream") << binaryBlock << std::flush;
         return true;
     }
 
     case RF_HEX: {
-        string strHex = HexStr(ssBlock.begin(), ssBlock.end()) + "\n";
+        string strHex = HexStr(span.begin(), span.end()) + "\n";
         conn->stream() << HTTPReply(HTTP_OK, strHex, fRun, false, "text/plain") << std::flush;
         return true;
     }
@@ -5,11 +5,14 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include "accumulators.h"
+#include "blockreader.h"
 #include "checkpoints.h"
 #include "main.h"
 #include "rpcserver.h"
 #include "sync.h"
 #include "util.h"
+#include "zerocoincache.h"
 
 #include <stdint.h>
 
@@ -309,16 +312,17 @@ Value getblock(const Array& params, bool fHelp)
     CBlock block;
     CBlockIndex* pblockindex = mapBlockIndex[hash];
 
-    if (!ReadBlockFromDisk(block, pblockindex))
-        throw JSONRPCError(RPC_INTERNAL_ERROR, "Can't read block from disk");
-
     if (!fVerbose) {
-        CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION);
-        ssBlock << block;
-        std::string strHex = HexStr(ssBlock.begin(), ssBlock.end());
-        return strHex;
+        // The stored bytes are the serialized block
+        CBlockSpan span;
+        if (!ReadBlockSpan(pblockindex->GetBlockPos(), span))
+            throw JSONRPCError(RPC_INTERNAL_ERROR, "Can't read block from disk");
+        return HexStr(span.begin(), span.end());
     }
 
+    if (!ReadBlockFromDisk(block, pblockindex))
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Can't read block from disk");
+
     return blockToJSON(block, pblockindex);
 }
 
@@ -385,7 +389,7 @@ Value gettxoutsetinfo(const Array& params, bool fHelp)
             "  \"bestblock\": \"hex\",   (string) the best block hash hex\n"
             "  \"transactions\": n,      (numeric) The number of transactions\n"
             "  \"txouts\": n,            (numeric) The number of output transactions\n"
-            "  \"bytes_serialized\": n,  (numeric) The serialized size\n"
+            "  \"bytes_serialized\": n,  (numeric) The size of the output records in the database\n"
             "  \"hash_serialized\": \"hash\",   (string) The serialized hash\n"
             "  \"total_amount\": x.xxx          (numeric) The total amount\n"
             "}\n"
@@ -518,7 +522,29 @@ Value getblockchaininfo(const Array& params, bool fHelp)
             "  \"bestblockhash\": \"...\", (string) the hash of the currently best block\n"
             "  \"difficulty\": xxxxxx,     (numeric) the current difficulty\n"
             "  \"verificationprogress\": xxxx, (numeric) estimate of verification progress [0..1]\n"
-            "  \"chainwork\": \"xxxx\"     (string) total amount of work in active chain, in hexadecimal\n"
+            "  \"chainwork\": \"xxxx\",    (string) total amount of work in active chain, in hexadecimal\n"
+            "  \"accumulatorcache\": {     (json object) Zerocoin accumulator values held in memory\n"
+            "     \"entries\": xxxxx       (numeric) Number of cached values\n"
+            "     \"maxentries\": xxxxx    (numeric) Maximum number of cached values\n"
+            "     \"hits\": xxxxx          (numeric) Lookups answered from memory\n"
+            "     \"misses\": xxxxx        (numeric) Lookups that were not in memory\n"
+            "  },\n"
+            "  \"coinscache\": {           (json object) In-memory cache of the unspent transaction outputs\n"
+            "     \"usage\": xxxxx         (numeric) Memory used by the cache, in bytes\n"
+            "     \"limit\": xxxxx         (numeric) Usage above which the cache is written to disk, set by -dbcache\n"
+            "     \"entries\": xxxxx       (numeric) Number of cached transactions\n"
+            "     \"flushes\": xxxxx       (numeric) Times the cache was written to disk\n"
+            "     \"fullflushes\": xxxxx   (numeric) Times it was written because it reached its limit\n"
+            "  },\n"
+            "  \"blockpipeline\": {        (json object) Downloaded blocks checked in parallel during the initial sync\n"
+            "     \"threads\": xxxxx       (numeric) Number of block checking threads, 0 if the pipeline is off\n"
+            "     \"queued\": xxxxx        (numeric) Blocks in the pipeline\n"
+            "     \"checked\": xxxxx       (numeric) Blocks in the pipeline that are checked and wait to be connected\n"
+            "     \"blocks\": xxxxx        (numeric) Blocks that went through the pipeline\n"
+            "     \"checktime\": x.xxx     (numeric) Average time checking a block, in milliseconds\n"
+            "     \"waittime\": x.xxx      (numeric) Average time a checked block waited for its parent, in milliseconds\n"
+            "     \"connecttime\": x.xxx   (numeric) Average time connecting a block, in milliseconds\n"
+            "  }\n"
             "}\n"
             "\nExamples:\n" +
             HelpExampleCli("getblockchaininfo", "") + HelpExampleRpc("getblockchaininfo", ""));
@@ -531,6 +557,37 @@ Value getblockchaininfo(const Array& params, bool fHelp)
     obj.push_back(Pair("difficulty", (double)GetDifficulty()));
     obj.push_back(Pair("verificationprogress", Checkpoints::GuessVerificationProgress(chainActive.Tip())));
     obj.push_back(Pair("chainwork", chainActive.Tip()->nChainWork.GetHex()));
+
+    CZerocoinCacheStats stats = GetAccumulatorCacheStats();
+    Object accumulatorcache;
+    accumulatorcache.push_back(Pair("entries", (int64_t)stats.nEntries));
+    accumulatorcache.push_back(Pair("maxentries", (int64_t)stats.nMaxEntries));
+    accumulatorcache.push_back(Pair("hits", (int64_t)stats.nHits));
+    accumulatorcache.push_back(Pair("misses", (int64_t)stats.nMisses));
+    obj.push_back(Pair("accumulatorcache", accumulatorcache));
+
+    CCoinsCacheStats coinsStats;
+    GetCoinsCacheStats(coinsStats);
+    Object coinscache;
+    coinscache.push_back(Pair("usage", (int64_t)coinsStats.nUsage));
+    coinscache.push_back(Pair("limit", (int64_t)coinsStats.nLimit));
+    coinscache.push_back(Pair("entries", (int64_t)coinsStats.nEntries));
+    coinscache.push_back(Pair("flushes", (int64_t)coinsStats.nFlushes));
+    coinscache.push_back(Pair("fullflushes", (int64_t)coinsStats.nFlushesFull));
+    obj.push_back(Pair("coinscache", coinscache));
+
+    CBlockPipelineStats pipeline;
+    GetBlockPipelineStats(pipeline);
+    double nBlocks = std::max(pipeline.nBlocks, (uint64_t)1);
+    Object blockpipeline;
+    blockpipeline.push_back(Pair("threads", pipeline.nThreads));
+    blockpipeline.push_back(Pair("queued", (int64_t)pipeline.nQueued));
+    blockpipeline.push_back(Pair("checked", (int64_t)pipeline.nChecked));
+    blockpipeline.push_back(Pair("blocks", (int64_t)pipeline.nBlocks));
+    blockpipeline.push_back(Pair("checktime", pipeline.nTimeCheck * 0.001 / nBlocks));
+    blockpipeline.push_back(Pair("waittime", pipeline.nTimeWait * 0.001 / nBlocks));
+    blockpipeline.push_back(Pair("connecttime", pipeline.nTimeConnect * 0.001 / nBlocks));
+    obj.push_back(Pair("blockpipeline", blockpipeline));
     return obj;
 }
 
@@ -642,6 +699,18 @@ Value getmempoolinfo(const Array& params, bool fHelp)
             "{\n"
             "  \"size\": xxxxx                (numeric) Current tx count\n"
             "  \"bytes\": xxxxx               (numeric) Sum of all tx sizes\n"
+            "  \"zerocoinspendcache\": {       (json object) Cache of verified zerocoin spends\n"
+            "     \"entries\": xxxxx           (numeric) Number of cached spends\n"
+            "     \"maxentries\": xxxxx        (numeric) Maximum number of cached spends\n"
+            "     \"hits\": xxxxx              (numeric) Spends that did not need to be verified again\n"
+            "     \"misses\": xxxxx            (numeric) Spends that had to be verified\n"
+            "  },\n"
+            "  \"pubcoincache\": {             (json object) Cache of validated zerocoin mints\n"
+            "     \"entries\": xxxxx           (numeric) Number of cached pubcoins\n"
+            "     \"maxentries\": xxxxx        (numeric) Maximum number of cached pubcoins\n"
+            "     \"hits\": xxxxx              (numeric) Pubcoins that did not need to be validated again\n"
+            "     \"misses\": xxxxx            (numeric) Pubcoins that had to be validated\n"
+            "  }\n"
             "}\n"
             "\nExamples:\n" +
             HelpExampleCli("getmempoolinfo", "") + HelpExampleRpc("getmempoolinfo", ""));
@@ -650,6 +719,22 @@ Value getmempoolinfo(const Array& params, bool fHelp)
     ret.push_back(Pair("size", (int64_t)mempool.size()));
     ret.push_back(Pair("bytes", (int64_t)mempool.GetTotalTxSize()));
 
+    CZerocoinCacheStats stats = GetZerocoinSpendCacheStats();
+    Object spendcache;
+    spendcache.push_back(Pair("entries", (int64_t)stats.nEntries));
+    spendcache.push_back(Pair("maxentries", (int64_t)stats.nMaxEntries));
+    spendcache.push_back(Pair("hits", (int64_t)stats.nHits));
+    spendcache.push_back(Pair("misses", (int64_t)stats.nMisses));
+    ret.push_back(Pair("zerocoinspendcache", spendcache));
+
+    stats = GetPubcoinCacheStats();
+    Object pubcoincache;
+    pubcoincache.push_back(Pair("entries", (int64_t)stats.nEntries));
+    pubcoincache.push_back(Pair("maxentries", (int64_t)stats.nMaxEntries));
+    pubcoincache.push_back(Pair("hits", (int64_t)stats.nHits));
+    pubcoincache.push_back(Pair("misses", (int64_t)stats.nMisses));
+    ret.push_back(Pair("pubcoincache", pubcoincache));
+
     return ret;
 }
 
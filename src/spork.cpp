@@ -146,27 +146,26 @@ bool IsSporkActive(int nSporkID)
 
 void ReprocessBlocks(int nBlocks)
 {
-    std::map<uint256, int64_t>::iterator it = mapRejectedBlocks.begin();
-    while (it != mapRejectedBlocks.end()) {
-        //use a window twice as large as is usual for the nBlocks we want to reset
-        if ((*it).second > GetTime() - (nBlocks * 60 * 5)) {
-            BlockMap::iterator mi = mapBlockIndex.find((*it).first);
-            if (mi != mapBlockIndex.end() && (*mi).second) {
-                LOCK(cs_main);
-
-                CBlockIndex* pindex = (*mi).second;
-                LogPrintf("ReprocessBlocks - %s\n", (*it).first.ToString());
-
-                CValidationState state;
-                ReconsiderBlock(state, pindex);
-            }
-        }
-        ++it;
-    }
-
     CValidationState state;
     {
+        // mapRejectedBlocks is guarded by cs_main
         LOCK(cs_main);
+        std::map<uint256, int64_t>::iterator it = mapRejectedBlocks.begin();
+        while (it != mapRejectedBlocks.end()) {
+            //use a window twice as large as is usual for the nBlocks we want to reset
+            if ((*it).second > GetTime() - (nBlocks * 60 * 5)) {
+                BlockMap::iterator mi = mapBlockIndex.find((*it).first);
+                if (mi != mapBlockIndex.end() && (*mi).second) {
+                    CBlockIndex* pindex = (*mi).second;
+                    LogPrintf("ReprocessBlocks - %s\n", (*it).first.ToString());
+
+                    CValidationState stateReconsider;
+                    ReconsiderBlock(stateReconsider, pindex);
+                }
+            }
+            ++it;
+        }
+
         DisconnectBlocksAndReprocess(nBlocks);
     }
 
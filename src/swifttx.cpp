@@ -98,9 +98,13 @@ void ProcessMessageSwiftTX(CNode* pfrom, std::string& strCommand, CDataStream& v
                 pfrom->addr.ToString().c_str(), pfrom->cleanSubVer.c_str(),
                 tx.GetHash().ToString().c_str());
 
-            BOOST_FOREACH (const CTxIn& in, tx.vin) {
-                if (!mapLockedInputs.count(in.prevout)) {
-                    mapLockedInputs.insert(make_pair(in.prevout, tx.GetHash()));
+            {
+                // mapLockedInputs is guarded by cs_main, blocks are checked against it from other threads
+                LOCK(cs_main);
+                BOOST_FOREACH (const CTxIn& in, tx.vin) {
+                    if (!mapLockedInputs.count(in.prevout)) {
+                        mapLockedInputs.insert(make_pair(in.prevout, tx.GetHash()));
+                    }
                 }
             }
 
@@ -358,6 +362,7 @@ bool ProcessConsensusVote(CNode* pnode, CConsensusVote& ctx)
 #endif
 
                 if (mapTxLockReq.count(ctx.txHash)) {
+                    LOCK(cs_main);
                     BOOST_FOREACH (const CTxIn& in, tx.vin) {
                         if (!mapLockedInputs.count(in.prevout)) {
                             mapLockedInputs.insert(make_pair(in.prevout, ctx.txHash));
@@ -432,8 +437,11 @@ void CleanTransactionLocksList()
             if (mapTxLockReq.count(it->second.txHash)) {
                 CTransaction& tx = mapTxLockReq[it->second.txHash];
 
-                BOOST_FOREACH (const CTxIn& in, tx.vin)
-                    mapLockedInputs.erase(in.prevout);
+                {
+                    LOCK(cs_main);
+                    BOOST_FOREACH (const CTxIn& in, tx.vin)
+                        mapLockedInputs.erase(in.prevout);
+                }
 
                 mapTxLockReq.erase(it->second.txHash);
                 mapTxLockReqRejected.erase(it->second.txHash);
@@ -25,6 +25,7 @@
 #include "libzerocoin/Coin.h"
 #include "libzerocoin/CoinSpend.h"
 #include "libzerocoin/Accumulator.h"
+#include "libzerocoin/MultiExp.h"
 
 using namespace std;
 using namespace libzerocoin;
@@ -229,6 +230,95 @@ Testb_ParamGen()
 	return result;
 }
 
+bool
+Testb_MultiExp()
+{
+	// Time the products of powers evaluated by AccumulatorProofOfKnowledge::Verify,
+	// once with separate pow_mod calls and once with the precomputed tables.
+	const uint32_t nRounds = 20;
+	const AccumulatorAndProofParams& p = gg_Params->accumulatorParams;
+	std::shared_ptr<const AccumulatorPoKPrecomputation> pre = p.GetPrecomputation();
+	const CBigNum& N = p.accumulatorModulus;
+	const CBigNum& g_n = p.accumulatorQRNCommitmentGroup.g;
+	const CBigNum& h_n = p.accumulatorQRNCommitmentGroup.h;
+
+	vector<CBigNum> vBases, vChallenges, vExponents1, vExponents2;
+	for (uint32_t i = 0; i < nRounds; i++) {
+		vBases.push_back(CBigNum::randBignum(N));
+		vChallenges.push_back(CBigNum::RandKBitBigum(256));
+		vExponents1.push_back(0 - CBigNum::RandKBitBigum(pre->g_n.getMaxBits() - 8));
+		vExponents2.push_back(CBigNum::RandKBitBigum(pre->h_n.getMaxBits() - 8));
+	}
+
+	vector<CBigNum> vPowMod, vMultiExp;
+	timer.start();
+	for (uint32_t i = 0; i < nRounds; i++)
+		vPowMod.push_back((vBases[i].pow_mod(vChallenges[i], N) * (g_n.inverse(N)).pow_mod(-vExponents1[i], N) * h_n.pow_mod(vExponents2[i], N)) % N);
+	timer.stop();
+	int nPowModDuration = timer.duration();
+
+	timer.start();
+	for (uint32_t i = 0; i < nRounds; i++)
+		vMultiExp.push_back(MultiExp(pre->qrnModulus).add(vBases[i], vChallenges[i]).add(pre->g_n, vExponents1[i]).add(pre->h_n, vExponents2[i]).eval());
+	timer.stop();
+	int nMultiExpDuration = timer.duration();
+
+	cout << "\tPOW_MOD PRODUCT ELAPSED TIME: " << nPowModDuration << " ms\t" << (double)nPowModDuration / nRounds << " ms per product" << endl;
+	cout << "\tMULTIEXP PRODUCT ELAPSED TIME: " << nMultiExpDuration << " ms\t" << (double)nMultiExpDuration / nRounds << " ms per product" << endl;
+	if (nMultiExpDuration > 0)
+		cout << "\tSPEEDUP: " << (double)nPowModDuration / nMultiExpDuration << "x" << endl;
+
+	return vPowMod == vMultiExp;
+}
+
+bool
+Testb_BignumBackend()
+{
+	// The big integer backend is picked at configure time
+	// (--with-zerocoin-bignum). Run this benchmark once per backend and
+	// compare, together with the spend timings below.
+	const uint32_t nRounds = 20;
+	const CBigNum& N = gg_Params->accumulatorParams.accumulatorModulus;
+	const CBigNum& p = gg_Params->coinCommitmentGroup.modulus;
+	const CBigNum& q = gg_Params->coinCommitmentGroup.groupOrder;
+
+	cout << "\tBIGNUM BACKEND: " << CBigNum::GetBackendName() << endl;
+
+	vector<CBigNum> vBases, vExponents, vResults, vResultsSec;
+	for (uint32_t i = 0; i < nRounds; i++) {
+		vBases.push_back(CBigNum::randBignum(N));
+		vExponents.push_back(CBigNum::randBignum(N));
+	}
+
+	timer.start();
+	for (uint32_t i = 0; i < nRounds; i++)
+		vResults.push_back(vBases[i].pow_mod(vExponents[i], N));
+	timer.stop();
+	cout << "\tPOW_MOD ELAPSED TIME: " << timer.duration() << " ms\t" << (double)timer.duration() / nRounds << " ms per operation" << endl;
+
+	timer.start();
+	for (uint32_t i = 0; i < nRounds; i++)
+		vResultsSec.push_back(vBases[i].pow_mod_sec(vExponents[i], N));
+	timer.stop();
+	cout << "\tPOW_MOD_SEC ELAPSED TIME: " << timer.duration() << " ms\t" << (double)timer.duration() / nRounds << " ms per operation" << endl;
+
+	bool fInverse = true;
+	timer.start();
+	for (uint32_t i = 0; i < nRounds * 10; i++)
+		fInverse &= (vBases[i % nRounds] % p).inverse(p).mul_mod(vBases[i % nRounds], p).isOne();
+	timer.stop();
+	cout << "\tINVERSE ELAPSED TIME: " << timer.duration() << " ms\t" << (double)timer.duration() / (nRounds * 10) << " ms per operation" << endl;
+
+	bool fPrime = true;
+	timer.start();
+	for (uint32_t i = 0; i < nRounds; i++)
+		fPrime &= q.isPrime(ZEROCOIN_MINT_PRIME_PARAM) && !(q * p).isPrime(ZEROCOIN_MINT_PRIME_PARAM);
+	timer.stop();
+	cout << "\tISPRIME ELAPSED TIME: " << timer.duration() << " ms\t" << (double)timer.duration() / (nRounds * 2) << " ms per operation" << endl;
+
+	return vResults == vResultsSec && fInverse && fPrime;
+}
+
 bool
 Testb_Accumulator()
 {
@@ -360,6 +450,18 @@ Testb_MintAndSpend()
 
 		cout << "\tSPEND VERIFY ELAPSED TIME: " << timer.duration() << " ms\t" << timer.duration()*0.001 << " s" << endl;
 
+		timer.start();
+		ret = ret && newSpend.VerifyAccumulatorPoK(acc);
+		timer.stop();
+
+		cout << "\tACCUMULATOR POK VERIFY ELAPSED TIME: " << timer.duration() << " ms\t" << timer.duration()*0.001 << " s" << endl;
+
+		timer.start();
+		ret = ret && newSpend.VerifySerialNumberSoK();
+		timer.stop();
+
+		cout << "\tSERIAL NUMBER SOK VERIFY ELAPSED TIME: " << timer.duration() << " ms\t" << timer.duration()*0.001 << " s" << endl;
+
 		return ret;
 	} catch (runtime_error &e) {
 		cout << e.what() << endl;
@@ -385,6 +487,8 @@ Testb_RunAllTests()
 	gLogTestResult("parameter sizes are correct", Testb_CalcParamSizes);
 	gLogTestResult("group/field parameters can be generated", Testb_GenerateGroupParams);
 	gLogTestResult("parameter generation is correct", Testb_ParamGen);
+	gLogTestResult("multi-exponentiation is faster than pow_mod", Testb_MultiExp);
+	gLogTestResult("the bignum backend works", Testb_BignumBackend);
 	gLogTestResult("coins can be minted", Testb_MintCoin);
 	gLogTestResult("the accumulator works", Testb_Accumulator);
 	gLogTestResult("a minted coin can be spent", Testb_MintAndSpend);
@@ -0,0 +1,123 @@
+// Copyright (c) 2017 The PIVX developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// Fixed vectors for CBigNum. Every big integer backend has to produce these
+// exact values and bytes, they end up in zerocoin proofs.
+
+#include "libzerocoin/bignum.h"
+#include "utilstrencodings.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(bignum_tests)
+
+static CBigNum FromHex(const std::string& str)
+{
+    CBigNum bn;
+    bn.SetHex(str);
+    return bn;
+}
+
+BOOST_AUTO_TEST_CASE(bignum_serialization)
+{
+    // hex value, getvch()
+    static const char* vectors[][2] = {
+        {"0", ""},
+        {"1", "01"},
+        {"-1", "81"},
+        {"7f", "7f"},
+        {"80", "8000"},
+        {"-80", "8080"},
+        {"ff", "ff00"},
+        {"-ff", "ff80"},
+        {"8000", "008000"},
+        {"10000000000000000", "000000000000000001"},
+        {"-10000000000000000", "000000000000000081"},
+        {"ffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff", "ffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff00"},
+        {"-123456789abcdef0123456789abcdef0123456789abcdef", "efcdab8967452301efcdab8967452301efcdab8967452381"},
+    };
+
+    for (unsigned int i = 0; i < sizeof(vectors) / sizeof(vectors[0]); i++) {
+        CBigNum bn = FromHex(vectors[i][0]);
+        BOOST_CHECK_EQUAL(HexStr(bn.getvch()), vectors[i][1]);
+        BOOST_CHECK_EQUAL(bn.GetHex(), vectors[i][0]);
+        BOOST_CHECK(CBigNum(ParseHex(vectors[i][1])) == bn);
+    }
+
+    // A sign bit on an otherwise empty magnitude is zero
+    BOOST_CHECK(!CBigNum(ParseHex("80")));
+    BOOST_CHECK(CBigNum(ParseHex("0180")) == -1);
+
+    // Integer constructors
+    BOOST_CHECK_EQUAL(HexStr(CBigNum(-32768L).getvch()), "008080");
+    BOOST_CHECK_EQUAL(HexStr(CBigNum(4294967295UL).getvch()), "ffffffff00");
+    BOOST_CHECK_EQUAL(HexStr(CBigNum(std::numeric_limits<long>::min()).getvch()), "000000000000008080");
+    BOOST_CHECK_EQUAL(CBigNum(std::numeric_limits<long>::min()).ToString(), "-9223372036854775808");
+}
+
+BOOST_AUTO_TEST_CASE(bignum_conversions)
+{
+    CBigNum bnLarge = FromHex("1ffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff0123");
+    BOOST_CHECK_EQUAL(bnLarge.bitSize(), 273);
+    BOOST_CHECK_EQUAL(bnLarge.getuint256().GetHex(), "ffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff0123");
+    BOOST_CHECK_EQUAL(bnLarge.getulong(), std::numeric_limits<unsigned long>::max());
+    BOOST_CHECK_EQUAL(bnLarge.getint(), std::numeric_limits<int>::max());
+    BOOST_CHECK_EQUAL((-bnLarge).getint(), std::numeric_limits<int>::min());
+    BOOST_CHECK_EQUAL(bnLarge.GetCompact(), 587333631U);
+    BOOST_CHECK_EQUAL(FromHex("-ff").GetCompact(), 42008320U);
+    BOOST_CHECK_EQUAL(FromHex("-123456789abcdef0123456789abcdef0123456789abcdef").getuint256().GetHex(),
+                      "00000000000000000123456789abcdef0123456789abcdef0123456789abcdef");
+    BOOST_CHECK_EQUAL(FromHex("-123456789abcdef0123456789abcdef0123456789abcdef").ToString(),
+                      "-27898229935051914142968983831921934135401027036219428335");
+
+    uint256 n;
+    n.SetHex("8000000000000000000000000000000000000000000000000000000000000001");
+    BOOST_CHECK_EQUAL(HexStr(CBigNum(n).getvch()), "010000000000000000000000000000000000000000000000000000000000008000");
+    BOOST_CHECK(CBigNum(n).getuint256() == n);
+
+    CBigNum bnCompact;
+    bnCompact.SetCompact(0x05c0de00);
+    BOOST_CHECK(bnCompact == FromHex("-40de000000"));
+    BOOST_CHECK(CBigNum().SetCompact(bnLarge.GetCompact()) == FromHex("1ffff0000000000000000000000000000000000000000000000000000000000000000"));
+}
+
+BOOST_AUTO_TEST_CASE(bignum_arithmetic)
+{
+    CBigNum a = FromHex("123456789abcdef");
+    CBigNum m = FromHex("fffffffffffffffffffffffffffffffffffffffffffffffffffffffefffffc2f");
+    CBigNum e = FromHex("-abcdef1234567");
+
+    // Division rounds towards zero, % is never negative, >> of a negative number is zero
+    BOOST_CHECK(CBigNum(-7) / CBigNum(2) == -3);
+    BOOST_CHECK(CBigNum(-7) % CBigNum(2) == 1);
+    BOOST_CHECK(CBigNum(-7) % CBigNum(-2) == 1);
+    BOOST_CHECK((CBigNum(-256) >> 4) == 0);
+    BOOST_CHECK((CBigNum(256) >> 4) == 16);
+    BOOST_CHECK((CBigNum(-1) << 4) == -16);
+    BOOST_CHECK(CBigNum(12).gcd(CBigNum(-18)) == 6);
+    BOOST_CHECK(CBigNum(3).pow(100).GetHex() == "5a4653ca673768565b41f775d6947d55cf3813d1");
+
+    BOOST_CHECK_EQUAL(a.pow_mod(e, m).GetHex(), "71016bc19aa3d81c5447234a008572551d5772c12f01a78d151a9b67b579d452");
+    BOOST_CHECK(a.pow_mod_sec(e, m) == a.pow_mod(e, m));
+    BOOST_CHECK(a.pow_mod_sec(-e, m) == a.pow_mod(-e, m));
+    BOOST_CHECK(a.pow_mod_sec(0, m).isOne());
+    BOOST_CHECK_EQUAL(a.inverse(m).GetHex(), "68835bccce646b8263a96bce4c8935bfd27e7d360d2b99952913dfe1fd88381");
+    BOOST_CHECK_EQUAL((-a).mul_mod(a, m).GetHex(), "fffffffffffffffffffffffffffffffffffeb49923cc0953235a1df66f0d570e");
+    BOOST_CHECK_THROW(CBigNum(2).inverse(CBigNum(4)), bignum_error);
+
+    BOOST_CHECK(m.isPrime());
+    BOOST_CHECK(!(m * a).isPrime());
+    BOOST_CHECK(CBigNum(2).isPrime());
+    BOOST_CHECK(!CBigNum(1).isPrime());
+    BOOST_CHECK(!CBigNum(-7).isPrime());
+
+    for (int i = 0; i < 20; i++) {
+        CBigNum r = CBigNum::randBignum(m);
+        BOOST_CHECK(r >= 0 && r < m);
+        BOOST_CHECK(CBigNum::RandKBitBigum(100).bitSize() <= 100);
+    }
+    BOOST_CHECK_EQUAL(CBigNum::generatePrime(128).bitSize(), 128);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,146 @@
+// Copyright (c) 2017 The PIVX developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockpipeline.h"
+#include "main.h"
+
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+namespace
+{
+struct CTestBlock {
+    uint256 hash;
+    bool fChecked;
+    bool fValid;
+
+    explicit CTestBlock(const uint256& hashIn) : hash(hashIn), fChecked(false), fValid(false) {}
+};
+
+typedef CBlockPipelineQueue<CTestBlock> TestPipeline;
+
+// Queue a block the way QueueBlockForPipeline does, nPrevHeight is -1 when the parent is not in the block index
+bool Receive(TestPipeline& pipeline, const uint256& hash, const uint256& hashPrev, int nPrevHeight, bool fInitialSync = true)
+{
+    int nHeight = pipeline.GetHeight(hashPrev, nPrevHeight, fInitialSync);
+    if (nHeight < 0)
+        return false;
+    pipeline.Add(hash, nHeight);
+    pipeline.QueueForCheck(nHeight, TestPipeline::Ref(new CTestBlock(hash)));
+    return true;
+}
+
+// Take every queued block off the check queue, in the order the workers would
+std::vector<TestPipeline::Ref> PopAllForCheck(TestPipeline& pipeline)
+{
+    std::vector<TestPipeline::Ref> vEntries;
+    while (pipeline.HasBlockToCheck())
+        vEntries.push_back(pipeline.PopForCheck());
+    return vEntries;
+}
+
+void Check(const TestPipeline::Ref& entry, bool fValid = true)
+{
+    entry->fChecked = true;
+    entry->fValid = fValid;
+}
+
+// Connect the next block like ThreadBlockConnect and return its hash
+uint256 ConnectNext(TestPipeline& pipeline)
+{
+    TestPipeline::Ref entry = pipeline.PopForConnect();
+    BOOST_REQUIRE(entry);
+    pipeline.Finished(entry->hash);
+    return entry->hash;
+}
+}
+
+BOOST_AUTO_TEST_SUITE(blockpipeline_tests)
+
+// Later blocks can be checked first, they are still connected in height order
+BOOST_AUTO_TEST_CASE(blockpipeline_out_of_order)
+{
+    TestPipeline pipeline(MAX_BLOCK_PIPELINE_DEPTH);
+    const uint256 hashTip(100);
+    BOOST_CHECK(Receive(pipeline, uint256(1), hashTip, 10));
+    BOOST_CHECK(Receive(pipeline, uint256(2), uint256(1), -1));
+    BOOST_CHECK(Receive(pipeline, uint256(3), uint256(2), -1));
+    BOOST_CHECK_EQUAL(pipeline.GetHeight(uint256(3), -1, true), 14);
+
+    std::vector<TestPipeline::Ref> vEntries = PopAllForCheck(pipeline);
+    BOOST_REQUIRE_EQUAL(vEntries.size(), 3U);
+    Check(vEntries[2]);
+    Check(vEntries[1]);
+    BOOST_CHECK_EQUAL(pipeline.CountChecked(), 2U);
+    BOOST_CHECK(!pipeline.HasBlockToConnect());
+    BOOST_CHECK(!pipeline.PopForConnect());
+
+    Check(vEntries[0]);
+    BOOST_CHECK(ConnectNext(pipeline) == uint256(1));
+    BOOST_CHECK(ConnectNext(pipeline) == uint256(2));
+    BOOST_CHECK(ConnectNext(pipeline) == uint256(3));
+    BOOST_CHECK(!pipeline.HasBlockToConnect());
+    BOOST_CHECK_EQUAL(pipeline.size(), 0U);
+}
+
+// The child of a block that fails its checks is not left behind in the pipeline
+BOOST_AUTO_TEST_CASE(blockpipeline_failed_parent)
+{
+    TestPipeline pipeline(MAX_BLOCK_PIPELINE_DEPTH);
+    const uint256 hashTip(100);
+    BOOST_CHECK(Receive(pipeline, uint256(1), hashTip, 10));
+    BOOST_CHECK(Receive(pipeline, uint256(2), uint256(1), -1));
+
+    std::vector<TestPipeline::Ref> vEntries = PopAllForCheck(pipeline);
+    BOOST_REQUIRE_EQUAL(vEntries.size(), 2U);
+    Check(vEntries[1]);
+    Check(vEntries[0], false);
+    BOOST_CHECK(ConnectNext(pipeline) == uint256(1));
+
+    // the child is still queued and takes its own children, it is rejected when it is connected
+    BOOST_CHECK(pipeline.Contains(uint256(2)));
+    BOOST_CHECK(Receive(pipeline, uint256(3), uint256(2), -1));
+    Check(pipeline.PopForCheck());
+    BOOST_CHECK(ConnectNext(pipeline) == uint256(2));
+    BOOST_CHECK(ConnectNext(pipeline) == uint256(3));
+    BOOST_CHECK_EQUAL(pipeline.size(), 0U);
+
+    // once the pipeline is done with them, a child of the failed block is processed directly
+    BOOST_CHECK(!Receive(pipeline, uint256(4), uint256(1), -1));
+}
+
+// A full pipeline only takes the children of its blocks, and the initial sync ending does not drop them either
+BOOST_AUTO_TEST_CASE(blockpipeline_full)
+{
+    TestPipeline pipeline(4);
+    const uint256 hashTip(100);
+    for (int i = 1; i <= 4; i++)
+        BOOST_CHECK(Receive(pipeline, uint256(i), hashTip, 10));
+    BOOST_CHECK(pipeline.IsFull());
+
+    // a block whose parent is in the index goes the direct way, one whose parent is queued cannot
+    BOOST_CHECK(!Receive(pipeline, uint256(5), hashTip, 10));
+    BOOST_CHECK(Receive(pipeline, uint256(6), uint256(1), -1));
+    BOOST_CHECK(Receive(pipeline, uint256(7), uint256(6), -1, false));
+    BOOST_CHECK(!Receive(pipeline, uint256(8), hashTip, 10, false));
+    BOOST_CHECK_EQUAL(pipeline.size(), 6U);
+
+    std::vector<TestPipeline::Ref> vEntries = PopAllForCheck(pipeline);
+    BOOST_REQUIRE_EQUAL(vEntries.size(), 6U);
+    for (unsigned int i = 0; i < vEntries.size(); i++)
+        Check(vEntries[i]);
+    for (int i = 0; i < 4; i++)
+        ConnectNext(pipeline);
+    BOOST_CHECK(pipeline.Contains(uint256(6)));
+    BOOST_CHECK(!pipeline.IsFull());
+    BOOST_CHECK(Receive(pipeline, uint256(5), hashTip, 10));
+    Check(pipeline.PopForCheck());
+    BOOST_CHECK(ConnectNext(pipeline) == uint256(5));
+    BOOST_CHECK(ConnectNext(pipeline) == uint256(6));
+    BOOST_CHECK(ConnectNext(pipeline) == uint256(7));
+    BOOST_CHECK_EQUAL(pipeline.size(), 0U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
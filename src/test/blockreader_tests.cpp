@@ -0,0 +1,68 @@
+// Copyright (c) 2017 The PIVX developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockreader.h"
+#include "chainparams.h"
+#include "clientversion.h"
+#include "main.h"
+#include "streams.h"
+
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(blockreader_tests)
+
+static std::vector<unsigned char> Serialized(const CBlock& block)
+{
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << block;
+    return std::vector<unsigned char>(ss.begin(), ss.end());
+}
+
+BOOST_AUTO_TEST_CASE(blockreader_span)
+{
+    // a file the chain does not use, the first block maps it at its current size
+    CBlock block = Params().GenesisBlock();
+    CDiskBlockPos posFirst(9, 0);
+    BOOST_CHECK(WriteBlockToDisk(block, posFirst));
+
+    CBlockSpan span;
+    BOOST_CHECK(ReadBlockSpan(posFirst, span));
+    std::vector<unsigned char> vch = Serialized(block);
+    BOOST_CHECK(std::vector<unsigned char>(span.begin(), span.end()) == vch);
+
+    // appending to the file makes the next read map it again
+    CBlock blockSecond = block;
+    blockSecond.vtx.push_back(CTransaction());
+    CDiskBlockPos posSecond(9, posFirst.nPos + vch.size());
+    BOOST_CHECK(WriteBlockToDisk(blockSecond, posSecond));
+
+    CBlockSpan spanSecond;
+    BOOST_CHECK(ReadBlockSpan(posSecond, spanSecond));
+    BOOST_CHECK(std::vector<unsigned char>(spanSecond.begin(), spanSecond.end()) == Serialized(blockSecond));
+
+    // the first span keeps its mapping even after the pool lets go of it
+    UnmapBlockFiles();
+    BOOST_CHECK(std::vector<unsigned char>(span.begin(), span.end()) == vch);
+
+    CBlock blockRead;
+    CSpanReader reader(spanSecond.begin(), spanSecond.size(), SER_DISK, CLIENT_VERSION);
+    reader >> blockRead;
+    BOOST_CHECK(reader.empty());
+    BOOST_CHECK(blockRead.GetHash() == blockSecond.GetHash());
+    BOOST_CHECK(ReadBlockFromDisk(blockRead, posFirst));
+    BOOST_CHECK(blockRead.GetHash() == block.GetHash());
+
+    // positions that are not the start of a block
+    BOOST_CHECK(!ReadBlockSpan(CDiskBlockPos(9, posFirst.nPos + 1), span));
+    BOOST_CHECK(!ReadBlockSpan(CDiskBlockPos(9, 4), span));
+    BOOST_CHECK(!ReadBlockSpan(CDiskBlockPos(10, 8), span));
+
+    // reading past the end of the span throws
+    CSpanReader readerShort(spanSecond.begin(), 10, SER_DISK, CLIENT_VERSION);
+    BOOST_CHECK_THROW(readerShort >> blockRead, std::ios_base::failure);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -2,8 +2,11 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include "chainparams.h"
 #include "coins.h"
+#include "hash.h"
 #include "random.h"
+#include "txdb.h"
 #include "uint256.h"
 
 #include <vector>
@@ -58,6 +61,53 @@ public:
 
     bool GetStats(CCoinsStats& stats) const { return false; }
 };
+
+class CCoinsViewCacheTest : public CCoinsViewCache
+{
+public:
+    CCoinsViewCacheTest(CCoinsView* base) : CCoinsViewCache(base) {}
+
+    void SelfTest() const
+    {
+        // Manually recompute the dynamic usage of the whole data, and compare it.
+        size_t ret = memusage::DynamicUsage(cacheCoins);
+        for (CCoinsMap::iterator it = cacheCoins.begin(); it != cacheCoins.end(); it++) {
+            ret += it->second.coins.DynamicMemoryUsage();
+        }
+        BOOST_CHECK_EQUAL(DynamicMemoryUsage(), ret);
+    }
+};
+
+class CCoinsViewDBTest : public CCoinsViewDB
+{
+public:
+    CCoinsViewDBTest() : CCoinsViewDB(1 << 20, true, true) {}
+
+    // Store coins the way versions before the per-output records did
+    void WriteLegacy(const uint256& txid, const CCoins& coins) { db.Write(std::make_pair('c', txid), coins); }
+};
+
+void WriteCoins(CCoinsView& view, const std::map<uint256, CCoins>& mapCoins)
+{
+    CCoinsViewCache cache(&view);
+    for (std::map<uint256, CCoins>::const_iterator it = mapCoins.begin(); it != mapCoins.end(); it++) {
+        CCoinsModifier coins = cache.ModifyCoins(it->first);
+        *coins = it->second;
+    }
+    cache.SetBestBlock(Params().HashGenesisBlock());
+    BOOST_CHECK(cache.Flush());
+}
+
+void CheckCoins(const CCoinsView& view, const std::map<uint256, CCoins>& mapCoins)
+{
+    for (std::map<uint256, CCoins>::const_iterator it = mapCoins.begin(); it != mapCoins.end(); it++) {
+        CCoins coins;
+        BOOST_CHECK_EQUAL(view.GetCoins(it->first, coins), !it->second.IsPruned());
+        BOOST_CHECK_EQUAL(view.HaveCoins(it->first), !it->second.IsPruned());
+        if (!it->second.IsPruned())
+            BOOST_CHECK(coins == it->second);
+    }
+}
 }
 
 BOOST_AUTO_TEST_SUITE(coins_tests)
@@ -89,8 +139,8 @@ BOOST_AUTO_TEST_CASE(coins_cache_simulation_test)
 
     // The cache stack.
     CCoinsViewTest base; // A CCoinsViewTest at the bottom.
-    std::vector<CCoinsViewCache*> stack; // A stack of CCoinsViewCaches on top.
-    stack.push_back(new CCoinsViewCache(&base)); // Start with one cache.
+    std::vector<CCoinsViewCacheTest*> stack; // A stack of CCoinsViewCaches on top.
+    stack.push_back(new CCoinsViewCacheTest(&base)); // Start with one cache.
 
     // Use a limited set of random transaction ids, so we do test overwriting entries.
     std::vector<uint256> txids;
@@ -115,6 +165,8 @@ BOOST_AUTO_TEST_CASE(coins_cache_simulation_test)
                 coins.nVersion = insecure_rand();
                 coins.vout.resize(1);
                 coins.vout[0].nValue = insecure_rand();
+                // scripts of varying size so that the memory accounting sees them
+                coins.vout[0].scriptPubKey.assign(insecure_rand() % 64, 0x51);
                 *entry = coins;
             } else {
                 coins.Clear();
@@ -135,6 +187,9 @@ BOOST_AUTO_TEST_CASE(coins_cache_simulation_test)
                     missed_an_entry = true;
                 }
             }
+            BOOST_FOREACH (const CCoinsViewCacheTest* test, stack) {
+                test->SelfTest();
+            }
         }
 
         if (insecure_rand() % 100 == 0) {
@@ -151,7 +206,7 @@ BOOST_AUTO_TEST_CASE(coins_cache_simulation_test)
                 } else {
                     removed_all_caches = true;
                 }
-                stack.push_back(new CCoinsViewCache(tip));
+                stack.push_back(new CCoinsViewCacheTest(tip));
                 if (stack.size() == 4) {
                     reached_4_caches = true;
                 }
@@ -175,4 +230,135 @@ BOOST_AUTO_TEST_CASE(coins_cache_simulation_test)
     BOOST_CHECK(missed_an_entry);
 }
 
+// The database keeps one record per unspent output, and reads back the coins that were written
+BOOST_AUTO_TEST_CASE(coins_db_outputs)
+{
+    std::map<uint256, CCoins> mapCoins;
+    for (int i = 0; i < 20; i++) {
+        CCoins& coins = mapCoins[GetRandHash()];
+        coins.nVersion = 1 + insecure_rand() % 2;
+        coins.nHeight = insecure_rand() % 1000000;
+        coins.fCoinBase = i == 0;
+        coins.fCoinStake = i == 1;
+        coins.vout.resize(1 + i % 5);
+        for (unsigned int n = 0; n < coins.vout.size(); n++) {
+            coins.vout[n].nValue = insecure_rand();
+            coins.vout[n].scriptPubKey.assign(1 + insecure_rand() % 40, 0);
+        }
+        // outputs of older transactions that are already spent
+        if (coins.vout.size() > 2)
+            coins.vout[1].SetNull();
+    }
+
+    CCoinsViewDBTest db;
+    WriteCoins(db, mapCoins);
+    CheckCoins(db, mapCoins);
+
+    // spend some outputs, and all of the first transaction
+    std::map<uint256, CCoins> mapSpent;
+    for (std::map<uint256, CCoins>::iterator it = mapCoins.begin(); it != mapCoins.end(); it++) {
+        if (it == mapCoins.begin()) {
+            for (unsigned int n = 0; n < it->second.vout.size(); n++)
+                it->second.Spend(n);
+        } else if (insecure_rand() % 2) {
+            it->second.Spend(insecure_rand() % it->second.vout.size());
+        } else {
+            continue;
+        }
+        mapSpent.insert(*it);
+    }
+    WriteCoins(db, mapSpent);
+    CheckCoins(db, mapCoins);
+    BOOST_CHECK(!db.HaveCoins(mapCoins.begin()->first));
+
+    // the stats hash the outputs per transaction, like they did when the records were per transaction,
+    // in the order of the database keys
+    std::map<std::string, std::pair<uint256, CCoins> > mapByKey;
+    for (std::map<uint256, CCoins>::const_iterator it = mapCoins.begin(); it != mapCoins.end(); it++) {
+        if (!it->second.IsPruned())
+            mapByKey[std::string(it->first.begin(), it->first.end())] = *it;
+    }
+    CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
+    ss << Params().HashGenesisBlock();
+    for (std::map<std::string, std::pair<uint256, CCoins> >::const_iterator it = mapByKey.begin(); it != mapByKey.end(); it++) {
+        const CCoins& coins = it->second.second;
+        ss << it->second.first << VARINT(coins.nVersion) << (coins.fCoinBase ? 'c' : 'n') << VARINT(coins.nHeight);
+        for (unsigned int n = 0; n < coins.vout.size(); n++) {
+            if (!coins.vout[n].IsNull())
+                ss << VARINT(n + 1) << coins.vout[n];
+        }
+        ss << VARINT(0);
+    }
+    CCoinsStats stats;
+    BOOST_CHECK(db.GetStats(stats));
+    BOOST_CHECK(stats.hashSerialized == ss.GetHash());
+    BOOST_CHECK_EQUAL(stats.nTransactions, mapByKey.size());
+
+    // a database with the records of older versions is converted in place
+    CCoinsViewDBTest dbLegacy;
+    for (std::map<uint256, CCoins>::const_iterator it = mapCoins.begin(); it != mapCoins.end(); it++) {
+        if (!it->second.IsPruned())
+            dbLegacy.WriteLegacy(it->first, it->second);
+    }
+    WriteCoins(dbLegacy, std::map<uint256, CCoins>()); // only sets the best block
+    BOOST_CHECK(dbLegacy.Upgrade());
+    CheckCoins(dbLegacy, mapCoins);
+    CCoinsStats statsLegacy;
+    BOOST_CHECK(dbLegacy.GetStats(statsLegacy));
+    BOOST_CHECK(statsLegacy.hashSerialized == stats.hashSerialized);
+    BOOST_CHECK_EQUAL(statsLegacy.nTransactionOutputs, stats.nTransactionOutputs);
+    BOOST_CHECK_EQUAL(statsLegacy.nSerializedSize, stats.nSerializedSize);
+    BOOST_CHECK(dbLegacy.Upgrade());
+}
+
+// Output indexes whose VARINT encoding would not sort in output order, like 16511 and 16512
+BOOST_AUTO_TEST_CASE(coins_db_large_index)
+{
+    std::map<uint256, CCoins> mapCoins;
+    CCoins& coins = mapCoins[GetRandHash()];
+    coins.nVersion = 1;
+    coins.nHeight = 100;
+    coins.vout.resize(20000);
+    const unsigned int vIndex[] = {0, 127, 128, 255, 256, 16511, 16512, 16513, 19999};
+    for (unsigned int i = 0; i < sizeof(vIndex) / sizeof(vIndex[0]); i++) {
+        coins.vout[vIndex[i]].nValue = 1 + i;
+        coins.vout[vIndex[i]].scriptPubKey.assign(1 + i, 0);
+    }
+
+    CCoinsViewDBTest db;
+    WriteCoins(db, mapCoins);
+    CheckCoins(db, mapCoins);
+
+    // spending one output leaves the records of the others
+    CTxOut txoutSpent = coins.vout[16512];
+    coins.Spend(16512);
+    WriteCoins(db, mapCoins);
+    CheckCoins(db, mapCoins);
+    coins.Spend(19999);
+    WriteCoins(db, mapCoins);
+    CheckCoins(db, mapCoins);
+
+    // a disconnected block puts a spent output back
+    coins.vout[16512] = txoutSpent;
+    WriteCoins(db, mapCoins);
+    CheckCoins(db, mapCoins);
+    coins.Spend(16512);
+    WriteCoins(db, mapCoins);
+    CheckCoins(db, mapCoins);
+
+    CCoinsStats stats;
+    BOOST_CHECK(db.GetStats(stats));
+    BOOST_CHECK_EQUAL(stats.nTransactions, 1U);
+    BOOST_CHECK_EQUAL(stats.nTransactionOutputs, 7U);
+
+    CCoinsViewDBTest dbLegacy;
+    dbLegacy.WriteLegacy(mapCoins.begin()->first, coins);
+    WriteCoins(dbLegacy, std::map<uint256, CCoins>()); // only sets the best block
+    BOOST_CHECK(dbLegacy.Upgrade());
+    CheckCoins(dbLegacy, mapCoins);
+    CCoinsStats statsLegacy;
+    BOOST_CHECK(dbLegacy.GetStats(statsLegacy));
+    BOOST_CHECK(statsLegacy.hashSerialized == stats.hashSerialized);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
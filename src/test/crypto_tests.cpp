@@ -9,6 +9,7 @@
 #include "crypto/sha512.h"
 #include "crypto/hmac_sha256.h"
 #include "crypto/hmac_sha512.h"
+#include "hash.h"
 #include "random.h"
 #include "utilstrencodings.h"
 
@@ -131,6 +132,48 @@ BOOST_AUTO_TEST_CASE(sha256_testvectors) {
     TestSHA256(test1, "a316d55510b49662420f49d145d42fb83f31ef8dc016aa4e32df049991a91e26");
 }
 
+void TestSHA256DBatch(const std::string &in, size_t nCount, const std::string &hexout) {
+    std::string strIn;
+    for (size_t i = 0; i < nCount; i++)
+        strIn += in;
+    std::vector<unsigned char> out(32 * nCount);
+    SHA256DBatch(out.data(), (const unsigned char*)strIn.data(), in.size(), nCount);
+    std::vector<unsigned char> hash = ParseHex(hexout);
+    for (size_t i = 0; i < nCount; i++)
+        BOOST_CHECK(std::equal(hash.begin(), hash.end(), out.begin() + 32 * i));
+}
+
+BOOST_AUTO_TEST_CASE(sha256_selftest) {
+    // the implementations detected for this machine, see test_pivx.cpp
+    BOOST_CHECK(SHA256SelfTest());
+}
+
+BOOST_AUTO_TEST_CASE(sha256d_batch_testvectors) {
+    // Counts below, at and above the lane width of every implementation
+    for (size_t nCount = 1; nCount <= 17; nCount += 4) {
+        TestSHA256DBatch("", nCount, "5df6e0e2761359d30a8275058e299fcc0381534545f55cf43e41983f5d4c9456");
+        TestSHA256DBatch("abc", nCount, "4f8b42c22dd3729b519ba6f68d2da7cc5b2d606d05daed5ad5128cc03e6c6358");
+    }
+    std::string str64;
+    for (int i = 0; i < 64; i++)
+        str64 += (char)i;
+    TestSHA256DBatch(str64, 9, "01c9f464780a1b6af4eb400fe2f2896cfb2169f5a65701439e4c2c4e213903ef");
+
+    // Distinct random messages on both sides of the padding boundaries against CHash256
+    static const size_t vLen[] = {32, 52, 55, 56, 63, 64, 65, 80, 120, 128};
+    for (size_t nLen : vLen) {
+        for (size_t nCount = 0; nCount <= 19; nCount++) {
+            std::vector<unsigned char> in(nLen * nCount + 1);
+            GetRandBytes(in.data(), in.size());
+            std::vector<unsigned char> out(32 * nCount + 1), expected(32 * nCount + 1);
+            SHA256DBatch(out.data(), in.data(), nLen, nCount);
+            for (size_t i = 0; i < nCount; i++)
+                CHash256().Write(&in[i * nLen], nLen).Finalize(&expected[i * 32]);
+            BOOST_CHECK(std::equal(expected.begin(), expected.begin() + 32 * nCount, out.begin()));
+        }
+    }
+}
+
 BOOST_AUTO_TEST_CASE(sha512_testvectors) {
     TestSHA512("",
                "cf83e1357eefb8bdf1542850d66d8007d620e4050b5715dc83f4a921d36ce9ce"
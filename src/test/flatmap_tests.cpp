@@ -0,0 +1,101 @@
+// Copyright (c) 2017 The PIVX developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "flatmap.h"
+
+#include "random.h"
+
+#include <map>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+namespace
+{
+// A poor hash so that keys share groups and control bytes
+struct CollidingHasher {
+    size_t operator()(int n) const { return (size_t)(n % 64) * 0x9e3779b9; }
+};
+
+typedef flatmap<int, std::vector<int>, CollidingHasher> TestMap;
+
+void CheckEqual(const TestMap& map, const std::map<int, std::vector<int> >& expected)
+{
+    BOOST_CHECK_EQUAL(map.size(), expected.size());
+    size_t nCount = 0;
+    for (TestMap::const_iterator it = map.begin(); it != map.end(); ++it) {
+        std::map<int, std::vector<int> >::const_iterator itExpected = expected.find(it->first);
+        BOOST_CHECK(itExpected != expected.end() && itExpected->second == it->second);
+        nCount++;
+    }
+    BOOST_CHECK_EQUAL(nCount, expected.size());
+}
+}
+
+BOOST_AUTO_TEST_SUITE(flatmap_tests)
+
+// Random inserts, lookups and erases behave like a std::map
+BOOST_AUTO_TEST_CASE(flatmap_like_map)
+{
+    TestMap map;
+    std::map<int, std::vector<int> > expected;
+
+    for (int i = 0; i < 100000; i++) {
+        int n = insecure_rand() % 2000;
+        switch (insecure_rand() % 4) {
+        case 0:
+        case 1: {
+            std::vector<int> v(1 + n % 3, n);
+            BOOST_CHECK_EQUAL(map.insert(std::make_pair(n, v)).second, expected.insert(std::make_pair(n, v)).second);
+            break;
+        }
+        case 2:
+            BOOST_CHECK_EQUAL(map.erase(n), expected.erase(n));
+            break;
+        case 3:
+            BOOST_CHECK_EQUAL(map.count(n), expected.count(n));
+            break;
+        }
+        if (i % 10000 == 0)
+            CheckEqual(map, expected);
+    }
+    CheckEqual(map, expected);
+
+    map.clear();
+    BOOST_CHECK(map.empty());
+    BOOST_CHECK(map.begin() == map.end());
+    BOOST_CHECK_EQUAL(map.bucket_count(), 0U);
+    BOOST_CHECK_EQUAL(map.node_bytes(), 0U);
+    BOOST_CHECK(map.find(1) == map.end());
+}
+
+// Entries stay where they are while the table grows, and can be erased while iterating
+BOOST_AUTO_TEST_CASE(flatmap_stable_entries)
+{
+    TestMap map;
+    std::vector<int>* pFirst = &map[0];
+    pFirst->push_back(42);
+    for (int i = 1; i < 5000; i++)
+        map[i].push_back(i);
+    BOOST_CHECK(&map.find(0)->second == pFirst);
+    BOOST_CHECK_EQUAL(map[0].size(), 1U);
+    BOOST_CHECK(map.bucket_count() >= 5000);
+
+    for (TestMap::iterator it = map.begin(); it != map.end();) {
+        TestMap::iterator itOld = it++;
+        if (itOld->first % 2)
+            map.erase(itOld);
+    }
+    BOOST_CHECK_EQUAL(map.size(), 2500U);
+    BOOST_CHECK(&map.find(0)->second == pFirst);
+
+    // erased entries are reused before the arena grows
+    size_t nBytes = map.node_bytes();
+    for (int i = 1; i < 5000; i += 2)
+        map[i];
+    BOOST_CHECK_EQUAL(map.node_bytes(), nBytes);
+    BOOST_CHECK_EQUAL(map.size(), 5000U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
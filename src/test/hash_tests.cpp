@@ -2,6 +2,7 @@
 // Distributed under the MIT/X11 software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include "crypto/quark.h"
 #include "hash.h"
 #include "utilstrencodings.h"
 
@@ -46,4 +47,28 @@ BOOST_AUTO_TEST_CASE(murmurhash3)
 #undef T
 }
 
+BOOST_AUTO_TEST_CASE(quark_testvectors)
+{
+    BOOST_CHECK(QuarkSelfTest());
+
+    // message bytes i * 7 + 3, covering an empty input, a block header and inputs over 128 bytes
+    vector<unsigned char> in(200);
+    for (size_t i = 0; i < in.size(); i++)
+        in[i] = i * 7 + 3;
+
+#define T(len, expected) BOOST_CHECK_EQUAL(HashQuark(in.begin(), in.begin() + len).GetHex(), expected)
+
+    T(0, "9c7d513ab01c44694f7bc7c6a7e269a3eced7b2be24d8663835bf35a3bf10008");
+    T(1, "9af0dde6b751ee3d91d401b94c3673c02c09652ac35c666e8e53daf2cd1ece73");
+    T(64, "41f43a74f686c8a0e8813a4994174c738948eb9adbf93d3fc751a7f427faf11d");
+    T(80, "47b15e83e605b6536f0fa6be033b1b3aced4d82acc8e12615a12d1b35151b07d");
+    T(140, "feaabcb38edd9f934d29129666ee4a9f2144f3f2d0b66c5976720622aa7c19f7");
+    T(200, "aa0e90be0dfddba61aa96188a1f429c25b137c37021a8eb71f0ebb8f57a1f610");
+
+#undef T
+
+    string fox = "The quick brown fox jumps over the lazy dog";
+    BOOST_CHECK_EQUAL(HashQuark(fox.begin(), fox.end()).GetHex(), "a51361c415e83def5c7c39e9ebc72913edb970a52403c91c04e2c9e96fceec70");
+}
+
 BOOST_AUTO_TEST_SUITE_END()
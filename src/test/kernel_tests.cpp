@@ -0,0 +1,168 @@
+// Copyright (c) 2017 The PIVX developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "kernel.h"
+#include "random.h"
+#include "streams.h"
+#include "uint256.h"
+
+#include <list>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(kernel_tests)
+
+// The search of CheckStakeKernelHash, one candidate after the other and the latest time first
+static bool FindStakeKernelSerial(const std::vector<CStakeCandidate>& vCandidates, unsigned int nBits, unsigned int& nTimeTx, unsigned int nHashDrift, unsigned int nTimeMin, size_t& nIndexFound, uint256& hashProofOfStake)
+{
+    uint256 bnTargetPerCoinDay;
+    bnTargetPerCoinDay.SetCompact(nBits);
+    for (size_t n = 0; n < vCandidates.size(); n++) {
+        const CStakeCandidate& candidate = vCandidates[n];
+        CDataStream ss(SER_GETHASH, 0);
+        ss << candidate.nStakeModifier;
+        for (unsigned int i = 0; i < nHashDrift; i++) {
+            unsigned int nTryTime = nTimeTx + nHashDrift - i;
+            if (nTryTime <= nTimeMin)
+                break;
+            uint256 hash = stakeHash(nTryTime, ss, candidate.prevout.n, candidate.prevout.hash, candidate.nTimeBlockFrom);
+            if (stakeTargetHit(hash, candidate.nValueIn, bnTargetPerCoinDay)) {
+                nIndexFound = n;
+                nTimeTx = nTryTime;
+                hashProofOfStake = hash;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+BOOST_AUTO_TEST_CASE(find_stake_kernel_matches_serial)
+{
+    // about one hash in 2000 meets the target for a weight of one
+    uint256 bnTarget = ~uint256(0) / uint256(2000);
+    unsigned int nBits = bnTarget.GetCompact();
+    const unsigned int nHashDrift = 45;
+    int nFound = 0;
+
+    for (int nTest = 0; nTest < 60; nTest++) {
+        std::vector<CStakeCandidate> vCandidates(1 + insecure_rand() % 40);
+        for (size_t n = 0; n < vCandidates.size(); n++) {
+            vCandidates[n].prevout = COutPoint(GetRandHash(), insecure_rand() % 4);
+            vCandidates[n].nValueIn = 100 + insecure_rand() % 900;
+            vCandidates[n].nTimeBlockFrom = 1500000000 + insecure_rand() % 100000;
+            vCandidates[n].nStakeModifier = ((uint64_t)insecure_rand() << 32) | insecure_rand();
+        }
+        unsigned int nTimeTx = 1510000000;
+        // some searches may only use the later part of the window
+        unsigned int nTimeMin = nTest % 3 == 0 ? nTimeTx + insecure_rand() % nHashDrift : 0;
+
+        unsigned int nTimeSerial = nTimeTx;
+        size_t nIndexSerial = 0;
+        uint256 hashSerial;
+        bool fSerial = FindStakeKernelSerial(vCandidates, nBits, nTimeSerial, nHashDrift, nTimeMin, nIndexSerial, hashSerial);
+        nFound += fSerial;
+
+        for (int nThreads = 1; nThreads <= 4; nThreads *= 2) {
+            unsigned int nTimeFound = nTimeTx;
+            size_t nIndexFound = 0;
+            uint256 hashFound;
+            BOOST_CHECK_EQUAL(FindStakeKernel(vCandidates, nBits, nTimeFound, nHashDrift, nTimeMin, nThreads, nIndexFound, hashFound), fSerial);
+            if (fSerial) {
+                BOOST_CHECK_EQUAL(nIndexFound, nIndexSerial);
+                BOOST_CHECK_EQUAL(nTimeFound, nTimeSerial);
+                BOOST_CHECK(hashFound == hashSerial);
+            }
+        }
+    }
+    // both outcomes were covered
+    BOOST_CHECK(nFound > 0 && nFound < 60);
+}
+
+// The walk of GetKernelStakeModifier without its cache
+static uint64_t KernelStakeModifierUncached(const CBlockIndex* pindexFrom, int& nStakeModifierHeight)
+{
+    int64_t nSelectionInterval = 0;
+    for (int nSection = 0; nSection < 64; nSection++)
+        nSelectionInterval += getIntervalVersion(false) * 63 / (63 + ((63 - nSection) * (MODIFIER_INTERVAL_RATIO - 1)));
+
+    nStakeModifierHeight = pindexFrom->nHeight;
+    int64_t nStakeModifierTime = pindexFrom->GetBlockTime();
+    const CBlockIndex* pindex = pindexFrom;
+    while (nStakeModifierTime < pindexFrom->GetBlockTime() + nSelectionInterval) {
+        pindex = chainActive.Next(pindex);
+        if (pindex->GeneratedStakeModifier()) {
+            nStakeModifierHeight = pindex->nHeight;
+            nStakeModifierTime = pindex->GetBlockTime();
+        }
+    }
+    return pindex->nStakeModifier;
+}
+
+static CBlockIndex* AppendBlock(std::list<CBlockIndex>& listBlocks, CBlockIndex* pindexPrev)
+{
+    listBlocks.emplace_back();
+    CBlockIndex* pindex = &listBlocks.back();
+    pindex->pprev = pindexPrev;
+    pindex->nHeight = pindexPrev->nHeight + 1;
+    pindex->nTime = pindexPrev->nTime + 60;
+    pindex->SetStakeModifier(((uint64_t)insecure_rand() << 32) | insecure_rand(), insecure_rand() % 4 == 0);
+    BlockMap::iterator mi = mapBlockIndex.insert(std::make_pair(GetRandHash(), pindex)).first;
+    pindex->phashBlock = &mi->first;
+    return pindex;
+}
+
+static void CheckKernelStakeModifier(const CBlockIndex* pindexFrom, uint64_t& nStakeModifier)
+{
+    int nStakeModifierHeight = 0;
+    int64_t nStakeModifierTime = 0;
+    BOOST_CHECK(GetKernelStakeModifier(pindexFrom->GetBlockHash(), nStakeModifier, nStakeModifierHeight, nStakeModifierTime, false));
+
+    int nHeightUncached = 0;
+    BOOST_CHECK_EQUAL(nStakeModifier, KernelStakeModifierUncached(pindexFrom, nHeightUncached));
+    BOOST_CHECK_EQUAL(nStakeModifierHeight, nHeightUncached);
+}
+
+BOOST_AUTO_TEST_CASE(kernel_stake_modifier_cache_reorg)
+{
+    LOCK(cs_main);
+    CBlockIndex* pindexGenesis = chainActive.Tip();
+    std::list<CBlockIndex> listBlocks;
+
+    // chain A, and chain B forking off A a few blocks after the kernel's block
+    std::vector<CBlockIndex*> vChainA(1, pindexGenesis);
+    for (int i = 0; i < 150; i++)
+        vChainA.push_back(AppendBlock(listBlocks, vChainA.back()));
+    CBlockIndex* pindexTipB = vChainA[15];
+    for (int i = 0; i < 150; i++)
+        pindexTipB = AppendBlock(listBlocks, pindexTipB);
+
+    const CBlockIndex* pindexFrom = vChainA[10];
+    const CBlockIndex* pindexFromDeep = vChainA[5];
+    uint64_t nModifierA, nModifierB, nModifier;
+
+    chainActive.SetTip(vChainA.back());
+    CheckKernelStakeModifier(pindexFrom, nModifierA);
+    CheckKernelStakeModifier(pindexFrom, nModifier);
+    BOOST_CHECK_EQUAL(nModifier, nModifierA);
+
+    // the cached walk of A ended after the fork and must not be used on B
+    chainActive.SetTip(pindexTipB);
+    CheckKernelStakeModifier(pindexFrom, nModifierB);
+    BOOST_CHECK(nModifierB != nModifierA);
+    CheckKernelStakeModifier(pindexFromDeep, nModifier);
+
+    // and back
+    chainActive.SetTip(vChainA.back());
+    CheckKernelStakeModifier(pindexFrom, nModifier);
+    BOOST_CHECK_EQUAL(nModifier, nModifierA);
+    CheckKernelStakeModifier(pindexFromDeep, nModifier);
+
+    chainActive.SetTip(pindexGenesis);
+    for (const CBlockIndex& block : listBlocks)
+        mapBlockIndex.erase(block.GetBlockHash());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -23,6 +23,7 @@
 #include "libzerocoin/Coin.h"
 #include "libzerocoin/CoinSpend.h"
 #include "libzerocoin/Accumulator.h"
+#include "libzerocoin/MultiExp.h"
 
 using namespace std;
 using namespace libzerocoin;
@@ -196,6 +197,37 @@ Test_ParamGen()
 	return result;
 }
 
+bool
+Test_ParamSerialization()
+{
+	try {
+		// Parameters read back from disk must match the derived ones
+		CDataStream ss(SER_DISK, PROTOCOL_VERSION);
+		ss << *g_Params;
+		ZerocoinParams loadedParams;
+		ss >> loadedParams;
+		loadedParams.accumulatorParams.Precompute();
+		loadedParams.Precompute();
+
+		if (!loadedParams.initialized || !loadedParams.accumulatorParams.initialized ||
+			loadedParams.accumulatorParams.accumulatorModulus != g_Params->accumulatorParams.accumulatorModulus ||
+			loadedParams.accumulatorParams.accumulatorBase != g_Params->accumulatorParams.accumulatorBase ||
+			loadedParams.coinCommitmentGroup.modulus != g_Params->coinCommitmentGroup.modulus ||
+			loadedParams.coinCommitmentGroup.g != g_Params->coinCommitmentGroup.g ||
+			loadedParams.serialNumberSoKCommitmentGroup.h != g_Params->serialNumberSoKCommitmentGroup.h ||
+			loadedParams.zkp_iterations != g_Params->zkp_iterations) {
+			return false;
+		}
+
+		// and mint valid coins
+		PrivateCoin coin(&loadedParams, libzerocoin::CoinDenomination::ZQ_ONE);
+		return coin.getPublicCoin().validate();
+	} catch (runtime_error &e) {
+		cout << e.what() << endl;
+		return false;
+	}
+}
+
 bool
 Test_Accumulator()
 {
@@ -315,6 +347,43 @@ Test_EqualityPoK()
 	return true;
 }
 
+bool
+Test_MultiExp()
+{
+	// Compare the multi-exponentiation against plain pow_mod on random
+	// positive, negative, zero and oversized exponents
+	const AccumulatorAndProofParams& p = g_Params->accumulatorParams;
+	std::shared_ptr<const AccumulatorPoKPrecomputation> pre = p.GetPrecomputation();
+	const CBigNum& N = p.accumulatorModulus;
+
+	try {
+		for (uint32_t i = 0; i < 20; i++) {
+			CBigNum base = CBigNum::randBignum(N);
+			CBigNum e1 = CBigNum::RandKBitBigum(pre->g_n.getMaxBits() - i);
+			CBigNum e2 = CBigNum::RandKBitBigum(64 * (i + 1));
+			CBigNum e3 = CBigNum::RandKBitBigum(pre->h_n.getMaxBits() + 64);
+			if (i % 2)
+				e1 = 0 - e1;
+			if (i % 3)
+				e2 = 0 - e2;
+
+			CBigNum expected = p.accumulatorQRNCommitmentGroup.g.pow_mod(e1, N).mul_mod(base.pow_mod(e2, N), N).mul_mod(p.accumulatorQRNCommitmentGroup.h.pow_mod(e3, N), N);
+			if (MultiExp(pre->qrnModulus).add(pre->g_n, e1).add(base, e2).add(pre->h_n, e3).eval() != expected)
+				return false;
+
+			if (pre->sg.pow_mod(e2) != p.accumulatorPoKCommitmentGroup.g.pow_mod(e2, p.accumulatorPoKCommitmentGroup.modulus))
+				return false;
+
+			if (!MultiExp(pre->qrnModulus).add(base, 0).eval().isOne())
+				return false;
+		}
+	} catch (runtime_error &e) {
+		return false;
+	}
+
+	return true;
+}
+
 bool
 Test_MintCoin()
 {
@@ -458,6 +527,8 @@ Test_RunAllTests()
 	LogTestResult("parameter sizes are correct", Test_CalcParamSizes);
 	LogTestResult("group/field parameters can be generated", Test_GenerateGroupParams);
 	LogTestResult("parameter generation is correct", Test_ParamGen);
+	LogTestResult("parameters survive serialization", Test_ParamSerialization);
+	LogTestResult("multi-exponentiation matches pow_mod", Test_MultiExp);
 	LogTestResult("coins can be minted", Test_MintCoin);
 	LogTestResult("invalid coins will be rejected", Test_InvalidCoin);
 	LogTestResult("the accumulator works", Test_Accumulator);
@@ -4,6 +4,8 @@
 
 #define BOOST_TEST_MODULE Pivx Test Suite
 
+#include "crypto/quark.h"
+#include "crypto/sha256.h"
 #include "main.h"
 #include "random.h"
 #include "txdb.h"
@@ -31,6 +33,8 @@ struct TestingSetup {
 
     TestingSetup() {
         SetupEnvironment();
+        SHA256AutoDetect();
+        QuarkAutoDetect();
         fPrintToDebugLog = false; // don't want to write to debug.log file
         fCheckBlockIndex = true;
         SelectParams(CBaseChainParams::UNITTEST);
@@ -41,6 +45,15 @@ struct TestingSetup {
         pathTemp = GetTempPath() / strprintf("test_pivx_%lu_%i", (unsigned long)GetTime(), (int)(GetRand(100000)));
         boost::filesystem::create_directories(pathTemp);
         mapArgs["-datadir"] = pathTemp.string();
+        // the zerocoin parameters are the same on every run, derive them only on the first one. The cache
+        // is kept in the user's own data directory, another user could plant it in a shared temp directory
+        try {
+            boost::filesystem::path pathZerocoinParams = GetDefaultDataDir() / "testcache";
+            boost::filesystem::create_directories(pathZerocoinParams);
+            mapArgs["-zerocoinparamsdir"] = pathZerocoinParams.string();
+        } catch (const boost::filesystem::filesystem_error&) {
+            // derive them in the temporary datadir
+        }
         pblocktree = new CBlockTreeDB(1 << 20, true);
         pcoinsdbview = new CCoinsViewDB(1 << 23, true);
         pcoinsTip = new CCoinsViewCache(pcoinsdbview);
@@ -52,8 +65,10 @@ struct TestingSetup {
         RegisterValidationInterface(pwalletMain);
 #endif
         nScriptCheckThreads = 3;
-        for (int i=0; i < nScriptCheckThreads-1; i++)
+        for (int i=0; i < nScriptCheckThreads-1; i++) {
             threadGroup.create_thread(&ThreadScriptCheck);
+            threadGroup.create_thread(&ThreadZerocoinSpendCheck);
+        }
         RegisterNodeSignals(GetNodeSignals());
     }
     ~TestingSetup()
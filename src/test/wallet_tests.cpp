@@ -4,6 +4,9 @@
 
 #include "wallet.h"
 
+#include "chainparams.h"
+#include "random.h"
+
 #include <set>
 #include <stdint.h>
 #include <utility>
@@ -305,4 +308,125 @@ BOOST_AUTO_TEST_CASE(coin_selection_tests)
     empty_wallet();
 }
 
+// The encryption steps of EncryptWallet, without the passphrase derivation and the key pool
+class CMintPoolTestWallet : public CWallet
+{
+public:
+    bool EncryptWithKey(CKeyingMaterial& vMasterKeyIn)
+    {
+        LOCK(cs_wallet);
+        return EncryptKeys(vMasterKeyIn) && EncryptMintPool(vMasterKeyIn);
+    }
+
+    bool UnlockWithKey(const CKeyingMaterial& vMasterKeyIn)
+    {
+        return CCryptoKeyStore::Unlock(vMasterKeyIn);
+    }
+};
+
+static void CheckSameCoin(const libzerocoin::PrivateCoin& coin, const libzerocoin::PrivateCoin& coinTaken)
+{
+    BOOST_CHECK(coinTaken.getPublicCoin().getValue() == coin.getPublicCoin().getValue());
+    BOOST_CHECK(coinTaken.getPublicCoin().getDenomination() == coin.getPublicCoin().getDenomination());
+    BOOST_CHECK(coinTaken.getSerialNumber() == coin.getSerialNumber());
+    BOOST_CHECK(coinTaken.getRandomness() == coin.getRandomness());
+}
+
+static CMintPoolEntry MintPoolEntry(const CBigNum& bnPubcoin, const std::vector<unsigned char>& vchSecret)
+{
+    CMintPoolEntry entry;
+    entry.denom = libzerocoin::ZQ_ONE;
+    entry.bnPubcoin = bnPubcoin;
+    entry.vchSecret = vchSecret;
+    return entry;
+}
+
+BOOST_AUTO_TEST_CASE(mint_pool_tests)
+{
+    libzerocoin::ZerocoinParams* params = Params().Zerocoin_Params();
+    libzerocoin::PrivateCoin coin(params, libzerocoin::ZQ_ONE);
+    libzerocoin::PrivateCoin coinTaken(params, libzerocoin::ZQ_ONE, false);
+
+    CWallet walletPool;
+    BOOST_CHECK(walletPool.GetMintPoolDenominationToFill(1) == libzerocoin::ZQ_ONE);
+    BOOST_CHECK(walletPool.AddToMintPool(coin));
+    BOOST_CHECK(walletPool.GetMintPoolDenominationToFill(1) != libzerocoin::ZQ_ONE);
+
+    BOOST_CHECK(!walletPool.TakeFromMintPool(libzerocoin::ZQ_FIVE, coinTaken));
+    BOOST_CHECK(walletPool.TakeFromMintPool(libzerocoin::ZQ_ONE, coinTaken));
+    CheckSameCoin(coin, coinTaken);
+    BOOST_CHECK(!walletPool.TakeFromMintPool(libzerocoin::ZQ_ONE, coinTaken));
+}
+
+BOOST_AUTO_TEST_CASE(mint_pool_encrypted_tests)
+{
+    libzerocoin::ZerocoinParams* params = Params().Zerocoin_Params();
+    libzerocoin::PrivateCoin coinPlain(params, libzerocoin::ZQ_ONE);
+    libzerocoin::PrivateCoin coinCrypted(params, libzerocoin::ZQ_ONE);
+    libzerocoin::PrivateCoin coinTaken(params, libzerocoin::ZQ_ONE, false);
+
+    // unlocking checks the master key against a key
+    CMintPoolTestWallet walletPool;
+    {
+        LOCK(walletPool.cs_wallet);
+        CKey key;
+        key.MakeNewKey(true);
+        BOOST_CHECK(walletPool.AddKeyPubKey(key, key.GetPubKey()));
+    }
+    BOOST_CHECK(walletPool.AddToMintPool(coinPlain));
+
+    // EncryptMintPool encrypts the entries added before, the wallet is locked afterwards
+    CKeyingMaterial vMasterKey(WALLET_CRYPTO_KEY_SIZE);
+    GetRandBytes(&vMasterKey[0], WALLET_CRYPTO_KEY_SIZE);
+    BOOST_CHECK(walletPool.EncryptWithKey(vMasterKey));
+    {
+        LOCK(walletPool.cs_wallet);
+        const CMintPoolEntry& entry = walletPool.mapMintPool[libzerocoin::ZQ_ONE].front();
+        CDataStream ss(SER_DISK, CLIENT_VERSION);
+        ss << coinPlain.getRandomness() << coinPlain.getSerialNumber();
+        BOOST_CHECK(entry.fCrypted);
+        BOOST_CHECK(entry.vchSecret != std::vector<unsigned char>(ss.begin(), ss.end()));
+    }
+    BOOST_CHECK(walletPool.IsLocked());
+
+    // nothing goes in or out while locked
+    BOOST_CHECK(walletPool.GetMintPoolDenominationToFill(2) == libzerocoin::ZQ_ERROR);
+    BOOST_CHECK(!walletPool.AddToMintPool(coinCrypted));
+    BOOST_CHECK(!walletPool.TakeFromMintPool(libzerocoin::ZQ_ONE, coinTaken));
+    BOOST_CHECK_EQUAL(walletPool.mapMintPool[libzerocoin::ZQ_ONE].size(), 1);
+
+    BOOST_CHECK(walletPool.UnlockWithKey(vMasterKey));
+    BOOST_CHECK(walletPool.AddToMintPool(coinCrypted));
+    BOOST_CHECK(walletPool.mapMintPool[libzerocoin::ZQ_ONE].back().fCrypted);
+
+    BOOST_CHECK(walletPool.TakeFromMintPool(libzerocoin::ZQ_ONE, coinTaken));
+    CheckSameCoin(coinPlain, coinTaken);
+    BOOST_CHECK(walletPool.TakeFromMintPool(libzerocoin::ZQ_ONE, coinTaken));
+    CheckSameCoin(coinCrypted, coinTaken);
+    BOOST_CHECK(!walletPool.TakeFromMintPool(libzerocoin::ZQ_ONE, coinTaken));
+}
+
+BOOST_AUTO_TEST_CASE(mint_pool_bad_entry_tests)
+{
+    libzerocoin::ZerocoinParams* params = Params().Zerocoin_Params();
+    libzerocoin::PrivateCoin coin(params, libzerocoin::ZQ_ONE);
+    libzerocoin::PrivateCoin coinOther(params, libzerocoin::ZQ_ONE);
+    libzerocoin::PrivateCoin coinTaken(params, libzerocoin::ZQ_ONE, false);
+
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << coin.getRandomness() << coin.getSerialNumber();
+    std::vector<unsigned char> vchSecret(ss.begin(), ss.end());
+
+    // empty, unreadable and not matching the pubcoin, all are dropped on the way to the good one
+    CWallet walletPool;
+    walletPool.LoadMintPoolEntry(MintPoolEntry(coin.getPublicCoin().getValue(), std::vector<unsigned char>()));
+    walletPool.LoadMintPoolEntry(MintPoolEntry(coin.getPublicCoin().getValue(), std::vector<unsigned char>(3, 1)));
+    walletPool.LoadMintPoolEntry(MintPoolEntry(coinOther.getPublicCoin().getValue(), vchSecret));
+    walletPool.LoadMintPoolEntry(MintPoolEntry(coin.getPublicCoin().getValue(), vchSecret));
+
+    BOOST_CHECK(walletPool.TakeFromMintPool(libzerocoin::ZQ_ONE, coinTaken));
+    CheckSameCoin(coin, coinTaken);
+    BOOST_CHECK(walletPool.mapMintPool[libzerocoin::ZQ_ONE].empty());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
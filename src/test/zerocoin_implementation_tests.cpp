@@ -3,10 +3,12 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "libzerocoin/Denominations.h"
+#include "accumulatormap.h"
 #include "amount.h"
 #include "chainparams.h"
 #include "main.h"
 #include "txdb.h"
+#include "zerocoincache.h"
 #include <boost/test/unit_test.hpp>
 #include <iostream>
 #include <accumulators.h>
@@ -181,6 +183,19 @@ BOOST_AUTO_TEST_CASE(checkzerocoinspend_test)
     PublicCoin pubCoin(Params().Zerocoin_Params(), bnpubcoin, CoinDenomination::ZQ_ONE);
     BOOST_CHECK_MESSAGE(pubCoin.validate(), "Failed to validate pubCoin created from hex string");
 
+    //the second validation of the same pubcoin is answered by the pubcoin cache, the cache is global
+    //and earlier tests validated rawTxpub1, so use a freshly minted coin
+    PublicCoin pubCoinFresh = PrivateCoin(Params().Zerocoin_Params(), CoinDenomination::ZQ_ONE).getPublicCoin();
+    CZerocoinCacheStats statsBefore = GetPubcoinCacheStats();
+    BOOST_CHECK(ValidatePubcoin(pubCoinFresh));
+    BOOST_CHECK(ValidatePubcoin(pubCoinFresh));
+    CZerocoinCacheStats statsAfter = GetPubcoinCacheStats();
+    BOOST_CHECK_EQUAL(statsAfter.nHits - statsBefore.nHits, 1);
+    BOOST_CHECK_EQUAL(statsAfter.nMisses - statsBefore.nMisses, 1);
+    PublicCoin pubCoinOtherDenom(Params().Zerocoin_Params(), pubCoinFresh.getValue(), CoinDenomination::ZQ_FIVE);
+    BOOST_CHECK(ValidatePubcoin(pubCoinOtherDenom));
+    BOOST_CHECK_EQUAL(GetPubcoinCacheStats().nMisses - statsAfter.nMisses, 1);
+
     //initialize and Accumulator and AccumulatorWitness
     Accumulator accumulator(Params().Zerocoin_Params(), CoinDenomination::ZQ_ONE);
     AccumulatorWitness witness(Params().Zerocoin_Params(), accumulator, pubCoin);
@@ -224,6 +239,19 @@ BOOST_AUTO_TEST_CASE(checkzerocoinspend_test)
     BOOST_CHECK_MESSAGE(denom == pubCoin.getDenomination(), "Spend denomination must match original pubCoin");
     BOOST_CHECK_MESSAGE(coinSpend.Verify(accumulator), "CoinSpend object failed to validate");
 
+    //the sub-proofs must also verify individually as queued check jobs
+    boost::shared_ptr<const CoinSpend> pspend(new CoinSpend(coinSpend));
+    boost::shared_ptr<const Accumulator> paccumulator(new Accumulator(accumulator));
+    BOOST_CHECK_MESSAGE(CZerocoinSpendCheck(pspend, paccumulator, CZerocoinSpendCheck::PROOF_COMMITMENT, 0)(), "Commitment PoK failed to validate");
+    BOOST_CHECK_MESSAGE(CZerocoinSpendCheck(pspend, paccumulator, CZerocoinSpendCheck::PROOF_ACCUMULATOR, 0)(), "Accumulator PoK failed to validate");
+    BOOST_CHECK_MESSAGE(CZerocoinSpendCheck(pspend, paccumulator, CZerocoinSpendCheck::PROOF_SERIAL, 0)(), "Serial number SoK failed to validate");
+    BOOST_CHECK_MESSAGE(!CZerocoinSpendCheck()(), "Empty spend check must not validate");
+
+    //a verified spend is remembered by the spend cache
+    BOOST_CHECK_MESSAGE(!IsZerocoinSpendVerified(coinSpend), "Unverified spend found in the spend cache");
+    SetZerocoinSpendVerified(coinSpend);
+    BOOST_CHECK_MESSAGE(IsZerocoinSpendVerified(coinSpend), "Verified spend missing from the spend cache");
+
     //serialize the spend
     CDataStream serializedCoinSpend2(SER_NETWORK, PROTOCOL_VERSION);
     serializedCoinSpend2 << coinSpend;
@@ -348,5 +376,134 @@ BOOST_AUTO_TEST_CASE(checksum_tests)
     }
 }
 
+BOOST_AUTO_TEST_CASE(pubcoin_index_tests)
+{
+    cout << "Running pubcoin_index_tests...\n";
+    SelectParams(CBaseChainParams::MAIN);
+
+    CBlock block;
+    for (auto& rawMint : vecRawMints) {
+        CTransaction tx;
+        BOOST_CHECK(DecodeHexTx(tx, rawMint.first));
+        block.vtx.emplace_back(tx);
+    }
+
+    // the index gives the same pubcoins as the block
+    list<PublicCoin> listFromBlock;
+    BOOST_CHECK(BlockToPubcoinList(block, listFromBlock, false));
+    CBlockPubcoins blockPubcoins;
+    BOOST_CHECK(BlockToBlockPubcoins(block, blockPubcoins));
+    list<PublicCoin> listFromIndex;
+    BlockPubcoinsToList(blockPubcoins, listFromIndex, false);
+    BOOST_CHECK_EQUAL(listFromIndex.size(), vecRawMints.size());
+    BOOST_CHECK(listFromBlock == listFromIndex);
+
+    // heights come back in order from a range scan
+    CZerocoinDB db(1 << 20, true);
+    for (int nHeight : {70000, 5, 256, 255, 65536})
+        BOOST_CHECK(db.WriteBlockPubcoins(nHeight, blockPubcoins));
+    BOOST_CHECK(db.EraseBlockPubcoins(65536));
+
+    map<int, CBlockPubcoins> mapRange;
+    BOOST_CHECK(db.ReadBlockPubcoinsRange(200, 70000, mapRange));
+    BOOST_CHECK_EQUAL(mapRange.size(), 2);
+    BOOST_CHECK(mapRange.count(255) && mapRange.count(256));
+    BOOST_CHECK(mapRange[256].hashBlock == block.GetHash());
+    BOOST_CHECK(mapRange[256].vTx[0].vPubcoin == blockPubcoins.vTx[0].vPubcoin);
+
+    CBlockPubcoins blockPubcoinsRead;
+    BOOST_CHECK(db.ReadBlockPubcoins(70000, blockPubcoinsRead));
+    BOOST_CHECK(!db.ReadBlockPubcoins(65536, blockPubcoinsRead));
+}
+
+BOOST_AUTO_TEST_CASE(accumulate_batch_tests)
+{
+    cout << "Running accumulate_batch_tests...\n";
+    SelectParams(CBaseChainParams::MAIN);
+    libzerocoin::ZerocoinParams* ZCParams = Params().Zerocoin_Params();
+
+    // a few pubcoins in every denomination, one denomination left empty
+    list<PublicCoin> listPubcoins;
+    for (auto& denom : zerocoinDenomList) {
+        if (denom == CoinDenomination::ZQ_FIVE)
+            continue;
+        for (int i = 0; i < 3; i++) {
+            CBigNum bnValue = CBigNum::randBignum(ZCParams->coinCommitmentGroup.modulus);
+            listPubcoins.emplace_back(PublicCoin(ZCParams, bnValue, denom));
+        }
+    }
+
+    AccumulatorMap mapOneByOne;
+    for (const PublicCoin& pubcoin : listPubcoins)
+        BOOST_CHECK(mapOneByOne.Accumulate(pubcoin, true));
+
+    AccumulatorMap mapBatch;
+    BOOST_CHECK(mapBatch.AccumulateBatch(listPubcoins, true));
+    BOOST_CHECK(mapBatch.GetCheckpoint() == mapOneByOne.GetCheckpoint());
+    for (auto& denom : zerocoinDenomList)
+        BOOST_CHECK(mapBatch.GetValue(denom) == mapOneByOne.GetValue(denom));
+
+    // an empty batch leaves the accumulators alone
+    BOOST_CHECK(mapBatch.AccumulateBatch(list<PublicCoin>(), true));
+    BOOST_CHECK(mapBatch.GetCheckpoint() == mapOneByOne.GetCheckpoint());
+
+    // with validation on, random values are not valid pubcoins
+    AccumulatorMap mapValidated;
+    BOOST_CHECK(!mapValidated.AccumulateBatch(listPubcoins));
+}
+
+BOOST_AUTO_TEST_CASE(accumulator_cache_tests)
+{
+    cout << "Running accumulator_cache_tests...\n";
+
+    // the least recently used value is dropped once the cache is full
+    bool fArgSet = mapArgs.count("-accumulatorcache");
+    std::string strArgPrev = fArgSet ? mapArgs["-accumulatorcache"] : "";
+    mapArgs["-accumulatorcache"] = "2";
+    AddAccumulatorChecksum(1, CBigNum(11), true);
+    AddAccumulatorChecksum(2, CBigNum(22), true);
+
+    CBigNum bnValue;
+    BOOST_CHECK(GetAccumulatorValueFromChecksum(1, true, bnValue));
+    BOOST_CHECK(bnValue == CBigNum(11));
+
+    AddAccumulatorChecksum(3, CBigNum(33), true);
+    BOOST_CHECK(GetAccumulatorValueFromChecksum(1, true, bnValue));
+    BOOST_CHECK(!GetAccumulatorValueFromChecksum(2, true, bnValue));
+    BOOST_CHECK(GetAccumulatorValueFromChecksum(3, true, bnValue));
+    BOOST_CHECK(bnValue == CBigNum(33));
+
+    CZerocoinCacheStats stats = GetAccumulatorCacheStats();
+    BOOST_CHECK_EQUAL(stats.nEntries, 2);
+    BOOST_CHECK_EQUAL(stats.nMaxEntries, 2);
+
+    // leave the process-wide cache and settings as the other suites expect them
+    for (uint32_t nChecksum = 1; nChecksum <= 3; nChecksum++)
+        EraseChecksum(nChecksum);
+    if (fArgSet)
+        mapArgs["-accumulatorcache"] = strArgPrev;
+    else
+        mapArgs.erase("-accumulatorcache");
+}
+
+BOOST_AUTO_TEST_CASE(mint_prime_filter_tests)
+{
+    cout << "Running mint_prime_filter_tests...\n";
+    ZerocoinParams* params = Params().Zerocoin_Params();
+
+    // minted coins passed the small-prime gcd before the primality test
+    for (int i = 0; i < 3; i++) {
+        PrivateCoin coin(params, CoinDenomination::ZQ_ONE);
+        BOOST_CHECK(IsValidCoinValue(params, coin.getPublicCoin().getValue()));
+    }
+
+    // random candidates in range are accepted exactly when they are prime, the gcd rejects no prime
+    const CBigNum& bnMin = params->accumulatorParams.minCoinValue;
+    const CBigNum& bnMax = params->accumulatorParams.maxCoinValue;
+    for (int i = 0; i < 500; i++) {
+        CBigNum bnValue = bnMin + CBigNum::randBignum(bnMax - bnMin);
+        BOOST_CHECK_EQUAL(IsValidCoinValue(params, bnValue), bnValue.isPrime(ZEROCOIN_MINT_PRIME_PARAM));
+    }
+}
 
 BOOST_AUTO_TEST_SUITE_END()
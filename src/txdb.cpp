@@ -6,25 +6,170 @@
 
 #include "txdb.h"
 
+#include "init.h"
 #include "main.h"
 #include "pow.h"
+#include "ui_interface.h"
 #include "uint256.h"
 #include "accumulators.h"
+#include "crypto/common.h"
 
 #include <stdint.h>
 
+#include <boost/scoped_ptr.hpp>
 #include <boost/thread.hpp>
 
 using namespace std;
 using namespace libzerocoin;
 
-void static BatchWriteCoins(CLevelDBBatch& batch, const uint256& hash, const CCoins& coins)
-{
-    if (coins.IsPruned())
-        batch.Erase(make_pair('c', hash));
-    else
-        batch.Write(make_pair('c', hash), coins);
+/**
+ * The chainstate keeps every unspent output under ('C', txid, n), so that spending
+ * one output of a transaction erases its record and leaves the others alone. The metadata
+ * of the transaction and which of its outputs have a record are in a header under
+ * ('H', txid), a point read that the bloom filter answers for transactions that are not
+ * in the database. Databases of older versions, with one CCoins per transaction
+ * under ('c', txid), are converted by CCoinsViewDB::Upgrade.
+ */
+namespace
+{
+/** Key of an output record, n is big-endian so that the records of a transaction sort in output order */
+class CCoinsOutputKey
+{
+public:
+    uint256 txid;
+    uint32_t n;
+
+    CCoinsOutputKey() : n(0) {}
+    CCoinsOutputKey(const uint256& txidIn, uint32_t nIn) : txid(txidIn), n(nIn) {}
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion)
+    {
+        char chType = 'C';
+        READWRITE(chType);
+        READWRITE(txid);
+        unsigned char vchIndex[4];
+        if (!ser_action.ForRead())
+            WriteBE32(vchIndex, n);
+        READWRITE(FLATDATA(vchIndex));
+        if (ser_action.ForRead())
+            n = ReadBE32(vchIndex);
+    }
+};
+
+class CCoinsHeader
+{
+public:
+    bool fCoinBase;
+    bool fCoinStake;
+    int nHeight;
+    int nVersion;
+    //! size of vout when the transaction was written, no output at or past it has a record
+    unsigned int nOutputs;
+    //! bit n is set when output n has a record
+    std::vector<unsigned char> vStored;
+
+    CCoinsHeader() : fCoinBase(false), fCoinStake(false), nHeight(0), nVersion(0), nOutputs(0) {}
+    CCoinsHeader(const CCoins& coins) : fCoinBase(coins.fCoinBase), fCoinStake(coins.fCoinStake), nHeight(coins.nHeight), nVersion(coins.nVersion), nOutputs(coins.vout.size()), vStored((nOutputs + 7) / 8, 0)
+    {
+        for (unsigned int n = 0; n < nOutputs; n++) {
+            if (!coins.vout[n].IsNull())
+                vStored[n / 8] |= 1 << (n % 8);
+        }
+    }
+
+    bool IsStored(unsigned int n) const { return n < nOutputs && (vStored[n / 8] >> (n % 8)) & 1; }
+
+    friend bool operator==(const CCoinsHeader& a, const CCoinsHeader& b)
+    {
+        return a.fCoinBase == b.fCoinBase && a.fCoinStake == b.fCoinStake && a.nHeight == b.nHeight && a.nVersion == b.nVersion && a.nOutputs == b.nOutputs && a.vStored == b.vStored;
+    }
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersionIn)
+    {
+        unsigned int nCode = nHeight * 4 + (fCoinBase ? 1 : 0) + (fCoinStake ? 2 : 0);
+        READWRITE(VARINT(nCode));
+        if (ser_action.ForRead()) {
+            nHeight = nCode / 4;
+            fCoinBase = nCode & 1;
+            fCoinStake = (nCode & 2) != 0;
+        }
+        READWRITE(VARINT(nVersion));
+        READWRITE(VARINT(nOutputs));
+        if (ser_action.ForRead())
+            vStored.resize((nOutputs + 7) / 8);
+        READWRITE(REF(CFlatData(vStored)));
+    }
+};
+
+/** Read the output records of txid into coins, whose vout is already sized from the header */
+void ReadCoinsOutputs(const CLevelDBWrapper& db, const uint256& txid, CCoins& coins)
+{
+    CDataStream ssPrefix(SER_DISK, CLIENT_VERSION);
+    ssPrefix << make_pair('C', txid);
+    leveldb::Slice slPrefix(&ssPrefix[0], ssPrefix.size());
+
+    boost::scoped_ptr<leveldb::Iterator> pcursor(db.NewReadIterator());
+    for (pcursor->Seek(slPrefix); pcursor->Valid() && pcursor->key().starts_with(slPrefix); pcursor->Next()) {
+        leveldb::Slice slKey = pcursor->key();
+        leveldb::Slice slValue = pcursor->value();
+        CDataStream ssKey(slKey.data(), slKey.data() + slKey.size(), SER_DISK, CLIENT_VERSION);
+        CCoinsOutputKey key;
+        ssKey >> key;
+        if (key.n >= coins.vout.size())
+            break;
+        CDataStream ssValue(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
+        ssValue >> REF(CTxOutCompressor(coins.vout[key.n]));
+    }
+    if (!pcursor->status().ok())
+        HandleError(pcursor->status());
+}
+
+/**
+ * Write the header and the outputs of a transaction that were not stored yet, and erase the
+ * records of the outputs that are spent now. The outputs that have records are in the stored
+ * header, so nothing else is read. fStored is false when the database has no records of the
+ * transaction. Returns the number of records written or erased.
+ */
+size_t BatchWriteCoins(CLevelDBBatch& batch, const CLevelDBWrapper& db, const uint256& hash, const CCoins& coins, bool fStored)
+{
+    CCoinsHeader stored;
+    if (fStored && !db.Read(make_pair('H', hash), stored))
+        fStored = false;
+
+    size_t nChanged = 0;
+    if (coins.IsPruned()) {
+        if (fStored) {
+            batch.Erase(make_pair('H', hash));
+            nChanged++;
+        }
+    } else {
+        CCoinsHeader header(coins);
+        if (!fStored || !(header == stored)) {
+            batch.Write(make_pair('H', hash), header);
+            nChanged++;
+        }
+    }
+    // the outputs of a transaction do not change while they are unspent, a stored one is kept as it is
+    const unsigned int nOutputs = std::max((unsigned int)coins.vout.size(), stored.nOutputs);
+    for (unsigned int n = 0; n < nOutputs; n++) {
+        const bool fUnspent = n < coins.vout.size() && !coins.vout[n].IsNull();
+        if (fUnspent && !stored.IsStored(n)) {
+            batch.Write(CCoinsOutputKey(hash, n), CTxOutCompressor(REF(coins.vout[n])));
+            nChanged++;
+        } else if (!fUnspent && stored.IsStored(n)) {
+            batch.Erase(CCoinsOutputKey(hash, n));
+            nChanged++;
+        }
+    }
+    return nChanged;
 }
+} // anon namespace
 
 void static BatchWriteHashBestChain(CLevelDBBatch& batch, const uint256& hash)
 {
@@ -37,12 +182,24 @@ CCoinsViewDB::CCoinsViewDB(size_t nCacheSize, bool fMemory, bool fWipe) : db(Get
 
 bool CCoinsViewDB::GetCoins(const uint256& txid, CCoins& coins) const
 {
-    return db.Read(make_pair('c', txid), coins);
+    CCoinsHeader header;
+    if (!db.Read(make_pair('H', txid), header))
+        return false;
+
+    coins.Clear();
+    coins.fCoinBase = header.fCoinBase;
+    coins.fCoinStake = header.fCoinStake;
+    coins.nHeight = header.nHeight;
+    coins.nVersion = header.nVersion;
+    coins.vout.resize(header.nOutputs);
+    ReadCoinsOutputs(db, txid, coins);
+    coins.Cleanup();
+    return true;
 }
 
 bool CCoinsViewDB::HaveCoins(const uint256& txid) const
 {
-    return db.Exists(make_pair('c', txid));
+    return db.Exists(make_pair('H', txid));
 }
 
 uint256 CCoinsViewDB::GetBestBlock() const
@@ -58,9 +215,11 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap& mapCoins, const uint256& hashBlock)
     CLevelDBBatch batch;
     size_t count = 0;
     size_t changed = 0;
+    size_t records = 0;
     for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end();) {
         if (it->second.flags & CCoinsCacheEntry::DIRTY) {
-            BatchWriteCoins(batch, it->first, it->second.coins);
+            // a fresh entry was not in the database when the cache fetched it
+            records += BatchWriteCoins(batch, db, it->first, it->second.coins, !(it->second.flags & CCoinsCacheEntry::FRESH));
             changed++;
         }
         count++;
@@ -70,10 +229,79 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap& mapCoins, const uint256& hashBlock)
     if (hashBlock != uint256(0))
         BatchWriteHashBestChain(batch, hashBlock);
 
-    LogPrint("coindb", "Committing %u changed transactions (out of %u) to coin database...\n", (unsigned int)changed, (unsigned int)count);
+    LogPrint("coindb", "Committing %u changed transactions (out of %u), %u output records, to coin database...\n", (unsigned int)changed, (unsigned int)count, (unsigned int)records);
     return db.WriteBatch(batch);
 }
 
+bool CCoinsViewDB::Upgrade()
+{
+    boost::scoped_ptr<leveldb::Iterator> pcursor(db.NewIterator());
+    CDataStream ssKeyLegacy(SER_DISK, CLIENT_VERSION);
+    ssKeyLegacy << 'c';
+    pcursor->Seek(ssKeyLegacy.str());
+    if (!pcursor->Valid() || pcursor->key()[0] != 'c')
+        return true;
+
+    LogPrintf("Upgrading the chainstate to one record per unspent output, older versions cannot read it afterwards...\n");
+    uiInterface.ShowProgress(_("Upgrading chainstate database..."), 0);
+    size_t nTransactions = 0;
+    size_t nOutputs = 0;
+    size_t nBatch = 0;
+    int nProgress = 0;
+    CLevelDBBatch batch;
+    while (pcursor->Valid() && !ShutdownRequested()) {
+        boost::this_thread::interruption_point();
+        leveldb::Slice slKey = pcursor->key();
+        if (slKey.size() == 0 || slKey[0] != 'c')
+            break;
+        uint256 txid;
+        CCoins coins;
+        try {
+            CDataStream ssKey(slKey.data(), slKey.data() + slKey.size(), SER_DISK, CLIENT_VERSION);
+            char chType;
+            ssKey >> chType >> txid;
+            leveldb::Slice slValue = pcursor->value();
+            CDataStream ssValue(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
+            ssValue >> coins;
+        } catch (std::exception& e) {
+            return error("%s : Deserialize or I/O error - %s", __func__, e.what());
+        }
+
+        // the new records and the erase of the old one are in the same batch, an interrupted
+        // upgrade continues with the transactions that are left at the next start
+        batch.Write(make_pair('H', txid), CCoinsHeader(coins));
+        for (unsigned int n = 0; n < coins.vout.size(); n++) {
+            if (!coins.vout[n].IsNull()) {
+                batch.Write(CCoinsOutputKey(txid, n), CTxOutCompressor(coins.vout[n]));
+                nOutputs++;
+            }
+        }
+        batch.Erase(make_pair('c', txid));
+        nTransactions++;
+        if (++nBatch == 10000) {
+            db.WriteBatch(batch);
+            batch.Clear();
+            nBatch = 0;
+            // keys are in txid order, the first byte tells how far along the upgrade is
+            int nProgressNow = (int)(*txid.begin()) * 100 / 256;
+            if (nProgressNow > nProgress) {
+                nProgress = nProgressNow;
+                uiInterface.ShowProgress(_("Upgrading chainstate database..."), nProgress);
+            }
+        }
+        pcursor->Next();
+    }
+    db.WriteBatch(batch);
+    uiInterface.ShowProgress("", 100);
+    if (ShutdownRequested()) {
+        LogPrintf("Chainstate upgrade interrupted after %u transactions, it continues at the next start\n", nTransactions);
+        return true;
+    }
+    db.CompactRange('c', 'd');
+    LogPrintf("Upgraded the chainstate: %u transactions with %u unspent outputs\n", nTransactions, nOutputs);
+    return true;
+}
+
 CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe) : CLevelDBWrapper(GetDataDir() / "blocks" / "index", nCacheSize, fMemory, fWipe)
 {
 }
@@ -83,6 +311,14 @@ bool CBlockTreeDB::WriteBlockIndex(const CDiskBlockIndex& blockindex)
     return Write(make_pair('b', blockindex.GetBlockHash()), blockindex);
 }
 
+bool CBlockTreeDB::WriteBlockIndexBatch(const std::vector<const CBlockIndex*>& vBlockIndex)
+{
+    CLevelDBBatch batch;
+    for (const CBlockIndex* pindex : vBlockIndex)
+        batch.Write(make_pair('b', pindex->GetBlockHash()), CDiskBlockIndex(pindex));
+    return WriteBatch(batch);
+}
+
 bool CBlockTreeDB::WriteBlockFileInfo(int nFile, const CBlockFileInfo& info)
 {
     return Write(make_pair('f', nFile), info);
@@ -123,48 +359,60 @@ bool CCoinsViewDB::GetStats(CCoinsStats& stats) const
        only need read operations on it, use a const-cast to get around
        that restriction.  */
     boost::scoped_ptr<leveldb::Iterator> pcursor(const_cast<CLevelDBWrapper*>(&db)->NewIterator());
-    pcursor->SeekToFirst();
+    CDataStream ssKeyFirst(SER_DISK, CLIENT_VERSION);
+    ssKeyFirst << 'C';
+    pcursor->Seek(ssKeyFirst.str());
 
+    // Outputs are hashed grouped by transaction as they were when the chainstate stored
+    // one record per transaction, so the hash did not change with the upgrade
     CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
     stats.hashBlock = GetBestBlock();
     ss << stats.hashBlock;
     CAmount nTotalAmount = 0;
+    uint256 txhashLast;
+    bool fFirst = true;
     while (pcursor->Valid()) {
         boost::this_thread::interruption_point();
         try {
             leveldb::Slice slKey = pcursor->key();
             CDataStream ssKey(slKey.data(), slKey.data() + slKey.size(), SER_DISK, CLIENT_VERSION);
-            char chType;
-            ssKey >> chType;
-            if (chType == 'c') {
-                leveldb::Slice slValue = pcursor->value();
-                CDataStream ssValue(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
-                CCoins coins;
-                ssValue >> coins;
-                uint256 txhash;
-                ssKey >> txhash;
+            if (slKey.size() == 0 || slKey[0] != 'C')
+                break;
+            CCoinsOutputKey key;
+            ssKey >> key;
+            const uint256& txhash = key.txid;
+            const unsigned int n = key.n;
+            leveldb::Slice slValue = pcursor->value();
+            CDataStream ssValue(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
+            CTxOut txout;
+            ssValue >> REF(CTxOutCompressor(txout));
+            if (fFirst || txhash != txhashLast) {
+                if (!fFirst)
+                    ss << VARINT(0);
+                CCoinsHeader header;
+                if (!db.Read(make_pair('H', txhash), header))
+                    return error("%s : No header for the outputs of %s", __func__, txhash.ToString());
                 ss << txhash;
-                ss << VARINT(coins.nVersion);
-                ss << (coins.fCoinBase ? 'c' : 'n');
-                ss << VARINT(coins.nHeight);
+                ss << VARINT(header.nVersion);
+                ss << (header.fCoinBase ? 'c' : 'n');
+                ss << VARINT(header.nHeight);
                 stats.nTransactions++;
-                for (unsigned int i = 0; i < coins.vout.size(); i++) {
-                    const CTxOut& out = coins.vout[i];
-                    if (!out.IsNull()) {
-                        stats.nTransactionOutputs++;
-                        ss << VARINT(i + 1);
-                        ss << out;
-                        nTotalAmount += out.nValue;
-                    }
-                }
-                stats.nSerializedSize += 32 + slValue.size();
-                ss << VARINT(0);
+                stats.nSerializedSize += ::GetSerializeSize(make_pair('H', txhash), SER_DISK, CLIENT_VERSION) + ::GetSerializeSize(header, SER_DISK, CLIENT_VERSION);
+                txhashLast = txhash;
+                fFirst = false;
             }
+            stats.nTransactionOutputs++;
+            ss << VARINT(n + 1);
+            ss << txout;
+            nTotalAmount += txout.nValue;
+            stats.nSerializedSize += slKey.size() + slValue.size();
             pcursor->Next();
         } catch (std::exception& e) {
             return error("%s : Deserialize or I/O error - %s", __func__, e.what());
         }
     }
+    if (!fFirst)
+        ss << VARINT(0);
     stats.nHeight = mapBlockIndex.find(GetBestBlock())->second->nHeight;
     stats.hashSerialized = ss.GetHash();
     stats.nTotalAmount = nTotalAmount;
@@ -365,3 +613,80 @@ bool CZerocoinDB::EraseAccumulatorValue(const uint32_t& nChecksum)
     LogPrint("zero", "%s : checksum:%d\n", __func__, nChecksum);
     return Erase(make_pair('a', nChecksum));
 }
+
+/** Height key of the pubcoin index, big endian so that LevelDB keeps the blocks in height order */
+class CPubcoinHeightKey
+{
+public:
+    uint32_t nHeight;
+
+    CPubcoinHeightKey(uint32_t nHeightIn = 0) : nHeight(nHeightIn) {}
+
+    unsigned int GetSerializeSize(int nType, int nVersion) const
+    {
+        return 4;
+    }
+
+    template <typename Stream>
+    void Serialize(Stream& s, int nType, int nVersion) const
+    {
+        unsigned char ch[4] = {(unsigned char)(nHeight >> 24), (unsigned char)(nHeight >> 16), (unsigned char)(nHeight >> 8), (unsigned char)nHeight};
+        s.write((char*)ch, sizeof(ch));
+    }
+
+    template <typename Stream>
+    void Unserialize(Stream& s, int nType, int nVersion)
+    {
+        unsigned char ch[4];
+        s.read((char*)ch, sizeof(ch));
+        nHeight = ((uint32_t)ch[0] << 24) | ((uint32_t)ch[1] << 16) | ((uint32_t)ch[2] << 8) | ch[3];
+    }
+};
+
+bool CZerocoinDB::WriteBlockPubcoins(int nHeight, const CBlockPubcoins& blockPubcoins)
+{
+    return Write(make_pair('p', CPubcoinHeightKey(nHeight)), blockPubcoins);
+}
+
+bool CZerocoinDB::ReadBlockPubcoins(int nHeight, CBlockPubcoins& blockPubcoins)
+{
+    return Read(make_pair('p', CPubcoinHeightKey(nHeight)), blockPubcoins);
+}
+
+bool CZerocoinDB::EraseBlockPubcoins(int nHeight)
+{
+    return Erase(make_pair('p', CPubcoinHeightKey(nHeight)));
+}
+
+bool CZerocoinDB::ReadBlockPubcoinsRange(int nHeightStart, int nHeightEnd, std::map<int, CBlockPubcoins>& mapBlockPubcoins)
+{
+    boost::scoped_ptr<leveldb::Iterator> pcursor(NewIterator());
+
+    CDataStream ssKeySet(SER_DISK, CLIENT_VERSION);
+    ssKeySet << make_pair('p', CPubcoinHeightKey(nHeightStart));
+    pcursor->Seek(ssKeySet.str());
+
+    while (pcursor->Valid()) {
+        try {
+            leveldb::Slice slKey = pcursor->key();
+            CDataStream ssKey(slKey.data(), slKey.data() + slKey.size(), SER_DISK, CLIENT_VERSION);
+            char chType;
+            CPubcoinHeightKey key;
+            ssKey >> chType;
+            if (chType != 'p')
+                break;
+            ssKey >> key;
+            if ((int)key.nHeight >= nHeightEnd)
+                break;
+
+            leveldb::Slice slValue = pcursor->value();
+            CDataStream ssValue(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
+            ssValue >> mapBlockPubcoins[key.nHeight];
+            pcursor->Next();
+        } catch (std::exception& e) {
+            return error("%s : Deserialize or I/O error - %s", __func__, e.what());
+        }
+    }
+
+    return true;
+}
@@ -40,6 +40,9 @@ public:
     uint256 GetBestBlock() const;
     bool BatchWrite(CCoinsMap& mapCoins, const uint256& hashBlock);
     bool GetStats(CCoinsStats& stats) const;
+
+    //! Convert the records of older versions, one per transaction, to one per unspent output. Stops early if a shutdown is requested.
+    bool Upgrade();
 };
 
 /** Access to the block database (blocks/index/) */
@@ -54,6 +57,7 @@ private:
 
 public:
     bool WriteBlockIndex(const CDiskBlockIndex& blockindex);
+    bool WriteBlockIndexBatch(const std::vector<const CBlockIndex*>& vBlockIndex);
     bool ReadBlockFileInfo(int nFile, CBlockFileInfo& fileinfo);
     bool WriteBlockFileInfo(int nFile, const CBlockFileInfo& fileinfo);
     bool ReadLastBlockFile(int& nFile);
@@ -69,6 +73,57 @@ public:
     bool LoadBlockIndexGuts();
 };
 
+/** A zerocoin mint transaction in the pubcoin index, with what the invalid outpoint filter needs */
+class CPubcoinTx
+{
+public:
+    uint256 txid;
+    std::vector<COutPoint> vPrevout;
+    std::vector<uint32_t> vOut; // output index of each pubcoin
+    std::vector<libzerocoin::CoinDenomination> vDenom;
+    std::vector<CBigNum> vPubcoin;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion)
+    {
+        READWRITE(txid);
+        READWRITE(vPrevout);
+        READWRITE(vOut);
+        READWRITE(vDenom);
+        READWRITE(vPubcoin);
+    }
+};
+
+/** The zerocoin mints of one block, indexed by height in CZerocoinDB */
+class CBlockPubcoins
+{
+public:
+    uint256 hashBlock;
+    std::vector<CPubcoinTx> vTx;
+
+    CBlockPubcoins()
+    {
+        SetNull();
+    }
+
+    void SetNull()
+    {
+        hashBlock = 0;
+        vTx.clear();
+    }
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion)
+    {
+        READWRITE(hashBlock);
+        READWRITE(vTx);
+    }
+};
+
 class CZerocoinDB : public CLevelDBWrapper
 {
 public:
@@ -88,6 +143,11 @@ public:
     bool WriteAccumulatorValue(const uint32_t& nChecksum, const CBigNum& bnValue);
     bool ReadAccumulatorValue(const uint32_t& nChecksum, CBigNum& bnValue);
     bool EraseAccumulatorValue(const uint32_t& nChecksum);
+    bool WriteBlockPubcoins(int nHeight, const CBlockPubcoins& blockPubcoins);
+    bool ReadBlockPubcoins(int nHeight, CBlockPubcoins& blockPubcoins);
+    bool EraseBlockPubcoins(int nHeight);
+    /** Read the pubcoin index of heights nHeightStart up to (not including) nHeightEnd in one sequential scan */
+    bool ReadBlockPubcoinsRange(int nHeightStart, int nHeightEnd, std::map<int, CBlockPubcoins>& mapBlockPubcoins);
 };
 
 #endif // BITCOIN_TXDB_H
@@ -22,6 +22,7 @@
 #include "timedata.h"
 #include "util.h"
 #include "utilmoneystr.h"
+#include "zerocoincache.h"
 
 #include "denomination_functions.h"
 #include "libzerocoin/Denominations.h"
@@ -583,6 +584,15 @@ bool CWallet::EncryptWallet(const SecureString& strWalletPassphrase)
             assert(false);
         }
 
+        if (!EncryptMintPool(vMasterKey)) {
+            if (fFileBacked) {
+                pwalletdbEncryption->TxnAbort();
+                delete pwalletdbEncryption;
+            }
+            // the pool's secrets are encrypted in memory only partly, same as the keys above
+            assert(false);
+        }
+
         // Encryption was introduced in version 0.4.0
         SetMinVersion(FEATURE_WALLETCRYPT, pwalletdbEncryption, true);
 
@@ -796,6 +806,13 @@ void CWallet::SyncTransaction(const CTransaction& tx, const CBlock* pblock)
     }
 }
 
+void CWallet::UpdatedBlockTip(const CBlockIndex* pindex)
+{
+    // the witnesses are advanced by ThreadZerocoinWitnesses
+    LOCK(cs_wallet);
+    fWitnessesDirty = true;
+}
+
 void CWallet::EraseFromWallet(const uint256& hash)
 {
     if (!fFileBacked)
@@ -2563,88 +2580,90 @@ bool CWallet::CreateCoinStake(const CKeyStore& keystore, unsigned int nBits, int
     if (GetAdjustedTime() <= chainActive.Tip()->nTime)
         MilliSleep(10000);
 
+    // gather what the kernel hash needs from every input, the search threads only hash
+    nTxNewTime = GetAdjustedTime();
+    vector<pair<const CWalletTx*, unsigned int> > vStakeCoins;
+    vector<CStakeCandidate> vCandidates;
     BOOST_FOREACH (PAIRTYPE(const CWalletTx*, unsigned int) pcoin, setStakeCoins) {
         //make sure that enough time has elapsed between
-        CBlockIndex* pindex = NULL;
         BlockMap::iterator it = mapBlockIndex.find(pcoin.first->hashBlock);
-        if (it != mapBlockIndex.end())
-            pindex = it->second;
-        else {
+        if (it == mapBlockIndex.end()) {
             if (fDebug)
                 LogPrintf("CreateCoinStake() failed to find block index \n");
             continue;
         }
 
-        // Read block header
-        CBlockHeader block = pindex->GetBlockHeader();
+        CStakeCandidate candidate;
+        if (!GetStakeCandidate(it->second, *pcoin.first, pcoin.second, nTxNewTime, candidate))
+            continue;
 
-        bool fKernelFound = false;
-        uint256 hashProofOfStake = 0;
-        COutPoint prevoutStake = COutPoint(pcoin.first->GetHash(), pcoin.second);
-        nTxNewTime = GetAdjustedTime();
+        vStakeCoins.push_back(pcoin);
+        vCandidates.push_back(candidate);
+    }
 
-        //iterates each utxo inside of CheckStakeKernelHash()
-        if (CheckStakeKernelHash(nBits, block, *pcoin.first, prevoutStake, nTxNewTime, nHashDrift, false, hashProofOfStake, true)) {
-            //Double check that this will pass time requirements
-            if (nTxNewTime <= chainActive.Tip()->GetMedianTimePast()) {
-                LogPrintf("CreateCoinStake() : kernel found, but it is too far in the past \n");
-                continue;
-            }
+    // a kernel at or before the median time past would not be accepted, the search goes on with
+    // the other times and inputs instead
+    size_t nKernel = 0;
+    uint256 hashProofOfStake = 0;
+    if (!FindStakeKernel(vCandidates, nBits, nTxNewTime, nHashDrift, chainActive.Tip()->GetMedianTimePast(), GetArg("-stakethreads", DEFAULT_STAKE_THREADS), nKernel, hashProofOfStake))
+        return false;
 
-            // Found a kernel
-            if (fDebug && GetBoolArg("-printcoinstake", false))
-                LogPrintf("CreateCoinStake : kernel found\n");
-
-            vector<valtype> vSolutions;
-            txnouttype whichType;
-            CScript scriptPubKeyOut;
-            scriptPubKeyKernel = pcoin.first->vout[pcoin.second].scriptPubKey;
-            if (!Solver(scriptPubKeyKernel, whichType, vSolutions)) {
-                LogPrintf("CreateCoinStake : failed to parse kernel\n");
-                break;
-            }
+    const PAIRTYPE(const CWalletTx*, unsigned int)& pcoin = vStakeCoins[nKernel];
+
+    //Double check that this will pass time requirements
+    if (nTxNewTime <= chainActive.Tip()->GetMedianTimePast()) {
+        LogPrintf("CreateCoinStake() : kernel found, but it is too far in the past \n");
+        return false;
+    }
+
+    // Found a kernel
+    if (fDebug && GetBoolArg("-printcoinstake", false))
+        LogPrintf("CreateCoinStake : kernel found\n");
+
+    vector<valtype> vSolutions;
+    txnouttype whichType;
+    CScript scriptPubKeyOut;
+    scriptPubKeyKernel = pcoin.first->vout[pcoin.second].scriptPubKey;
+    if (!Solver(scriptPubKeyKernel, whichType, vSolutions)) {
+        LogPrintf("CreateCoinStake : failed to parse kernel\n");
+        return false;
+    }
+    if (fDebug && GetBoolArg("-printcoinstake", false))
+        LogPrintf("CreateCoinStake : parsed kernel type=%d\n", whichType);
+    if (whichType != TX_PUBKEY && whichType != TX_PUBKEYHASH) {
+        if (fDebug && GetBoolArg("-printcoinstake", false))
+            LogPrintf("CreateCoinStake : no support for kernel type=%d\n", whichType);
+        return false; // only support pay to public key and pay to address
+    }
+    if (whichType == TX_PUBKEYHASH) // pay to address type
+    {
+        //convert to pay to public key type
+        CKey key;
+        if (!keystore.GetKey(uint160(vSolutions[0]), key)) {
             if (fDebug && GetBoolArg("-printcoinstake", false))
-                LogPrintf("CreateCoinStake : parsed kernel type=%d\n", whichType);
-            if (whichType != TX_PUBKEY && whichType != TX_PUBKEYHASH) {
-                if (fDebug && GetBoolArg("-printcoinstake", false))
-                    LogPrintf("CreateCoinStake : no support for kernel type=%d\n", whichType);
-                break; // only support pay to public key and pay to address
-            }
-            if (whichType == TX_PUBKEYHASH) // pay to address type
-            {
-                //convert to pay to public key type
-                CKey key;
-                if (!keystore.GetKey(uint160(vSolutions[0]), key)) {
-                    if (fDebug && GetBoolArg("-printcoinstake", false))
-                        LogPrintf("CreateCoinStake : failed to get key for kernel type=%d\n", whichType);
-                    break; // unable to find corresponding public key
-                }
+                LogPrintf("CreateCoinStake : failed to get key for kernel type=%d\n", whichType);
+            return false; // unable to find corresponding public key
+        }
 
-                scriptPubKeyOut << key.GetPubKey() << OP_CHECKSIG;
-            } else
-                scriptPubKeyOut = scriptPubKeyKernel;
+        scriptPubKeyOut << key.GetPubKey() << OP_CHECKSIG;
+    } else
+        scriptPubKeyOut = scriptPubKeyKernel;
 
-            txNew.vin.push_back(CTxIn(pcoin.first->GetHash(), pcoin.second));
-            nCredit += pcoin.first->vout[pcoin.second].nValue;
-            vwtxPrev.push_back(pcoin.first);
-            txNew.vout.push_back(CTxOut(0, scriptPubKeyOut));
+    txNew.vin.push_back(CTxIn(pcoin.first->GetHash(), pcoin.second));
+    nCredit += pcoin.first->vout[pcoin.second].nValue;
+    vwtxPrev.push_back(pcoin.first);
+    txNew.vout.push_back(CTxOut(0, scriptPubKeyOut));
 
-            //presstab HyperStake - calculate the total size of our new output including the stake reward so that we can use it to decide whether to split the stake outputs
-            const CBlockIndex* pIndex0 = chainActive.Tip();
-            uint64_t nTotalSize = pcoin.first->vout[pcoin.second].nValue + GetBlockValue(pIndex0->nHeight);
+    //presstab HyperStake - calculate the total size of our new output including the stake reward so that we can use it to decide whether to split the stake outputs
+    uint64_t nTotalSize = pcoin.first->vout[pcoin.second].nValue + GetBlockValue(chainActive.Tip()->nHeight);
 
-            //presstab HyperStake - if MultiSend is set to send in coinstake we will add our outputs here (values asigned further down)
-            if (nTotalSize / 2 > nStakeSplitThreshold * COIN)
-                txNew.vout.push_back(CTxOut(0, scriptPubKeyOut)); //split stake
+    //presstab HyperStake - if MultiSend is set to send in coinstake we will add our outputs here (values asigned further down)
+    if (nTotalSize / 2 > nStakeSplitThreshold * COIN)
+        txNew.vout.push_back(CTxOut(0, scriptPubKeyOut)); //split stake
+
+    if (fDebug && GetBoolArg("-printcoinstake", false))
+        LogPrintf("CreateCoinStake : added kernel type=%d\n", whichType);
 
-            if (fDebug && GetBoolArg("-printcoinstake", false))
-                LogPrintf("CreateCoinStake : added kernel type=%d\n", whichType);
-            fKernelFound = true;
-            break;
-        }
-        if (fKernelFound)
-            break; // if kernel is found stop searching
-    }
     if (nCredit == 0 || nCredit > nBalance - nReserveBalance)
         return false;
 
@@ -3978,12 +3997,15 @@ bool CWallet::CreateZerocoinMintTransaction(const CAmount nValue, CMutableTransa
         CAmount nValueNewMint = libzerocoin::ZerocoinDenominationToAmount(denomination);
         nMintingValue += nValueNewMint;
 
-        // mint a new coin (create Pedersen Commitment) and extract PublicCoin that is shareable from it
-        libzerocoin::PrivateCoin newCoin(Params().Zerocoin_Params(), denomination);
+        // take a pre-generated coin from the mint pool, or mint a new coin (create Pedersen Commitment)
+        // and extract PublicCoin that is shareable from it
+        libzerocoin::PrivateCoin newCoin(Params().Zerocoin_Params(), denomination, false);
+        if (!TakeFromMintPool(denomination, newCoin))
+            newCoin = libzerocoin::PrivateCoin(Params().Zerocoin_Params(), denomination);
         libzerocoin::PublicCoin pubCoin = newCoin.getPublicCoin();
 
-        // Validate
-        if(!pubCoin.validate()) {
+        // Validate, which also lets the memory pool skip the check when the mint is relayed
+        if(!ValidatePubcoin(pubCoin)) {
             strFailReason = _("failed to validate zerocoin");
             return false;
         }
@@ -4068,7 +4090,7 @@ bool CWallet::MintToTxIn(CZerocoinMint zerocoinSelected, int nSecurityLevel, con
     // 2. Get pubcoin from the private coin
     libzerocoin::PublicCoin pubCoinSelected(Params().Zerocoin_Params(), zerocoinSelected.GetValue(), denomination);
     LogPrintf("%s : pubCoinSelected:\n denom=%d\n value%s\n", __func__, denomination, pubCoinSelected.getValue().GetHex());
-    if (!pubCoinSelected.validate()) {
+    if (!ValidatePubcoin(pubCoinSelected)) {
         receipt.SetStatus("the selected mint coin is an invalid coin", ZPIV_INVALID_COIN);
         return false;
     }
@@ -4078,14 +4100,16 @@ bool CWallet::MintToTxIn(CZerocoinMint zerocoinSelected, int nSecurityLevel, con
     libzerocoin::AccumulatorWitness witness(Params().Zerocoin_Params(), accumulator, pubCoinSelected);
     string strFailReason = "";
     int nMintsAdded = 0;
-    if (!GenerateAccumulatorWitness(pubCoinSelected, accumulator, witness, nSecurityLevel, nMintsAdded, strFailReason)) {
+    CWitnessData witnessData;
+    bool fTracked = CWalletDB(strWalletFile).ReadZerocoinWitness(pubCoinSelected.getValue(), witnessData);
+    if (!GenerateAccumulatorWitness(pubCoinSelected, accumulator, witness, nSecurityLevel, nMintsAdded, strFailReason, fTracked ? &witnessData : NULL)) {
         receipt.SetStatus("Try to spend with a higher security level to include more coins", ZPIV_FAILED_ACCUMULATOR_INITIALIZATION);
         LogPrintf("%s : %s \n", __func__, receipt.GetStatusMessage());
         return false;
     }
 
     // Construct the CoinSpend object. This acts like a signature on the transaction.
-    libzerocoin::PrivateCoin privateCoin(Params().Zerocoin_Params(), denomination);
+    libzerocoin::PrivateCoin privateCoin(Params().Zerocoin_Params(), denomination, false);
     privateCoin.setPublicCoin(pubCoinSelected);
     privateCoin.setRandomness(zerocoinSelected.GetRandomness());
     privateCoin.setSerialNumber(zerocoinSelected.GetSerialNumber());
@@ -4443,6 +4467,282 @@ void CWallet::ReconsiderZerocoins(std::list<CZerocoinMint>& listMintsRestored)
     }
 }
 
+bool CWallet::UpdateZerocoinWitnesses(int nMaxBlocks)
+{
+    if (!fFileBacked)
+        return false;
+
+    LOCK2(cs_main, cs_wallet);
+
+    // witnesses only move forward when the chain has grown by a checkpoint, or after a reorg
+    int nHeightEnd = GetWitnessHeightEnd(chainActive.Height());
+    if (nHeightEnd <= Params().Zerocoin_StartHeight())
+        return false;
+
+    uint256 hashEnd = chainActive[nHeightEnd - 1]->GetBlockHash();
+    if (hashEnd == hashWitnessesUpdated)
+        return false;
+
+    CWalletDB walletdb(strWalletFile);
+    list<CZerocoinMint> listMints = walletdb.ListMintedCoins(false, false, false);
+    list<CWitnessData> listWitnesses;
+    vector<CWitnessData*> vAdvance;
+    for (const CZerocoinMint& mint : listMints) {
+        CWitnessData witnessData;
+        bool fTracked = walletdb.ReadZerocoinWitness(mint.GetValue(), witnessData);
+        if (mint.IsUsed()) {
+            if (fTracked)
+                walletdb.EraseZerocoinWitness(mint.GetValue());
+            continue;
+        }
+
+        // start over from the mint if the blocks it was advanced with have been disconnected
+        bool fReset = !fTracked || !IsWitnessDataOnChain(witnessData);
+        if (fReset) {
+            libzerocoin::PublicCoin pubcoin(Params().Zerocoin_Params(), mint.GetValue(), mint.GetDenomination());
+            if (!InitWitnessData(pubcoin, witnessData)) {
+                if (fTracked)
+                    walletdb.EraseZerocoinWitness(mint.GetValue());
+                continue;
+            }
+        }
+
+        if (witnessData.nHeightNext >= nHeightEnd) {
+            if (fReset)
+                walletdb.WriteZerocoinWitness(witnessData);
+            continue;
+        }
+
+        listWitnesses.emplace_back(witnessData);
+        vAdvance.emplace_back(&listWitnesses.back());
+    }
+
+    // only add up to nMaxBlocks blocks while the locks are held, the caller picks up the rest
+    int nHeightSlice = nHeightEnd;
+    for (const CWitnessData* pWitnessData : vAdvance)
+        nHeightSlice = std::min(nHeightSlice, pWitnessData->nHeightNext + nMaxBlocks);
+
+    int64_t nTimeStart = GetTimeMicros();
+    if (!AdvanceWitnessData(vAdvance, nHeightSlice)) {
+        LogPrintf("%s : failed to advance zerocoin witnesses to height %d\n", __func__, nHeightSlice);
+        return false;
+    }
+
+    for (const CWitnessData* pWitnessData : vAdvance) {
+        if (!walletdb.WriteZerocoinWitness(*pWitnessData))
+            LogPrintf("%s : failed to write witness for %s\n", __func__, pWitnessData->bnPubcoin.GetHex());
+    }
+
+    LogPrint("zero", "%s : advanced %d witnesses to height %d in %.2fms\n", __func__, vAdvance.size(), nHeightSlice, (GetTimeMicros() - nTimeStart) * 0.001);
+    if (nHeightSlice < nHeightEnd)
+        return true;
+
+    hashWitnessesUpdated = hashEnd;
+    return false;
+}
+
+
+uint256 CMintPoolEntry::GetHash() const
+{
+    CDataStream ss(SER_GETHASH, 0);
+    ss << bnPubcoin;
+    return Hash(ss.begin(), ss.end());
+}
+
+void CWallet::LoadMintPoolEntry(const CMintPoolEntry& entry)
+{
+    LOCK(cs_wallet);
+    mapMintPool[entry.denom].push_back(entry);
+}
+
+bool CWallet::AddToMintPool(const libzerocoin::PrivateCoin& coin)
+{
+    LOCK(cs_wallet);
+    CMintPoolEntry entry;
+    entry.denom = coin.getPublicCoin().getDenomination();
+    entry.bnPubcoin = coin.getPublicCoin().getValue();
+
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << coin.getRandomness() << coin.getSerialNumber();
+    CKeyingMaterial vchSecret(ss.begin(), ss.end());
+    if (IsCrypted()) {
+        if (!EncryptWithMasterKey(vchSecret, entry.GetHash(), entry.vchSecret))
+            return false;
+        entry.fCrypted = true;
+    } else {
+        entry.vchSecret.assign(vchSecret.begin(), vchSecret.end());
+    }
+
+    if (fFileBacked && !CWalletDB(strWalletFile).WriteMintPoolEntry(entry))
+        return false;
+
+    mapMintPool[entry.denom].push_back(entry);
+    return true;
+}
+
+bool CWallet::TakeFromMintPool(libzerocoin::CoinDenomination denom, libzerocoin::PrivateCoin& coin)
+{
+    LOCK(cs_wallet);
+    std::list<CMintPoolEntry>& listPool = mapMintPool[denom];
+    while (!listPool.empty()) {
+        CMintPoolEntry entry = listPool.front();
+        CKeyingMaterial vchSecret;
+        if (entry.fCrypted) {
+            if (!DecryptWithMasterKey(entry.vchSecret, entry.GetHash(), vchSecret))
+                return false;
+        } else {
+            vchSecret.assign(entry.vchSecret.begin(), entry.vchSecret.end());
+        }
+
+        // a mint leaves the pool as soon as it is handed out, even if its transaction is never committed,
+        // so the same serial can never end up in two mints
+        listPool.pop_front();
+        if (fFileBacked)
+            CWalletDB(strWalletFile).EraseMintPoolEntry(entry);
+
+        if (vchSecret.empty()) {
+            LogPrintf("%s : empty mint pool entry %s\n", __func__, entry.bnPubcoin.GetHex().substr(0, 10));
+            continue;
+        }
+
+        CBigNum bnRandomness;
+        CBigNum bnSerial;
+        try {
+            CDataStream ss((const char*)&vchSecret[0], (const char*)&vchSecret[0] + vchSecret.size(), SER_DISK, CLIENT_VERSION);
+            ss >> bnRandomness >> bnSerial;
+        } catch (const std::exception&) {
+            LogPrintf("%s : unreadable mint pool entry %s\n", __func__, entry.bnPubcoin.GetHex().substr(0, 10));
+            continue;
+        }
+
+        // a mint whose secrets do not open its commitment could never be spent
+        const libzerocoin::IntegerGroupParams& group = Params().Zerocoin_Params()->coinCommitmentGroup;
+        CBigNum bnCommitment = group.g.pow_mod(bnSerial, group.modulus).mul_mod(group.h.pow_mod(bnRandomness, group.modulus), group.modulus);
+        if (bnCommitment != entry.bnPubcoin) {
+            LogPrintf("%s : mint pool entry %s does not match its secrets\n", __func__, entry.bnPubcoin.GetHex().substr(0, 10));
+            continue;
+        }
+
+        coin.setPublicCoin(libzerocoin::PublicCoin(Params().Zerocoin_Params(), entry.bnPubcoin, denom));
+        coin.setRandomness(bnRandomness);
+        coin.setSerialNumber(bnSerial);
+        return true;
+    }
+
+    return false;
+}
+
+libzerocoin::CoinDenomination CWallet::GetMintPoolDenominationToFill(unsigned int nTarget) const
+{
+    LOCK(cs_wallet);
+    if (IsLocked())
+        return libzerocoin::ZQ_ERROR;
+
+    libzerocoin::CoinDenomination denomFill = libzerocoin::ZQ_ERROR;
+    size_t nFewest = nTarget;
+    for (auto denom : libzerocoin::zerocoinDenomList) {
+        std::map<libzerocoin::CoinDenomination, std::list<CMintPoolEntry> >::const_iterator it = mapMintPool.find(denom);
+        size_t nSize = it == mapMintPool.end() ? 0 : it->second.size();
+        if (nSize < nFewest) {
+            nFewest = nSize;
+            denomFill = denom;
+        }
+    }
+
+    return denomFill;
+}
+
+bool CWallet::EncryptMintPool(const CKeyingMaterial& vMasterKeyIn)
+{
+    AssertLockHeld(cs_wallet);
+    for (auto& denomPool : mapMintPool) {
+        for (CMintPoolEntry& entry : denomPool.second) {
+            if (entry.fCrypted)
+                continue;
+
+            CKeyingMaterial vchSecret(entry.vchSecret.begin(), entry.vchSecret.end());
+            std::vector<unsigned char> vchCryptedSecret;
+            if (!EncryptSecret(vMasterKeyIn, vchSecret, entry.GetHash(), vchCryptedSecret))
+                return false;
+            if (!entry.vchSecret.empty())
+                OPENSSL_cleanse(&entry.vchSecret[0], entry.vchSecret.size());
+            entry.vchSecret = vchCryptedSecret;
+            entry.fCrypted = true;
+
+            if (pwalletdbEncryption && !pwalletdbEncryption->WriteMintPoolEntry(entry))
+                return false;
+        }
+    }
+
+    return true;
+}
+
+void ThreadMintPool(CWallet* pwallet, unsigned int nTarget)
+{
+    RenameThread("pivx-mintpool");
+    // refilling the pool is background work, search for primes on one core and leave the others to validation
+    SetThreadPriority(THREAD_PRIORITY_LOWEST);
+    libzerocoin::SetThreadSingleCore(true);
+    LogPrintf("%s started, keeping %d mints of each denomination\n", __func__, nTarget);
+
+    // pause after a failed mint, doubled on every failure in a row up to ten minutes
+    int64_t nBackoff = 5000;
+    try {
+        while (true) {
+            boost::this_thread::interruption_point();
+            libzerocoin::CoinDenomination denom = pwallet->GetMintPoolDenominationToFill(nTarget);
+            if (denom == libzerocoin::ZQ_ERROR) {
+                MilliSleep(5000);
+                continue;
+            }
+
+            // the prime search runs without holding any locks
+            try {
+                libzerocoin::PrivateCoin coin(Params().Zerocoin_Params(), denom);
+                if (!pwallet->AddToMintPool(coin))
+                    MilliSleep(5000);
+                nBackoff = 5000;
+            } catch (const std::exception& e) {
+                LogPrintf("%s : %s, retrying in %ds\n", __func__, e.what(), nBackoff / 1000);
+                MilliSleep(nBackoff);
+                nBackoff = std::min(nBackoff * 2, (int64_t)600000);
+            }
+        }
+    } catch (const boost::thread_interrupted&) {
+        LogPrintf("%s exiting\n", __func__);
+        throw;
+    }
+}
+
+void ThreadZerocoinWitnesses(CWallet* pwallet)
+{
+    RenameThread("pivx-witness");
+    LogPrintf("%s started\n", __func__);
+
+    try {
+        while (true) {
+            boost::this_thread::interruption_point();
+            bool fDirty = false;
+            {
+                LOCK(pwallet->cs_wallet);
+                std::swap(fDirty, pwallet->fWitnessesDirty);
+            }
+            if (!fDirty) {
+                MilliSleep(1000);
+                continue;
+            }
+
+            // cs_main and cs_wallet are released between the slices so that a long catch up does not stall the node
+            while (pwallet->UpdateZerocoinWitnesses(WITNESS_UPDATE_SLICE_BLOCKS))
+                MilliSleep(10);
+        }
+    } catch (const boost::thread_interrupted&) {
+        LogPrintf("%s exiting\n", __func__);
+        throw;
+    } catch (const std::exception& e) {
+        LogPrintf("%s : %s\n", __func__, e.what());
+    }
+}
 
 void CWallet::ZPivBackupWallet()
 {
@@ -52,6 +52,8 @@ static const CAmount nHighTransactionFeeWarning = 0.1 * COIN;
 static const CAmount DEFAULT_TRANSACTION_MAXFEE = 1 * COIN;
 //! -maxtxfee will warn if called with a higher fee than this amount (in satoshis)
 static const CAmount nHighTransactionMaxFeeWarning = 100 * nHighTransactionFeeWarning;
+//! Blocks added to the zerocoin witnesses per cs_main/cs_wallet lock
+static const int WITNESS_UPDATE_SLICE_BLOCKS = 500;
 //! Largest (in bytes) free transaction we're willing to create
 static const unsigned int MAX_FREE_TRANSACTION_CREATE_SIZE = 1000;
 
@@ -136,6 +138,41 @@ public:
     }
 };
 
+/**
+ * A pre-generated zerocoin mint waiting in the wallet's mint pool. The randomness and
+ * serial are encrypted with the wallet master key when the wallet is encrypted.
+ */
+class CMintPoolEntry
+{
+public:
+    libzerocoin::CoinDenomination denom;
+    CBigNum bnPubcoin;
+    bool fCrypted;
+    std::vector<unsigned char> vchSecret;
+
+    CMintPoolEntry()
+    {
+        denom = libzerocoin::ZQ_ERROR;
+        bnPubcoin = 0;
+        fCrypted = false;
+    }
+
+    uint256 GetHash() const;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion)
+    {
+        if (!(nType & SER_GETHASH))
+            READWRITE(nVersion);
+        READWRITE(denom);
+        READWRITE(bnPubcoin);
+        READWRITE(fCrypted);
+        READWRITE(vchSecret);
+    }
+};
+
 /** Address book data */
 class CAddressBookData
 {
@@ -207,6 +244,12 @@ public:
     std::string ResetSpentZerocoin();
     void ReconsiderZerocoins(std::list<CZerocoinMint>& listMintsRestored);
     void ZPivBackupWallet();
+    bool UpdateZerocoinWitnesses(int nMaxBlocks);
+    void LoadMintPoolEntry(const CMintPoolEntry& entry);
+    bool AddToMintPool(const libzerocoin::PrivateCoin& coin);
+    bool TakeFromMintPool(libzerocoin::CoinDenomination denom, libzerocoin::PrivateCoin& coin);
+    libzerocoin::CoinDenomination GetMintPoolDenominationToFill(unsigned int nTarget) const;
+    bool EncryptMintPool(const CKeyingMaterial& vMasterKeyIn);
 
     /** Zerocin entry changed.
     * @note called with lock cs_wallet held.
@@ -226,6 +269,14 @@ public:
     std::string strWalletFile;
     bool fBackupMints;
 
+    //! last block added to the tracked zerocoin witnesses
+    uint256 hashWitnessesUpdated;
+    //! set when the tip changed, cleared by ThreadZerocoinWitnesses
+    bool fWitnessesDirty;
+
+    //! pre-generated mints per denomination, drawn from by CreateZerocoinMintTransaction
+    std::map<libzerocoin::CoinDenomination, std::list<CMintPoolEntry> > mapMintPool;
+
     std::set<int64_t> setKeyPool;
     std::map<CKeyID, CKeyMetadata> mapKeyMetadata;
 
@@ -283,6 +334,8 @@ public:
         nTimeFirstKey = 0;
         fWalletUnlockAnonymizeOnly = false;
         fBackupMints = false;
+        hashWitnessesUpdated = 0;
+        fWitnessesDirty = true;
 
         // Stake Settings
         nHashDrift = 45;
@@ -437,6 +490,7 @@ public:
     void MarkDirty();
     bool AddToWallet(const CWalletTx& wtxIn, bool fFromLoadWallet = false);
     void SyncTransaction(const CTransaction& tx, const CBlock* pblock);
+    void UpdatedBlockTip(const CBlockIndex* pindex);
     bool AddToWalletIfInvolvingMe(const CTransaction& tx, const CBlock* pblock, bool fUpdate);
     void EraseFromWallet(const uint256& hash);
     int ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate = false);
@@ -640,6 +694,12 @@ public:
 };
 
 
+/** Keeps the wallet's mint pool filled with nTarget pre-generated mints of each denomination, on one core at the lowest priority */
+void ThreadMintPool(CWallet* pwallet, unsigned int nTarget);
+
+/** Advances the tracked zerocoin witnesses after the tip changed, WITNESS_UPDATE_SLICE_BLOCKS blocks per lock */
+void ThreadZerocoinWitnesses(CWallet* pwallet);
+
 /** A key allocated from the key pool. */
 class CReserveKey
 {
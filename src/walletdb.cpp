@@ -7,6 +7,7 @@
 
 #include "walletdb.h"
 
+#include "accumulators.h"
 #include "base58.h"
 #include "protocol.h"
 #include "serialize.h"
@@ -604,6 +605,12 @@ bool ReadKeyValue(CWallet* pwallet, CDataStream& ssKey, CDataStream& ssValue, CW
             CKeyID keyid = keypool.vchPubKey.GetID();
             if (pwallet->mapKeyMetadata.count(keyid) == 0)
                 pwallet->mapKeyMetadata[keyid] = CKeyMetadata(keypool.nTime);
+        } else if (strType == "zcmintpool") {
+            uint256 hash;
+            ssKey >> hash;
+            CMintPoolEntry entry;
+            ssValue >> entry;
+            pwallet->LoadMintPoolEntry(entry);
         } else if (strType == "version") {
             ssValue >> wss.nFileVersion;
             if (wss.nFileVersion == 10300)
@@ -1041,6 +1048,45 @@ bool CWalletDB::ReadZerocoinSpendSerialEntry(const CBigNum& bnSerial)
     return Read(make_pair(string("zcserial"), bnSerial), spend);
 }
 
+bool CWalletDB::WriteZerocoinWitness(const CWitnessData& witnessData)
+{
+    CDataStream ss(SER_GETHASH, 0);
+    ss << witnessData.bnPubcoin;
+    uint256 hash = Hash(ss.begin(), ss.end());
+
+    return Write(make_pair(string("zcwitness"), hash), witnessData, true);
+}
+
+bool CWalletDB::ReadZerocoinWitness(const CBigNum& bnPubcoin, CWitnessData& witnessData)
+{
+    CDataStream ss(SER_GETHASH, 0);
+    ss << bnPubcoin;
+    uint256 hash = Hash(ss.begin(), ss.end());
+
+    return Read(make_pair(string("zcwitness"), hash), witnessData);
+}
+
+bool CWalletDB::EraseZerocoinWitness(const CBigNum& bnPubcoin)
+{
+    CDataStream ss(SER_GETHASH, 0);
+    ss << bnPubcoin;
+    uint256 hash = Hash(ss.begin(), ss.end());
+
+    return Erase(make_pair(string("zcwitness"), hash));
+}
+
+bool CWalletDB::WriteMintPoolEntry(const CMintPoolEntry& entry)
+{
+    nWalletDBUpdated++;
+    return Write(make_pair(string("zcmintpool"), entry.GetHash()), entry, true);
+}
+
+bool CWalletDB::EraseMintPoolEntry(const CMintPoolEntry& entry)
+{
+    nWalletDBUpdated++;
+    return Erase(make_pair(string("zcmintpool"), entry.GetHash()));
+}
+
 bool CWalletDB::WriteZerocoinMint(const CZerocoinMint& zerocoinMint)
 {
     CDataStream ss(SER_GETHASH, 0);
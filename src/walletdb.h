@@ -29,6 +29,8 @@ class CMasterKey;
 class CScript;
 class CWallet;
 class CWalletTx;
+class CWitnessData;
+class CMintPoolEntry;
 class CZerocoinMint;
 class CZerocoinSpend;
 class uint160;
@@ -161,6 +163,11 @@ public:
     bool WriteZerocoinSpendSerialEntry(const CZerocoinSpend& zerocoinSpend);
     bool EraseZerocoinSpendSerialEntry(const CBigNum& serialEntry);
     bool ReadZerocoinSpendSerialEntry(const CBigNum& bnSerial);
+    bool WriteZerocoinWitness(const CWitnessData& witnessData);
+    bool ReadZerocoinWitness(const CBigNum& bnPubcoin, CWitnessData& witnessData);
+    bool EraseZerocoinWitness(const CBigNum& bnPubcoin);
+    bool WriteMintPoolEntry(const CMintPoolEntry& entry);
+    bool EraseMintPoolEntry(const CMintPoolEntry& entry);
 
 private:
     CWalletDB(const CWalletDB&);
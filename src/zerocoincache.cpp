@@ -0,0 +1,147 @@
+// Copyright (c) 2017 The PIVX developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "zerocoincache.h"
+
+#include "hash.h"
+#include "random.h"
+#include "uint256.h"
+#include "util.h"
+#include "version.h"
+
+#include <atomic>
+#include <set>
+#include <string>
+
+#include <boost/thread.hpp>
+
+namespace {
+
+/**
+ * A bounded set of zerocoin objects that already passed an expensive check,
+ * keyed by (hash, 32 bit tag). Entries are evicted at random once the limit
+ * set by strArg is reached, same as the signature cache does.
+ */
+class CZerocoinVerifiedCache
+{
+private:
+    typedef std::pair<uint256, uint32_t> entry_type;
+    std::set<entry_type> setValid;
+    boost::shared_mutex cs_cache;
+    std::atomic<uint64_t> nHits;
+    std::atomic<uint64_t> nMisses;
+    const std::string strArg;
+    const int64_t nDefaultMaxSize;
+
+public:
+    CZerocoinVerifiedCache(const std::string& strArgIn, int64_t nDefaultMaxSizeIn) : nHits(0), nMisses(0), strArg(strArgIn), nDefaultMaxSize(nDefaultMaxSizeIn) {}
+
+    bool Get(const entry_type& k)
+    {
+        bool fFound;
+        {
+            boost::shared_lock<boost::shared_mutex> lock(cs_cache);
+            fFound = setValid.count(k) > 0;
+        }
+
+        if (fFound)
+            nHits++;
+        else
+            nMisses++;
+        return fFound;
+    }
+
+    void Set(const entry_type& k)
+    {
+        int64_t nMaxCacheSize = GetArg(strArg, nDefaultMaxSize);
+        if (nMaxCacheSize <= 0) return;
+
+        boost::unique_lock<boost::shared_mutex> lock(cs_cache);
+
+        while (static_cast<int64_t>(setValid.size()) >= nMaxCacheSize) {
+            std::set<entry_type>::iterator it = setValid.lower_bound(entry_type(GetRandHash(), 0));
+            if (it == setValid.end())
+                it = setValid.begin();
+            setValid.erase(it);
+        }
+
+        setValid.insert(k);
+    }
+
+    CZerocoinCacheStats GetStats()
+    {
+        CZerocoinCacheStats stats;
+        {
+            boost::shared_lock<boost::shared_mutex> lock(cs_cache);
+            stats.nEntries = setValid.size();
+        }
+        stats.nMaxEntries = std::max<int64_t>(0, GetArg(strArg, nDefaultMaxSize));
+        stats.nHits = nHits;
+        stats.nMisses = nMisses;
+        return stats;
+    }
+};
+
+/**
+ * Valid zerocoin spend cache, to avoid verifying the spend proofs twice for
+ * every zerocoin spend (once when accepted into memory pool, and again when
+ * accepted into the block chain). Keyed by (hash of the serialized spend, accumulator checksum).
+ */
+CZerocoinVerifiedCache spendCache("-maxzerocoinspendcache", DEFAULT_MAX_ZEROCOINSPEND_CACHE);
+
+/**
+ * Valid pubcoin cache, a mint is checked in the memory pool, in the block and again by the
+ * wallet and the accumulators. Keyed by (hash of the pubcoin value, denomination).
+ */
+CZerocoinVerifiedCache pubcoinCache("-maxpubcoincache", DEFAULT_MAX_PUBCOIN_CACHE);
+
+std::pair<uint256, uint32_t> GetSpendKey(const libzerocoin::CoinSpend& spend)
+{
+    CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
+    ss << spend;
+    return std::make_pair(ss.GetHash(), spend.getAccumulatorChecksum());
+}
+
+std::pair<uint256, uint32_t> GetPubcoinKey(const libzerocoin::PublicCoin& pubcoin)
+{
+    CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
+    ss << pubcoin.getValue();
+    return std::make_pair(ss.GetHash(), (uint32_t)pubcoin.getDenomination());
+}
+
+
+}
+
+bool IsZerocoinSpendVerified(const libzerocoin::CoinSpend& spend)
+{
+    return spendCache.Get(GetSpendKey(spend));
+}
+
+void SetZerocoinSpendVerified(const libzerocoin::CoinSpend& spend)
+{
+    spendCache.Set(GetSpendKey(spend));
+}
+
+CZerocoinCacheStats GetZerocoinSpendCacheStats()
+{
+    return spendCache.GetStats();
+}
+
+bool ValidatePubcoin(const libzerocoin::PublicCoin& pubcoin)
+{
+    std::pair<uint256, uint32_t> k = GetPubcoinKey(pubcoin);
+    if (pubcoinCache.Get(k))
+        return true;
+
+    if (!pubcoin.validate())
+        return false;
+
+    pubcoinCache.Set(k);
+    return true;
+}
+
+CZerocoinCacheStats GetPubcoinCacheStats()
+{
+    return pubcoinCache.GetStats();
+}
@@ -0,0 +1,38 @@
+// Copyright (c) 2017 The PIVX developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+#ifndef PIVX_ZEROCOINCACHE_H
+#define PIVX_ZEROCOINCACHE_H
+
+#include "libzerocoin/Coin.h"
+#include "libzerocoin/CoinSpend.h"
+
+#include <stdint.h>
+
+/** Default for -maxzerocoinspendcache, the number of verified spends that are remembered */
+static const int64_t DEFAULT_MAX_ZEROCOINSPEND_CACHE = 20000;
+/** Default for -maxpubcoincache, the number of validated pubcoins that are remembered */
+static const int64_t DEFAULT_MAX_PUBCOIN_CACHE = 50000;
+
+/** Usage statistics of a zerocoin verification cache */
+struct CZerocoinCacheStats
+{
+    uint64_t nEntries;
+    uint64_t nMaxEntries;
+    uint64_t nHits;
+    uint64_t nMisses;
+
+    CZerocoinCacheStats() : nEntries(0), nMaxEntries(0), nHits(0), nMisses(0) {}
+};
+
+/** Check whether the proofs of this spend were already verified against the accumulator it references */
+bool IsZerocoinSpendVerified(const libzerocoin::CoinSpend& spend);
+/** Remember that the proofs of this spend verified against the accumulator it references */
+void SetZerocoinSpendVerified(const libzerocoin::CoinSpend& spend);
+CZerocoinCacheStats GetZerocoinSpendCacheStats();
+
+/** PublicCoin::validate(), skipped for pubcoins that already passed it */
+bool ValidatePubcoin(const libzerocoin::PublicCoin& pubcoin);
+CZerocoinCacheStats GetPubcoinCacheStats();
+
+#endif //PIVX_ZEROCOINCACHE_H